@@ -140,7 +140,9 @@ static css_select_handler select_handler = {
 	node_is_lang,
 	node_presentational_hint,
 	ua_default_for_property,
-	compute_font_size
+	compute_font_size,
+	NULL,			/* node_state; unused in version 1 */
+	NULL			/* node_attribute_names; unused in version 1 */
 };
 
 
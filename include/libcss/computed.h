@@ -94,308 +94,321 @@ css_error css_computed_style_compose(const css_computed_style *parent,
 /******************************************************************************
  * Property accessors below here                                              *
  ******************************************************************************/
+
+/* Clients which define CSS_COMPUTED_INLINE before including this header have
+ * the accessors defined inline, rather than calling the library's exported
+ * definitions. */
+#ifdef CSS_COMPUTED_INLINE
+#define CSS_COMPUTED_ACCESSOR static inline
+#else
+#define CSS_COMPUTED_ACCESSOR
+#endif
   
-uint8_t css_computed_letter_spacing(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_letter_spacing(
 		const css_computed_style *style, 
 		css_fixed *length, css_unit *unit);
 
-uint8_t css_computed_outline_color(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_outline_color(
 		const css_computed_style *style, css_color *color);
   
-uint8_t css_computed_outline_width(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_outline_width(
 		const css_computed_style *style, 
 		css_fixed *length, css_unit *unit);
   
-uint8_t css_computed_border_spacing(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_border_spacing(
 		const css_computed_style *style, 
 		css_fixed *hlength, css_unit *hunit,
 		css_fixed *vlength, css_unit *vunit);
   
-uint8_t css_computed_word_spacing(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_word_spacing(
 		const css_computed_style *style, 
 		css_fixed *length, css_unit *unit);
   
-uint8_t css_computed_counter_increment(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_counter_increment(
 		const css_computed_style *style, 
 		const css_computed_counter **counters);
   
-uint8_t css_computed_counter_reset(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_counter_reset(
 		const css_computed_style *style, 
 		const css_computed_counter **counters);
   
-uint8_t css_computed_cursor(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_cursor(
 		const css_computed_style *style, 
 		lwc_string ***urls);
 
-uint8_t css_computed_clip(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_clip(
 		const css_computed_style *style, 
 		css_computed_clip_rect *rect);
   
-uint8_t css_computed_content(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_content(
 		const css_computed_style *style, 
 		const css_computed_content_item **content);
   
-uint8_t css_computed_vertical_align(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_vertical_align(
 		const css_computed_style *style, 
 		css_fixed *length, css_unit *unit);
   
-uint8_t css_computed_font_size(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_font_size(
 		const css_computed_style *style, 
 		css_fixed *length, css_unit *unit);
   
-uint8_t css_computed_border_top_width(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_border_top_width(
 		const css_computed_style *style, 
 		css_fixed *length, css_unit *unit);
   
-uint8_t css_computed_border_right_width(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_border_right_width(
 		const css_computed_style *style, 
 		css_fixed *length, css_unit *unit);
   
-uint8_t css_computed_border_bottom_width(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_border_bottom_width(
 		const css_computed_style *style, 
 		css_fixed *length, css_unit *unit);
   
-uint8_t css_computed_border_left_width(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_border_left_width(
 		const css_computed_style *style, 
 		css_fixed *length, css_unit *unit);
   
-uint8_t css_computed_background_image(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_background_image(
 		const css_computed_style *style, 
 		lwc_string **url);
   
-uint8_t css_computed_color(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_color(
 		const css_computed_style *style, 
 		css_color *color);
   
-uint8_t css_computed_list_style_image(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_list_style_image(
 		const css_computed_style *style, 
 		lwc_string **url);
   
-uint8_t css_computed_quotes(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_quotes(
 		const css_computed_style *style, 
 		lwc_string ***quotes);
   
-uint8_t css_computed_top(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_top(
 		const css_computed_style *style, 
 		css_fixed *length, css_unit *unit);
   
-uint8_t css_computed_right(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_right(
 		const css_computed_style *style, 
 		css_fixed *length, css_unit *unit);
   
-uint8_t css_computed_bottom(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_bottom(
 		const css_computed_style *style, 
 		css_fixed *length, css_unit *unit);
   
-uint8_t css_computed_left(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_left(
 		const css_computed_style *style, 
 		css_fixed *length, css_unit *unit);
   
-uint8_t css_computed_border_top_color(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_border_top_color(
 		const css_computed_style *style, 
 		css_color *color);
   
-uint8_t css_computed_border_right_color(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_border_right_color(
 		const css_computed_style *style, 
 		css_color *color);
   
-uint8_t css_computed_border_bottom_color(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_border_bottom_color(
 		const css_computed_style *style, 
 		css_color *color);
   
-uint8_t css_computed_border_left_color(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_border_left_color(
 		const css_computed_style *style, 
 		css_color *color);
   
-uint8_t css_computed_height(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_height(
 		const css_computed_style *style, 
 		css_fixed *length, css_unit *unit);
   
-uint8_t css_computed_line_height(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_line_height(
 		const css_computed_style *style, 
 		css_fixed *length, css_unit *unit);
   
-uint8_t css_computed_background_color(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_background_color(
 		const css_computed_style *style, 
 		css_color *color);
   
-uint8_t css_computed_z_index(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_z_index(
 		const css_computed_style *style, 
 		int32_t *z_index);
   
-uint8_t css_computed_margin_top(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_margin_top(
 		const css_computed_style *style, 
 		css_fixed *length, css_unit *unit);
   
-uint8_t css_computed_margin_right(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_margin_right(
 		const css_computed_style *style, 
 		css_fixed *length, css_unit *unit);
   
-uint8_t css_computed_margin_bottom(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_margin_bottom(
 		const css_computed_style *style, 
 		css_fixed *length, css_unit *unit);
   
-uint8_t css_computed_margin_left(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_margin_left(
 		const css_computed_style *style, 
 		css_fixed *length, css_unit *unit);
   
-uint8_t css_computed_background_attachment(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_background_attachment(
 		const css_computed_style *style);
   
-uint8_t css_computed_border_collapse(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_border_collapse(
 		const css_computed_style *style);
   
-uint8_t css_computed_caption_side(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_caption_side(
 		const css_computed_style *style);
   
-uint8_t css_computed_direction(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_direction(
 		const css_computed_style *style);
   
-uint8_t css_computed_max_height(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_max_height(
 		const css_computed_style *style, 
 		css_fixed *length, css_unit *unit);
   
-uint8_t css_computed_max_width(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_max_width(
 		const css_computed_style *style, 
 		css_fixed *length, css_unit *unit);
   
-uint8_t css_computed_width(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_width(
 		const css_computed_style *style, 
 		css_fixed *length, css_unit *unit);
   
-uint8_t css_computed_empty_cells(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_empty_cells(
 		const css_computed_style *style);
   
-uint8_t css_computed_float(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_float(
 		const css_computed_style *style);
   
-uint8_t css_computed_font_style(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_font_style(
 		const css_computed_style *style);
   
-uint8_t css_computed_min_height(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_min_height(
 		const css_computed_style *style, 
 		css_fixed *length, css_unit *unit);
   
-uint8_t css_computed_min_width(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_min_width(
 		const css_computed_style *style, 
 		css_fixed *length, css_unit *unit);
   
-uint8_t css_computed_background_repeat(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_background_repeat(
 		const css_computed_style *style);
   
-uint8_t css_computed_clear(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_clear(
 		const css_computed_style *style);
   
-uint8_t css_computed_padding_top(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_padding_top(
 		const css_computed_style *style, 
 		css_fixed *length, css_unit *unit);
   
-uint8_t css_computed_padding_right(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_padding_right(
 		const css_computed_style *style, 
 		css_fixed *length, css_unit *unit);
   
-uint8_t css_computed_padding_bottom(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_padding_bottom(
 		const css_computed_style *style, 
 		css_fixed *length, css_unit *unit);
   
-uint8_t css_computed_padding_left(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_padding_left(
 		const css_computed_style *style, 
 		css_fixed *length, css_unit *unit);
   
-uint8_t css_computed_overflow(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_overflow(
 		const css_computed_style *style);
   
-uint8_t css_computed_position(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_position(
 		const css_computed_style *style);
   
-uint8_t css_computed_opacity(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_opacity(
 		const css_computed_style *style, 
 		css_fixed *opacity);
   
-uint8_t css_computed_text_transform(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_text_transform(
 		const css_computed_style *style);
   
-uint8_t css_computed_text_indent(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_text_indent(
 		const css_computed_style *style, 
 		css_fixed *length, css_unit *unit);
   
-uint8_t css_computed_white_space(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_white_space(
 		const css_computed_style *style);
   
-uint8_t css_computed_background_position(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_background_position(
 		const css_computed_style *style, 
 		css_fixed *hlength, css_unit *hunit,
 		css_fixed *vlength, css_unit *vunit);
   
-uint8_t css_computed_display(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_display(
 		const css_computed_style *style, bool root);
   
-uint8_t css_computed_display_static(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_display_static(
 		const css_computed_style *style);
   
-uint8_t css_computed_font_variant(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_font_variant(
 		const css_computed_style *style);
   
-uint8_t css_computed_text_decoration(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_text_decoration(
 		const css_computed_style *style);
   
-uint8_t css_computed_font_family(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_font_family(
 		const css_computed_style *style, 
 		lwc_string ***names);
   
-uint8_t css_computed_border_top_style(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_border_top_style(
 		const css_computed_style *style);
   
-uint8_t css_computed_border_right_style(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_border_right_style(
 		const css_computed_style *style);
   
-uint8_t css_computed_border_bottom_style(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_border_bottom_style(
 		const css_computed_style *style);
   
-uint8_t css_computed_border_left_style(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_border_left_style(
 		const css_computed_style *style);
   
-uint8_t css_computed_font_weight(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_font_weight(
 		const css_computed_style *style);
   
-uint8_t css_computed_list_style_type(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_list_style_type(
 		const css_computed_style *style);
   
-uint8_t css_computed_outline_style(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_outline_style(
 		const css_computed_style *style);
   
-uint8_t css_computed_table_layout(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_table_layout(
 		const css_computed_style *style);
   
-uint8_t css_computed_unicode_bidi(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_unicode_bidi(
 		const css_computed_style *style);
   
-uint8_t css_computed_visibility(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_visibility(
 		const css_computed_style *style);
   
-uint8_t css_computed_list_style_position(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_list_style_position(
 		const css_computed_style *style);
   
-uint8_t css_computed_text_align(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_text_align(
 		const css_computed_style *style);
 
-uint8_t css_computed_page_break_after(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_page_break_after(
 		const css_computed_style *style);
 
-uint8_t css_computed_page_break_before(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_page_break_before(
 		const css_computed_style *style);
 
-uint8_t css_computed_page_break_inside(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_page_break_inside(
 		const css_computed_style *style);
 
-uint8_t css_computed_orphans(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_orphans(
 		const css_computed_style *style, 
 		int32_t *orphans);
 
-uint8_t css_computed_widows(
+CSS_COMPUTED_ACCESSOR uint8_t css_computed_widows(
 		const css_computed_style *style, 
 		int32_t *widows);
 
+#ifdef CSS_COMPUTED_INLINE
+#include <libcss/computed_inline.h>
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -29,6 +29,14 @@ typedef enum css_pseudo_element {
 	CSS_PSEUDO_ELEMENT_COUNT	= 5	/**< Number of pseudo elements */
 } css_pseudo_element;
 
+/**
+ * Mask of a pseudo element, for css_select_style_masked()
+ */
+#define CSS_PSEUDO_ELEMENT_MASK(pseudo) (1u << (pseudo))
+/** Mask of every pseudo element */
+#define CSS_PSEUDO_ELEMENT_MASK_ALL \
+		((1u << CSS_PSEUDO_ELEMENT_COUNT) - 1)
+
 /**
  * Style selection result set
  */
@@ -47,15 +55,41 @@ typedef struct css_select_results {
 } css_select_results;
 
 typedef enum css_select_handler_version {
-	CSS_SELECT_HANDLER_VERSION_1 = 1
+	CSS_SELECT_HANDLER_VERSION_1 = 1,
+	CSS_SELECT_HANDLER_VERSION_2 = 2
 } css_select_handler_version;
 
+/**
+ * Node state, as reported by the node_state handler
+ */
+typedef enum css_node_state_flags {
+	CSS_NODE_STATE_ROOT     = (1 << 0),
+	CSS_NODE_STATE_EMPTY    = (1 << 1),
+	CSS_NODE_STATE_LINK     = (1 << 2),
+	CSS_NODE_STATE_VISITED  = (1 << 3),
+	CSS_NODE_STATE_HOVER    = (1 << 4),
+	CSS_NODE_STATE_ACTIVE   = (1 << 5),
+	CSS_NODE_STATE_FOCUS    = (1 << 6),
+	CSS_NODE_STATE_ENABLED  = (1 << 7),
+	CSS_NODE_STATE_DISABLED = (1 << 8),
+	CSS_NODE_STATE_CHECKED  = (1 << 9),
+	CSS_NODE_STATE_TARGET   = (1 << 10)
+} css_node_state_flags;
+
 typedef struct css_select_handler {
 	/** ABI version of this structure */
 	uint32_t handler_version;
 
 	css_error (*node_name)(void *pw, void *node,
 			css_qname *qname);
+	/**
+	 * In version 1, the class array is allocated using the selection
+	 * context's allocator, and LibCSS takes ownership of both it and
+	 * a reference to each class. From version 2, both remain owned by
+	 * the client, and must remain valid until selection returns. A
+	 * frozen selection context takes no references to the strings
+	 * returned by the handler; see css_select_ctx_freeze().
+	 */
 	css_error (*node_classes)(void *pw, void *node,
 			lwc_string ***classes,
 			uint32_t *n_classes);
@@ -101,6 +135,14 @@ typedef struct css_select_handler {
 			const css_qname *qname, lwc_string *value,
 			bool *match);
 
+	/**
+	 * In version 1, the state of a node is obtained by calling
+	 * node_is_root, node_is_empty, node_is_link, node_is_visited,
+	 * node_is_hover, node_is_active, node_is_focus, node_is_enabled,
+	 * node_is_disabled, node_is_checked and node_is_target as each
+	 * is needed. From version 2, these may be NULL, as node_state is
+	 * called instead.
+	 */
 	css_error (*node_is_root)(void *pw, void *node, bool *match);
 	css_error (*node_count_siblings)(void *pw, void *node,
 			bool same_name, bool after, int32_t *count);
@@ -128,8 +170,51 @@ typedef struct css_select_handler {
 
 	css_error (*compute_font_size)(void *pw, const css_hint *parent,
 			css_hint *size);
+
+	/**
+	 * From version 2. Obtains the state of a node, as a mask of
+	 * css_node_state_flags. The result is cached, so it is normally
+	 * called only once for each node considered during a selection.
+	 */
+	css_error (*node_state)(void *pw, void *node, uint32_t *flags);
+
+	/**
+	 * From version 2, and optional. Obtains the names of a node's
+	 * attributes, each given once regardless of case, so that selectors
+	 * keyed by the name of an attribute the node lacks need not be
+	 * tried. The array and names remain owned by the client, and must
+	 * remain valid until selection returns. If NULL, all such selectors
+	 * are tried.
+	 */
+	css_error (*node_attribute_names)(void *pw, void *node,
+			lwc_string ***names, uint32_t *n_names);
 } css_select_handler;
 
+typedef enum css_select_visitor_version {
+	CSS_SELECT_VISITOR_VERSION_1 = 1
+} css_select_visitor_version;
+
+/**
+ * Subtree selection visitor
+ *
+ * The child and sibling functions must only return element nodes.
+ */
+typedef struct css_select_visitor {
+	/** ABI version of this structure */
+	uint32_t visitor_version;
+
+	css_error (*first_child)(void *pw, void *node, void **child);
+	css_error (*next_sibling)(void *pw, void *node, void **sibling);
+
+	css_error (*node_inline_style)(void *pw, void *node,
+			const css_stylesheet **inline_style);
+	css_error (*parent_style)(void *pw, void *node,
+			const css_computed_style **style);
+
+	css_error (*visit)(void *pw, void *node, 
+			css_select_results *results);
+} css_select_visitor;
+
 /**
  * Font face selection result set
  */
@@ -144,6 +229,45 @@ typedef struct css_select_font_faces_results {
 	uint32_t n_font_faces;
 } css_select_font_faces_results;
 
+/**
+ * Kind of change made to a document node
+ */
+typedef enum css_select_change_type {
+	CSS_SELECT_CHANGE_CLASS     = 0,	/**< Class added or removed */
+	CSS_SELECT_CHANGE_ID        = 1,	/**< ID set or removed */
+	CSS_SELECT_CHANGE_ATTRIBUTE = 2,	/**< Attribute set or removed */
+	CSS_SELECT_CHANGE_STATE     = 3		/**< Node state changed */
+} css_select_change_type;
+
+/**
+ * Change made to a document node
+ */
+typedef struct css_select_change {
+	css_select_change_type type;
+
+	/** Class, ID or attribute name, for changes of those */
+	lwc_string *name;
+	/** Mask of css_node_state_flags which changed, for state changes */
+	uint32_t state;
+} css_select_change;
+
+/**
+ * Nodes whose styles may be affected by a change to a node
+ *
+ * Each scope includes the nodes of those before it.
+ */
+typedef enum css_select_invalidation {
+	/** No node's style is affected */
+	CSS_SELECT_INVALIDATE_NONE        = 0,
+	/** The node's style may be affected */
+	CSS_SELECT_INVALIDATE_SELF        = 1,
+	/** The styles of the node and its descendants may be affected */
+	CSS_SELECT_INVALIDATE_DESCENDANTS = 2,
+	/** The styles of the node, its following siblings, and the
+	 * descendants of all of them may be affected */
+	CSS_SELECT_INVALIDATE_SIBLINGS    = 3
+} css_select_invalidation;
+
 css_error css_select_ctx_create(css_allocator_fn alloc, void *pw,
 		css_select_ctx **result);
 css_error css_select_ctx_destroy(css_select_ctx *ctx);
@@ -161,12 +285,43 @@ css_error css_select_ctx_count_sheets(css_select_ctx *ctx, uint32_t *count);
 css_error css_select_ctx_get_sheet(css_select_ctx *ctx, uint32_t index,
 		const css_stylesheet **sheet);
 
+css_error css_select_ctx_freeze(css_select_ctx *ctx);
+css_error css_select_ctx_clone(css_select_ctx *ctx, css_select_ctx **result);
+
+css_error css_select_ctx_invalidation(css_select_ctx *ctx,
+		const css_select_change *change,
+		css_select_invalidation *scope);
+
+css_error css_select_ctx_begin_pass(css_select_ctx *ctx);
+css_error css_select_ctx_end_pass(css_select_ctx *ctx);
+css_error css_select_ctx_set_memo_size(css_select_ctx *ctx, uint32_t size);
+css_error css_select_ctx_set_interning(css_select_ctx *ctx, bool intern);
+css_error css_select_ctx_intern_style(css_select_ctx *ctx,
+		css_computed_style **style);
+
+css_error css_select_bloom_push(css_select_ctx *ctx, void *node,
+		css_select_handler *handler, void *pw);
+css_error css_select_bloom_pop(css_select_ctx *ctx);
+
 css_error css_select_style(css_select_ctx *ctx, void *node,
 		uint64_t media, const css_stylesheet *inline_style,
 		css_select_handler *handler, void *pw,
 		css_select_results **result);
+css_error css_select_style_into(css_select_ctx *ctx, void *node,
+		uint64_t media, const css_stylesheet *inline_style,
+		css_select_handler *handler, void *pw,
+		css_select_results *results);
+css_error css_select_style_masked(css_select_ctx *ctx, void *node,
+		uint64_t media, uint32_t pseudo_mask,
+		const css_stylesheet *inline_style,
+		css_select_handler *handler, void *pw,
+		css_select_results **result);
 css_error css_select_results_destroy(css_select_results *results);    
 
+css_error css_select_subtree(css_select_ctx *ctx, void *root,
+		uint64_t media, css_select_handler *handler, void *pw,
+		css_select_visitor *visitor);
+
 css_error css_select_font_faces(css_select_ctx *ctx,
 		uint64_t media, lwc_string *font_family,
 		css_select_font_faces_results **result);
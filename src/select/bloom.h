@@ -0,0 +1,139 @@
+/*
+ * This file is part of LibCSS
+ * Licensed under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ */
+
+#ifndef css_select_bloom_h_
+#define css_select_bloom_h_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <libwapcaplet/libwapcaplet.h>
+
+/**
+ * Number of counters in an ancestor filter. Must be a power of 2.
+ *
+ * Each hash sets two counters, from its low and high bits respectively.
+ */
+#define CSS_BLOOM_SIZE 4096
+#define CSS_BLOOM_MASK (CSS_BLOOM_SIZE - 1)
+#define CSS_BLOOM_SHIFT 12
+
+/**
+ * Counting Bloom filter of the names, IDs and classes of a node's ancestors
+ *
+ * Counters saturate, rather than wrapping, and are never decremented once
+ * saturated. The filter may therefore produce false positives, but never
+ * false negatives.
+ */
+typedef struct css_bloom {
+	uint8_t counters[CSS_BLOOM_SIZE];
+} css_bloom;
+
+/**
+ * Compute the filter hash of a string
+ *
+ * \param str  String to hash
+ * \return Hash value (never 0)
+ *
+ * The hash ignores case, so that it is suitable for element names and
+ * for any client which compares IDs or classes caselessly.
+ */
+static inline uint32_t css_bloom_hash(lwc_string *str)
+{
+	uint32_t z = 0x811c9dc5;
+	const char *data = lwc_string_data(str);
+	const char *end = data + lwc_string_length(str);
+
+	while (data != end) {
+		const char c = *data++;
+
+		z *= 0x01000193;
+		z ^= c & ~0x20;
+	}
+
+	/* 0 is used to terminate lists of hashes */
+	return z != 0 ? z : 1;
+}
+
+/**
+ * Clear a filter
+ *
+ * \param bloom  Filter to clear
+ */
+static inline void css_bloom_clear(css_bloom *bloom)
+{
+	memset(bloom->counters, 0, sizeof(bloom->counters));
+}
+
+/**
+ * Add a hash to a filter
+ *
+ * \param bloom  Filter to add to
+ * \param hash   Hash to add
+ */
+static inline void css_bloom_add(css_bloom *bloom, uint32_t hash)
+{
+	uint8_t *a = &bloom->counters[hash & CSS_BLOOM_MASK];
+	uint8_t *b = &bloom->counters[(hash >> CSS_BLOOM_SHIFT) &
+			CSS_BLOOM_MASK];
+
+	if (*a != UINT8_MAX)
+		(*a)++;
+	if (*b != UINT8_MAX)
+		(*b)++;
+}
+
+/**
+ * Remove a hash from a filter
+ *
+ * \param bloom  Filter to remove from
+ * \param hash   Hash to remove, which must previously have been added
+ */
+static inline void css_bloom_remove(css_bloom *bloom, uint32_t hash)
+{
+	uint8_t *a = &bloom->counters[hash & CSS_BLOOM_MASK];
+	uint8_t *b = &bloom->counters[(hash >> CSS_BLOOM_SHIFT) &
+			CSS_BLOOM_MASK];
+
+	if (*a != UINT8_MAX)
+		(*a)--;
+	if (*b != UINT8_MAX)
+		(*b)--;
+}
+
+/**
+ * Compute the fingerprint of a hash
+ *
+ * \param hash  Hash to consider
+ * \return Fingerprint, a word with a single bit set
+ *
+ * A set of strings may be fingerprinted by combining theirs, forming a
+ * filter one word long. A set's fingerprint lacking any bit of another's
+ * shows that it lacks one of the other's strings.
+ */
+static inline uint64_t css_bloom_fingerprint(uint32_t hash)
+{
+	return (uint64_t) 1 << (hash >> 26);
+}
+
+/**
+ * Determine whether a filter may contain a hash
+ *
+ * \param bloom  Filter to consider
+ * \param hash   Hash to look for
+ * \return false if the hash is definitely absent, true otherwise
+ */
+static inline bool css_bloom_may_contain(const css_bloom *bloom,
+		uint32_t hash)
+{
+	return bloom->counters[hash & CSS_BLOOM_MASK] != 0 &&
+			bloom->counters[(hash >> CSS_BLOOM_SHIFT) &
+				CSS_BLOOM_MASK] != 0;
+}
+
+#endif
+
@@ -5,14 +5,37 @@
  * Copyright 2009 John-Mark Bell <jmb@netsurf-browser.org>
  */
 
+#include <stddef.h>
 #include <string.h>
 
 #include "select/computed.h"
 #include "select/dispatch.h"
+#include "select/intern.h"
 #include "select/propget.h"
 #include "select/propset.h"
 #include "utils/utils.h"
 
+static void release_contents(css_computed_style *style);
+static void destroy_uncommon(css_computed_style *style,
+		css_computed_uncommon *uncommon);
+static void destroy_inherited(css_computed_style *style,
+		css_computed_inherited *inherited);
+static css_error copy_counters(css_computed_style *style,
+		const css_computed_counter *counters,
+		css_computed_counter **copy);
+static css_error copy_strings(css_computed_style *style,
+		lwc_string **strings, lwc_string ***copy);
+static css_error copy_content(css_computed_style *style,
+		const css_computed_content_item *content,
+		css_computed_content_item **copy);
+static bool blocks_shareable(const css_computed_style *parent,
+		const css_computed_style *result);
+static bool uncommon_shareable(const css_computed_style *parent);
+static void share_page(const css_computed_style *parent,
+		css_computed_style *result);
+static bool font_size_equal(const css_computed_style *style,
+		const css_hint *size);
+
 static css_error compute_absolute_color(css_computed_style *style,
 		uint8_t (*get)(const css_computed_style *style,
 				css_color *color),
@@ -100,6 +123,7 @@ css_error css_computed_style_create(css_allocator_fn alloc, void *pw,
 
 	s->alloc = alloc;
 	s->pw = pw;
+	s->refcount = 1;
 
 	*result = s;
 
@@ -111,114 +135,25 @@ css_error css_computed_style_create(css_allocator_fn alloc, void *pw,
  *
  * \param style  Style to destroy
  * \return CSS_OK on success, appropriate error otherwise
+ *
+ * Styles interned by a selection context may have been handed out several
+ * times. Each destruction releases one reference, and the style is only
+ * destroyed, and removed from the context's table, once none remain.
  */
 css_error css_computed_style_destroy(css_computed_style *style)
 {
 	if (style == NULL)
 		return CSS_BADPARM;
 
-	if (style->uncommon != NULL) {
-		if (style->uncommon->counter_increment != NULL) {
-			css_computed_counter *c;
-
-			for (c = style->uncommon->counter_increment; 
-					c->name != NULL; c++) {
-				lwc_string_unref(c->name);
-			}
-
-			style->alloc(style->uncommon->counter_increment, 0,
-					style->pw);
-		}
-
-		if (style->uncommon->counter_reset != NULL) {
-			css_computed_counter *c;
-
-			for (c = style->uncommon->counter_reset; 
-					c->name != NULL; c++) {
-				lwc_string_unref(c->name);
-			}
-
-			style->alloc(style->uncommon->counter_reset, 0,
-					style->pw);
-		}
-	
-		if (style->uncommon->cursor != NULL) {
-			lwc_string **s;
-
-			for (s = style->uncommon->cursor; *s != NULL; s++) {
-				lwc_string_unref(*s);
-			}
-
-			style->alloc(style->uncommon->cursor, 0, style->pw);
-		}
-
-		if (style->uncommon->content != NULL) {
-			css_computed_content_item *c;
-
-			for (c = style->uncommon->content; 
-					c->type != CSS_COMPUTED_CONTENT_NONE;
-					c++) {
-				switch (c->type) {
-				case CSS_COMPUTED_CONTENT_STRING:
-					lwc_string_unref(c->data.string);
-					break;
-				case CSS_COMPUTED_CONTENT_URI:
-					lwc_string_unref(c->data.uri);
-					break;
-				case CSS_COMPUTED_CONTENT_ATTR:
-					lwc_string_unref(c->data.attr);
-					break;
-				case CSS_COMPUTED_CONTENT_COUNTER:
-					lwc_string_unref(c->data.counter.name);
-					break;
-				case CSS_COMPUTED_CONTENT_COUNTERS:
-					lwc_string_unref(c->data.counters.name);
-					lwc_string_unref(c->data.counters.sep);
-					break;
-				default:
-					break;
-				}
-			}
-
-			style->alloc(style->uncommon->content, 0, style->pw);
-		}
-
-		style->alloc(style->uncommon, 0, style->pw);
-	}
-
-	if (style->page != NULL) {
-		style->alloc(style->page, 0, style->pw);
-	}
-
-	if (style->aural != NULL) {
-		style->alloc(style->aural, 0, style->pw);
-	}
-
-	if (style->font_family != NULL) {
-		lwc_string **s;
-
-		for (s = style->font_family; *s != NULL; s++) {
-			lwc_string_unref(*s);
-		}
-
-		style->alloc(style->font_family, 0, style->pw);
-	}
-
-	if (style->quotes != NULL) {
-		lwc_string **s;
-
-		for (s = style->quotes; *s != NULL; s++) {
-			lwc_string_unref(*s);
-		}
-
-		style->alloc(style->quotes, 0, style->pw);
+	if (style->refcount > 1) {
+		style->refcount--;
+		return CSS_OK;
 	}
 
-	if (style->list_style_image != NULL)
-		lwc_string_unref(style->list_style_image);
+	if (style->intern != NULL)
+		css__style_intern_remove(style->intern, style);
 
-	if (style->background_image != NULL)
-		lwc_string_unref(style->background_image);
+	release_contents(style);
 
 	style->alloc(style, 0, style->pw);
 
@@ -226,2056 +161,687 @@ css_error css_computed_style_destroy(css_computed_style *style)
 }
 
 /**
- * Populate a blank computed style with Initial values
+ * Return a computed style to the state of a newly created one, or a template
  *
- * \param style    Computed style to populate
- * \param handler  Dispatch table of handler functions
- * \param pw       Client-specific private data for handler functions
- * \return CSS_OK on success.
+ * \param style    Style to reset
+ * \param initial  Template to copy, which owns no data, or NULL
+ * \return CSS_OK on success, appropriate error otherwise
+ *
+ * Any data owned by the style is released, but the style itself is not,
+ * so that it may be reused without allocating another. The style must not
+ * be shared.
  */
-css_error css_computed_style_initialise(css_computed_style *style,
-		css_select_handler *handler, void *pw)
+css_error css__computed_style_reset(css_computed_style *style,
+		const css_computed_style *initial)
 {
-	css_select_state state;
-	uint32_t i;
-	css_error error;
+	css_allocator_fn alloc;
+	void *pw;
 
 	if (style == NULL)
 		return CSS_BADPARM;
 
-	state.node = NULL;
-	state.media = CSS_MEDIA_ALL;
-	state.results = NULL;
-	state.computed = style;
-	state.handler = handler;
-	state.pw = pw;
+	if (css__computed_style_shared(style))
+		return CSS_INVALID;
 
-	for (i = 0; i < CSS_N_PROPERTIES; i++) {
-		/* No need to initialise anything other than the normal
-		 * properties -- the others are handled by the accessors */
-		if (prop_dispatch[i].inherited == false &&
-				prop_dispatch[i].group == GROUP_NORMAL) {
-			error = prop_dispatch[i].initial(&state);
-			if (error != CSS_OK)
-				return error;
-		}
-	}
+	release_contents(style);
+
+	alloc = style->alloc;
+	pw = style->pw;
+
+	if (initial != NULL)
+		memcpy(style, initial, sizeof(css_computed_style));
+	else
+		memset(style, 0, sizeof(css_computed_style));
+
+	style->alloc = alloc;
+	style->pw = pw;
+	style->refcount = 1;
 
 	return CSS_OK;
 }
 
 /**
- * Compose two computed styles
+ * Release the data owned by a computed style
  *
- * \param parent             Parent style
- * \param child              Child style
- * \param compute_font_size  Function to compute an absolute font size
- * \param pw                 Client data for compute_font_size
- * \param result             Pointer to style to compose into
- * \return CSS_OK on success, appropriate error otherwise.
+ * \param style  Style whose data to release
  *
- * \pre \a parent is a fully composed style (thus has no inherited properties)
- *
- * \note \a child and \a result may point at the same object
+ * The style's pointers to the released data are left dangling.
  */
-css_error css_computed_style_compose(const css_computed_style *parent,
-		const css_computed_style *child,
-		css_error (*compute_font_size)(void *pw,
-			const css_hint *parent, css_hint *size),
-		void *pw,
-		css_computed_style *result)
-{
-	css_error error = CSS_OK;
-	size_t i;
-
-	/* Iterate through the properties */
-	for (i = 0; i < CSS_N_PROPERTIES; i++) {
-		/* Skip any in extension blocks if the block does not exist */	
-		if (prop_dispatch[i].group == GROUP_UNCOMMON &&
-				parent->uncommon == NULL && 
-				child->uncommon == NULL)
-			continue;
-
-		if (prop_dispatch[i].group == GROUP_PAGE &&
-				parent->page == NULL && child->page == NULL)
-			continue;
-
-		if (prop_dispatch[i].group == GROUP_AURAL &&
-				parent->aural == NULL && child->aural == NULL)
-			continue;
-
-		/* Compose the property */
-		error = prop_dispatch[i].compose(parent, child, result);
-		if (error != CSS_OK)
-			break;
-	}
-
-	/* Finally, compute absolute values for everything */
-	return css__compute_absolute_values(parent, result, compute_font_size, pw);
-}
-
-/******************************************************************************
- * Property accessors                                                         *
- ******************************************************************************/
-
-
-#define CSS_LETTER_SPACING_INDEX 0
-#define CSS_LETTER_SPACING_SHIFT 2
-#define CSS_LETTER_SPACING_MASK  0xfc
-uint8_t css_computed_letter_spacing(
-		const css_computed_style *style, 
-		css_fixed *length, css_unit *unit)
-{
-	if (style->uncommon != NULL) {
-		uint8_t bits = style->uncommon->bits[CSS_LETTER_SPACING_INDEX];
-		bits &= CSS_LETTER_SPACING_MASK;
-		bits >>= CSS_LETTER_SPACING_SHIFT;
-
-		/* 6bits: uuuutt : unit | type */
-
-		if ((bits & 3) == CSS_LETTER_SPACING_SET) {
-			*length = style->uncommon->letter_spacing;
-			*unit = (css_unit) (bits >> 2);
-		}
-
-		return (bits & 3);
-	}
-
-	return CSS_LETTER_SPACING_NORMAL;
-}
-#undef CSS_LETTER_SPACING_MASK
-#undef CSS_LETTER_SPACING_SHIFT
-#undef CSS_LETTER_SPACING_INDEX
-
-#define CSS_OUTLINE_COLOR_INDEX 0
-#define CSS_OUTLINE_COLOR_SHIFT 0
-#define CSS_OUTLINE_COLOR_MASK  0x3
-uint8_t css_computed_outline_color(
-		const css_computed_style *style, css_color *color)
-{
-	if (style->uncommon != NULL) {
-		uint8_t bits = style->uncommon->bits[CSS_OUTLINE_COLOR_INDEX];
-		bits &= CSS_OUTLINE_COLOR_MASK;
-		bits >>= CSS_OUTLINE_COLOR_SHIFT;
-
-		/* 2bits: tt : type */
-
-		if ((bits & 3) == CSS_OUTLINE_COLOR_COLOR) {
-			*color = style->uncommon->outline_color;
-		}
-
-		return (bits & 3);
-	}
-
-	return CSS_OUTLINE_COLOR_INVERT;
-}
-#undef CSS_OUTLINE_COLOR_MASK
-#undef CSS_OUTLINE_COLOR_SHIFT
-#undef CSS_OUTLINE_COLOR_INDEX
-
-#define CSS_OUTLINE_WIDTH_INDEX 1
-#define CSS_OUTLINE_WIDTH_SHIFT 1
-#define CSS_OUTLINE_WIDTH_MASK  0xfe
-uint8_t css_computed_outline_width(
-		const css_computed_style *style, 
-		css_fixed *length, css_unit *unit)
-{
-	if (style->uncommon != NULL) {
-		uint8_t bits = style->uncommon->bits[CSS_OUTLINE_WIDTH_INDEX];
-		bits &= CSS_OUTLINE_WIDTH_MASK;
-		bits >>= CSS_OUTLINE_WIDTH_SHIFT;
-
-		/* 7bits: uuuuttt : unit | type */
-
-		if ((bits & 7) == CSS_OUTLINE_WIDTH_WIDTH) {
-			*length = style->uncommon->outline_width;
-			*unit = (css_unit) (bits >> 3);
-		}
-
-		return (bits & 7);
-	}
-
-	*length = INTTOFIX(2);
-	*unit = CSS_UNIT_PX;
-
-	return CSS_OUTLINE_WIDTH_WIDTH;
-}
-#undef CSS_OUTLINE_WIDTH_MASK
-#undef CSS_OUTLINE_WIDTH_SHIFT
-#undef CSS_OUTLINE_WIDTH_INDEX
-
-#define CSS_BORDER_SPACING_INDEX 1
-#define CSS_BORDER_SPACING_SHIFT 0
-#define CSS_BORDER_SPACING_MASK  0x1
-#define CSS_BORDER_SPACING_INDEX1 2
-#define CSS_BORDER_SPACING_SHIFT1 0
-#define CSS_BORDER_SPACING_MASK1 0xff
-uint8_t css_computed_border_spacing(
-		const css_computed_style *style, 
-		css_fixed *hlength, css_unit *hunit,
-		css_fixed *vlength, css_unit *vunit)
+void release_contents(css_computed_style *style)
 {
+	/* Extension blocks may be shared with other styles */
 	if (style->uncommon != NULL) {
-		uint8_t bits = style->uncommon->bits[CSS_BORDER_SPACING_INDEX];
-		bits &= CSS_BORDER_SPACING_MASK;
-		bits >>= CSS_BORDER_SPACING_SHIFT;
-
-		/* 1 bit: type */
-		if (bits == CSS_BORDER_SPACING_SET) {
-			uint8_t bits1 = 
-				style->uncommon->bits[CSS_BORDER_SPACING_INDEX1];
-			bits1 &= CSS_BORDER_SPACING_MASK1;
-			bits1 >>= CSS_BORDER_SPACING_SHIFT1;
-
-			/* 8bits: hhhhvvvv : hunit | vunit */
-
-			*hlength = style->uncommon->border_spacing[0];
-			*hunit = (css_unit) (bits1 >> 4);
-
-			*vlength = style->uncommon->border_spacing[1];
-			*vunit = (css_unit) (bits1 & 0xf);
-		}
-
-		return bits;
-	} else {
-		*hlength = *vlength = 0;
-		*hunit = *vunit = CSS_UNIT_PX;
+		if (style->uncommon->refcount > 1)
+			style->uncommon->refcount--;
+		else
+			destroy_uncommon(style, style->uncommon);
 	}
 
-	return CSS_BORDER_SPACING_SET;
-}
-#undef CSS_BORDER_SPACING_MASK1
-#undef CSS_BORDER_SPACING_SHIFT1
-#undef CSS_BORDER_SPACING_INDEX1
-#undef CSS_BORDER_SPACING_MASK
-#undef CSS_BORDER_SPACING_SHIFT
-#undef CSS_BORDER_SPACING_INDEX
-
-#define CSS_WORD_SPACING_INDEX 3
-#define CSS_WORD_SPACING_SHIFT 2
-#define CSS_WORD_SPACING_MASK  0xfc
-uint8_t css_computed_word_spacing(
-		const css_computed_style *style, 
-		css_fixed *length, css_unit *unit)
-{
-	if (style->uncommon != NULL) {
-		uint8_t bits = style->uncommon->bits[CSS_WORD_SPACING_INDEX];
-		bits &= CSS_WORD_SPACING_MASK;
-		bits >>= CSS_WORD_SPACING_SHIFT;
-
-		/* 6bits: uuuutt : unit | type */
-
-		if ((bits & 3) == CSS_WORD_SPACING_SET) {
-			*length = style->uncommon->word_spacing;
-			*unit = (css_unit) (bits >> 2);
-		}
-
-		return (bits & 3);
+	if (style->page != NULL) {
+		if (style->page->refcount > 1)
+			style->page->refcount--;
+		else
+			style->alloc(style->page, 0, style->pw);
 	}
 
-	return CSS_WORD_SPACING_NORMAL;
-}
-#undef CSS_WORD_SPACING_MASK
-#undef CSS_WORD_SPACING_SHIFT
-#undef CSS_WORD_SPACING_INDEX
-
-#define CSS_COUNTER_INCREMENT_INDEX 3
-#define CSS_COUNTER_INCREMENT_SHIFT 1
-#define CSS_COUNTER_INCREMENT_MASK  0x2
-uint8_t css_computed_counter_increment(
-		const css_computed_style *style, 
-		const css_computed_counter **counters)
-{
-	if (style->uncommon != NULL) {
-		uint8_t bits = 
-			style->uncommon->bits[CSS_COUNTER_INCREMENT_INDEX];
-		bits &= CSS_COUNTER_INCREMENT_MASK;
-		bits >>= CSS_COUNTER_INCREMENT_SHIFT;
-
-		/* 1bit: type */
-		*counters = style->uncommon->counter_increment;
-
-		return bits;
+	if (style->inherited != NULL) {
+		if (style->inherited->refcount > 1)
+			style->inherited->refcount--;
+		else
+			destroy_inherited(style, style->inherited);
 	}
 
-	return CSS_COUNTER_INCREMENT_NONE;
-}
-#undef CSS_COUNTER_INCREMENT_MASK
-#undef CSS_COUNTER_INCREMENT_SHIFT
-#undef CSS_COUNTER_INCREMENT_INDEX
-
-#define CSS_COUNTER_RESET_INDEX 3
-#define CSS_COUNTER_RESET_SHIFT 0
-#define CSS_COUNTER_RESET_MASK  0x1
-uint8_t css_computed_counter_reset(
-		const css_computed_style *style, 
-		const css_computed_counter **counters)
-{
-	if (style->uncommon != NULL) {
-		uint8_t bits = style->uncommon->bits[CSS_COUNTER_RESET_INDEX];
-		bits &= CSS_COUNTER_RESET_MASK;
-		bits >>= CSS_COUNTER_RESET_SHIFT;
-
-		/* 1bit: type */
-		*counters = style->uncommon->counter_reset;
-
-		return bits;
+	if (style->aural != NULL) {
+		style->alloc(style->aural, 0, style->pw);
 	}
 
-	return CSS_COUNTER_RESET_NONE;
+	if (style->background_image != NULL)
+		css__computed_string_unref(style, style->background_image);
 }
-#undef CSS_COUNTER_RESET_MASK
-#undef CSS_COUNTER_RESET_SHIFT
-#undef CSS_COUNTER_RESET_INDEX
-
-#define CSS_CURSOR_INDEX 4
-#define CSS_CURSOR_SHIFT 3
-#define CSS_CURSOR_MASK  0xf8
-uint8_t css_computed_cursor(
-		const css_computed_style *style, 
-		lwc_string ***urls)
-{
-	if (style->uncommon != NULL) {
-		uint8_t bits = style->uncommon->bits[CSS_CURSOR_INDEX];
-		bits &= CSS_CURSOR_MASK;
-		bits >>= CSS_CURSOR_SHIFT;
 
-		/* 5bits: type */
-		*urls = style->uncommon->cursor;
-
-		return bits;
-	}
-
-	return CSS_CURSOR_AUTO;
-}
-#undef CSS_CURSOR_MASK
-#undef CSS_CURSOR_SHIFT
-#undef CSS_CURSOR_INDEX
-
-#define CSS_CLIP_INDEX 7
-#define CSS_CLIP_SHIFT 2
-#define CSS_CLIP_MASK  0xfc
-#define CSS_CLIP_INDEX1 5
-#define CSS_CLIP_SHIFT1 0
-#define CSS_CLIP_MASK1 0xff
-#define CSS_CLIP_INDEX2 6
-#define CSS_CLIP_SHIFT2 0
-#define CSS_CLIP_MASK2 0xff
-uint8_t css_computed_clip(
-		const css_computed_style *style, 
-		css_computed_clip_rect *rect)
+/**
+ * Destroy a block of uncommon properties, and the data it owns
+ *
+ * \param style     Style which used the block
+ * \param uncommon  Block to destroy
+ */
+void destroy_uncommon(css_computed_style *style,
+		css_computed_uncommon *uncommon)
 {
-	if (style->uncommon != NULL) {
-		uint8_t bits = style->uncommon->bits[CSS_CLIP_INDEX];
-		bits &= CSS_CLIP_MASK;
-		bits >>= CSS_CLIP_SHIFT;
-
-		/* 6bits: trblyy : top | right | bottom | left | type */
-		if ((bits & 0x3) == CSS_CLIP_RECT) {
-			uint8_t bits1; 
-
-			rect->left_auto = (bits & 0x4);
-			rect->bottom_auto = (bits & 0x8);
-			rect->right_auto = (bits & 0x10);
-			rect->top_auto = (bits & 0x20);
-
-			if (rect->top_auto == false ||
-					rect->right_auto == false) {
-				/* 8bits: ttttrrrr : top | right */
-				bits1 = style->uncommon->bits[CSS_CLIP_INDEX1];
-				bits1 &= CSS_CLIP_MASK1;
-				bits1 >>= CSS_CLIP_SHIFT1;
-			} else {
-				bits1 = 0;
-			}
+	if (uncommon->counter_increment != NULL) {
+		css_computed_counter *c;
 
-			rect->top = style->uncommon->clip[0];
-			rect->tunit = (css_unit) (bits1 >> 4);
-
-			rect->right = style->uncommon->clip[1];
-			rect->runit = (css_unit) (bits1 & 0xf);
-
-			if (rect->bottom_auto == false ||
-					rect->left_auto == false) {
-				/* 8bits: bbbbllll : bottom | left */
-				bits1 = style->uncommon->bits[CSS_CLIP_INDEX2];
-				bits1 &= CSS_CLIP_MASK2;
-				bits1 >>= CSS_CLIP_SHIFT2;
-			} else {
-				bits1 = 0;
-			}
-
-			rect->bottom = style->uncommon->clip[2];
-			rect->bunit = (css_unit) (bits1 >> 4);
-
-			rect->left = style->uncommon->clip[3];
-			rect->lunit = (css_unit) (bits1 & 0xf);
+		for (c = uncommon->counter_increment; c->name != NULL; c++) {
+			css__computed_string_unref(style, c->name);
 		}
 
-		return (bits & 0x3);
-	}
-
-	return CSS_CLIP_AUTO;
-}
-#undef CSS_CLIP_MASK2
-#undef CSS_CLIP_SHIFT2
-#undef CSS_CLIP_INDEX2
-#undef CSS_CLIP_MASK1
-#undef CSS_CLIP_SHIFT1
-#undef CSS_CLIP_INDEX1
-#undef CSS_CLIP_MASK
-#undef CSS_CLIP_SHIFT
-#undef CSS_CLIP_INDEX
-
-#define CSS_CONTENT_INDEX 7
-#define CSS_CONTENT_SHIFT 0
-#define CSS_CONTENT_MASK  0x3
-uint8_t css_computed_content(
-		const css_computed_style *style, 
-		const css_computed_content_item **content)
-{
-	if (style->uncommon != NULL) {
-		uint8_t bits = style->uncommon->bits[CSS_CONTENT_INDEX];
-		bits &= CSS_CONTENT_MASK;
-		bits >>= CSS_CONTENT_SHIFT;
-
-		/* 2bits: type */
-		*content = style->uncommon->content;
-
-		return bits;
-	}
-
-	return CSS_CONTENT_NORMAL;
-}
-#undef CSS_CONTENT_MASK
-#undef CSS_CONTENT_SHIFT
-#undef CSS_CONTENT_INDEX
-
-#define CSS_VERTICAL_ALIGN_INDEX 0
-#define CSS_VERTICAL_ALIGN_SHIFT 0
-#define CSS_VERTICAL_ALIGN_MASK  0xff
-uint8_t css_computed_vertical_align(
-		const css_computed_style *style, 
-		css_fixed *length, css_unit *unit)
-{
-	uint8_t bits = style->bits[CSS_VERTICAL_ALIGN_INDEX];
-	bits &= CSS_VERTICAL_ALIGN_MASK;
-	bits >>= CSS_VERTICAL_ALIGN_SHIFT;
-
-	/* 8bits: uuuutttt : units | type */
-	if ((bits & 0xf) == CSS_VERTICAL_ALIGN_SET) {
-		*length = style->vertical_align;
-		*unit = (css_unit) (bits >> 4);
-	}
-
-	return (bits & 0xf);
-}
-#undef CSS_VERTICAL_ALIGN_MASK
-#undef CSS_VERTICAL_ALIGN_SHIFT
-#undef CSS_VERTICAL_ALIGN_INDEX
-
-#define CSS_FONT_SIZE_INDEX 1
-#define CSS_FONT_SIZE_SHIFT 0
-#define CSS_FONT_SIZE_MASK  0xff
-uint8_t css_computed_font_size(
-		const css_computed_style *style, 
-		css_fixed *length, css_unit *unit)
-{
-	uint8_t bits = style->bits[CSS_FONT_SIZE_INDEX];
-	bits &= CSS_FONT_SIZE_MASK;
-	bits >>= CSS_FONT_SIZE_SHIFT;
-
-	/* 8bits: uuuutttt : units | type */
-	if ((bits & 0xf) == CSS_FONT_SIZE_DIMENSION) {
-		*length = style->font_size;
-		*unit = (css_unit) (bits >> 4);
-	}
-
-	return (bits & 0xf);
-}
-#undef CSS_FONT_SIZE_MASK
-#undef CSS_FONT_SIZE_SHIFT
-#undef CSS_FONT_SIZE_INDEX
-
-#define CSS_BORDER_TOP_WIDTH_INDEX 2
-#define CSS_BORDER_TOP_WIDTH_SHIFT 1
-#define CSS_BORDER_TOP_WIDTH_MASK  0xfe
-uint8_t css_computed_border_top_width(
-		const css_computed_style *style, 
-		css_fixed *length, css_unit *unit)
-{
-	uint8_t bits = style->bits[CSS_BORDER_TOP_WIDTH_INDEX];
-	bits &= CSS_BORDER_TOP_WIDTH_MASK;
-	bits >>= CSS_BORDER_TOP_WIDTH_SHIFT;
-
-	/* 7bits: uuuuttt : units | type */
-	if ((bits & 0x7) == CSS_BORDER_WIDTH_WIDTH) {
-		*length = style->border_width[0];
-		*unit = (css_unit) (bits >> 3);
+		style->alloc(uncommon->counter_increment, 0, style->pw);
 	}
 
-	return (bits & 0x7);
-}
-#undef CSS_BORDER_TOP_WIDTH_MASK
-#undef CSS_BORDER_TOP_WIDTH_SHIFT
-#undef CSS_BORDER_TOP_WIDTH_INDEX
-
-#define CSS_BORDER_RIGHT_WIDTH_INDEX 3
-#define CSS_BORDER_RIGHT_WIDTH_SHIFT 1
-#define CSS_BORDER_RIGHT_WIDTH_MASK  0xfe
-uint8_t css_computed_border_right_width(
-		const css_computed_style *style, 
-		css_fixed *length, css_unit *unit)
-{
-	uint8_t bits = style->bits[CSS_BORDER_RIGHT_WIDTH_INDEX];
-	bits &= CSS_BORDER_RIGHT_WIDTH_MASK;
-	bits >>= CSS_BORDER_RIGHT_WIDTH_SHIFT;
-
-	/* 7bits: uuuuttt : units | type */
-	if ((bits & 0x7) == CSS_BORDER_WIDTH_WIDTH) {
-		*length = style->border_width[1];
-		*unit = (css_unit) (bits >> 3);
-	}
+	if (uncommon->counter_reset != NULL) {
+		css_computed_counter *c;
 
-	return (bits & 0x7);
-}
-#undef CSS_BORDER_RIGHT_WIDTH_MASK
-#undef CSS_BORDER_RIGHT_WIDTH_SHIFT
-#undef CSS_BORDER_RIGHT_WIDTH_INDEX
-
-#define CSS_BORDER_BOTTOM_WIDTH_INDEX 4
-#define CSS_BORDER_BOTTOM_WIDTH_SHIFT 1
-#define CSS_BORDER_BOTTOM_WIDTH_MASK  0xfe
-uint8_t css_computed_border_bottom_width(
-		const css_computed_style *style, 
-		css_fixed *length, css_unit *unit)
-{
-	uint8_t bits = style->bits[CSS_BORDER_BOTTOM_WIDTH_INDEX];
-	bits &= CSS_BORDER_BOTTOM_WIDTH_MASK;
-	bits >>= CSS_BORDER_BOTTOM_WIDTH_SHIFT;
-
-	/* 7bits: uuuuttt : units | type */
-	if ((bits & 0x7) == CSS_BORDER_WIDTH_WIDTH) {
-		*length = style->border_width[2];
-		*unit = (css_unit) (bits >> 3);
-	}
+		for (c = uncommon->counter_reset; c->name != NULL; c++) {
+			css__computed_string_unref(style, c->name);
+		}
 
-	return (bits & 0x7);
-}
-#undef CSS_BORDER_BOTTOM_WIDTH_MASK
-#undef CSS_BORDER_BOTTOM_WIDTH_SHIFT
-#undef CSS_BORDER_BOTTOM_WIDTH_INDEX
-
-#define CSS_BORDER_LEFT_WIDTH_INDEX 5
-#define CSS_BORDER_LEFT_WIDTH_SHIFT 1
-#define CSS_BORDER_LEFT_WIDTH_MASK  0xfe
-uint8_t css_computed_border_left_width(
-		const css_computed_style *style, 
-		css_fixed *length, css_unit *unit)
-{
-	uint8_t bits = style->bits[CSS_BORDER_LEFT_WIDTH_INDEX];
-	bits &= CSS_BORDER_LEFT_WIDTH_MASK;
-	bits >>= CSS_BORDER_LEFT_WIDTH_SHIFT;
-
-	/* 7bits: uuuuttt : units | type */
-	if ((bits & 0x7) == CSS_BORDER_WIDTH_WIDTH) {
-		*length = style->border_width[3];
-		*unit = (css_unit) (bits >> 3);
+		style->alloc(uncommon->counter_reset, 0, style->pw);
 	}
 
-	return (bits & 0x7);
-}
-#undef CSS_BORDER_LEFT_WIDTH_MASK
-#undef CSS_BORDER_LEFT_WIDTH_SHIFT
-#undef CSS_BORDER_LEFT_WIDTH_INDEX
-
-#define CSS_BACKGROUND_IMAGE_INDEX 2
-#define CSS_BACKGROUND_IMAGE_SHIFT 0
-#define CSS_BACKGROUND_IMAGE_MASK  0x1
-uint8_t css_computed_background_image(
-		const css_computed_style *style, 
-		lwc_string **url)
-{
-	uint8_t bits = style->bits[CSS_BACKGROUND_IMAGE_INDEX];
-	bits &= CSS_BACKGROUND_IMAGE_MASK;
-	bits >>= CSS_BACKGROUND_IMAGE_SHIFT;
-
-	/* 1bit: type */
-	*url = style->background_image;
-
-	return bits;
-}
-#undef CSS_BACKGROUND_IMAGE_MASK
-#undef CSS_BACKGROUND_IMAGE_SHIFT
-#undef CSS_BACKGROUND_IMAGE_INDEX
-
-#define CSS_COLOR_INDEX 3
-#define CSS_COLOR_SHIFT 0
-#define CSS_COLOR_MASK  0x1
-uint8_t css_computed_color(
-		const css_computed_style *style, 
-		css_color *color)
-{
-	uint8_t bits = style->bits[CSS_COLOR_INDEX];
-	bits &= CSS_COLOR_MASK;
-	bits >>= CSS_COLOR_SHIFT;
-
-	/* 1bit: type */
-	*color = style->color;
-
-	return bits;
-}
-#undef CSS_COLOR_MASK
-#undef CSS_COLOR_SHIFT
-#undef CSS_COLOR_INDEX
-
-#define CSS_LIST_STYLE_IMAGE_INDEX 4
-#define CSS_LIST_STYLE_IMAGE_SHIFT 0
-#define CSS_LIST_STYLE_IMAGE_MASK  0x1
-uint8_t css_computed_list_style_image(
-		const css_computed_style *style, 
-		lwc_string **url)
-{
-	uint8_t bits = style->bits[CSS_LIST_STYLE_IMAGE_INDEX];
-	bits &= CSS_LIST_STYLE_IMAGE_MASK;
-	bits >>= CSS_LIST_STYLE_IMAGE_SHIFT;
-
-	/* 1bit: type */
-	*url = style->list_style_image;
-
-	return bits;
-}
-#undef CSS_LIST_STYLE_IMAGE_MASK
-#undef CSS_LIST_STYLE_IMAGE_SHIFT
-#undef CSS_LIST_STYLE_IMAGE_INDEX
-
-#define CSS_QUOTES_INDEX 5
-#define CSS_QUOTES_SHIFT 0
-#define CSS_QUOTES_MASK  0x1
-uint8_t css_computed_quotes(
-		const css_computed_style *style, 
-		lwc_string ***quotes)
-{
-	uint8_t bits = style->bits[CSS_QUOTES_INDEX];
-	bits &= CSS_QUOTES_MASK;
-	bits >>= CSS_QUOTES_SHIFT;
-
-	/* 1bit: type */
-	*quotes = style->quotes;
+	if (uncommon->cursor != NULL) {
+		lwc_string **s;
 
-	return bits;
-}
-#undef CSS_QUOTES_MASK
-#undef CSS_QUOTES_SHIFT
-#undef CSS_QUOTES_INDEX
-
-#define CSS_TOP_INDEX 6
-#define CSS_TOP_SHIFT 2
-#define CSS_TOP_MASK  0xfc
-#define CSS_RIGHT_INDEX 7
-#define CSS_RIGHT_SHIFT 2
-#define CSS_RIGHT_MASK  0xfc
-#define CSS_BOTTOM_INDEX 8
-#define CSS_BOTTOM_SHIFT 2
-#define CSS_BOTTOM_MASK  0xfc
-#define CSS_LEFT_INDEX 9
-#define CSS_LEFT_SHIFT 2
-#define CSS_LEFT_MASK  0xfc
-uint8_t css_computed_top(
-		const css_computed_style *style, 
-		css_fixed *length, css_unit *unit)
-{
-	uint8_t bits = style->bits[CSS_TOP_INDEX];
-	bits &= CSS_TOP_MASK;
-	bits >>= CSS_TOP_SHIFT;
-
-	/* Fix up, based on computed position */
-	if (css_computed_position(style) == CSS_POSITION_STATIC) {
-		/* Static -> auto */
-		bits = CSS_TOP_AUTO;
-	} else if (css_computed_position(style) == CSS_POSITION_RELATIVE) {
-		/* Relative -> follow $9.4.3 */
-		uint8_t bottom = style->bits[CSS_BOTTOM_INDEX];
-		bottom &= CSS_BOTTOM_MASK;
-		bottom >>= CSS_BOTTOM_SHIFT;
-
-		if ((bits & 0x3) == CSS_TOP_AUTO && 
-				(bottom & 0x3) == CSS_BOTTOM_AUTO) {
-			/* Both auto => 0px */
-			*length = 0;
-			*unit = CSS_UNIT_PX;
-		} else if ((bits & 0x3) == CSS_TOP_AUTO) {
-			/* Top is auto => -bottom */
-			*length = -style->bottom;
-			*unit = (css_unit) (bottom >> 2);
-		} else {
-			*length = style->top;
-			*unit = (css_unit) (bits >> 2);
+		for (s = uncommon->cursor; *s != NULL; s++) {
+			css__computed_string_unref(style, *s);
 		}
 
-		bits = CSS_TOP_SET;
-	} else if ((bits & 0x3) == CSS_TOP_SET) {
-		*length = style->top;
-		*unit = (css_unit) (bits >> 2);
-	}
-
-	/* 6bits: uuuutt : units | type */
-	return (bits & 0x3);
-}
-
-uint8_t css_computed_right(
-		const css_computed_style *style, 
-		css_fixed *length, css_unit *unit)
-{
-	uint8_t bits = style->bits[CSS_RIGHT_INDEX];
-	bits &= CSS_RIGHT_MASK;
-	bits >>= CSS_RIGHT_SHIFT;
-
-	/* Fix up, based on computed position */
-	if (css_computed_position(style) == CSS_POSITION_STATIC) {
-		/* Static -> auto */
-		bits = CSS_RIGHT_AUTO;
-	} else if (css_computed_position(style) == CSS_POSITION_RELATIVE) {
-		/* Relative -> follow $9.4.3 */
-		uint8_t left = style->bits[CSS_LEFT_INDEX];
-		left &= CSS_LEFT_MASK;
-		left >>= CSS_LEFT_SHIFT;
-
-		if ((bits & 0x3) == CSS_RIGHT_AUTO && 
-				(left & 0x3) == CSS_LEFT_AUTO) {
-			/* Both auto => 0px */
-			*length = 0;
-			*unit = CSS_UNIT_PX;
-		} else if ((bits & 0x3) == CSS_RIGHT_AUTO) {
-			/* Right is auto => -left */
-			*length = -style->left;
-			*unit = (css_unit) (left >> 2);
-		} else {
-			/** \todo Consider containing block's direction 
-			 * if overconstrained */
-			*length = style->right;
-			*unit = (css_unit) (bits >> 2);
+		style->alloc(uncommon->cursor, 0, style->pw);
+	}
+
+	if (uncommon->content != NULL) {
+		css_computed_content_item *c;
+
+		for (c = uncommon->content;
+				c->type != CSS_COMPUTED_CONTENT_NONE; c++) {
+			switch (c->type) {
+			case CSS_COMPUTED_CONTENT_STRING:
+				css__computed_string_unref(style,
+						c->data.string);
+				break;
+			case CSS_COMPUTED_CONTENT_URI:
+				css__computed_string_unref(style, c->data.uri);
+				break;
+			case CSS_COMPUTED_CONTENT_ATTR:
+				css__computed_string_unref(style, c->data.attr);
+				break;
+			case CSS_COMPUTED_CONTENT_COUNTER:
+				css__computed_string_unref(style,
+						c->data.counter.name);
+				break;
+			case CSS_COMPUTED_CONTENT_COUNTERS:
+				css__computed_string_unref(style,
+						c->data.counters.name);
+				css__computed_string_unref(style,
+						c->data.counters.sep);
+				break;
+			default:
+				break;
+			}
 		}
 
-		bits = CSS_RIGHT_SET;
-	} else if ((bits & 0x3) == CSS_RIGHT_SET) {
-		*length = style->right;
-		*unit = (css_unit) (bits >> 2);
+		style->alloc(uncommon->content, 0, style->pw);
 	}
 
-	/* 6bits: uuuutt : units | type */
-	return (bits & 0x3);
+	style->alloc(uncommon, 0, style->pw);
 }
 
-uint8_t css_computed_bottom(
-		const css_computed_style *style, 
-		css_fixed *length, css_unit *unit)
+/**
+ * Destroy a block of inherited properties, and the data it owns
+ *
+ * \param style      Style which used the block
+ * \param inherited  Block to destroy
+ */
+void destroy_inherited(css_computed_style *style,
+		css_computed_inherited *inherited)
 {
-	uint8_t bits = style->bits[CSS_BOTTOM_INDEX];
-	bits &= CSS_BOTTOM_MASK;
-	bits >>= CSS_BOTTOM_SHIFT;
-
-	/* Fix up, based on computed position */
-	if (css_computed_position(style) == CSS_POSITION_STATIC) {
-		/* Static -> auto */
-		bits = CSS_BOTTOM_AUTO;
-	} else if (css_computed_position(style) == CSS_POSITION_RELATIVE) {
-		/* Relative -> follow $9.4.3 */
-		uint8_t top = style->bits[CSS_TOP_INDEX];
-		top &= CSS_TOP_MASK;
-		top >>= CSS_TOP_SHIFT;
-
-		if ((bits & 0x3) == CSS_BOTTOM_AUTO &&
-				(top & 0x3) == CSS_TOP_AUTO) {
-			/* Both auto => 0px */
-			*length = 0;
-			*unit = CSS_UNIT_PX;
-		} else if ((bits & 0x3) == CSS_BOTTOM_AUTO || 
-				(top & 0x3) != CSS_TOP_AUTO) {
-			/* Bottom is auto or top is not auto => -top */
-			*length = -style->top;
-			*unit = (css_unit) (top >> 2);
-		} else {
-			*length = style->bottom;
-			*unit = (css_unit) (bits >> 2);
+	if (inherited->font_family != NULL) {
+		lwc_string **s;
+
+		for (s = inherited->font_family; *s != NULL; s++) {
+			css__computed_string_unref(style, *s);
 		}
 
-		bits = CSS_BOTTOM_SET;
-	} else if ((bits & 0x3) == CSS_BOTTOM_SET) {
-		*length = style->bottom;
-		*unit = (css_unit) (bits >> 2);
+		style->alloc(inherited->font_family, 0, style->pw);
 	}
 
-	/* 6bits: uuuutt : units | type */
-	return (bits & 0x3);
-}
+	if (inherited->quotes != NULL) {
+		lwc_string **s;
 
-uint8_t css_computed_left(
-		const css_computed_style *style, 
-		css_fixed *length, css_unit *unit)
-{
-	uint8_t bits = style->bits[CSS_LEFT_INDEX];
-	bits &= CSS_LEFT_MASK;
-	bits >>= CSS_LEFT_SHIFT;
-
-	/* Fix up, based on computed position */
-	if (css_computed_position(style) == CSS_POSITION_STATIC) {
-		/* Static -> auto */
-		bits = CSS_LEFT_AUTO;
-	} else if (css_computed_position(style) == CSS_POSITION_RELATIVE) {
-		/* Relative -> follow $9.4.3 */
-		uint8_t right = style->bits[CSS_RIGHT_INDEX];
-		right &= CSS_RIGHT_MASK;
-		right >>= CSS_RIGHT_SHIFT;
-
-		if ((bits & 0x3) == CSS_LEFT_AUTO && 
-				(right & 0x3) == CSS_RIGHT_AUTO) {
-			/* Both auto => 0px */
-			*length = 0;
-			*unit = CSS_UNIT_PX;
-		} else if ((bits & 0x3) == CSS_LEFT_AUTO) {
-			/* Left is auto => -right */
-			*length = -style->right;
-			*unit = (css_unit) (right >> 2);
-		} else {
-			/** \todo Consider containing block's direction 
-			 * if overconstrained */
-			*length = style->left;
-			*unit = (css_unit) (bits >> 2);
+		for (s = inherited->quotes; *s != NULL; s++) {
+			css__computed_string_unref(style, *s);
 		}
 
-		bits = CSS_LEFT_SET;
-	} else if ((bits & 0x3) == CSS_LEFT_SET) {
-		*length = style->left;
-		*unit = (css_unit) (bits >> 2);
+		style->alloc(inherited->quotes, 0, style->pw);
 	}
 
-	/* 6bits: uuuutt : units | type */
-	return (bits & 0x3);
-}
-#undef CSS_LEFT_MASK
-#undef CSS_LEFT_SHIFT
-#undef CSS_LEFT_INDEX
-#undef CSS_BOTTOM_MASK
-#undef CSS_BOTTOM_SHIFT
-#undef CSS_BOTTOM_INDEX
-#undef CSS_RIGHT_MASK
-#undef CSS_RIGHT_SHIFT
-#undef CSS_RIGHT_INDEX
-#undef CSS_TOP_MASK
-#undef CSS_TOP_SHIFT
-#undef CSS_TOP_INDEX
-
-#define CSS_BORDER_TOP_COLOR_INDEX 6
-#define CSS_BORDER_TOP_COLOR_SHIFT 0
-#define CSS_BORDER_TOP_COLOR_MASK  0x3
-uint8_t css_computed_border_top_color(
-		const css_computed_style *style, 
-		css_color *color)
-{
-	uint8_t bits = style->bits[CSS_BORDER_TOP_COLOR_INDEX];
-	bits &= CSS_BORDER_TOP_COLOR_MASK;
-	bits >>= CSS_BORDER_TOP_COLOR_SHIFT;
+	if (inherited->list_style_image != NULL)
+		css__computed_string_unref(style, inherited->list_style_image);
 
-	/* 2bits: type */
-	*color = style->border_color[0];
-
-	return bits;
+	style->alloc(inherited, 0, style->pw);
 }
-#undef CSS_BORDER_TOP_COLOR_MASK
-#undef CSS_BORDER_TOP_COLOR_SHIFT
-#undef CSS_BORDER_TOP_COLOR_INDEX
-
-#define CSS_BORDER_RIGHT_COLOR_INDEX 7
-#define CSS_BORDER_RIGHT_COLOR_SHIFT 0
-#define CSS_BORDER_RIGHT_COLOR_MASK  0x3
-uint8_t css_computed_border_right_color(
-		const css_computed_style *style, 
-		css_color *color)
-{
-	uint8_t bits = style->bits[CSS_BORDER_RIGHT_COLOR_INDEX];
-	bits &= CSS_BORDER_RIGHT_COLOR_MASK;
-	bits >>= CSS_BORDER_RIGHT_COLOR_SHIFT;
-
-	/* 2bits: type */
-	*color = style->border_color[1];
 
-	return bits;
-}
-#undef CSS_BORDER_RIGHT_COLOR_MASK
-#undef CSS_BORDER_RIGHT_COLOR_SHIFT
-#undef CSS_BORDER_RIGHT_COLOR_INDEX
-
-#define CSS_BORDER_BOTTOM_COLOR_INDEX 8
-#define CSS_BORDER_BOTTOM_COLOR_SHIFT 0
-#define CSS_BORDER_BOTTOM_COLOR_MASK  0x3
-uint8_t css_computed_border_bottom_color(
-		const css_computed_style *style, 
-		css_color *color)
-{
-	uint8_t bits = style->bits[CSS_BORDER_BOTTOM_COLOR_INDEX];
-	bits &= CSS_BORDER_BOTTOM_COLOR_MASK;
-	bits >>= CSS_BORDER_BOTTOM_COLOR_SHIFT;
-
-	/* 2bits: type */
-	*color = style->border_color[2];
-
-	return bits;
-}
-#undef CSS_BORDER_BOTTOM_COLOR_MASK
-#undef CSS_BORDER_BOTTOM_COLOR_SHIFT
-#undef CSS_BORDER_BOTTOM_COLOR_INDEX
-
-#define CSS_BORDER_LEFT_COLOR_INDEX 9
-#define CSS_BORDER_LEFT_COLOR_SHIFT 0
-#define CSS_BORDER_LEFT_COLOR_MASK  0x3
-uint8_t css_computed_border_left_color(
-		const css_computed_style *style, 
-		css_color *color)
-{
-	uint8_t bits = style->bits[CSS_BORDER_LEFT_COLOR_INDEX];
-	bits &= CSS_BORDER_LEFT_COLOR_MASK;
-	bits >>= CSS_BORDER_LEFT_COLOR_SHIFT;
-
-	/* 2bits: type */
-	*color = style->border_color[3];
-
-	return bits;
-}
-#undef CSS_BORDER_LEFT_COLOR_MASK
-#undef CSS_BORDER_LEFT_COLOR_SHIFT
-#undef CSS_BORDER_LEFT_COLOR_INDEX
-
-#define CSS_HEIGHT_INDEX 10
-#define CSS_HEIGHT_SHIFT 2
-#define CSS_HEIGHT_MASK  0xfc
-uint8_t css_computed_height(
-		const css_computed_style *style, 
-		css_fixed *length, css_unit *unit)
+/**
+ * Give a style its own copy of a shared block of uncommon properties
+ *
+ * \param style  Style whose block to copy
+ * \return CSS_OK on success, CSS_NOMEM on memory exhaustion
+ *
+ * The style's reference to the shared block is released, so the copy may
+ * be modified without affecting the other styles using the block.
+ */
+css_error css__computed_style_unshare_uncommon(css_computed_style *style)
 {
-	uint8_t bits = style->bits[CSS_HEIGHT_INDEX];
-	bits &= CSS_HEIGHT_MASK;
-	bits >>= CSS_HEIGHT_SHIFT;
-
-	/* 6bits: uuuutt : units | type */
-	if ((bits & 0x3) == CSS_HEIGHT_SET) {
-		*length = style->height;
-		*unit = (css_unit) (bits >> 2);
-	}
+	css_computed_uncommon *shared = style->uncommon;
+	css_computed_uncommon *copy;
+	css_error error;
 
-	return (bits & 0x3);
-}
-#undef CSS_HEIGHT_MASK
-#undef CSS_HEIGHT_SHIFT
-#undef CSS_HEIGHT_INDEX
-
-#define CSS_LINE_HEIGHT_INDEX 11
-#define CSS_LINE_HEIGHT_SHIFT 2
-#define CSS_LINE_HEIGHT_MASK  0xfc
-uint8_t css_computed_line_height(
-		const css_computed_style *style, 
-		css_fixed *length, css_unit *unit)
-{
-	uint8_t bits = style->bits[CSS_LINE_HEIGHT_INDEX];
-	bits &= CSS_LINE_HEIGHT_MASK;
-	bits >>= CSS_LINE_HEIGHT_SHIFT;
-
-	/* 6bits: uuuutt : units | type */
-	if ((bits & 0x3) == CSS_LINE_HEIGHT_NUMBER || 
-			(bits & 0x3) == CSS_LINE_HEIGHT_DIMENSION) {
-		*length = style->line_height;
-	}
+	copy = style->alloc(NULL, sizeof(css_computed_uncommon), style->pw);
+	if (copy == NULL)
+		return CSS_NOMEM;
 
-	if ((bits & 0x3) == CSS_LINE_HEIGHT_DIMENSION) {
-		*unit = (css_unit) (bits >> 2);
+	memcpy(copy, shared, sizeof(css_computed_uncommon));
+	copy->counter_increment = NULL;
+	copy->counter_reset = NULL;
+	copy->cursor = NULL;
+	copy->content = NULL;
+	copy->refcount = 1;
+
+	error = copy_counters(style, shared->counter_increment,
+			&copy->counter_increment);
+	if (error == CSS_OK) {
+		error = copy_counters(style, shared->counter_reset,
+				&copy->counter_reset);
+	}
+	if (error == CSS_OK)
+		error = copy_strings(style, shared->cursor, &copy->cursor);
+	if (error == CSS_OK)
+		error = copy_content(style, shared->content, &copy->content);
+
+	if (error != CSS_OK) {
+		destroy_uncommon(style, copy);
+		return error;
 	}
 
-	return (bits & 0x3);
-}
-#undef CSS_LINE_HEIGHT_MASK
-#undef CSS_LINE_HEIGHT_SHIFT
-#undef CSS_LINE_HEIGHT_INDEX
-
-#define CSS_BACKGROUND_COLOR_INDEX 10
-#define CSS_BACKGROUND_COLOR_SHIFT 0
-#define CSS_BACKGROUND_COLOR_MASK  0x3
-uint8_t css_computed_background_color(
-		const css_computed_style *style, 
-		css_color *color)
-{
-	uint8_t bits = style->bits[CSS_BACKGROUND_COLOR_INDEX];
-	bits &= CSS_BACKGROUND_COLOR_MASK;
-	bits >>= CSS_BACKGROUND_COLOR_SHIFT;
-
-	/* 2bits: type */
-	*color = style->background_color;
+	shared->refcount--;
+	style->uncommon = copy;
 
-	return bits;
-}
-#undef CSS_BACKGROUND_COLOR_MASK
-#undef CSS_BACKGROUND_COLOR_SHIFT
-#undef CSS_BACKGROUND_COLOR_INDEX
-
-#define CSS_Z_INDEX_INDEX 11
-#define CSS_Z_INDEX_SHIFT 0
-#define CSS_Z_INDEX_MASK  0x3
-uint8_t css_computed_z_index(
-		const css_computed_style *style, 
-		int32_t *z_index)
-{
-	uint8_t bits = style->bits[CSS_Z_INDEX_INDEX];
-	bits &= CSS_Z_INDEX_MASK;
-	bits >>= CSS_Z_INDEX_SHIFT;
-
-	/* 2bits: type */
-	*z_index = style->z_index;
-
-	return bits;
+	return CSS_OK;
 }
-#undef CSS_Z_INDEX_MASK
-#undef CSS_Z_INDEX_SHIFT
-#undef CSS_Z_INDEX_INDEX
-
-#define CSS_MARGIN_TOP_INDEX 12
-#define CSS_MARGIN_TOP_SHIFT 2
-#define CSS_MARGIN_TOP_MASK  0xfc
-uint8_t css_computed_margin_top(
-		const css_computed_style *style, 
-		css_fixed *length, css_unit *unit)
-{
-	uint8_t bits = style->bits[CSS_MARGIN_TOP_INDEX];
-	bits &= CSS_MARGIN_TOP_MASK;
-	bits >>= CSS_MARGIN_TOP_SHIFT;
-
-	/* 6bits: uuuutt : units | type */
-	if ((bits & 0x3) == CSS_MARGIN_SET) {
-		*length = style->margin[0];
-		*unit = (css_unit) (bits >> 2);
-	}
 
-	return (bits & 0x3);
-}
-#undef CSS_MARGIN_TOP_MASK
-#undef CSS_MARGIN_TOP_SHIFT
-#undef CSS_MARGIN_TOP_INDEX
-
-#define CSS_MARGIN_RIGHT_INDEX 13
-#define CSS_MARGIN_RIGHT_SHIFT 2
-#define CSS_MARGIN_RIGHT_MASK  0xfc
-uint8_t css_computed_margin_right(
-		const css_computed_style *style, 
-		css_fixed *length, css_unit *unit)
+/**
+ * Give a style its own copy of a shared block of page properties
+ *
+ * \param style  Style whose block to copy
+ * \return CSS_OK on success, CSS_NOMEM on memory exhaustion
+ *
+ * The style's reference to the shared block is released.
+ */
+css_error css__computed_style_unshare_page(css_computed_style *style)
 {
-	uint8_t bits = style->bits[CSS_MARGIN_RIGHT_INDEX];
-	bits &= CSS_MARGIN_RIGHT_MASK;
-	bits >>= CSS_MARGIN_RIGHT_SHIFT;
-
-	/* 6bits: uuuutt : units | type */
-	if ((bits & 0x3) == CSS_MARGIN_SET) {
-		*length = style->margin[1];
-		*unit = (css_unit) (bits >> 2);
-	}
+	css_computed_page *copy;
 
-	return (bits & 0x3);
-}
-#undef CSS_MARGIN_RIGHT_MASK
-#undef CSS_MARGIN_RIGHT_SHIFT
-#undef CSS_MARGIN_RIGHT_INDEX
-
-#define CSS_MARGIN_BOTTOM_INDEX 14
-#define CSS_MARGIN_BOTTOM_SHIFT 2
-#define CSS_MARGIN_BOTTOM_MASK  0xfc
-uint8_t css_computed_margin_bottom(
-		const css_computed_style *style, 
-		css_fixed *length, css_unit *unit)
-{
-	uint8_t bits = style->bits[CSS_MARGIN_BOTTOM_INDEX];
-	bits &= CSS_MARGIN_BOTTOM_MASK;
-	bits >>= CSS_MARGIN_BOTTOM_SHIFT;
-
-	/* 6bits: uuuutt : units | type */
-	if ((bits & 0x3) == CSS_MARGIN_SET) {
-		*length = style->margin[2];
-		*unit = (css_unit) (bits >> 2);
-	}
+	copy = style->alloc(NULL, sizeof(css_computed_page), style->pw);
+	if (copy == NULL)
+		return CSS_NOMEM;
 
-	return (bits & 0x3);
-}
-#undef CSS_MARGIN_BOTTOM_MASK
-#undef CSS_MARGIN_BOTTOM_SHIFT
-#undef CSS_MARGIN_BOTTOM_INDEX
-
-#define CSS_MARGIN_LEFT_INDEX 15
-#define CSS_MARGIN_LEFT_SHIFT 2
-#define CSS_MARGIN_LEFT_MASK  0xfc
-uint8_t css_computed_margin_left(
-		const css_computed_style *style, 
-		css_fixed *length, css_unit *unit)
-{
-	uint8_t bits = style->bits[CSS_MARGIN_LEFT_INDEX];
-	bits &= CSS_MARGIN_LEFT_MASK;
-	bits >>= CSS_MARGIN_LEFT_SHIFT;
-
-	/* 6bits: uuuutt : units | type */
-	if ((bits & 0x3) == CSS_MARGIN_SET) {
-		*length = style->margin[3];
-		*unit = (css_unit) (bits >> 2);
-	}
+	memcpy(copy, style->page, sizeof(css_computed_page));
+	copy->refcount = 1;
 
-	return (bits & 0x3);
-}
-#undef CSS_MARGIN_LEFT_MASK
-#undef CSS_MARGIN_LEFT_SHIFT
-#undef CSS_MARGIN_LEFT_INDEX
-
-#define CSS_BACKGROUND_ATTACHMENT_INDEX 12
-#define CSS_BACKGROUND_ATTACHMENT_SHIFT 0
-#define CSS_BACKGROUND_ATTACHMENT_MASK  0x3
-uint8_t css_computed_background_attachment(
-		const css_computed_style *style)
-{
-	uint8_t bits = style->bits[CSS_BACKGROUND_ATTACHMENT_INDEX];
-	bits &= CSS_BACKGROUND_ATTACHMENT_MASK;
-	bits >>= CSS_BACKGROUND_ATTACHMENT_SHIFT;
+	style->page->refcount--;
+	style->page = copy;
 
-	/* 2bits: type */
-	return bits;
+	return CSS_OK;
 }
-#undef CSS_BACKGROUND_ATTACHMENT_MASK
-#undef CSS_BACKGROUND_ATTACHMENT_SHIFT
-#undef CSS_BACKGROUND_ATTACHMENT_INDEX
-
-#define CSS_BORDER_COLLAPSE_INDEX 13
-#define CSS_BORDER_COLLAPSE_SHIFT 0
-#define CSS_BORDER_COLLAPSE_MASK  0x3
-uint8_t css_computed_border_collapse(
-		const css_computed_style *style)
-{
-	uint8_t bits = style->bits[CSS_BORDER_COLLAPSE_INDEX];
-	bits &= CSS_BORDER_COLLAPSE_MASK;
-	bits >>= CSS_BORDER_COLLAPSE_SHIFT;
 
-	/* 2bits: type */
-	return bits;
-}
-#undef CSS_BORDER_COLLAPSE_MASK
-#undef CSS_BORDER_COLLAPSE_SHIFT
-#undef CSS_BORDER_COLLAPSE_INDEX
-
-#define CSS_CAPTION_SIDE_INDEX 14
-#define CSS_CAPTION_SIDE_SHIFT 0
-#define CSS_CAPTION_SIDE_MASK  0x3
-uint8_t css_computed_caption_side(
-		const css_computed_style *style)
+/**
+ * Give a style its own copy of a shared block of inherited properties
+ *
+ * \param style  Style whose block to copy
+ * \return CSS_OK on success, CSS_NOMEM on memory exhaustion
+ *
+ * The style's reference to the shared block is released.
+ */
+css_error css__computed_style_unshare_inherited(css_computed_style *style)
 {
-	uint8_t bits = style->bits[CSS_CAPTION_SIDE_INDEX];
-	bits &= CSS_CAPTION_SIDE_MASK;
-	bits >>= CSS_CAPTION_SIDE_SHIFT;
+	css_computed_inherited *shared = style->inherited;
+	css_computed_inherited *copy;
+	css_error error;
 
-	/* 2bits: type */
-	return bits;
-}
-#undef CSS_CAPTION_SIDE_MASK
-#undef CSS_CAPTION_SIDE_SHIFT
-#undef CSS_CAPTION_SIDE_INDEX
-
-#define CSS_DIRECTION_INDEX 15
-#define CSS_DIRECTION_SHIFT 0
-#define CSS_DIRECTION_MASK  0x3
-uint8_t css_computed_direction(
-		const css_computed_style *style)
-{
-	uint8_t bits = style->bits[CSS_DIRECTION_INDEX];
-	bits &= CSS_DIRECTION_MASK;
-	bits >>= CSS_DIRECTION_SHIFT;
+	copy = style->alloc(NULL, sizeof(css_computed_inherited), style->pw);
+	if (copy == NULL)
+		return CSS_NOMEM;
 
-	/* 2bits: type */
-	return bits;
-}
-#undef CSS_DIRECTION_MASK
-#undef CSS_DIRECTION_SHIFT
-#undef CSS_DIRECTION_INDEX
-
-#define CSS_MAX_HEIGHT_INDEX 16
-#define CSS_MAX_HEIGHT_SHIFT 2
-#define CSS_MAX_HEIGHT_MASK  0xfc
-uint8_t css_computed_max_height(
-		const css_computed_style *style, 
-		css_fixed *length, css_unit *unit)
-{
-	uint8_t bits = style->bits[CSS_MAX_HEIGHT_INDEX];
-	bits &= CSS_MAX_HEIGHT_MASK;
-	bits >>= CSS_MAX_HEIGHT_SHIFT;
-
-	/* 6bits: uuuutt : units | type */
-	if ((bits & 0x3) == CSS_MAX_HEIGHT_SET) {
-		*length = style->max_height;
-		*unit = (css_unit) (bits >> 2);
-	}
+	memcpy(copy, shared, sizeof(css_computed_inherited));
+	copy->list_style_image = NULL;
+	copy->font_family = NULL;
+	copy->quotes = NULL;
+	copy->refcount = 1;
 
-	return (bits & 0x3);
-}
-#undef CSS_MAX_HEIGHT_MASK
-#undef CSS_MAX_HEIGHT_SHIFT
-#undef CSS_MAX_HEIGHT_INDEX
-
-#define CSS_MAX_WIDTH_INDEX 17
-#define CSS_MAX_WIDTH_SHIFT 2
-#define CSS_MAX_WIDTH_MASK  0xfc
-uint8_t css_computed_max_width(
-		const css_computed_style *style, 
-		css_fixed *length, css_unit *unit)
-{
-	uint8_t bits = style->bits[CSS_MAX_WIDTH_INDEX];
-	bits &= CSS_MAX_WIDTH_MASK;
-	bits >>= CSS_MAX_WIDTH_SHIFT;
-
-	/* 6bits: uuuutt : units | type */
-	if ((bits & 0x3) == CSS_MAX_WIDTH_SET) {
-		*length = style->max_width;
-		*unit = (css_unit) (bits >> 2);
+	error = copy_strings(style, shared->font_family, &copy->font_family);
+	if (error == CSS_OK)
+		error = copy_strings(style, shared->quotes, &copy->quotes);
+
+	if (error != CSS_OK) {
+		destroy_inherited(style, copy);
+		return error;
 	}
 
-	return (bits & 0x3);
-}
-#undef CSS_MAX_WIDTH_MASK
-#undef CSS_MAX_WIDTH_SHIFT
-#undef CSS_MAX_WIDTH_INDEX
-
-#define CSS_WIDTH_INDEX 18
-#define CSS_WIDTH_SHIFT 2
-#define CSS_WIDTH_MASK  0xfc
-uint8_t css_computed_width(
-		const css_computed_style *style, 
-		css_fixed *length, css_unit *unit)
-{
-	uint8_t bits = style->bits[CSS_WIDTH_INDEX];
-	bits &= CSS_WIDTH_MASK;
-	bits >>= CSS_WIDTH_SHIFT;
-
-	/* 6bits: uuuutt : units | type */
-	if ((bits & 0x3) == CSS_WIDTH_SET) {
-		*length = style->width;
-		*unit = (css_unit) (bits >> 2);
+	if (shared->list_style_image != NULL) {
+		copy->list_style_image = css__computed_string_ref(style,
+				shared->list_style_image);
 	}
 
-	return (bits & 0x3);
-}
-#undef CSS_WIDTH_MASK
-#undef CSS_WIDTH_SHIFT
-#undef CSS_WIDTH_INDEX
-
-#define CSS_EMPTY_CELLS_INDEX 16
-#define CSS_EMPTY_CELLS_SHIFT 0
-#define CSS_EMPTY_CELLS_MASK  0x3
-uint8_t css_computed_empty_cells(
-		const css_computed_style *style)
-{
-	uint8_t bits = style->bits[CSS_EMPTY_CELLS_INDEX];
-	bits &= CSS_EMPTY_CELLS_MASK;
-	bits >>= CSS_EMPTY_CELLS_SHIFT;
+	shared->refcount--;
+	style->inherited = copy;
 
-	/* 2bits: type */
-	return bits;
+	return CSS_OK;
 }
-#undef CSS_EMPTY_CELLS_MASK
-#undef CSS_EMPTY_CELLS_SHIFT
-#undef CSS_EMPTY_CELLS_INDEX
-
-#define CSS_FLOAT_INDEX 17
-#define CSS_FLOAT_SHIFT 0
-#define CSS_FLOAT_MASK  0x3
-uint8_t css_computed_float(
-		const css_computed_style *style)
+
+/**
+ * Copy a list of counters, referencing their names
+ *
+ * \param style     Style to hold the copy
+ * \param counters  Counters to copy, or NULL
+ * \param copy      Pointer to location to receive copy, NULL for none
+ * \return CSS_OK on success, CSS_NOMEM on memory exhaustion
+ */
+css_error copy_counters(css_computed_style *style,
+		const css_computed_counter *counters,
+		css_computed_counter **copy)
 {
-	uint8_t bits = style->bits[CSS_FLOAT_INDEX];
-	bits &= CSS_FLOAT_MASK;
-	bits >>= CSS_FLOAT_SHIFT;
+	size_t n = 0, i;
 
-	/* Fix up as per $9.7:2 */
-	if (css_computed_position(style) == CSS_POSITION_ABSOLUTE ||
-			css_computed_position(style) == CSS_POSITION_FIXED)
-		return CSS_FLOAT_NONE;
+	if (counters == NULL)
+		return CSS_OK;
 
-	/* 2bits: type */
-	return bits;
-}
-#undef CSS_FLOAT_MASK
-#undef CSS_FLOAT_SHIFT
-#undef CSS_FLOAT_INDEX
-
-#define CSS_FONT_STYLE_INDEX 18
-#define CSS_FONT_STYLE_SHIFT 0
-#define CSS_FONT_STYLE_MASK  0x3
-uint8_t css_computed_font_style(
-		const css_computed_style *style)
-{
-	uint8_t bits = style->bits[CSS_FONT_STYLE_INDEX];
-	bits &= CSS_FONT_STYLE_MASK;
-	bits >>= CSS_FONT_STYLE_SHIFT;
+	while (counters[n].name != NULL)
+		n++;
 
-	/* 2bits: type */
-	return bits;
-}
-#undef CSS_FONT_STYLE_MASK
-#undef CSS_FONT_STYLE_SHIFT
-#undef CSS_FONT_STYLE_INDEX
-
-#define CSS_MIN_HEIGHT_INDEX 19
-#define CSS_MIN_HEIGHT_SHIFT 3
-#define CSS_MIN_HEIGHT_MASK  0xf8
-uint8_t css_computed_min_height(
-		const css_computed_style *style, 
-		css_fixed *length, css_unit *unit)
-{
-	uint8_t bits = style->bits[CSS_MIN_HEIGHT_INDEX];
-	bits &= CSS_MIN_HEIGHT_MASK;
-	bits >>= CSS_MIN_HEIGHT_SHIFT;
-
-	/* 5bits: uuuut : units | type */
-	if ((bits & 0x1) == CSS_MIN_HEIGHT_SET) {
-		*length = style->min_height;
-		*unit = (css_unit) (bits >> 1);
-	}
+	*copy = style->alloc(NULL, (n + 1) * sizeof(css_computed_counter),
+			style->pw);
+	if (*copy == NULL)
+		return CSS_NOMEM;
 
-	return (bits & 0x1);
-}
-#undef CSS_MIN_HEIGHT_MASK
-#undef CSS_MIN_HEIGHT_SHIFT
-#undef CSS_MIN_HEIGHT_INDEX
-
-#define CSS_MIN_WIDTH_INDEX 20
-#define CSS_MIN_WIDTH_SHIFT 3
-#define CSS_MIN_WIDTH_MASK  0xf8
-uint8_t css_computed_min_width(
-		const css_computed_style *style, 
-		css_fixed *length, css_unit *unit)
-{
-	uint8_t bits = style->bits[CSS_MIN_WIDTH_INDEX];
-	bits &= CSS_MIN_WIDTH_MASK;
-	bits >>= CSS_MIN_WIDTH_SHIFT;
-
-	/* 5bits: uuuut : units | type */
-	if ((bits & 0x1) == CSS_MIN_WIDTH_SET) {
-		*length = style->min_width;
-		*unit = (css_unit) (bits >> 1);
-	}
+	memcpy(*copy, counters, (n + 1) * sizeof(css_computed_counter));
 
-	return (bits & 0x1);
-}
-#undef CSS_MIN_WIDTH_MASK
-#undef CSS_MIN_WIDTH_SHIFT
-#undef CSS_MIN_WIDTH_INDEX
-
-#define CSS_BACKGROUND_REPEAT_INDEX 19
-#define CSS_BACKGROUND_REPEAT_SHIFT 0
-#define CSS_BACKGROUND_REPEAT_MASK  0x7
-uint8_t css_computed_background_repeat(
-		const css_computed_style *style)
-{
-	uint8_t bits = style->bits[CSS_BACKGROUND_REPEAT_INDEX];
-	bits &= CSS_BACKGROUND_REPEAT_MASK;
-	bits >>= CSS_BACKGROUND_REPEAT_SHIFT;
+	for (i = 0; i < n; i++)
+		css__computed_string_ref(style, (*copy)[i].name);
 
-	/* 3bits: type */
-	return bits;
+	return CSS_OK;
 }
-#undef CSS_BACKGROUND_REPEAT_MASK
-#undef CSS_BACKGROUND_REPEAT_SHIFT
-#undef CSS_BACKGROUND_REPEAT_INDEX
-
-#define CSS_CLEAR_INDEX 20
-#define CSS_CLEAR_SHIFT 0
-#define CSS_CLEAR_MASK  0x7
-uint8_t css_computed_clear(
-		const css_computed_style *style)
-{
-	uint8_t bits = style->bits[CSS_CLEAR_INDEX];
-	bits &= CSS_CLEAR_MASK;
-	bits >>= CSS_CLEAR_SHIFT;
 
-	/* 3bits: type */
-	return bits;
-}
-#undef CSS_CLEAR_MASK
-#undef CSS_CLEAR_SHIFT
-#undef CSS_CLEAR_INDEX
-
-#define CSS_PADDING_TOP_INDEX 21
-#define CSS_PADDING_TOP_SHIFT 3
-#define CSS_PADDING_TOP_MASK  0xf8
-uint8_t css_computed_padding_top(
-		const css_computed_style *style, 
-		css_fixed *length, css_unit *unit)
+/**
+ * Copy a list of strings, referencing them
+ *
+ * \param style    Style to hold the copy
+ * \param strings  NULL-terminated strings to copy, or NULL
+ * \param copy     Pointer to location to receive copy, NULL for none
+ * \return CSS_OK on success, CSS_NOMEM on memory exhaustion
+ */
+css_error copy_strings(css_computed_style *style,
+		lwc_string **strings, lwc_string ***copy)
 {
-	uint8_t bits = style->bits[CSS_PADDING_TOP_INDEX];
-	bits &= CSS_PADDING_TOP_MASK;
-	bits >>= CSS_PADDING_TOP_SHIFT;
-
-	/* 5bits: uuuut : units | type */
-	if ((bits & 0x1) == CSS_PADDING_SET) {
-		*length = style->padding[0];
-		*unit = (css_unit) (bits >> 1);
-	}
+	size_t n = 0, i;
 
-	return (bits & 0x1);
-}
-#undef CSS_PADDING_TOP_MASK
-#undef CSS_PADDING_TOP_SHIFT
-#undef CSS_PADDING_TOP_INDEX
-
-#define CSS_PADDING_RIGHT_INDEX 22
-#define CSS_PADDING_RIGHT_SHIFT 3
-#define CSS_PADDING_RIGHT_MASK  0xf8
-uint8_t css_computed_padding_right(
-		const css_computed_style *style, 
-		css_fixed *length, css_unit *unit)
-{
-	uint8_t bits = style->bits[CSS_PADDING_RIGHT_INDEX];
-	bits &= CSS_PADDING_RIGHT_MASK;
-	bits >>= CSS_PADDING_RIGHT_SHIFT;
-
-	/* 5bits: uuuut : units | type */
-	if ((bits & 0x1) == CSS_PADDING_SET) {
-		*length = style->padding[1];
-		*unit = (css_unit) (bits >> 1);
-	}
+	if (strings == NULL)
+		return CSS_OK;
 
-	return (bits & 0x1);
-}
-#undef CSS_PADDING_RIGHT_MASK
-#undef CSS_PADDING_RIGHT_SHIFT
-#undef CSS_PADDING_RIGHT_INDEX
-
-#define CSS_PADDING_BOTTOM_INDEX 23
-#define CSS_PADDING_BOTTOM_SHIFT 3
-#define CSS_PADDING_BOTTOM_MASK  0xf8
-uint8_t css_computed_padding_bottom(
-		const css_computed_style *style, 
-		css_fixed *length, css_unit *unit)
-{
-	uint8_t bits = style->bits[CSS_PADDING_BOTTOM_INDEX];
-	bits &= CSS_PADDING_BOTTOM_MASK;
-	bits >>= CSS_PADDING_BOTTOM_SHIFT;
-
-	/* 5bits: uuuut : units | type */
-	if ((bits & 0x1) == CSS_PADDING_SET) {
-		*length = style->padding[2];
-		*unit = (css_unit) (bits >> 1);
-	}
+	while (strings[n] != NULL)
+		n++;
 
-	return (bits & 0x1);
-}
-#undef CSS_PADDING_BOTTOM_MASK
-#undef CSS_PADDING_BOTTOM_SHIFT
-#undef CSS_PADDING_BOTTOM_INDEX
-
-#define CSS_PADDING_LEFT_INDEX 24
-#define CSS_PADDING_LEFT_SHIFT 3
-#define CSS_PADDING_LEFT_MASK  0xf8
-uint8_t css_computed_padding_left(
-		const css_computed_style *style, 
-		css_fixed *length, css_unit *unit)
-{
-	uint8_t bits = style->bits[CSS_PADDING_LEFT_INDEX];
-	bits &= CSS_PADDING_LEFT_MASK;
-	bits >>= CSS_PADDING_LEFT_SHIFT;
-
-	/* 5bits: uuuut : units | type */
-	if ((bits & 0x1) == CSS_PADDING_SET) {
-		*length = style->padding[3];
-		*unit = (css_unit) (bits >> 1);
-	}
+	*copy = style->alloc(NULL, (n + 1) * sizeof(lwc_string *),
+			style->pw);
+	if (*copy == NULL)
+		return CSS_NOMEM;
 
-	return (bits & 0x1);
-}
-#undef CSS_PADDING_LEFT_MASK
-#undef CSS_PADDING_LEFT_SHIFT
-#undef CSS_PADDING_LEFT_INDEX
-
-#define CSS_OVERFLOW_INDEX 21
-#define CSS_OVERFLOW_SHIFT 0
-#define CSS_OVERFLOW_MASK  0x7
-uint8_t css_computed_overflow(
-		const css_computed_style *style)
-{
-	uint8_t bits = style->bits[CSS_OVERFLOW_INDEX];
-	bits &= CSS_OVERFLOW_MASK;
-	bits >>= CSS_OVERFLOW_SHIFT;
+	for (i = 0; i < n; i++)
+		(*copy)[i] = css__computed_string_ref(style, strings[i]);
+	(*copy)[n] = NULL;
 
-	/* 3bits: type */
-	return bits;
+	return CSS_OK;
 }
-#undef CSS_OVERFLOW_MASK
-#undef CSS_OVERFLOW_SHIFT
-#undef CSS_OVERFLOW_INDEX
-
-#define CSS_POSITION_INDEX 22
-#define CSS_POSITION_SHIFT 0
-#define CSS_POSITION_MASK  0x7
-uint8_t css_computed_position(
-		const css_computed_style *style)
-{
-	uint8_t bits = style->bits[CSS_POSITION_INDEX];
-	bits &= CSS_POSITION_MASK;
-	bits >>= CSS_POSITION_SHIFT;
 
-	/* 3bits: type */
-	return bits;
-}
-#undef CSS_POSITION_MASK
-#undef CSS_POSITION_SHIFT
-#undef CSS_POSITION_INDEX
-
-#define CSS_OPACITY_INDEX 23
-#define CSS_OPACITY_SHIFT 2
-#define CSS_OPACITY_MASK  0x04
-uint8_t css_computed_opacity(
-		const css_computed_style *style, 
-		css_fixed *opacity)
+/**
+ * Copy a list of content items, referencing their strings
+ *
+ * \param style    Style to hold the copy
+ * \param content  Items to copy, or NULL
+ * \param copy     Pointer to location to receive copy, NULL for none
+ * \return CSS_OK on success, CSS_NOMEM on memory exhaustion
+ */
+css_error copy_content(css_computed_style *style,
+		const css_computed_content_item *content,
+		css_computed_content_item **copy)
 {
-	uint8_t bits = style->bits[CSS_OPACITY_INDEX];
-	bits &= CSS_OPACITY_MASK;
-	bits >>= CSS_OPACITY_SHIFT;
-
-	/* 1bit: t : type */
-	if ((bits & 0x1) == CSS_OPACITY_SET) {
-		*opacity = style->opacity;
-	}
+	css_computed_content_item *c;
+	size_t n = 0;
 
-	return (bits & 0x1);
-}
-#undef CSS_OPACITY_MASK
-#undef CSS_OPACITY_SHIFT
-#undef CSS_OPACITY_INDEX
-
-#define CSS_TEXT_TRANSFORM_INDEX 24
-#define CSS_TEXT_TRANSFORM_SHIFT 0
-#define CSS_TEXT_TRANSFORM_MASK  0x7
-uint8_t css_computed_text_transform(
-		const css_computed_style *style)
-{
-	uint8_t bits = style->bits[CSS_TEXT_TRANSFORM_INDEX];
-	bits &= CSS_TEXT_TRANSFORM_MASK;
-	bits >>= CSS_TEXT_TRANSFORM_SHIFT;
+	if (content == NULL)
+		return CSS_OK;
 
-	/* 3bits: type */
-	return bits;
-}
-#undef CSS_TEXT_TRANSFORM_MASK
-#undef CSS_TEXT_TRANSFORM_SHIFT
-#undef CSS_TEXT_TRANSFORM_INDEX
-
-#define CSS_TEXT_INDENT_INDEX 25
-#define CSS_TEXT_INDENT_SHIFT 3
-#define CSS_TEXT_INDENT_MASK  0xf8
-uint8_t css_computed_text_indent(
-		const css_computed_style *style, 
-		css_fixed *length, css_unit *unit)
-{
-	uint8_t bits = style->bits[CSS_TEXT_INDENT_INDEX];
-	bits &= CSS_TEXT_INDENT_MASK;
-	bits >>= CSS_TEXT_INDENT_SHIFT;
-
-	/* 5bits: uuuut : units | type */
-	if ((bits & 0x1) == CSS_TEXT_INDENT_SET) {
-		*length = style->text_indent;
-		*unit = (css_unit) (bits >> 1);
-	}
+	while (content[n].type != CSS_COMPUTED_CONTENT_NONE)
+		n++;
 
-	return (bits & 0x1);
-}
-#undef CSS_TEXT_INDENT_MASK
-#undef CSS_TEXT_INDENT_SHIFT
-#undef CSS_TEXT_INDENT_INDEX
-
-#define CSS_WHITE_SPACE_INDEX 25
-#define CSS_WHITE_SPACE_SHIFT 0
-#define CSS_WHITE_SPACE_MASK  0x7
-uint8_t css_computed_white_space(
-		const css_computed_style *style)
-{
-	uint8_t bits = style->bits[CSS_WHITE_SPACE_INDEX];
-	bits &= CSS_WHITE_SPACE_MASK;
-	bits >>= CSS_WHITE_SPACE_SHIFT;
+	*copy = style->alloc(NULL, (n + 1) * sizeof(css_computed_content_item),
+			style->pw);
+	if (*copy == NULL)
+		return CSS_NOMEM;
 
-	/* 3bits: type */
-	return bits;
-}
-#undef CSS_WHITE_SPACE_MASK
-#undef CSS_WHITE_SPACE_SHIFT
-#undef CSS_WHITE_SPACE_INDEX
-
-#define CSS_BACKGROUND_POSITION_INDEX 27
-#define CSS_BACKGROUND_POSITION_SHIFT 7
-#define CSS_BACKGROUND_POSITION_MASK  0x80
-#define CSS_BACKGROUND_POSITION_INDEX1 26
-#define CSS_BACKGROUND_POSITION_SHIFT1 0
-#define CSS_BACKGROUND_POSITION_MASK1 0xff
-uint8_t css_computed_background_position(
-		const css_computed_style *style, 
-		css_fixed *hlength, css_unit *hunit,
-		css_fixed *vlength, css_unit *vunit)
-{
-	uint8_t bits = style->bits[CSS_BACKGROUND_POSITION_INDEX];
-	bits &= CSS_BACKGROUND_POSITION_MASK;
-	bits >>= CSS_BACKGROUND_POSITION_SHIFT;
-
-	/* 1bit: type */
-	if (bits == CSS_BACKGROUND_POSITION_SET) {
-		uint8_t bits1 = style->bits[CSS_BACKGROUND_POSITION_INDEX1];
-		bits1 &= CSS_BACKGROUND_POSITION_MASK1;
-		bits1 >>= CSS_BACKGROUND_POSITION_SHIFT1;
-
-		/* 8bits: hhhhvvvv : hunit | vunit */
-		*hlength = style->background_position[0];
-		*hunit = (css_unit) (bits1 >> 4);
-
-		*vlength = style->background_position[1];
-		*vunit = (css_unit) (bits1 & 0xf);
-	}
+	memcpy(*copy, content, (n + 1) * sizeof(css_computed_content_item));
 
-	return bits;
-}
-#undef CSS_BACKGROUND_POSITION_MASK1
-#undef CSS_BACKGROUND_POSITION_SHIFT1
-#undef CSS_BACKGROUND_POSITION_INDEX1
-#undef CSS_BACKGROUND_POSITION_MASK
-#undef CSS_BACKGROUND_POSITION_SHIFT
-#undef CSS_BACKGROUND_POSITION_INDEX
-
-#define CSS_DISPLAY_INDEX 27
-#define CSS_DISPLAY_SHIFT 2
-#define CSS_DISPLAY_MASK  0x7c
-uint8_t css_computed_display(
-		const css_computed_style *style, bool root)
-{
-	uint8_t position;
-	uint8_t bits = style->bits[CSS_DISPLAY_INDEX];
-	bits &= CSS_DISPLAY_MASK;
-	bits >>= CSS_DISPLAY_SHIFT;
-
-	/* Return computed display as per $9.7 */
-	position = css_computed_position(style);
-
-	/* 5bits: type */
-	if (bits == CSS_DISPLAY_NONE)
-		return bits; /* 1. */
-
-	if ((position == CSS_POSITION_ABSOLUTE || 
-			position == CSS_POSITION_FIXED) /* 2. */ ||
-			css_computed_float(style) != CSS_FLOAT_NONE /* 3. */ ||
-			root /* 4. */) {
-		if (bits == CSS_DISPLAY_INLINE_TABLE) {
-			return CSS_DISPLAY_TABLE;
-		} else if (bits == CSS_DISPLAY_INLINE ||
-				bits == CSS_DISPLAY_RUN_IN ||
-				bits == CSS_DISPLAY_TABLE_ROW_GROUP ||
-				bits == CSS_DISPLAY_TABLE_COLUMN ||
-				bits == CSS_DISPLAY_TABLE_COLUMN_GROUP ||
-				bits == CSS_DISPLAY_TABLE_HEADER_GROUP ||
-				bits == CSS_DISPLAY_TABLE_FOOTER_GROUP ||
-				bits == CSS_DISPLAY_TABLE_ROW ||
-				bits == CSS_DISPLAY_TABLE_CELL ||
-				bits == CSS_DISPLAY_TABLE_CAPTION ||
-				bits == CSS_DISPLAY_INLINE_BLOCK) {
-			return CSS_DISPLAY_BLOCK;
+	for (c = *copy; c->type != CSS_COMPUTED_CONTENT_NONE; c++) {
+		switch (c->type) {
+		case CSS_COMPUTED_CONTENT_STRING:
+			css__computed_string_ref(style, c->data.string);
+			break;
+		case CSS_COMPUTED_CONTENT_URI:
+			css__computed_string_ref(style, c->data.uri);
+			break;
+		case CSS_COMPUTED_CONTENT_ATTR:
+			css__computed_string_ref(style, c->data.attr);
+			break;
+		case CSS_COMPUTED_CONTENT_COUNTER:
+			css__computed_string_ref(style, c->data.counter.name);
+			break;
+		case CSS_COMPUTED_CONTENT_COUNTERS:
+			css__computed_string_ref(style, c->data.counters.name);
+			css__computed_string_ref(style, c->data.counters.sep);
+			break;
+		default:
+			break;
 		}
 	}
 
-	/* 5. */
-	return bits;
+	return CSS_OK;
 }
 
-uint8_t css_computed_display_static(
-		const css_computed_style *style)
+/**
+ * Determine whether a composed style may share blocks with its parent
+ *
+ * \param parent  Composed parent style
+ * \param result  Composed style
+ * \return true if blocks may be shared, false otherwise
+ *
+ * Sharing a block updates its reference count, so styles which borrow
+ * their strings share none: they may be composed with the same parent on
+ * several threads at once. Nor may their blocks, whose strings are not
+ * referenced, be shared with styles which reference theirs.
+ */
+bool blocks_shareable(const css_computed_style *parent,
+		const css_computed_style *result)
 {
-	uint8_t bits = style->bits[CSS_DISPLAY_INDEX];
-	bits &= CSS_DISPLAY_MASK;
-	bits >>= CSS_DISPLAY_SHIFT;
-
-	/* 5bits: type */
-	return bits;
+	return result->alloc == parent->alloc && result->pw == parent->pw &&
+			result->borrowed == false && parent->borrowed == false;
 }
 
-#undef CSS_DISPLAY_MASK
-#undef CSS_DISPLAY_SHIFT
-#undef CSS_DISPLAY_INDEX
-
-#define CSS_FONT_VARIANT_INDEX 27
-#define CSS_FONT_VARIANT_SHIFT 0
-#define CSS_FONT_VARIANT_MASK  0x3
-uint8_t css_computed_font_variant(
-		const css_computed_style *style)
+/**
+ * Determine whether a child without uncommon properties may share its
+ * parent's block of them
+ *
+ * \param parent  Composed parent style, with uncommon properties
+ * \return true if the block may be shared, false otherwise
+ *
+ * A child without the block inherits its parent's inherited uncommon
+ * properties, and takes the Initial value of the others. It may only share
+ * the parent's block if the parent's values of the others are Initial too.
+ */
+bool uncommon_shareable(const css_computed_style *parent)
 {
-	uint8_t bits = style->bits[CSS_FONT_VARIANT_INDEX];
-	bits &= CSS_FONT_VARIANT_MASK;
-	bits >>= CSS_FONT_VARIANT_SHIFT;
+	const css_computed_counter *increment = NULL, *reset = NULL;
+	const css_computed_content_item *content;
+	css_computed_clip_rect rect;
+	css_color color;
+	css_fixed length = 0;
+	css_unit unit = CSS_UNIT_PX;
 
-	/* 2bits: type */
-	return bits;
+	/* Counters are named, rather than none, if there are names */
+	return get_outline_color(parent, &color) == CSS_OUTLINE_COLOR_INVERT &&
+			get_outline_width(parent, &length, &unit) ==
+					CSS_OUTLINE_WIDTH_WIDTH &&
+			length == INTTOFIX(2) && unit == CSS_UNIT_PX &&
+			get_counter_increment(parent, &increment) ==
+					CSS_COUNTER_INCREMENT_NONE &&
+			increment == NULL &&
+			get_counter_reset(parent, &reset) ==
+					CSS_COUNTER_RESET_NONE &&
+			reset == NULL &&
+			get_clip(parent, &rect) == CSS_CLIP_AUTO &&
+			get_content(parent, &content) == CSS_CONTENT_NORMAL;
 }
-#undef CSS_FONT_VARIANT_MASK
-#undef CSS_FONT_VARIANT_SHIFT
-#undef CSS_FONT_VARIANT_INDEX
-
-#define CSS_TEXT_DECORATION_INDEX 28
-#define CSS_TEXT_DECORATION_SHIFT 3
-#define CSS_TEXT_DECORATION_MASK  0xf8
-uint8_t css_computed_text_decoration(
-		const css_computed_style *style)
-{
-	uint8_t bits = style->bits[CSS_TEXT_DECORATION_INDEX];
-	bits &= CSS_TEXT_DECORATION_MASK;
-	bits >>= CSS_TEXT_DECORATION_SHIFT;
 
-	/* 5bits: type */
-	return bits;
-}
-#undef CSS_TEXT_DECORATION_MASK
-#undef CSS_TEXT_DECORATION_SHIFT
-#undef CSS_TEXT_DECORATION_INDEX
-
-#define CSS_FONT_FAMILY_INDEX 28
-#define CSS_FONT_FAMILY_SHIFT 0
-#define CSS_FONT_FAMILY_MASK  0x7
-uint8_t css_computed_font_family(
-		const css_computed_style *style, 
-		lwc_string ***names)
+/**
+ * Share a parent's page properties, if a composed style's are the same
+ *
+ * \param parent  Composed parent style
+ * \param result  Composed style
+ */
+void share_page(const css_computed_style *parent,
+		css_computed_style *result)
 {
-	uint8_t bits = style->bits[CSS_FONT_FAMILY_INDEX];
-	bits &= CSS_FONT_FAMILY_MASK;
-	bits >>= CSS_FONT_FAMILY_SHIFT;
+	if (result->page == NULL || parent->page == NULL ||
+			result->page == parent->page ||
+			result->page->refcount > 1 ||
+			blocks_shareable(parent, result) == false)
+		return;
 
-	/* 3bits: type */
-	*names = style->font_family;
+	if (memcmp(result->page, parent->page,
+			offsetof(css_computed_page, refcount)) != 0)
+		return;
 
-	return bits;
-}
-#undef CSS_FONT_FAMILY_MASK
-#undef CSS_FONT_FAMILY_SHIFT
-#undef CSS_FONT_FAMILY_INDEX
-
-#define CSS_BORDER_TOP_STYLE_INDEX 29
-#define CSS_BORDER_TOP_STYLE_SHIFT 4
-#define CSS_BORDER_TOP_STYLE_MASK  0xf0
-uint8_t css_computed_border_top_style(
-		const css_computed_style *style)
-{
-	uint8_t bits = style->bits[CSS_BORDER_TOP_STYLE_INDEX];
-	bits &= CSS_BORDER_TOP_STYLE_MASK;
-	bits >>= CSS_BORDER_TOP_STYLE_SHIFT;
+	result->alloc(result->page, 0, result->pw);
 
-	/* 4bits: type */
-	return bits;
+	result->page = parent->page;
+	result->page->refcount++;
 }
-#undef CSS_BORDER_TOP_STYLE_MASK
-#undef CSS_BORDER_TOP_STYLE_SHIFT
-#undef CSS_BORDER_TOP_STYLE_INDEX
-
-#define CSS_BORDER_RIGHT_STYLE_INDEX 29
-#define CSS_BORDER_RIGHT_STYLE_SHIFT 0
-#define CSS_BORDER_RIGHT_STYLE_MASK  0xf
-uint8_t css_computed_border_right_style(
-		const css_computed_style *style)
-{
-	uint8_t bits = style->bits[CSS_BORDER_RIGHT_STYLE_INDEX];
-	bits &= CSS_BORDER_RIGHT_STYLE_MASK;
-	bits >>= CSS_BORDER_RIGHT_STYLE_SHIFT;
 
-	/* 4bits: type */
-	return bits;
-}
-#undef CSS_BORDER_RIGHT_STYLE_MASK
-#undef CSS_BORDER_RIGHT_STYLE_SHIFT
-#undef CSS_BORDER_RIGHT_STYLE_INDEX
-
-#define CSS_BORDER_BOTTOM_STYLE_INDEX 30
-#define CSS_BORDER_BOTTOM_STYLE_SHIFT 4
-#define CSS_BORDER_BOTTOM_STYLE_MASK  0xf0
-uint8_t css_computed_border_bottom_style(
-		const css_computed_style *style)
+/**
+ * Determine whether a style's font size is a given one
+ *
+ * \param style  Style to examine
+ * \param size   Font size to compare with
+ * \return true if the sizes are equal, false otherwise
+ */
+bool font_size_equal(const css_computed_style *style, const css_hint *size)
 {
-	uint8_t bits = style->bits[CSS_BORDER_BOTTOM_STYLE_INDEX];
-	bits &= CSS_BORDER_BOTTOM_STYLE_MASK;
-	bits >>= CSS_BORDER_BOTTOM_STYLE_SHIFT;
+	css_fixed length = 0;
+	css_unit unit = CSS_UNIT_PX;
 
-	/* 4bits: type */
-	return bits;
-}
-#undef CSS_BORDER_BOTTOM_STYLE_MASK
-#undef CSS_BORDER_BOTTOM_STYLE_SHIFT
-#undef CSS_BORDER_BOTTOM_STYLE_INDEX
-
-#define CSS_BORDER_LEFT_STYLE_INDEX 30
-#define CSS_BORDER_LEFT_STYLE_SHIFT 0
-#define CSS_BORDER_LEFT_STYLE_MASK  0xf
-uint8_t css_computed_border_left_style(
-		const css_computed_style *style)
-{
-	uint8_t bits = style->bits[CSS_BORDER_LEFT_STYLE_INDEX];
-	bits &= CSS_BORDER_LEFT_STYLE_MASK;
-	bits >>= CSS_BORDER_LEFT_STYLE_SHIFT;
+	if (get_font_size(style, &length, &unit) != size->status)
+		return false;
 
-	/* 4bits: type */
-	return bits;
+	return size->status != CSS_FONT_SIZE_DIMENSION ||
+			(length == size->data.length.value &&
+			unit == size->data.length.unit);
 }
-#undef CSS_BORDER_LEFT_STYLE_MASK
-#undef CSS_BORDER_LEFT_STYLE_SHIFT
-#undef CSS_BORDER_LEFT_STYLE_INDEX
-
-#define CSS_FONT_WEIGHT_INDEX 31
-#define CSS_FONT_WEIGHT_SHIFT 4
-#define CSS_FONT_WEIGHT_MASK  0xf0
-uint8_t css_computed_font_weight(
-		const css_computed_style *style)
-{
-	uint8_t bits = style->bits[CSS_FONT_WEIGHT_INDEX];
-	bits &= CSS_FONT_WEIGHT_MASK;
-	bits >>= CSS_FONT_WEIGHT_SHIFT;
 
-	/* 4bits: type */
-	return bits;
-}
-#undef CSS_FONT_WEIGHT_MASK
-#undef CSS_FONT_WEIGHT_SHIFT
-#undef CSS_FONT_WEIGHT_INDEX
-
-#define CSS_LIST_STYLE_TYPE_INDEX 31
-#define CSS_LIST_STYLE_TYPE_SHIFT 0
-#define CSS_LIST_STYLE_TYPE_MASK  0xf
-uint8_t css_computed_list_style_type(
-		const css_computed_style *style)
+/**
+ * Populate a blank computed style with Initial values
+ *
+ * \param style    Computed style to populate
+ * \param handler  Dispatch table of handler functions
+ * \param pw       Client-specific private data for handler functions
+ * \return CSS_OK on success.
+ */
+css_error css_computed_style_initialise(css_computed_style *style,
+		css_select_handler *handler, void *pw)
 {
-	uint8_t bits = style->bits[CSS_LIST_STYLE_TYPE_INDEX];
-	bits &= CSS_LIST_STYLE_TYPE_MASK;
-	bits >>= CSS_LIST_STYLE_TYPE_SHIFT;
+	css_select_state state;
+	uint32_t i;
+	css_error error;
 
-	/* 4bits: type */
-	return bits;
-}
-#undef CSS_LIST_STYLE_TYPE_MASK
-#undef CSS_LIST_STYLE_TYPE_SHIFT
-#undef CSS_LIST_STYLE_TYPE_INDEX
-
-#define CSS_OUTLINE_STYLE_INDEX 32
-#define CSS_OUTLINE_STYLE_SHIFT 4
-#define CSS_OUTLINE_STYLE_MASK  0xf0
-uint8_t css_computed_outline_style(
-		const css_computed_style *style)
-{
-	uint8_t bits = style->bits[CSS_OUTLINE_STYLE_INDEX];
-	bits &= CSS_OUTLINE_STYLE_MASK;
-	bits >>= CSS_OUTLINE_STYLE_SHIFT;
+	if (style == NULL)
+		return CSS_BADPARM;
 
-	/* 4bits: type */
-	return bits;
-}
-#undef CSS_OUTLINE_STYLE_MASK
-#undef CSS_OUTLINE_STYLE_SHIFT
-#undef CSS_OUTLINE_STYLE_INDEX
-
-#define CSS_TABLE_LAYOUT_INDEX 32
-#define CSS_TABLE_LAYOUT_SHIFT 2
-#define CSS_TABLE_LAYOUT_MASK  0xc
-uint8_t css_computed_table_layout(
-		const css_computed_style *style)
-{
-	uint8_t bits = style->bits[CSS_TABLE_LAYOUT_INDEX];
-	bits &= CSS_TABLE_LAYOUT_MASK;
-	bits >>= CSS_TABLE_LAYOUT_SHIFT;
+	/* Interned styles may be shared, so are immutable */
+	if (css__computed_style_shared(style))
+		return CSS_INVALID;
 
-	/* 2bits: type */
-	return bits;
-}
-#undef CSS_TABLE_LAYOUT_MASK
-#undef CSS_TABLE_LAYOUT_SHIFT
-#undef CSS_TABLE_LAYOUT_INDEX
-
-#define CSS_UNICODE_BIDI_INDEX 32
-#define CSS_UNICODE_BIDI_SHIFT 0
-#define CSS_UNICODE_BIDI_MASK  0x3
-uint8_t css_computed_unicode_bidi(
-		const css_computed_style *style)
-{
-	uint8_t bits = style->bits[CSS_UNICODE_BIDI_INDEX];
-	bits &= CSS_UNICODE_BIDI_MASK;
-	bits >>= CSS_UNICODE_BIDI_SHIFT;
+	state.node = NULL;
+	state.media = CSS_MEDIA_ALL;
+	state.results = NULL;
+	state.computed = style;
+	state.handler = handler;
+	state.pw = pw;
 
-	/* 2bits: type */
-	return bits;
-}
-#undef CSS_UNICODE_BIDI_MASK
-#undef CSS_UNICODE_BIDI_SHIFT
-#undef CSS_UNICODE_BIDI_INDEX
-
-#define CSS_VISIBILITY_INDEX 33
-#define CSS_VISIBILITY_SHIFT 6
-#define CSS_VISIBILITY_MASK  0xc0
-uint8_t css_computed_visibility(
-		const css_computed_style *style)
-{
-	uint8_t bits = style->bits[CSS_VISIBILITY_INDEX];
-	bits &= CSS_VISIBILITY_MASK;
-	bits >>= CSS_VISIBILITY_SHIFT;
+	for (i = 0; i < CSS_N_PROPERTIES; i++) {
+		/* No need to initialise anything other than the normal
+		 * properties -- the others are handled by the accessors */
+		if (prop_dispatch[i].inherited == false &&
+				prop_dispatch[i].group == GROUP_NORMAL) {
+			error = prop_dispatch[i].initial(&state);
+			if (error != CSS_OK)
+				return error;
+		}
+	}
 
-	/* 2bits: type */
-	return bits;
+	return CSS_OK;
 }
-#undef CSS_VISIBILITY_MASK
-#undef CSS_VISIBILITY_SHIFT
-#undef CSS_VISIBILITY_INDEX
-
-#define CSS_LIST_STYLE_POSITION_INDEX 33
-#define CSS_LIST_STYLE_POSITION_SHIFT 4
-#define CSS_LIST_STYLE_POSITION_MASK  0x30
-uint8_t css_computed_list_style_position(
-		const css_computed_style *style)
-{
-	uint8_t bits = style->bits[CSS_LIST_STYLE_POSITION_INDEX];
-	bits &= CSS_LIST_STYLE_POSITION_MASK;
-	bits >>= CSS_LIST_STYLE_POSITION_SHIFT;
 
-	/* 2bits: type */
-	return bits;
-}
-#undef CSS_LIST_STYLE_POSITION_MASK
-#undef CSS_LIST_STYLE_POSITION_SHIFT
-#undef CSS_LIST_STYLE_POSITION_INDEX
-
-#define CSS_TEXT_ALIGN_INDEX 33
-#define CSS_TEXT_ALIGN_SHIFT 0
-#define CSS_TEXT_ALIGN_MASK  0xf
-uint8_t css_computed_text_align(
-		const css_computed_style *style)
+/**
+ * Compose two computed styles
+ *
+ * \param parent             Parent style
+ * \param child              Child style
+ * \param compute_font_size  Function to compute an absolute font size
+ * \param pw                 Client data for compute_font_size
+ * \param result             Pointer to style to compose into
+ * \return CSS_OK on success, appropriate error otherwise.
+ *
+ * \pre \a parent is a fully composed style (thus has no inherited properties)
+ * \pre \a result is not interned, as interned styles may be shared
+ * \pre If \a result borrows its strings, so do \a parent and \a child
+ *
+ * \note \a child and \a result may point at the same object
+ * \note \a result may share \a parent's extension blocks, whose reference
+ *       counts are updated even though \a parent is const, unless either
+ *       borrows its strings
+ */
+css_error css_computed_style_compose(const css_computed_style *parent,
+		const css_computed_style *child,
+		css_error (*compute_font_size)(void *pw,
+			const css_hint *parent, css_hint *size),
+		void *pw,
+		css_computed_style *result)
 {
-	uint8_t bits = style->bits[CSS_TEXT_ALIGN_INDEX];
-	bits &= CSS_TEXT_ALIGN_MASK;
-	bits >>= CSS_TEXT_ALIGN_SHIFT;
+	css_error error = CSS_OK;
+	bool share_inherited, share_uncommon;
+	size_t i;
 
-	/* 4bits: type */
-	return bits;
-}
-#undef CSS_TEXT_ALIGN_MASK
-#undef CSS_TEXT_ALIGN_SHIFT
-#undef CSS_TEXT_ALIGN_INDEX
-
-#define CSS_PAGE_BREAK_AFTER_INDEX 0
-#define CSS_PAGE_BREAK_AFTER_SHIFT 0
-#define CSS_PAGE_BREAK_AFTER_MASK 0x7
-uint8_t css_computed_page_break_after(
-		const css_computed_style *style)
-{
-	if (style->page != NULL) {
-		uint8_t bits = style->page->bits[CSS_PAGE_BREAK_AFTER_INDEX];
-		bits &= CSS_PAGE_BREAK_AFTER_MASK;
-		bits >>= CSS_PAGE_BREAK_AFTER_SHIFT;
-	
-		/* 3bits: type */
-		return bits;
-	}
-    
-	return CSS_PAGE_BREAK_AFTER_AUTO;
-}
-#undef CSS_PAGE_BREAK_AFTER_MASK
-#undef CSS_PAGE_BREAK_AFTER_SHIFT
-#undef CSS_PAGE_BREAK_AFTER_INDEX
- 
-#define CSS_PAGE_BREAK_BEFORE_INDEX 0
-#define CSS_PAGE_BREAK_BEFORE_SHIFT 3
-#define CSS_PAGE_BREAK_BEFORE_MASK 0x38
-uint8_t css_computed_page_break_before(
-		const css_computed_style *style)
-{
-	if (style->page != NULL) {
-		uint8_t bits = style->page->bits[CSS_PAGE_BREAK_BEFORE_INDEX];
-		bits &= CSS_PAGE_BREAK_BEFORE_MASK;
-		bits >>= CSS_PAGE_BREAK_BEFORE_SHIFT;
-	
-		/* 3bits: type */
-		return bits;
-	}
-    
-	return CSS_PAGE_BREAK_BEFORE_AUTO;
-}
-#undef CSS_PAGE_BREAK_BEFORE_MASK
-#undef CSS_PAGE_BREAK_BEFORE_SHIFT
-#undef CSS_PAGE_BREAK_BEFORE_INDEX
-    
-#define CSS_PAGE_BREAK_INSIDE_INDEX 0
-#define CSS_PAGE_BREAK_INSIDE_SHIFT 6
-#define CSS_PAGE_BREAK_INSIDE_MASK 0xc0
-uint8_t css_computed_page_break_inside(
-	    const css_computed_style *style)
-{
-	if (style->page != NULL) {
-		uint8_t bits = style->page->bits[CSS_PAGE_BREAK_INSIDE_INDEX];
-		bits &= CSS_PAGE_BREAK_INSIDE_MASK;
-		bits >>= CSS_PAGE_BREAK_INSIDE_SHIFT;
-	
-		/* 2bits: type */
-		return bits;
-	}
-    
-	return CSS_PAGE_BREAK_INSIDE_AUTO;
-}
-#undef CSS_PAGE_BREAK_INSIDE_MASK
-#undef CSS_PAGE_BREAK_INSIDE_SHIFT
-#undef CSS_PAGE_BREAK_INSIDE_INDEX
-
-#define CSS_ORPHANS_INDEX 1
-#define CSS_ORPHANS_SHIFT 0
-#define CSS_ORPHANS_MASK  0x1
-uint8_t css_computed_orphans(
-		const css_computed_style *style, 
-		int32_t *orphans)
-{
-	if (style->page != NULL) {
-		uint8_t bits = style->page->bits[CSS_ORPHANS_INDEX];
-		bits &= CSS_ORPHANS_MASK;
-		bits >>= CSS_ORPHANS_SHIFT;
+	if (css__computed_style_shared(result))
+		return CSS_INVALID;
+
+	/* A style which borrows strings may only take them from others
+	 * which borrow them too */
+	if (result->borrowed && (parent->borrowed == false ||
+			child->borrowed == false))
+		return CSS_INVALID;
+
+	/* A child without a block of inherited properties inherits all of
+	 * them, so shares its parent's block */
+	share_inherited = child->inherited == NULL &&
+			(parent->inherited == NULL ||
+			blocks_shareable(parent, result));
+	if (share_inherited && result->inherited != parent->inherited) {
+		if (result->inherited != NULL) {
+			if (result->inherited->refcount > 1)
+				result->inherited->refcount--;
+			else
+				destroy_inherited(result, result->inherited);
+		}
 
-		*orphans = FIXTOINT(style->page->orphans);;
+		result->inherited = parent->inherited;
+		if (result->inherited != NULL)
+			result->inherited->refcount++;
+	}
+
+	/* A child without uncommon properties may share its parent's block,
+	 * rather than copying it. The parent's values are already absolute. */
+	share_uncommon = child->uncommon == NULL && parent->uncommon != NULL &&
+			blocks_shareable(parent, result) &&
+			uncommon_shareable(parent);
+	if (share_uncommon && result->uncommon != parent->uncommon) {
+		if (result->uncommon != NULL) {
+			if (result->uncommon->refcount > 1)
+				result->uncommon->refcount--;
+			else
+				destroy_uncommon(result, result->uncommon);
+		}
 
-		/* 1bit: type */
-		return bits;
+		result->uncommon = parent->uncommon;
+		result->uncommon->refcount++;
 	}
 
-	/* Use initial value */
-	*orphans = 2;
+	/* Iterate through the properties */
+	for (i = 0; i < CSS_N_PROPERTIES; i++) {
+		/* Skip any in extension blocks if the block does not exist */	
+		if (prop_dispatch[i].group == GROUP_INHERITED &&
+				share_inherited)
+			continue;
 
-	return CSS_ORPHANS_SET;
-}
-#undef CSS_ORPHANS_MASK
-#undef CSS_ORPHANS_SHIFT
-#undef CSS_ORPHANS_INDEX
-
-#define CSS_WIDOWS_INDEX 1
-#define CSS_WIDOWS_SHIFT 1
-#define CSS_WIDOWS_MASK  0x2
-uint8_t css_computed_widows(
-		const css_computed_style *style, 
-		int32_t *widows)
-{
-	if (style->page != NULL) {
-		uint8_t bits = style->page->bits[CSS_WIDOWS_INDEX];
-		bits &= CSS_WIDOWS_MASK;
-		bits >>= CSS_WIDOWS_SHIFT;
+		if (prop_dispatch[i].group == GROUP_UNCOMMON &&
+				((parent->uncommon == NULL &&
+				child->uncommon == NULL) || share_uncommon))
+			continue;
+
+		if (prop_dispatch[i].group == GROUP_PAGE &&
+				parent->page == NULL && child->page == NULL)
+			continue;
 
-		*widows = FIXTOINT(style->page->widows);
+		if (prop_dispatch[i].group == GROUP_AURAL &&
+				parent->aural == NULL && child->aural == NULL)
+			continue;
 
-		/* 1bit: type */
-		return bits;
+		/* Compose the property */
+		error = prop_dispatch[i].compose(parent, child, result);
+		if (error != CSS_OK)
+			break;
 	}
 
-	/* Use initial value */
-	*widows = 2;
+	share_page(parent, result);
 
-	return CSS_WIDOWS_SET;
+	/* Finally, compute absolute values for everything */
+	return css__compute_absolute_values(parent, result, compute_font_size, pw);
 }
-#undef CSS_WIDOWS_MASK
-#undef CSS_WIDOWS_SHIFT
-#undef CSS_WIDOWS_INDEX
+
+/******************************************************************************
+ * Property accessors                                                         *
+ ******************************************************************************/
+
+
+/* The accessors are defined in a public header, so that clients may have
+ * them inline. Here, they are given the external definitions exported by
+ * the library. */
+#include <libcss/computed_inline.h>
 
 
 /******************************************************************************
@@ -2315,11 +881,16 @@ css_error css__compute_absolute_values(const css_computed_style *parent,
 	if (error != CSS_OK)
 		return error;
 
-	error = set_font_size(style, size.status,
-			size.data.length.value, 
-			size.data.length.unit);
-	if (error != CSS_OK)
-		return error;
+	/* A shared block was taken from a composed style, so its values are
+	 * already absolute and are left alone unless the client disagrees */
+	if (style->inherited == NULL || style->inherited->refcount == 1 ||
+			font_size_equal(style, &size) == false) {
+		error = set_font_size(style, size.status,
+				size.data.length.value,
+				size.data.length.unit);
+		if (error != CSS_OK)
+			return error;
+	}
 
 	/* Compute the size of an ex unit */
 	ex_size.status = CSS_FONT_SIZE_DIMENSION;
@@ -2373,9 +944,12 @@ css_error css__compute_absolute_values(const css_computed_style *parent,
 		return error;
 
 	/* Fix up line-height (must be before vertical-align) */
-	error = compute_absolute_line_height(style, &ex_size.data.length);
-	if (error != CSS_OK)
-		return error;
+	if (style->inherited == NULL || style->inherited->refcount == 1) {
+		error = compute_absolute_line_height(style,
+				&ex_size.data.length);
+		if (error != CSS_OK)
+			return error;
+	}
 
 	/* Fix up margins */
 	error = compute_absolute_margins(style, &ex_size.data.length);
@@ -2412,10 +986,12 @@ css_error css__compute_absolute_values(const css_computed_style *parent,
 		return error;
 
 	/* Fix up text-indent */
-	error = compute_absolute_length(style, &ex_size.data.length, 
-			get_text_indent, set_text_indent);
-	if (error != CSS_OK)
-		return error;
+	if (style->inherited == NULL || style->inherited->refcount == 1) {
+		error = compute_absolute_length(style, &ex_size.data.length,
+				get_text_indent, set_text_indent);
+		if (error != CSS_OK)
+			return error;
+	}
 
 	/* Fix up vertical-align */
 	error = compute_absolute_vertical_align(style, &ex_size.data.length);
@@ -2428,8 +1004,8 @@ css_error css__compute_absolute_values(const css_computed_style *parent,
 	if (error != CSS_OK)
 		return error;
 
-	/* Uncommon properties */
-	if (style->uncommon != NULL) {
+	/* Uncommon properties, unless shared with an absolute style */
+	if (style->uncommon != NULL && style->uncommon->refcount == 1) {
 		/* Fix up border-spacing */
 		error = compute_absolute_length_pair(style,
 				&ex_size.data.length,
@@ -2869,8 +1445,8 @@ css_error compute_absolute_length(css_computed_style *style,
 		css_error (*set)(css_computed_style *style, uint8_t type,
 				css_fixed len, css_unit unit))
 {
-	css_fixed length;
-	css_unit unit;
+	css_fixed length = 0;
+	css_unit unit = CSS_UNIT_PX;
 	uint8_t type;
 
 	type = get(style, &length, &unit);
@@ -2899,8 +1475,8 @@ css_error compute_absolute_length_auto(css_computed_style *style,
 		css_error (*set)(css_computed_style *style, uint8_t type,
 				css_fixed len, css_unit unit))
 {
-	css_fixed length;
-	css_unit unit;
+	css_fixed length = 0;
+	css_unit unit = CSS_UNIT_PX;
 	uint8_t type;
 
 	type = get(style, &length, &unit);
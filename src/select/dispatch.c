@@ -141,7 +141,7 @@ struct prop_table prop_dispatch[CSS_N_PROPERTIES] = {
 	{
 		PROPERTY_FUNCS(color),
 		1,
-		GROUP_NORMAL
+		GROUP_INHERITED
 	},
 	{
 		PROPERTY_FUNCS(content),
@@ -201,12 +201,12 @@ struct prop_table prop_dispatch[CSS_N_PROPERTIES] = {
 	{
 		PROPERTY_FUNCS(font_family),
 		1,
-		GROUP_NORMAL
+		GROUP_INHERITED
 	},
 	{
 		PROPERTY_FUNCS(font_size),
 		1,
-		GROUP_NORMAL
+		GROUP_INHERITED
 	},
 	{
 		PROPERTY_FUNCS(font_style),
@@ -241,12 +241,12 @@ struct prop_table prop_dispatch[CSS_N_PROPERTIES] = {
 	{
 		PROPERTY_FUNCS(line_height),
 		1,
-		GROUP_NORMAL
+		GROUP_INHERITED
 	},
 	{
 		PROPERTY_FUNCS(list_style_image),
 		1,
-		GROUP_NORMAL
+		GROUP_INHERITED
 	},
 	{
 		PROPERTY_FUNCS(list_style_position),
@@ -391,7 +391,7 @@ struct prop_table prop_dispatch[CSS_N_PROPERTIES] = {
 	{
 		PROPERTY_FUNCS(quotes),
 		1,
-		GROUP_NORMAL
+		GROUP_INHERITED
 	},
 	{
 		PROPERTY_FUNCS(richness),
@@ -451,7 +451,7 @@ struct prop_table prop_dispatch[CSS_N_PROPERTIES] = {
 	{
 		PROPERTY_FUNCS(text_indent),
 		1,
-		GROUP_NORMAL
+		GROUP_INHERITED
 	},
 	{
 		PROPERTY_FUNCS(text_transform),
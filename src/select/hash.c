@@ -6,32 +6,115 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "stylesheet.h"
 #include "select/hash.h"
 #include "utils/utils.h"
 
-typedef struct hash_entry {
-	const css_selector *sel;
-	struct hash_entry *next;
-} hash_entry;
+typedef css_selector_hash_entry hash_entry;
+
+/**
+ * Chain of selectors, held in an array
+ *
+ * The array ends with an entry whose selector is NULL, which is not
+ * counted. Chains filled when a hash is built share a block of entries,
+ * and are copied to an array of their own if they must grow.
+ */
+typedef struct hash_bucket {
+	hash_entry *entries;		/**< Entries, in cascade order */
+	uint32_t n_entries;		/**< Number of entries */
+	uint32_t size;			/**< Allocated size of entries, or 0 if
+					 * they are in a block */
+} hash_bucket;
 
 typedef struct hash_t {
 #define DEFAULT_SLOTS (1<<6)
 	size_t n_slots;
+/* Tables grow once they hold more than this many selectors per slot */
+#define MAX_LOAD 2
+	size_t n_entries;
 
-	hash_entry *slots;
+	hash_bucket *slots;
 } hash_t;
 
-struct css_selector_hash {
+/**
+ * Selectors which select a given pseudo element
+ *
+ * The tables of a partition are allocated when a selector is first
+ * inserted into it, except for those of the base element's partition.
+ */
+typedef struct hash_partition {
 	hash_t elements;
 
 	hash_t classes;
 
 	hash_t ids;
 
-	hash_entry universal;
+	hash_t attributes;
+
+	/** Every selector in the attribute hash, for use when the names of
+	 * a node's attributes are unknown */
+	hash_bucket any_attribute;
+
+	/** Selectors requiring a node state, one chain for each
+	 * css_node_state_flags bit */
+#define N_STATES 11
+	hash_bucket states[N_STATES];
+
+	hash_bucket universal;
+} hash_partition;
+
+/**
+ * Block of entries allocated at once, which the entries follow
+ */
+typedef struct hash_block {
+	struct hash_block *next;	/**< Next block */
+	size_t n_entries;		/**< Number of entries in block */
+} hash_block;
+
+/**
+ * Selector awaiting insertion, while insertion is deferred
+ */
+typedef struct hash_pending {
+	const css_selector *sel;
+	uint32_t source;
+} hash_pending;
+
+/**
+ * Placement of a selector, when a hash is built in bulk
+ */
+typedef struct hash_placement {
+	hash_entry entry;		/**< Entry for selector */
+	uint32_t slot;			/**< Slot of table, or 0 for chains */
+	uint32_t seq;			/**< Order of insertion */
+	uint8_t pseudo;			/**< Partition */
+	uint8_t chain;			/**< Table or chain, as below */
+#define CHAIN_ELEMENTS		(0)
+#define CHAIN_CLASSES		(1)
+#define CHAIN_IDS		(2)
+#define CHAIN_ATTRIBUTES	(3)
+#define CHAIN_STATES		(4)
+#define CHAIN_ANY_ATTRIBUTE	(CHAIN_STATES + N_STATES)
+#define CHAIN_UNIVERSAL		(CHAIN_ANY_ATTRIBUTE + 1)
+} hash_placement;
+
+struct css_selector_hash {
+	/** Partitions, indexed by css_pseudo_element */
+	hash_partition partitions[CSS_PSEUDO_ELEMENT_COUNT];
+
+	uint32_t partition_mask;	/**< Mask of partitions allocated */
+
+	uint32_t state_mask;		/**< Mask of state chains in use */
+	uint32_t n_attribute_selectors;	/**< Selectors keyed by attribute */
+
+	bool deferred;			/**< Whether insertion is deferred */
+	hash_pending *pending;		/**< Selectors awaiting insertion */
+	uint32_t n_pending;		/**< Number of selectors awaiting */
+	uint32_t pending_size;		/**< Allocated size of pending */
+
+	hash_block *blocks;		/**< Blocks of entries */
 
 	size_t hash_size;
 
@@ -39,24 +122,43 @@ struct css_selector_hash {
 	void *pw;
 };
 
+/* Terminates chains with no entries */
 static hash_entry empty_slot;
 
+static css_error _partition_create(css_selector_hash *hash,
+		css_pseudo_element pseudo, uint32_t n_slots);
+static void _partition_destroy(css_selector_hash *hash, hash_partition *p);
 static inline uint32_t _hash_name(lwc_string *name);
 static inline lwc_string *_class_name(const css_selector *selector);
 static inline lwc_string *_id_name(const css_selector *selector);
-static css_error _insert_into_chain(css_selector_hash *ctx, hash_entry *head, 
+static inline lwc_string *_attribute_name(const css_selector *selector);
+static inline uint32_t _state_index(uint32_t state);
+static void _update_state_mask(css_selector_hash *hash, uint32_t index);
+static uint8_t _chain_of(const css_selector *selector, lwc_string **key,
+		uint32_t *hash_value);
+static hash_t *_chain_table(hash_partition *p, uint8_t chain);
+static hash_bucket *_chain_bucket(hash_partition *p, uint8_t chain,
+		uint32_t hash_value);
+static css_error _find_in_table(css_selector_hash *hash,
+		css_pseudo_element pseudo, uint8_t chain, lwc_string *name,
+		const hash_entry **matched);
+static css_error _grow_table(css_selector_hash *hash, hash_t *table);
+static hash_entry *_alloc_block(css_selector_hash *hash, size_t n_entries);
+static void _free_bucket(css_selector_hash *hash, hash_bucket *bucket);
+static css_error _insert_into_bucket(css_selector_hash *hash,
+		hash_bucket *bucket, const hash_entry *entry);
+static css_error _remove_from_bucket(hash_bucket *bucket,
 		const css_selector *selector);
-static css_error _remove_from_chain(css_selector_hash *ctx, hash_entry *head,
+static inline bool _entry_follows(const hash_entry *a, const hash_entry *b);
+static void _make_entry(hash_entry *entry, const css_selector *selector,
+		uint32_t source, lwc_string *key, uint32_t hash_value);
+static css_error _defer_insert(css_selector_hash *hash,
+		const css_selector *selector, uint32_t source);
+static bool _remove_pending(css_selector_hash *hash,
 		const css_selector *selector);
-
-static css_error _iterate_elements(const css_selector **current,
-		const css_selector ***next);
-static css_error _iterate_classes(const css_selector **current,
-		const css_selector ***next);
-static css_error _iterate_ids(const css_selector **current,
-		const css_selector ***next);
-static css_error _iterate_universal(const css_selector **current,
-		const css_selector ***next);
+static int _compare_placements(const void *a, const void *b);
+static inline bool _same_chain(const hash_placement *a,
+		const hash_placement *b);
 
 /**
  * Create a hash
@@ -66,59 +168,51 @@ static css_error _iterate_universal(const css_selector **current,
  * \param hash   Pointer to location to receive result
  * \return CSS_OK on success, appropriate error otherwise
  */
-css_error css__selector_hash_create(css_allocator_fn alloc, void *pw, 
+css_error css__selector_hash_create(css_allocator_fn alloc, void *pw,
 		css_selector_hash **hash)
+{
+	return css__selector_hash_create_sized(alloc, pw, DEFAULT_SLOTS, hash);
+}
+
+/**
+ * Create a hash with a given number of slots
+ *
+ * \param alloc    Memory (de)allocation function
+ * \param pw       Pointer to client-specific private data
+ * \param n_slots  Initial number of slots in each of the tables of the
+ *                 base element's selectors, which must be a power of 2
+ * \param hash     Pointer to location to receive result
+ * \return CSS_OK on success, appropriate error otherwise
+ */
+css_error css__selector_hash_create_sized(css_allocator_fn alloc, void *pw,
+		uint32_t n_slots, css_selector_hash **hash)
 {
 	css_selector_hash *h;
+	css_error error;
 
-	if (alloc == NULL || hash == NULL)
+	if (alloc == NULL || hash == NULL || n_slots == 0 ||
+			(n_slots & (n_slots - 1)) != 0)
 		return CSS_BADPARM;
 
 	h = alloc(0, sizeof(css_selector_hash), pw);
 	if (h == NULL)
 		return CSS_NOMEM;
 
-	/* Element hash */
-	h->elements.slots = alloc(0, DEFAULT_SLOTS * sizeof(hash_entry), pw);
-	if (h->elements.slots == NULL) {
-		alloc(h, 0, pw);
-		return CSS_NOMEM;
-	}
-	memset(h->elements.slots, 0, DEFAULT_SLOTS * sizeof(hash_entry));
-	h->elements.n_slots = DEFAULT_SLOTS;
-
-	/* Class hash */
-	h->classes.slots = alloc(0, DEFAULT_SLOTS * sizeof(hash_entry), pw);
-	if (h->classes.slots == NULL) {
-		alloc(h->elements.slots, 0, pw);
-		alloc(h, 0, pw);
-		return CSS_NOMEM;
-	}
-	memset(h->classes.slots, 0, DEFAULT_SLOTS * sizeof(hash_entry));
-	h->classes.n_slots = DEFAULT_SLOTS;
-
-	/* ID hash */
-	h->ids.slots = alloc(0, DEFAULT_SLOTS * sizeof(hash_entry), pw);
-	if (h->ids.slots == NULL) {
-		alloc(h->classes.slots, 0, pw);
-		alloc(h->elements.slots, 0, pw);
-		alloc(h, 0, pw);
-		return CSS_NOMEM;
-	}
-	memset(h->ids.slots, 0, DEFAULT_SLOTS * sizeof(hash_entry));
-	h->ids.n_slots = DEFAULT_SLOTS;
-
-	/* Universal chain */
-	memset(&h->universal, 0, sizeof(hash_entry));
+	memset(h, 0, sizeof(css_selector_hash));
 
-	h->hash_size = sizeof(css_selector_hash) + 
-			DEFAULT_SLOTS * sizeof(hash_entry) +
-			DEFAULT_SLOTS * sizeof(hash_entry) +
-			DEFAULT_SLOTS * sizeof(hash_entry);
+	h->hash_size = sizeof(css_selector_hash);
 
 	h->alloc = alloc;
 	h->pw = pw;
 
+	/* Most selectors select the base element, so only its partition is
+	 * sized for the number of selectors */
+	error = _partition_create(h, CSS_PSEUDO_ELEMENT_NONE, n_slots);
+	if (error != CSS_OK) {
+		alloc(h, 0, pw);
+		return error;
+	}
+
 	*hash = h;
 
 	return CSS_OK;
@@ -132,48 +226,25 @@ css_error css__selector_hash_create(css_allocator_fn alloc, void *pw,
  */
 css_error css__selector_hash_destroy(css_selector_hash *hash)
 {
-	hash_entry *d, *e;
 	uint32_t i;
 
 	if (hash == NULL)
 		return CSS_BADPARM;
 
-	/* Element hash */
-	for (i = 0; i < hash->elements.n_slots; i++) {
-		for (d = hash->elements.slots[i].next; d != NULL; d = e) {
-			e = d->next;
-
-			hash->alloc(d, 0, hash->pw);
-		}
-	}
-	hash->alloc(hash->elements.slots, 0, hash->pw);
-
-	/* Class hash */
-	for (i = 0; i < hash->classes.n_slots; i++) {
-		for (d = hash->classes.slots[i].next; d != NULL; d = e) {
-			e = d->next;
-
-			hash->alloc(d, 0, hash->pw);
-		}
+	for (i = 0; i < CSS_PSEUDO_ELEMENT_COUNT; i++) {
+		if ((hash->partition_mask & (1 << i)) != 0)
+			_partition_destroy(hash, &hash->partitions[i]);
 	}
-	hash->alloc(hash->classes.slots, 0, hash->pw);
 
-	/* ID hash */
-	for (i = 0; i < hash->ids.n_slots; i++) {
-		for (d = hash->ids.slots[i].next; d != NULL; d = e) {
-			e = d->next;
+	while (hash->blocks != NULL) {
+		hash_block *next = hash->blocks->next;
 
-			hash->alloc(d, 0, hash->pw);
-		}
+		hash->alloc(hash->blocks, 0, hash->pw);
+		hash->blocks = next;
 	}
-	hash->alloc(hash->ids.slots, 0, hash->pw);
-
-	/* Universal chain */
-	for (d = hash->universal.next; d != NULL; d = e) {
-		e = d->next;
 
-		hash->alloc(d, 0, hash->pw);
-	}
+	if (hash->pending != NULL)
+		hash->alloc(hash->pending, 0, hash->pw);
 
 	hash->alloc(hash, 0, hash->pw);
 
@@ -190,42 +261,94 @@ css_error css__selector_hash_destroy(css_selector_hash *hash)
 css_error css__selector_hash_insert(css_selector_hash *hash,
 		const css_selector *selector)
 {
-	uint32_t index, mask;
-	lwc_string *name;
+	return css__selector_hash_insert_from(hash, selector, 0);
+}
+
+/**
+ * Insert an item from a given source into a hash
+ *
+ * \param hash      The hash to insert into
+ * \param selector  Pointer to selector
+ * \param source    Cascade position of the sheet containing the selector
+ * \return CSS_OK on success, appropriate error otherwise
+ *
+ * Selectors with the same specificity are ordered by ascending source,
+ * and only then by rule index. This allows selectors from many sheets to
+ * be held in a single hash.
+ *
+ * Selectors are keyed by their ID, else their class, else their element
+ * name. Universal selectors are instead keyed by a state they require,
+ * else by the name of an attribute they require. Only those with none
+ * of these are held in the universal chain.
+ */
+css_error css__selector_hash_insert_from(css_selector_hash *hash,
+		const css_selector *selector, uint32_t source)
+{
+	hash_partition *p;
+	hash_t *table = NULL;
+	hash_entry entry;
+	lwc_string *key;
+	uint32_t hash_value;
+	uint8_t chain;
 	css_error error;
 
 	if (hash == NULL || selector == NULL)
 		return CSS_BADPARM;
 
-	/* Work out which hash to insert into */
-	if ((name = _id_name(selector)) != NULL) {
-		/* Named ID */
-		mask = hash->ids.n_slots - 1;
-		index = _hash_name(name) & mask;
+	if (hash->deferred)
+		return _defer_insert(hash, selector, source);
 
-		error = _insert_into_chain(hash, &hash->ids.slots[index],
-				selector);
-	} else if ((name = _class_name(selector)) != NULL) {
-		/* Named class */
-		mask = hash->classes.n_slots - 1;
-		index = _hash_name(name) & mask;
+	/* Find the partition for the selector's pseudo element */
+	if ((hash->partition_mask & (1 << selector->pseudo_element)) == 0) {
+		error = _partition_create(hash, selector->pseudo_element,
+				DEFAULT_SLOTS);
+		if (error != CSS_OK)
+			return error;
+	}
 
-		error = _insert_into_chain(hash, &hash->classes.slots[index],
-				selector);
-	} else if (lwc_string_length(selector->data.qname.name) != 1 ||
-			lwc_string_data(selector->data.qname.name)[0] != '*') {
-		/* Named element */
-		mask = hash->elements.n_slots - 1;
-		index = _hash_name(selector->data.qname.name) & mask;
+	p = &hash->partitions[selector->pseudo_element];
 
-		error = _insert_into_chain(hash, &hash->elements.slots[index],
-				selector);
-	} else {
-		/* Universal chain */
-		error = _insert_into_chain(hash, &hash->universal, selector);
+	/* Work out which hash to insert into, growing it if it is full */
+	chain = _chain_of(selector, &key, &hash_value);
+	if (chain <= CHAIN_ATTRIBUTES) {
+		table = _chain_table(p, chain);
+
+		if (table->n_entries >= table->n_slots * MAX_LOAD) {
+			error = _grow_table(hash, table);
+			if (error != CSS_OK)
+				return error;
+		}
 	}
 
-	return error;
+	_make_entry(&entry, selector, source, key, hash_value);
+
+	error = _insert_into_bucket(hash,
+			_chain_bucket(p, chain, hash_value), &entry);
+	if (error != CSS_OK)
+		return error;
+
+	if (table != NULL)
+		table->n_entries++;
+
+	if (chain == CHAIN_ATTRIBUTES) {
+		/* Selectors keyed by attribute are also held in a chain of
+		 * all such selectors */
+		_make_entry(&entry, selector, source, NULL, 0);
+
+		error = _insert_into_bucket(hash, &p->any_attribute, &entry);
+		if (error != CSS_OK) {
+			_remove_from_bucket(_chain_bucket(p, chain,
+					hash_value), selector);
+			table->n_entries--;
+			return error;
+		}
+
+		hash->n_attribute_selectors++;
+	} else if (chain >= CHAIN_STATES && chain < CHAIN_ANY_ATTRIBUTE) {
+		hash->state_mask |= (1 << (chain - CHAIN_STATES));
+	}
+
+	return CSS_OK;
 }
 
 /**
@@ -238,214 +361,412 @@ css_error css__selector_hash_insert(css_selector_hash *hash,
 css_error css__selector_hash_remove(css_selector_hash *hash,
 		const css_selector *selector)
 {
-	uint32_t index, mask;
-	lwc_string *name;
+	hash_partition *p;
+	lwc_string *key;
+	uint32_t hash_value;
+	uint8_t chain;
 	css_error error;
 
 	if (hash == NULL || selector == NULL)
 		return CSS_BADPARM;
 
+	/* The selector may not have been inserted yet */
+	if (hash->deferred && _remove_pending(hash, selector))
+		return CSS_OK;
+
+	/* Nothing was inserted into a partition which was never allocated */
+	if ((hash->partition_mask & (1 << selector->pseudo_element)) == 0)
+		return CSS_INVALID;
+
+	p = &hash->partitions[selector->pseudo_element];
+
 	/* Work out which hash to remove from */
-	if ((name = _id_name(selector)) != NULL) {
-		/* Named ID */
-		mask = hash->ids.n_slots - 1;
-		index = _hash_name(name) & mask;
+	chain = _chain_of(selector, &key, &hash_value);
 
-		error = _remove_from_chain(hash, &hash->ids.slots[index],
-				selector);
-	} else if ((name = _class_name(selector)) != NULL) {
-		/* Named class */
-		mask = hash->classes.n_slots - 1;
-		index = _hash_name(name) & mask;
+	error = _remove_from_bucket(_chain_bucket(p, chain, hash_value),
+			selector);
+	if (error != CSS_OK)
+		return error;
 
-		error = _remove_from_chain(hash, &hash->classes.slots[index],
-				selector);
-	} else if (lwc_string_length(selector->data.qname.name) != 1 ||
-			lwc_string_data(selector->data.qname.name)[0] != '*') {
-		/* Named element */
-		mask = hash->elements.n_slots - 1;
-		index = _hash_name(selector->data.qname.name) & mask;
+	if (chain <= CHAIN_ATTRIBUTES)
+		_chain_table(p, chain)->n_entries--;
 
-		error = _remove_from_chain(hash, &hash->elements.slots[index],
-				selector);
-	} else {
-		/* Universal chain */
-		error = _remove_from_chain(hash, &hash->universal, selector);
+	if (chain == CHAIN_ATTRIBUTES) {
+		error = _remove_from_bucket(&p->any_attribute, selector);
+		if (error != CSS_OK)
+			return error;
+
+		hash->n_attribute_selectors--;
+	} else if (chain >= CHAIN_STATES && chain < CHAIN_ANY_ATTRIBUTE) {
+		if (p->states[chain - CHAIN_STATES].n_entries == 0)
+			_update_state_mask(hash, chain - CHAIN_STATES);
 	}
 
-	return error;
+	return CSS_OK;
 }
 
 /**
- * Find the first selector that matches name
+ * Defer the insertion of selectors into a hash, until it is built
  *
- * \param hash      Hash to search
- * \param qname     Qualified name to match
- * \param iterator  Pointer to location to receive iterator function
- * \param matched   Pointer to location to receive selector
+ * \param hash  The hash to defer insertion into
  * \return CSS_OK on success, appropriate error otherwise
  *
- * If nothing matches, CSS_OK will be returned and **matched == NULL
+ * Selectors inserted while insertion is deferred are merely recorded,
+ * and are not found until css__selector_hash_build() is called.
  */
-css_error css__selector_hash_find(css_selector_hash *hash,
-		css_qname *qname, 
-		css_selector_hash_iterator *iterator,
-		const css_selector ***matched)
+css_error css__selector_hash_defer(css_selector_hash *hash)
+{
+	if (hash == NULL)
+		return CSS_BADPARM;
+
+	hash->deferred = true;
+
+	return CSS_OK;
+}
+
+/**
+ * Insert the selectors whose insertion was deferred into a hash
+ *
+ * \param hash  The hash to build
+ * \return CSS_OK on success, appropriate error otherwise
+ *
+ * The selectors are sorted into their chains at once, rather than each
+ * being placed by searching its chain. Their tables are sized for them
+ * up front, and the chains they are added to are laid out in a single
+ * block of entries. Later insertions are made one at a time.
+ *
+ * On failure, the selectors found are unchanged, and insertion remains
+ * deferred.
+ */
+css_error css__selector_hash_build(css_selector_hash *hash)
 {
-	uint32_t index, mask;
-	hash_entry *head;
+	hash_placement *placements;
+	hash_entry *block;
+	uint32_t n_placements = 0, n_entries = 0;
+	uint32_t added[CSS_PSEUDO_ELEMENT_COUNT][CHAIN_ATTRIBUTES + 1];
+	uint32_t i, j, t;
+	css_error error;
 
-	if (hash == NULL || qname == NULL || iterator == NULL || matched == NULL)
+	if (hash == NULL)
 		return CSS_BADPARM;
 
-	/* Find index */
-	mask = hash->elements.n_slots - 1;
-	index = _hash_name(qname->name) & mask;
+	if (hash->deferred == false)
+		return CSS_OK;
+
+	if (hash->n_pending == 0)
+		goto done;
+
+	/* Selectors keyed by attribute are also placed in the chain of
+	 * every such selector */
+	placements = hash->alloc(NULL, 2 * hash->n_pending *
+			sizeof(hash_placement), hash->pw);
+	if (placements == NULL)
+		return CSS_NOMEM;
+
+	memset(added, 0, sizeof(added));
+
+	for (i = 0; i < hash->n_pending; i++) {
+		const css_selector *sel = hash->pending[i].sel;
+		hash_placement *pl = &placements[n_placements++];
+		lwc_string *key;
+		uint32_t hash_value;
+
+		/* Create the partitions needed */
+		if ((hash->partition_mask & (1 << sel->pseudo_element)) == 0) {
+			error = _partition_create(hash, sel->pseudo_element,
+					DEFAULT_SLOTS);
+			if (error != CSS_OK)
+				goto cleanup;
+		}
+
+		pl->chain = _chain_of(sel, &key, &hash_value);
+		pl->pseudo = sel->pseudo_element;
+		pl->seq = i;
+		_make_entry(&pl->entry, sel, hash->pending[i].source,
+				key, hash_value);
+
+		if (pl->chain <= CHAIN_ATTRIBUTES)
+			added[pl->pseudo][pl->chain]++;
+
+		if (pl->chain == CHAIN_ATTRIBUTES) {
+			hash_placement *any = &placements[n_placements++];
+
+			*any = *pl;
+			any->chain = CHAIN_ANY_ATTRIBUTE;
+			any->entry.key = NULL;
+			any->entry.hash = 0;
+		}
+	}
+
+	/* Size the tables for the selectors to be added to them */
+	for (i = 0; i < CSS_PSEUDO_ELEMENT_COUNT; i++) {
+		for (t = 0; t <= CHAIN_ATTRIBUTES; t++) {
+			hash_t *table;
+
+			if (added[i][t] == 0)
+				continue;
+
+			table = _chain_table(&hash->partitions[i], t);
+
+			while (table->n_entries + added[i][t] >
+					MAX_LOAD * table->n_slots) {
+				error = _grow_table(hash, table);
+				if (error != CSS_OK)
+					goto cleanup;
+			}
+		}
+	}
+
+	for (i = 0; i < n_placements; i++) {
+		hash_placement *pl = &placements[i];
+
+		pl->slot = 0;
+		if (pl->chain <= CHAIN_ATTRIBUTES) {
+			pl->slot = pl->entry.hash & (_chain_table(
+					&hash->partitions[pl->pseudo],
+					pl->chain)->n_slots - 1);
+		}
+	}
+
+	qsort(placements, n_placements, sizeof(hash_placement),
+			_compare_placements);
 
-	head = &hash->elements.slots[index];
+	/* Each chain added to is laid out afresh, with its terminator */
+	for (i = 0; i < n_placements; i = j) {
+		const hash_placement *pl = &placements[i];
 
-	if (head->sel != NULL) {
-		/* Search through chain for first match */
-		while (head != NULL) {
-			lwc_error lerror;
-			bool match = false;
+		for (j = i + 1; j < n_placements &&
+				_same_chain(pl, &placements[j]); j++)
+			;
 
-			lerror = lwc_string_caseless_isequal(
-					qname->name, head->sel->data.qname.name,
-					&match);
-			if (lerror != lwc_error_ok)
-				return css_error_from_lwc_error(lerror);
+		n_entries += j - i + 1 + _chain_bucket(
+				&hash->partitions[pl->pseudo], pl->chain,
+				pl->slot)->n_entries;
+	}
 
-			if (match)
-				break;
+	block = _alloc_block(hash, n_entries);
+	if (block == NULL) {
+		error = CSS_NOMEM;
+		goto cleanup;
+	}
 
-			head = head->next;
+	/* Nothing can fail from here on */
+	for (i = 0; i < n_placements; i = j) {
+		hash_partition *p = &hash->partitions[placements[i].pseudo];
+		hash_bucket *bucket = _chain_bucket(p, placements[i].chain,
+				placements[i].slot);
+		const hash_entry *old = bucket->entries;
+		hash_entry *entry = block;
+
+		for (j = i + 1; j < n_placements &&
+				_same_chain(&placements[i], &placements[j]);
+				j++)
+			;
+
+		/* Merge the run with the chain's existing entries, which
+		 * precede those with the same cascade order */
+		t = i;
+		while (old->sel != NULL || t < j) {
+			if (old->sel != NULL && (t == j || _entry_follows(
+					&placements[t].entry, old) == false))
+				*entry++ = *old++;
+			else
+				*entry++ = placements[t++].entry;
 		}
 
-		if (head == NULL)
-			head = &empty_slot;
+		entry->sel = NULL;
+		entry->key = NULL;
+
+		_free_bucket(hash, bucket);
+
+		bucket->entries = block;
+		bucket->n_entries = entry - block;
+		bucket->size = 0;
+
+		block = entry + 1;
+
+		if (placements[i].chain <= CHAIN_ATTRIBUTES) {
+			_chain_table(p, placements[i].chain)->n_entries +=
+					j - i;
+		} else if (placements[i].chain < CHAIN_ANY_ATTRIBUTE) {
+			hash->state_mask |= (1 <<
+					(placements[i].chain - CHAIN_STATES));
+		} else if (placements[i].chain == CHAIN_ANY_ATTRIBUTE) {
+			hash->n_attribute_selectors += j - i;
+		}
 	}
 
-	(*iterator) = _iterate_elements;
-	(*matched) = (const css_selector **) head;
+	hash->alloc(placements, 0, hash->pw);
+
+	hash->alloc(hash->pending, 0, hash->pw);
+	hash->hash_size -= hash->pending_size * sizeof(hash_pending);
+	hash->pending = NULL;
+	hash->n_pending = 0;
+	hash->pending_size = 0;
+
+done:
+	hash->deferred = false;
 
 	return CSS_OK;
+
+cleanup:
+	hash->alloc(placements, 0, hash->pw);
+
+	return error;
+}
+
+/**
+ * Find the first selector that matches name
+ *
+ * \param hash      Hash to search
+ * \param pseudo    Pseudo element selected by the selectors to search
+ * \param qname     Qualified name to match
+ * \param matched   Pointer to location to receive entry
+ * \return CSS_OK on success, appropriate error otherwise
+ *
+ * If nothing matches, CSS_OK will be returned and (*matched)->sel == NULL
+ */
+css_error css__selector_hash_find(css_selector_hash *hash,
+		css_pseudo_element pseudo, css_qname *qname,
+		const css_selector_hash_entry **matched)
+{
+	if (hash == NULL || qname == NULL || matched == NULL ||
+			pseudo >= CSS_PSEUDO_ELEMENT_COUNT)
+		return CSS_BADPARM;
+
+	return _find_in_table(hash, pseudo, CHAIN_ELEMENTS, qname->name,
+			matched);
 }
 
 /**
  * Find the first selector that has a class that matches name
  *
  * \param hash      Hash to search
+ * \param pseudo    Pseudo element selected by the selectors to search
  * \param name      Name to match
- * \param iterator  Pointer to location to receive iterator function
- * \param matched   Pointer to location to receive selector
+ * \param matched   Pointer to location to receive entry
  * \return CSS_OK on success, appropriate error otherwise
  *
- * If nothing matches, CSS_OK will be returned and **matched == NULL
+ * If nothing matches, CSS_OK will be returned and (*matched)->sel == NULL
  */
 css_error css__selector_hash_find_by_class(css_selector_hash *hash,
-		lwc_string *name, 
-		css_selector_hash_iterator *iterator,
-		const css_selector ***matched)
+		css_pseudo_element pseudo, lwc_string *name,
+		const css_selector_hash_entry **matched)
 {
-	uint32_t index, mask;
-	hash_entry *head;
-
-	if (hash == NULL || name == NULL || iterator == NULL || matched == NULL)
+	if (hash == NULL || name == NULL || matched == NULL ||
+			pseudo >= CSS_PSEUDO_ELEMENT_COUNT)
 		return CSS_BADPARM;
 
-	/* Find index */
-	mask = hash->classes.n_slots - 1;
-	index = _hash_name(name) & mask;
-
-	head = &hash->classes.slots[index];
-
-	if (head->sel != NULL) {
-		/* Search through chain for first match */
-		while (head != NULL) {
-			lwc_error lerror;
-			lwc_string *n;
-			bool match = false;
-
-			n = _class_name(head->sel);
-			if (n != NULL) {
-				lerror = lwc_string_caseless_isequal(
-						name, n, &match);
-				if (lerror != lwc_error_ok)
-					return css_error_from_lwc_error(lerror);
-
-				if (match)
-					break;
-			}
-
-			head = head->next;
-		}
-
-		if (head == NULL)
-			head = &empty_slot;
-	}
-
-	(*iterator) = _iterate_classes;
-	(*matched) = (const css_selector **) head;
-
-	return CSS_OK;
+	return _find_in_table(hash, pseudo, CHAIN_CLASSES, name, matched);
 }
 
 /**
  * Find the first selector that has an ID that matches name
  *
  * \param hash      Hash to search
+ * \param pseudo    Pseudo element selected by the selectors to search
  * \param name      Name to match
- * \param iterator  Pointer to location to receive iterator function
- * \param matched   Pointer to location to receive selector
+ * \param matched   Pointer to location to receive entry
  * \return CSS_OK on success, appropriate error otherwise
  *
- * If nothing matches, CSS_OK will be returned and **matched == NULL
+ * If nothing matches, CSS_OK will be returned and (*matched)->sel == NULL
  */
 css_error css__selector_hash_find_by_id(css_selector_hash *hash,
-		lwc_string *name, 
-		css_selector_hash_iterator *iterator,
-		const css_selector ***matched)
+		css_pseudo_element pseudo, lwc_string *name,
+		const css_selector_hash_entry **matched)
 {
-	uint32_t index, mask;
-	hash_entry *head;
+	if (hash == NULL || name == NULL || matched == NULL ||
+			pseudo >= CSS_PSEUDO_ELEMENT_COUNT)
+		return CSS_BADPARM;
+
+	return _find_in_table(hash, pseudo, CHAIN_IDS, name, matched);
+}
 
-	if (hash == NULL || name == NULL || iterator == NULL || matched == NULL)
+/**
+ * Find the first selector that has an attribute that matches name
+ *
+ * \param hash      Hash to search
+ * \param pseudo    Pseudo element selected by the selectors to search
+ * \param name      Name to match
+ * \param matched   Pointer to location to receive entry
+ * \return CSS_OK on success, appropriate error otherwise
+ *
+ * Only selectors with no ID, class, element name or required state are
+ * found by their attributes. If nothing matches, CSS_OK will be returned
+ * and (*matched)->sel == NULL
+ */
+css_error css__selector_hash_find_by_attribute(css_selector_hash *hash,
+		css_pseudo_element pseudo, lwc_string *name,
+		const css_selector_hash_entry **matched)
+{
+	if (hash == NULL || name == NULL || matched == NULL ||
+			pseudo >= CSS_PSEUDO_ELEMENT_COUNT)
 		return CSS_BADPARM;
 
-	/* Find index */
-	mask = hash->ids.n_slots - 1;
-	index = _hash_name(name) & mask;
+	return _find_in_table(hash, pseudo, CHAIN_ATTRIBUTES, name, matched);
+}
 
-	head = &hash->ids.slots[index];
+/**
+ * Find the first selector that has an attribute, whatever its name
+ *
+ * \param hash      Hash to search
+ * \param pseudo    Pseudo element selected by the selectors to search
+ * \param matched   Pointer to location to receive entry
+ * \return CSS_OK on success, appropriate error otherwise
+ *
+ * This finds every selector which css__selector_hash_find_by_attribute()
+ * may, for use when the names of a node's attributes are unknown.
+ * If nothing matches, CSS_OK will be returned and (*matched)->sel == NULL
+ */
+css_error css__selector_hash_find_any_attribute(css_selector_hash *hash,
+		css_pseudo_element pseudo,
+		const css_selector_hash_entry **matched)
+{
+	if (hash == NULL || matched == NULL ||
+			pseudo >= CSS_PSEUDO_ELEMENT_COUNT)
+		return CSS_BADPARM;
 
-	if (head->sel != NULL) {
-		/* Search through chain for first match */
-		while (head != NULL) {
-			lwc_error lerror;
-			lwc_string *n;
-			bool match = false;
+	if ((hash->partition_mask & (1 << pseudo)) == 0)
+		(*matched) = &empty_slot;
+	else
+		(*matched) = hash->partitions[pseudo].any_attribute.entries;
 
-			n = _id_name(head->sel);
-			if (n != NULL) {
-				lerror = lwc_string_caseless_isequal(
-						name, n, &match);
-				if (lerror != lwc_error_ok)
-					return css_error_from_lwc_error(lerror);
+	return CSS_OK;
+}
 
-				if (match)
-					break;
-			}
+/**
+ * Find the first selector keyed by a node state
+ *
+ * \param hash      Hash to search
+ * \param pseudo    Pseudo element selected by the selectors to search
+ * \param state     State to match, a single css_node_state_flags bit
+ * \param matched   Pointer to location to receive entry
+ * \return CSS_OK on success, appropriate error otherwise
+ *
+ * Only selectors with no ID, class or element name are found by state.
+ * Each is found by only one of the states it requires, so those of all
+ * the states a node has must be searched. If nothing matches, CSS_OK
+ * will be returned and (*matched)->sel == NULL
+ */
+css_error css__selector_hash_find_by_state(css_selector_hash *hash,
+		css_pseudo_element pseudo, uint32_t state,
+		const css_selector_hash_entry **matched)
+{
+	uint32_t index;
 
-			head = head->next;
-		}
+	if (hash == NULL || matched == NULL ||
+			pseudo >= CSS_PSEUDO_ELEMENT_COUNT || state == 0 ||
+			(state & (state - 1)) != 0)
+		return CSS_BADPARM;
 
-		if (head == NULL)
-			head = &empty_slot;
-	}
+	index = _state_index(state);
+	if (index >= N_STATES)
+		return CSS_BADPARM;
 
-	(*iterator) = _iterate_ids;
-	(*matched) = (const css_selector **) head;
+	if ((hash->partition_mask & (1 << pseudo)) == 0)
+		(*matched) = &empty_slot;
+	else
+		(*matched) = hash->partitions[pseudo].states[index].entries;
 
 	return CSS_OK;
 }
@@ -454,25 +775,65 @@ css_error css__selector_hash_find_by_id(css_selector_hash *hash,
  * Find the first universal selector
  *
  * \param hash      Hash to search
- * \param iterator  Pointer to location to receive iterator function
- * \param matched   Pointer to location to receive selector
+ * \param pseudo    Pseudo element selected by the selectors to search
+ * \param matched   Pointer to location to receive entry
  * \return CSS_OK on success, appropriate error otherwise
  *
- * If nothing matches, CSS_OK will be returned and **matched == NULL
+ * If nothing matches, CSS_OK will be returned and (*matched)->sel == NULL
  */
 css_error css__selector_hash_find_universal(css_selector_hash *hash,
-		css_selector_hash_iterator *iterator,
-		const css_selector ***matched)
+		css_pseudo_element pseudo,
+		const css_selector_hash_entry **matched)
 {
-	if (hash == NULL || iterator == NULL || matched == NULL)
+	if (hash == NULL || matched == NULL ||
+			pseudo >= CSS_PSEUDO_ELEMENT_COUNT)
 		return CSS_BADPARM;
 
-	(*iterator) = _iterate_universal;
-	(*matched) = (const css_selector **) &hash->universal;
+	if ((hash->partition_mask & (1 << pseudo)) == 0)
+		(*matched) = &empty_slot;
+	else
+		(*matched) = hash->partitions[pseudo].universal.entries;
 
 	return CSS_OK;
 }
 
+/**
+ * Retrieve the partitions of a hash which may hold selectors
+ *
+ * \param hash  Hash to consider
+ * \return Mask of pseudo elements, with bit n set for css_pseudo_element n
+ *
+ * Selectors of pseudo elements whose bits are clear need not be sought.
+ */
+uint32_t css__selector_hash_partitions(const css_selector_hash *hash)
+{
+	return hash->partition_mask;
+}
+
+/**
+ * Retrieve the node states by which a hash has keyed selectors
+ *
+ * \param hash  Hash to consider
+ * \return Mask of css_node_state_flags
+ *
+ * Selectors keyed by states whose bits are clear need not be sought.
+ */
+uint32_t css__selector_hash_states(const css_selector_hash *hash)
+{
+	return hash->state_mask;
+}
+
+/**
+ * Determine whether a hash has keyed any selectors by attribute name
+ *
+ * \param hash  Hash to consider
+ * \return True if so, false otherwise
+ */
+bool css__selector_hash_has_attributes(const css_selector_hash *hash)
+{
+	return hash->n_attribute_selectors > 0;
+}
+
 /**
  * Determine the memory-resident size of a hash
  *
@@ -493,10 +854,135 @@ css_error css__selector_hash_size(css_selector_hash *hash, size_t *size)
 	return CSS_OK;
 }
 
+/**
+ * Determine the occupancy of the tables of a hash
+ *
+ * \param hash   Hash to consider
+ * \param stats  Pointer to location to receive statistics
+ * \return CSS_OK on success.
+ *
+ * The tables of every partition are included. Selectors found by state,
+ * and universal selectors, are held in chains rather than tables, so are
+ * not.
+ */
+css_error css__selector_hash_stats(const css_selector_hash *hash,
+		css_selector_hash_stats *stats)
+{
+	uint32_t i, t;
+
+	if (hash == NULL || stats == NULL)
+		return CSS_BADPARM;
+
+	memset(stats, 0, sizeof(css_selector_hash_stats));
+
+	for (i = 0; i < CSS_PSEUDO_ELEMENT_COUNT; i++) {
+		hash_partition *p = (hash_partition *) &hash->partitions[i];
+
+		if ((hash->partition_mask & (1 << i)) == 0)
+			continue;
+
+		for (t = 0; t <= CHAIN_ATTRIBUTES; t++) {
+			const hash_t *table = _chain_table(p, t);
+			size_t slot;
+
+			stats->n_slots += table->n_slots;
+			stats->n_entries += table->n_entries;
+
+			for (slot = 0; slot < table->n_slots; slot++) {
+				size_t length = table->slots[slot].n_entries;
+
+				if (length == 0)
+					continue;
+
+				stats->n_used++;
+				if (length > stats->max_chain)
+					stats->max_chain = length;
+			}
+		}
+	}
+
+	return CSS_OK;
+}
+
 /******************************************************************************
  * Private functions                                                          *
  ******************************************************************************/
 
+/**
+ * Allocate the tables of a hash's partition
+ *
+ * \param hash     Hash containing partition
+ * \param pseudo   Pseudo element of partition
+ * \param n_slots  Number of slots in each table, which must be a power of 2
+ * \return CSS_OK on success, CSS_NOMEM on memory exhaustion
+ */
+css_error _partition_create(css_selector_hash *hash,
+		css_pseudo_element pseudo, uint32_t n_slots)
+{
+	hash_partition *p = &hash->partitions[pseudo];
+	uint32_t i, t;
+
+	for (t = 0; t <= CHAIN_ATTRIBUTES; t++) {
+		hash_t *table = _chain_table(p, t);
+
+		table->slots = hash->alloc(0,
+				n_slots * sizeof(hash_bucket), hash->pw);
+		if (table->slots == NULL) {
+			while (t > 0) {
+				table = _chain_table(p, --t);
+				hash->alloc(table->slots, 0, hash->pw);
+			}
+			return CSS_NOMEM;
+		}
+
+		for (i = 0; i < n_slots; i++) {
+			table->slots[i].entries = &empty_slot;
+			table->slots[i].n_entries = 0;
+			table->slots[i].size = 0;
+		}
+
+		table->n_slots = n_slots;
+		table->n_entries = 0;
+	}
+
+	/* Chains */
+	for (t = CHAIN_STATES; t <= CHAIN_UNIVERSAL; t++) {
+		hash_bucket *bucket = _chain_bucket(p, t, 0);
+
+		bucket->entries = &empty_slot;
+		bucket->n_entries = 0;
+		bucket->size = 0;
+	}
+
+	hash->partition_mask |= (1 << pseudo);
+	hash->hash_size += 4 * n_slots * sizeof(hash_bucket);
+
+	return CSS_OK;
+}
+
+/**
+ * Free the tables of a hash's partition, along with their chains
+ *
+ * \param hash  Hash containing partition
+ * \param p     Partition to destroy
+ */
+void _partition_destroy(css_selector_hash *hash, hash_partition *p)
+{
+	uint32_t i, t;
+
+	for (t = 0; t <= CHAIN_ATTRIBUTES; t++) {
+		hash_t *table = _chain_table(p, t);
+
+		for (i = 0; i < table->n_slots; i++)
+			_free_bucket(hash, &table->slots[i]);
+
+		hash->alloc(table->slots, 0, hash->pw);
+	}
+
+	for (t = CHAIN_STATES; t <= CHAIN_UNIVERSAL; t++)
+		_free_bucket(hash, _chain_bucket(p, t, 0));
+}
+
 /**
  * Name hash function -- case-insensitive FNV.
  *
@@ -574,242 +1060,585 @@ lwc_string *_id_name(const css_selector *selector)
 }
 
 /**
- * Insert a selector into a hash chain
+ * Retrieve the name of the first attribute in a selector, or NULL if none
  *
- * \param ctx       Selector hash
- * \param head      Head of chain to insert into
- * \param selector  Selector to insert
- * \return CSS_OK    on success,
- *         CSS_NOMEM on memory exhaustion.
+ * \param selector  Selector to consider
+ * \return Pointer to attribute name, or NULL if none
  */
-css_error _insert_into_chain(css_selector_hash *ctx, hash_entry *head, 
-		const css_selector *selector)
+lwc_string *_attribute_name(const css_selector *selector)
 {
-	if (head->sel == NULL) {
-		head->sel = selector;
-		head->next = NULL;
-	} else {
-		hash_entry *search = head;
-		hash_entry *prev = NULL;
-		hash_entry *entry = 
-				ctx->alloc(NULL, sizeof(hash_entry), ctx->pw);
-		if (entry == NULL)
-			return CSS_NOMEM;
+	const css_selector_detail *detail = &selector->data;
+	lwc_string *name = NULL;
 
-		/* Find place to insert entry */
-		do {
-			/* Sort by ascending specificity */
-			if (search->sel->specificity > selector->specificity)
-				break;
-
-			/* Sort by ascending rule index */
-			if (search->sel->specificity == selector->specificity &&
-					search->sel->rule->index > 
-					selector->rule->index)
-				break;
-
-			prev = search;
-			search = search->next;
-		} while (search != NULL);
-
-		if (prev == NULL) {
-			entry->sel = head->sel;
-			entry->next = head->next;
-			head->sel = selector;
-			head->next = entry;
-		} else {
-			entry->sel = selector;
-			entry->next = prev->next;
-			prev->next = entry;
+	do {
+		/* Ignore :not([attr]) */
+		if (detail->negate == 0 &&
+				(detail->type == CSS_SELECTOR_ATTRIBUTE ||
+				detail->type == CSS_SELECTOR_ATTRIBUTE_EQUAL ||
+				detail->type ==
+					CSS_SELECTOR_ATTRIBUTE_DASHMATCH ||
+				detail->type ==
+					CSS_SELECTOR_ATTRIBUTE_INCLUDES ||
+				detail->type == CSS_SELECTOR_ATTRIBUTE_PREFIX ||
+				detail->type == CSS_SELECTOR_ATTRIBUTE_SUFFIX ||
+				detail->type ==
+					CSS_SELECTOR_ATTRIBUTE_SUBSTRING)) {
+			name = detail->qname.name;
+			break;
 		}
 
-		ctx->hash_size += sizeof(hash_entry);
-	}
+		if (detail->next)
+			detail++;
+		else
+			detail = NULL;
+	} while (detail != NULL);
 
-	return CSS_OK;
+	return name;
 }
 
 /**
- * Remove a selector from a hash chain
+ * Find the chain for the lowest of a set of node states
  *
- * \param ctx       Selector hash
- * \param head      Head of chain to remove from
- * \param selector  Selector to remove
- * \return CSS_OK       on success,
- *         CSS_INVALID  if selector not found in chain.
+ * \param state  Mask of css_node_state_flags, which must not be 0
+ * \return Index of state chain
  */
-css_error _remove_from_chain(css_selector_hash *ctx, hash_entry *head,
-		const css_selector *selector)
+uint32_t _state_index(uint32_t state)
 {
-	hash_entry *search = head, *prev = NULL;
+	uint32_t index = 0;
 
-	if (head->sel == NULL)
-		return CSS_INVALID;
+	while ((state & 1) == 0) {
+		state >>= 1;
+		index++;
+	}
 
-	do {
-		if (search->sel == selector)
-			break;
+	return index;
+}
 
-		prev = search;
-		search = search->next;
-	} while (search != NULL);
+/**
+ * Recalculate whether any partition of a hash has a given state chain
+ *
+ * \param hash   Hash to consider
+ * \param index  Index of state chain
+ */
+void _update_state_mask(css_selector_hash *hash, uint32_t index)
+{
+	uint32_t i;
 
-	if (search == NULL)
-		return CSS_INVALID;
+	hash->state_mask &= ~(1 << index);
 
-	if (prev == NULL) {
-		if (search->next != NULL) {
-			head->sel = search->next->sel;
-			head->next = search->next->next;
-		} else {
-			head->sel = NULL;
-			head->next = NULL;
-		}
+	for (i = 0; i < CSS_PSEUDO_ELEMENT_COUNT; i++) {
+		if ((hash->partition_mask & (1 << i)) != 0 &&
+				hash->partitions[i].states[index].n_entries > 0)
+			hash->state_mask |= (1 << index);
+	}
+}
+
+/**
+ * Determine the table or chain of a partition a selector belongs in
+ *
+ * \param selector    Selector to consider
+ * \param key         Pointer to location to receive name keying selector,
+ *                    or NULL if it is placed in a chain
+ * \param hash_value  Pointer to location to receive hash of key, or 0
+ * \return Table or chain, as CHAIN_*
+ */
+uint8_t _chain_of(const css_selector *selector, lwc_string **key,
+		uint32_t *hash_value)
+{
+	lwc_string *name;
+	uint8_t chain;
+
+	if ((name = _id_name(selector)) != NULL) {
+		/* Named ID */
+		chain = CHAIN_IDS;
+	} else if ((name = _class_name(selector)) != NULL) {
+		/* Named class */
+		chain = CHAIN_CLASSES;
+	} else if (lwc_string_length(selector->data.qname.name) != 1 ||
+			lwc_string_data(selector->data.qname.name)[0] != '*') {
+		/* Named element */
+		name = selector->data.qname.name;
+		chain = CHAIN_ELEMENTS;
+	} else if (selector->node_state != 0) {
+		/* Required state */
+		chain = CHAIN_STATES + _state_index(selector->node_state);
+	} else if ((name = _attribute_name(selector)) != NULL) {
+		/* Named attribute */
+		chain = CHAIN_ATTRIBUTES;
 	} else {
-		prev->next = search->next;
+		/* Universal chain */
+		chain = CHAIN_UNIVERSAL;
+	}
+
+	*key = name;
+	*hash_value = name != NULL ? _hash_name(name) : 0;
+
+	return chain;
+}
+
+/**
+ * Retrieve a table of a partition
+ *
+ * \param p      Partition to consider
+ * \param chain  Table, as CHAIN_*, which must be CHAIN_ATTRIBUTES or less
+ * \return Table
+ */
+hash_t *_chain_table(hash_partition *p, uint8_t chain)
+{
+	switch (chain) {
+	case CHAIN_ELEMENTS:
+		return &p->elements;
+	case CHAIN_CLASSES:
+		return &p->classes;
+	case CHAIN_IDS:
+		return &p->ids;
+	}
+
+	return &p->attributes;
+}
+
+/**
+ * Retrieve a chain of a partition
+ *
+ * \param p           Partition to consider
+ * \param chain       Table or chain, as CHAIN_*
+ * \param hash_value  Hash of key, or slot, for chains of tables
+ * \return Chain
+ */
+hash_bucket *_chain_bucket(hash_partition *p, uint8_t chain,
+		uint32_t hash_value)
+{
+	hash_t *table;
 
-		ctx->alloc(search, 0, ctx->pw);
+	if (chain < CHAIN_STATES) {
+		table = _chain_table(p, chain);
 
-		ctx->hash_size -= sizeof(hash_entry);
+		return &table->slots[hash_value & (table->n_slots - 1)];
+	} else if (chain < CHAIN_ANY_ATTRIBUTE) {
+		return &p->states[chain - CHAIN_STATES];
+	} else if (chain == CHAIN_ANY_ATTRIBUTE) {
+		return &p->any_attribute;
 	}
 
-	return CSS_OK;
+	return &p->universal;
 }
 
 /**
- * Find the next selector that matches
+ * Find the first selector in a table with a given key
  *
- * \param current  Current item
- * \param next     Pointer to location to receive next item
+ * \param hash     Hash to search
+ * \param pseudo   Pseudo element selected by the selectors to search
+ * \param chain    Table to search, as CHAIN_*
+ * \param name     Key to match
+ * \param matched  Pointer to location to receive entry
  * \return CSS_OK on success, appropriate error otherwise
- *
- * If nothing further matches, CSS_OK will be returned and **next == NULL
  */
-css_error _iterate_elements(const css_selector **current,
-		const css_selector ***next)
+css_error _find_in_table(css_selector_hash *hash, css_pseudo_element pseudo,
+		uint8_t chain, lwc_string *name, const hash_entry **matched)
 {
-	const hash_entry *head = (const hash_entry *) current;
-	bool match = false;
-	lwc_error lerror = lwc_error_ok;
-	lwc_string *name;
+	const hash_entry *entry;
+	uint32_t hash_value;
+
+	/* Nothing was inserted into a partition which was never allocated */
+	if ((hash->partition_mask & (1 << pseudo)) == 0) {
+		(*matched) = &empty_slot;
+		return CSS_OK;
+	}
 
-	name = head->sel->data.qname.name;
+	hash_value = _hash_name(name);
 
-	/* Look for the next selector that matches the key */
-	while (match == false && (head = head->next) != NULL) {
-		lerror = lwc_string_caseless_isequal(
-				name, head->sel->data.qname.name, &match);
+	/* Search through chain for first match. Names with differing
+	 * hashes cannot match, so need not be compared. */
+	for (entry = _chain_bucket(&hash->partitions[pseudo], chain,
+			hash_value)->entries; entry->sel != NULL; entry++) {
+		bool match = false;
+		lwc_error lerror;
+
+		if (entry->key == name)
+			break;
+
+		if (entry->hash != hash_value)
+			continue;
+
+		lerror = lwc_string_caseless_isequal(name, entry->key, &match);
 		if (lerror != lwc_error_ok)
 			return css_error_from_lwc_error(lerror);
-	}
 
-	if (head == NULL)
-		head = &empty_slot;
+		if (match)
+			break;
+	}
 
-	(*next) = (const css_selector **) head;
+	(*matched) = entry;
 
 	return CSS_OK;
 }
 
 /**
- * Find the next selector that matches
+ * Double the number of slots in a table of a hash
  *
- * \param current  Current item
- * \param next     Pointer to location to receive next item
- * \return CSS_OK on success, appropriate error otherwise
+ * \param hash   Selector hash
+ * \param table  Table to grow
+ * \return CSS_OK    on success,
+ *         CSS_NOMEM on memory exhaustion.
  *
- * If nothing further matches, CSS_OK will be returned and **next == NULL
+ * Each new slot takes its selectors from a single old slot, so moving
+ * them in order keeps every chain sorted. The new chains are laid out
+ * in a single block of entries.
  */
-css_error _iterate_classes(const css_selector **current,
-		const css_selector ***next)
+css_error _grow_table(css_selector_hash *hash, hash_t *table)
 {
-	const hash_entry *head = (const hash_entry *) current;
-	bool match = false;
-	lwc_error lerror = lwc_error_ok;
-	lwc_string *name, *ref;
+	size_t n_slots = table->n_slots * 2, n_entries = 0;
+	uint32_t mask = n_slots - 1;
+	hash_bucket *slots;
+	hash_entry *block = NULL;
+	size_t i;
+
+	slots = hash->alloc(0, n_slots * sizeof(hash_bucket), hash->pw);
+	if (slots == NULL)
+		return CSS_NOMEM;
+
+	/* Count the entries of each new slot */
+	for (i = 0; i < n_slots; i++) {
+		slots[i].entries = &empty_slot;
+		slots[i].n_entries = 0;
+		slots[i].size = 0;
+	}
+
+	for (i = 0; i < table->n_slots; i++) {
+		const hash_entry *entry;
+
+		for (entry = table->slots[i].entries; entry->sel != NULL;
+				entry++)
+			slots[entry->hash & mask].n_entries++;
+	}
+
+	for (i = 0; i < n_slots; i++) {
+		if (slots[i].n_entries > 0)
+			n_entries += slots[i].n_entries + 1;
+	}
 
-	ref = _class_name(head->sel);
+	if (n_entries > 0) {
+		block = _alloc_block(hash, n_entries);
+		if (block == NULL) {
+			hash->alloc(slots, 0, hash->pw);
+			return CSS_NOMEM;
+		}
+	}
 
-	/* Look for the next selector that matches the key */
-	while (match == false && (head = head->next) != NULL) {
-		name = _class_name(head->sel);
-		if (name == NULL)
+	for (i = 0; i < n_slots; i++) {
+		if (slots[i].n_entries == 0)
 			continue;
 
-		lerror = lwc_string_caseless_isequal(
-				ref, name, &match);
-		if (lerror != lwc_error_ok)
-			return css_error_from_lwc_error(lerror);
+		slots[i].entries = block;
+		block += slots[i].n_entries;
+		block->sel = NULL;
+		block->key = NULL;
+		block++;
+
+		slots[i].n_entries = 0;
+	}
+
+	/* Move the entries, in order */
+	for (i = 0; i < table->n_slots; i++) {
+		const hash_entry *entry;
+
+		for (entry = table->slots[i].entries; entry->sel != NULL;
+				entry++) {
+			hash_bucket *bucket = &slots[entry->hash & mask];
+
+			bucket->entries[bucket->n_entries++] = *entry;
+		}
+
+		_free_bucket(hash, &table->slots[i]);
 	}
 
-	if (head == NULL)
-		head = &empty_slot;
+	hash->alloc(table->slots, 0, hash->pw);
+
+	hash->hash_size += (n_slots - table->n_slots) * sizeof(hash_bucket);
 
-	(*next) = (const css_selector **) head;
+	table->slots = slots;
+	table->n_slots = n_slots;
 
 	return CSS_OK;
 }
 
 /**
- * Find the next selector that matches
+ * Allocate a block of entries
  *
- * \param current  Current item
- * \param next     Pointer to location to receive next item
- * \return CSS_OK on success, appropriate error otherwise
+ * \param hash       Selector hash
+ * \param n_entries  Number of entries, which must not be 0
+ * \return Pointer to first entry, or NULL on memory exhaustion
  *
- * If nothing further matches, CSS_OK will be returned and **next == NULL
+ * Blocks are freed along with the hash.
  */
-css_error _iterate_ids(const css_selector **current,
-		const css_selector ***next)
+hash_entry *_alloc_block(css_selector_hash *hash, size_t n_entries)
 {
-	const hash_entry *head = (const hash_entry *) current;
-	bool match = false;
-	lwc_error lerror = lwc_error_ok;
-	lwc_string *name, *ref;
+	hash_block *block;
+	size_t size = sizeof(hash_block) + n_entries * sizeof(hash_entry);
 
-	ref = _id_name(head->sel);
+	block = hash->alloc(NULL, size, hash->pw);
+	if (block == NULL)
+		return NULL;
 
-	/* Look for the next selector that matches the key */
-	while (match == false && (head = head->next) != NULL) {
-		name = _id_name(head->sel);
-		if (name == NULL)
-			continue;
+	block->next = hash->blocks;
+	block->n_entries = n_entries;
+	hash->blocks = block;
 
-		lerror = lwc_string_caseless_isequal(
-				ref, name, &match);
-		if (lerror != lwc_error_ok)
-			return css_error_from_lwc_error(lerror);
+	hash->hash_size += size;
+
+	return (hash_entry *) (void *) (block + 1);
+}
+
+/**
+ * Free the entries of a chain, unless they are in a block
+ *
+ * \param hash    Selector hash
+ * \param bucket  Chain to consider
+ */
+void _free_bucket(css_selector_hash *hash, hash_bucket *bucket)
+{
+	if (bucket->size == 0)
+		return;
+
+	hash->alloc(bucket->entries, 0, hash->pw);
+
+	hash->hash_size -= (bucket->size + 1) * sizeof(hash_entry);
+
+	bucket->entries = &empty_slot;
+	bucket->n_entries = 0;
+	bucket->size = 0;
+}
+
+/**
+ * Insert an entry into a chain, in cascade order
+ *
+ * \param hash    Selector hash
+ * \param bucket  Chain to insert into
+ * \param entry   Entry to insert
+ * \return CSS_OK    on success,
+ *         CSS_NOMEM on memory exhaustion.
+ *
+ * The entry follows any with the same cascade order.
+ */
+css_error _insert_into_bucket(css_selector_hash *hash,
+		hash_bucket *bucket, const hash_entry *entry)
+{
+	uint32_t pos;
+
+	/* Chains in a block, like empty ones, have no space of their own,
+	 * so are copied out before they grow */
+	if (bucket->size == 0 || bucket->n_entries == bucket->size) {
+		uint32_t size = bucket->n_entries < 4 ?
+				4 : bucket->n_entries * 2;
+		hash_entry *temp;
+
+		temp = hash->alloc(bucket->size == 0 ? NULL : bucket->entries,
+				(size + 1) * sizeof(hash_entry), hash->pw);
+		if (temp == NULL)
+			return CSS_NOMEM;
+
+		if (bucket->size == 0) {
+			memcpy(temp, bucket->entries,
+					(bucket->n_entries + 1) *
+					sizeof(hash_entry));
+		}
+
+		hash->hash_size += (size - bucket->size +
+				(bucket->size == 0 ? 1 : 0)) *
+				sizeof(hash_entry);
+
+		bucket->entries = temp;
+		bucket->size = size;
 	}
 
-	if (head == NULL)
-		head = &empty_slot;
+	/* Selectors are mostly inserted in order, so search from the end */
+	for (pos = bucket->n_entries; pos > 0; pos--) {
+		if (_entry_follows(&bucket->entries[pos - 1], entry) == false)
+			break;
+	}
 
-	(*next) = (const css_selector **) head;
+	/* Move the later entries, and the terminator, up */
+	memmove(&bucket->entries[pos + 1], &bucket->entries[pos],
+			(bucket->n_entries - pos + 1) * sizeof(hash_entry));
+
+	bucket->entries[pos] = *entry;
+	bucket->n_entries++;
 
 	return CSS_OK;
 }
 
 /**
- * Find the next selector that matches
+ * Remove a selector from a chain
  *
- * \param current  Current item
- * \param next     Pointer to location to receive next item
- * \return CSS_OK on success, appropriate error otherwise
+ * \param bucket    Chain to remove from
+ * \param selector  Selector to remove
+ * \return CSS_OK       on success,
+ *         CSS_INVALID  if selector not found in chain.
+ */
+css_error _remove_from_bucket(hash_bucket *bucket,
+		const css_selector *selector)
+{
+	uint32_t pos;
+
+	for (pos = 0; pos < bucket->n_entries; pos++) {
+		if (bucket->entries[pos].sel == selector)
+			break;
+	}
+
+	if (pos == bucket->n_entries)
+		return CSS_INVALID;
+
+	/* Move the later entries, and the terminator, down */
+	memmove(&bucket->entries[pos], &bucket->entries[pos + 1],
+			(bucket->n_entries - pos) * sizeof(hash_entry));
+	bucket->n_entries--;
+
+	return CSS_OK;
+}
+
+/**
+ * Determine whether one entry follows another in cascade order
  *
- * If nothing further matches, CSS_OK will be returned and **next == NULL
+ * \param a  First entry
+ * \param b  Second entry
+ * \return True if a's selector is to be processed after b's
  */
-css_error _iterate_universal(const css_selector **current,
-		const css_selector ***next)
+bool _entry_follows(const hash_entry *a, const hash_entry *b)
 {
-	const hash_entry *head = (const hash_entry *) current;
+	/* Sort by ascending specificity */
+	if (a->specificity != b->specificity)
+		return a->specificity > b->specificity;
 
-	if (head->next == NULL)
-		head = &empty_slot;
-	else
-		head = head->next;
+	/* Then by ascending source */
+	if (a->source != b->source)
+		return a->source > b->source;
+
+	/* Then by ascending rule index */
+	return a->index > b->index;
+}
+
+/**
+ * Fill in the entry of a selector
+ *
+ * \param entry       Entry to fill in
+ * \param selector    Selector
+ * \param source      Cascade position of the sheet containing the selector
+ * \param key         Name keying selector, or NULL
+ * \param hash_value  Hash of key, or 0
+ */
+void _make_entry(hash_entry *entry, const css_selector *selector,
+		uint32_t source, lwc_string *key, uint32_t hash_value)
+{
+	entry->sel = selector;
+	entry->key = key;
+	entry->specificity = selector->specificity;
+	entry->source = source;
+	entry->index = selector->rule->index;
+	entry->hash = hash_value;
+}
+
+/**
+ * Record a selector for insertion into a hash when it is built
+ *
+ * \param hash      Selector hash
+ * \param selector  Selector to insert
+ * \param source    Cascade position of the sheet containing the selector
+ * \return CSS_OK    on success,
+ *         CSS_NOMEM on memory exhaustion.
+ */
+css_error _defer_insert(css_selector_hash *hash,
+		const css_selector *selector, uint32_t source)
+{
+	if (hash->n_pending == hash->pending_size) {
+		uint32_t size = hash->pending_size == 0 ?
+				DEFAULT_SLOTS : hash->pending_size * 2;
+		hash_pending *temp;
+
+		temp = hash->alloc(hash->pending, size * sizeof(hash_pending),
+				hash->pw);
+		if (temp == NULL)
+			return CSS_NOMEM;
+
+		hash->hash_size += (size - hash->pending_size) *
+				sizeof(hash_pending);
 
-	(*next) = (const css_selector **) head;
+		hash->pending = temp;
+		hash->pending_size = size;
+	}
+
+	hash->pending[hash->n_pending].sel = selector;
+	hash->pending[hash->n_pending].source = source;
+	hash->n_pending++;
 
 	return CSS_OK;
 }
 
+/**
+ * Remove a selector awaiting insertion into a hash
+ *
+ * \param hash      Selector hash
+ * \param selector  Selector to remove
+ * \return True if the selector was awaiting insertion, false otherwise
+ */
+bool _remove_pending(css_selector_hash *hash, const css_selector *selector)
+{
+	uint32_t i;
+
+	/* Selectors are normally removed soon after they are inserted */
+	for (i = hash->n_pending; i > 0; i--) {
+		if (hash->pending[i - 1].sel == selector) {
+			memmove(&hash->pending[i - 1], &hash->pending[i],
+					(hash->n_pending - i) *
+					sizeof(hash_pending));
+			hash->n_pending--;
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Compare the placements of selectors, for qsort()
+ *
+ * \param a  First placement
+ * \param b  Second placement
+ * \return <0 if a sorts before b, >0 if after, and 0 if equal
+ *
+ * Placements are grouped by chain, and ordered within each as they would
+ * be if inserted one by one.
+ */
+int _compare_placements(const void *a, const void *b)
+{
+	const hash_placement *pa = a, *pb = b;
+
+	if (pa->pseudo != pb->pseudo)
+		return pa->pseudo < pb->pseudo ? -1 : 1;
+	if (pa->chain != pb->chain)
+		return pa->chain < pb->chain ? -1 : 1;
+	if (pa->slot != pb->slot)
+		return pa->slot < pb->slot ? -1 : 1;
+	if (_entry_follows(&pa->entry, &pb->entry))
+		return 1;
+	if (_entry_follows(&pb->entry, &pa->entry))
+		return -1;
+	if (pa->seq != pb->seq)
+		return pa->seq < pb->seq ? -1 : 1;
+
+	return 0;
+}
+
+/**
+ * Determine whether selectors are placed in the same chain
+ *
+ * \param a  First placement
+ * \param b  Second placement
+ * \return True if so, false otherwise
+ */
+bool _same_chain(const hash_placement *a, const hash_placement *b)
+{
+	return a->pseudo == b->pseudo && a->chain == b->chain &&
+			a->slot == b->slot;
+}
+
@@ -12,42 +12,128 @@
 
 #include <libcss/errors.h>
 #include <libcss/functypes.h>
+#include <libcss/select.h>
+
+#include "utils/utils.h"
 
 /* Ugh. We need this to avoid circular includes. Happy! */
 struct css_selector;
 
 typedef struct css_selector_hash css_selector_hash;
 
-typedef css_error (*css_selector_hash_iterator)(
-		const struct css_selector **current,
-		const struct css_selector ***next);
+/**
+ * Entry of a selector hash chain
+ *
+ * Each chain is an array of entries, in cascade order, ending with one
+ * whose selector is NULL. The cascade order of a selector is copied into
+ * its entry, so that chains may be merged without consulting selectors.
+ */
+typedef struct css_selector_hash_entry {
+	const struct css_selector *sel;	/**< Selector, or NULL at chain end */
+	lwc_string *key;		/**< Name keying selector, or NULL */
+	uint32_t specificity;		/**< Specificity of selector */
+	uint32_t source;		/**< Cascade position of its sheet */
+	uint32_t index;			/**< Index of its rule in the sheet */
+	uint32_t hash;			/**< Hash of key */
+} css_selector_hash_entry;
+
+/**
+ * Occupancy of the tables of a selector hash
+ */
+typedef struct css_selector_hash_stats {
+	size_t n_slots;		/**< Slots in all tables */
+	size_t n_used;		/**< Slots holding at least one selector */
+	size_t n_entries;	/**< Selectors held in tables */
+	size_t max_chain;	/**< Length of the longest chain in a slot */
+} css_selector_hash_stats;
 
 css_error css__selector_hash_create(css_allocator_fn alloc, void *pw, 
 		css_selector_hash **hash);
+css_error css__selector_hash_create_sized(css_allocator_fn alloc, void *pw,
+		uint32_t n_slots, css_selector_hash **hash);
 css_error css__selector_hash_destroy(css_selector_hash *hash);
 
 css_error css__selector_hash_insert(css_selector_hash *hash,
 		const struct css_selector *selector);
+css_error css__selector_hash_insert_from(css_selector_hash *hash,
+		const struct css_selector *selector, uint32_t source);
 css_error css__selector_hash_remove(css_selector_hash *hash,
 		const struct css_selector *selector);
 
+css_error css__selector_hash_defer(css_selector_hash *hash);
+css_error css__selector_hash_build(css_selector_hash *hash);
+
 css_error css__selector_hash_find(css_selector_hash *hash,
-		css_qname *qname,
-		css_selector_hash_iterator *iterator,
-		const struct css_selector ***matched);
+		css_pseudo_element pseudo, css_qname *qname,
+		const css_selector_hash_entry **matched);
 css_error css__selector_hash_find_by_class(css_selector_hash *hash,
-		lwc_string *name,
-		css_selector_hash_iterator *iterator,
-		const struct css_selector ***matched);
+		css_pseudo_element pseudo, lwc_string *name,
+		const css_selector_hash_entry **matched);
 css_error css__selector_hash_find_by_id(css_selector_hash *hash,
-		lwc_string *name,
-		css_selector_hash_iterator *iterator,
-		const struct css_selector ***matched);
+		css_pseudo_element pseudo, lwc_string *name,
+		const css_selector_hash_entry **matched);
+css_error css__selector_hash_find_by_attribute(css_selector_hash *hash,
+		css_pseudo_element pseudo, lwc_string *name,
+		const css_selector_hash_entry **matched);
+css_error css__selector_hash_find_any_attribute(css_selector_hash *hash,
+		css_pseudo_element pseudo,
+		const css_selector_hash_entry **matched);
+css_error css__selector_hash_find_by_state(css_selector_hash *hash,
+		css_pseudo_element pseudo, uint32_t state,
+		const css_selector_hash_entry **matched);
 css_error css__selector_hash_find_universal(css_selector_hash *hash,
-		css_selector_hash_iterator *iterator,
-		const struct css_selector ***matched);
+		css_pseudo_element pseudo,
+		const css_selector_hash_entry **matched);
+
+uint32_t css__selector_hash_partitions(const css_selector_hash *hash);
+uint32_t css__selector_hash_states(const css_selector_hash *hash);
+bool css__selector_hash_has_attributes(const css_selector_hash *hash);
 
 css_error css__selector_hash_size(css_selector_hash *hash, size_t *size);
+css_error css__selector_hash_stats(const css_selector_hash *hash,
+		css_selector_hash_stats *stats);
+
+/**
+ * Find the next selector in a chain with the same key as the current one
+ *
+ * \param current  Current entry, whose selector must not be NULL
+ * \param next     Pointer to location to receive next entry
+ * \return CSS_OK on success, appropriate error otherwise
+ *
+ * If nothing further matches, CSS_OK will be returned and (*next)->sel
+ * will be NULL. Chains of a table hold selectors of every key hashed to
+ * their slot, which are skipped. Keys are compared only if their hashes
+ * are equal and they are not the same string.
+ */
+static inline css_error css__selector_hash_next(
+		const css_selector_hash_entry *current,
+		const css_selector_hash_entry **next)
+{
+	const css_selector_hash_entry *entry = current;
+
+	while ((++entry)->sel != NULL) {
+		bool match = false;
+		lwc_error lerror;
+
+		if (entry->key == current->key)
+			break;
+
+		if (entry->hash != current->hash)
+			continue;
+
+		lerror = lwc_string_caseless_isequal(current->key, entry->key,
+				&match);
+		if (lerror != lwc_error_ok)
+			return css_error_from_lwc_error(lerror);
+
+		if (match)
+			break;
+	}
+
+	*next = entry;
+
+	return CSS_OK;
+}
 
 #endif
 
@@ -0,0 +1,512 @@
+/*
+ * This file is part of LibCSS
+ * Licensed under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "select/intern.h"
+#include "utils/utils.h"
+
+/* Initial number of slots in the table of styles */
+#define DEFAULT_SLOTS (1 << 6)
+
+/**
+ * Table of the distinct computed styles handed out by a selection context
+ *
+ * Each style is chained into the slot selected by the hash of its contents.
+ * Styles are not referenced by the table: each removes itself from it when
+ * its last reference is released.
+ */
+struct css_style_intern {
+	css_computed_style **slots;	/**< Chains of styles */
+	uint32_t n_slots;		/**< Number of slots, a power of 2 */
+	uint32_t n_styles;		/**< Number of styles in table */
+
+	css_allocator_fn alloc;		/**< Allocation routine */
+	void *pw;			/**< Client data for allocator */
+};
+
+static css_error grow_table(css_style_intern *table);
+static uint32_t hash_style(const css_computed_style *style);
+static inline uint32_t hash_bytes(uint32_t z, const void *data, size_t len);
+static uint32_t hash_strings(uint32_t z, lwc_string **strings);
+static bool styles_equal(const css_computed_style *a,
+		const css_computed_style *b);
+static bool inherited_equal(const css_computed_inherited *a,
+		const css_computed_inherited *b);
+static bool uncommon_equal(const css_computed_uncommon *a,
+		const css_computed_uncommon *b);
+static bool strings_equal(lwc_string **a, lwc_string **b);
+static bool counters_equal(const css_computed_counter *a,
+		const css_computed_counter *b);
+static bool content_equal(const css_computed_content_item *a,
+		const css_computed_content_item *b);
+
+/**
+ * Create a style interning table
+ *
+ * \param alloc  Memory (de)allocation function
+ * \param pw     Client-specific private data
+ * \param table  Pointer to location to receive created table
+ * \return CSS_OK on success, appropriate error otherwise
+ */
+css_error css__style_intern_create(css_allocator_fn alloc, void *pw,
+		css_style_intern **table)
+{
+	css_style_intern *t;
+
+	if (alloc == NULL || table == NULL)
+		return CSS_BADPARM;
+
+	t = alloc(NULL, sizeof(css_style_intern), pw);
+	if (t == NULL)
+		return CSS_NOMEM;
+
+	t->slots = alloc(NULL, DEFAULT_SLOTS * sizeof(css_computed_style *),
+			pw);
+	if (t->slots == NULL) {
+		alloc(t, 0, pw);
+		return CSS_NOMEM;
+	}
+
+	memset(t->slots, 0, DEFAULT_SLOTS * sizeof(css_computed_style *));
+	t->n_slots = DEFAULT_SLOTS;
+	t->n_styles = 0;
+
+	t->alloc = alloc;
+	t->pw = pw;
+
+	*table = t;
+
+	return CSS_OK;
+}
+
+/**
+ * Destroy a style interning table
+ *
+ * \param table  The table to destroy
+ * \return CSS_OK on success, appropriate error otherwise
+ *
+ * Styles remaining in the table are not destroyed, as they are still
+ * referenced by the client. They cease to be interned, but keep their
+ * references, so remain shared until all but one have been released.
+ */
+css_error css__style_intern_destroy(css_style_intern *table)
+{
+	uint32_t i;
+
+	if (table == NULL)
+		return CSS_BADPARM;
+
+	for (i = 0; i < table->n_slots; i++) {
+		css_computed_style *style = table->slots[i];
+
+		while (style != NULL) {
+			css_computed_style *next = style->intern_next;
+
+			style->intern = NULL;
+			style->intern_next = NULL;
+
+			style = next;
+		}
+	}
+
+	table->alloc(table->slots, 0, table->pw);
+	table->alloc(table, 0, table->pw);
+
+	return CSS_OK;
+}
+
+/**
+ * Intern a computed style
+ *
+ * \param table  Table to intern style in
+ * \param style  Pointer to style to intern, replaced by the interned style
+ * \return CSS_OK on success, appropriate error otherwise
+ *
+ * If the table holds a style with the same contents, the given style is
+ * destroyed, and a reference to that one is returned in its place.
+ * Otherwise, the given style is added to the table. Either way, the caller
+ * owns one reference to the resulting style, which must not be modified.
+ */
+css_error css__style_intern_insert(css_style_intern *table,
+		css_computed_style **style)
+{
+	css_computed_style *s, *existing;
+	uint32_t hash;
+	css_error error;
+
+	if (table == NULL || style == NULL || *style == NULL)
+		return CSS_BADPARM;
+
+	s = *style;
+
+	/* Styles already interned have no duplicates */
+	if (s->intern != NULL)
+		return CSS_OK;
+
+	hash = hash_style(s);
+
+	for (existing = table->slots[hash & (table->n_slots - 1)];
+			existing != NULL; existing = existing->intern_next) {
+		if (existing->hash == hash && styles_equal(existing, s)) {
+			existing->refcount++;
+
+			css_computed_style_destroy(s);
+
+			*style = existing;
+
+			return CSS_OK;
+		}
+	}
+
+	if (table->n_styles >= table->n_slots) {
+		error = grow_table(table);
+		if (error != CSS_OK)
+			return error;
+	}
+
+	s->hash = hash;
+	s->intern = table;
+	s->intern_next = table->slots[hash & (table->n_slots - 1)];
+	table->slots[hash & (table->n_slots - 1)] = s;
+	table->n_styles++;
+
+	return CSS_OK;
+}
+
+/**
+ * Remove a computed style from a style interning table
+ *
+ * \param table  Table holding style
+ * \param style  Style to remove
+ * \return CSS_OK on success, appropriate error otherwise
+ */
+css_error css__style_intern_remove(css_style_intern *table,
+		css_computed_style *style)
+{
+	css_computed_style **link;
+
+	if (table == NULL || style == NULL || style->intern != table)
+		return CSS_BADPARM;
+
+	for (link = &table->slots[style->hash & (table->n_slots - 1)];
+			*link != NULL; link = &(*link)->intern_next) {
+		if (*link == style) {
+			*link = style->intern_next;
+			table->n_styles--;
+			break;
+		}
+	}
+
+	style->intern = NULL;
+	style->intern_next = NULL;
+
+	return CSS_OK;
+}
+
+/******************************************************************************
+ * Private functions                                                          *
+ ******************************************************************************/
+
+/**
+ * Double the number of slots in a style interning table
+ *
+ * \param table  Table to grow
+ * \return CSS_OK on success, appropriate error otherwise
+ */
+css_error grow_table(css_style_intern *table)
+{
+	uint32_t n_slots = table->n_slots * 2;
+	css_computed_style **slots;
+	uint32_t i;
+
+	slots = table->alloc(NULL, n_slots * sizeof(css_computed_style *),
+			table->pw);
+	if (slots == NULL)
+		return CSS_NOMEM;
+
+	memset(slots, 0, n_slots * sizeof(css_computed_style *));
+
+	for (i = 0; i < table->n_slots; i++) {
+		css_computed_style *style = table->slots[i];
+
+		while (style != NULL) {
+			css_computed_style *next = style->intern_next;
+			uint32_t slot = style->hash & (n_slots - 1);
+
+			style->intern_next = slots[slot];
+			slots[slot] = style;
+
+			style = next;
+		}
+	}
+
+	table->alloc(table->slots, 0, table->pw);
+
+	table->slots = slots;
+	table->n_slots = n_slots;
+
+	return CSS_OK;
+}
+
+/**
+ * Hash the contents of a computed style
+ *
+ * \param style  Style to hash
+ * \return Hash of style
+ *
+ * Strings are hashed by address, as interned strings with the same
+ * contents are the same string.
+ */
+uint32_t hash_style(const css_computed_style *style)
+{
+	uint32_t z = 0x811c9dc5;
+
+	z = hash_bytes(z, style, offsetof(css_computed_style, inherited));
+
+	if (style->inherited != NULL) {
+		z = hash_bytes(z, style->inherited,
+				offsetof(css_computed_inherited, font_family));
+		z = hash_strings(z, style->inherited->font_family);
+		z = hash_strings(z, style->inherited->quotes);
+	}
+
+	if (style->uncommon != NULL) {
+		z = hash_bytes(z, style->uncommon,
+				offsetof(css_computed_uncommon,
+						counter_increment));
+		z = hash_strings(z, style->uncommon->cursor);
+	}
+
+	if (style->page != NULL) {
+		z = hash_bytes(z, style->page,
+				offsetof(css_computed_page, refcount));
+	}
+
+	return z;
+}
+
+/**
+ * Add some bytes to a hash
+ *
+ * \param z     Hash so far
+ * \param data  Bytes to add
+ * \param len   Number of bytes
+ * \return Updated hash
+ */
+uint32_t hash_bytes(uint32_t z, const void *data, size_t len)
+{
+	const uint8_t *d = data;
+	const uint8_t *end = d + len;
+
+	while (d != end) {
+		z *= 0x01000193;
+		z ^= *d++;
+	}
+
+	return z;
+}
+
+/**
+ * Add an array of strings to a hash
+ *
+ * \param z        Hash so far
+ * \param strings  Array of strings, terminated by NULL, or NULL
+ * \return Updated hash
+ */
+uint32_t hash_strings(uint32_t z, lwc_string **strings)
+{
+	if (strings == NULL)
+		return z;
+
+	for (; *strings != NULL; strings++)
+		z = hash_bytes(z, strings, sizeof(lwc_string *));
+
+	return z;
+}
+
+/**
+ * Determine whether two computed styles have the same contents
+ *
+ * \param a  First style
+ * \param b  Second style
+ * \return true if the styles are equal, false otherwise
+ *
+ * The fixed size part of a style is compared bytewise. Styles and their
+ * blocks start as copies of zeroed templates, so padding compares equal.
+ */
+bool styles_equal(const css_computed_style *a, const css_computed_style *b)
+{
+	if (memcmp(a, b, offsetof(css_computed_style, inherited)) != 0)
+		return false;
+
+	/* Styles which borrow their strings may not outlive their sources */
+	if (a->borrowed != b->borrowed)
+		return false;
+
+	if (inherited_equal(a->inherited, b->inherited) == false)
+		return false;
+
+	if (uncommon_equal(a->uncommon, b->uncommon) == false)
+		return false;
+
+	if (a->page != b->page && (a->page == NULL || b->page == NULL ||
+			memcmp(a->page, b->page,
+				offsetof(css_computed_page, refcount)) != 0))
+		return false;
+
+	return a->aural == b->aural;
+}
+
+/**
+ * Determine whether two blocks of inherited properties are equal
+ *
+ * \param a  First block, or NULL
+ * \param b  Second block, or NULL
+ * \return true if the blocks are equal, false otherwise
+ */
+bool inherited_equal(const css_computed_inherited *a,
+		const css_computed_inherited *b)
+{
+	if (a == b)
+		return true;
+
+	if (a == NULL || b == NULL)
+		return false;
+
+	if (memcmp(a, b, offsetof(css_computed_inherited, font_family)) != 0)
+		return false;
+
+	return strings_equal(a->font_family, b->font_family) &&
+			strings_equal(a->quotes, b->quotes);
+}
+
+/**
+ * Determine whether two blocks of uncommon properties are equal
+ *
+ * \param a  First block, or NULL
+ * \param b  Second block, or NULL
+ * \return true if the blocks are equal, false otherwise
+ */
+bool uncommon_equal(const css_computed_uncommon *a,
+		const css_computed_uncommon *b)
+{
+	if (a == b)
+		return true;
+
+	if (a == NULL || b == NULL)
+		return false;
+
+	if (memcmp(a, b, offsetof(css_computed_uncommon,
+			counter_increment)) != 0)
+		return false;
+
+	return counters_equal(a->counter_increment, b->counter_increment) &&
+			counters_equal(a->counter_reset, b->counter_reset) &&
+			strings_equal(a->cursor, b->cursor) &&
+			content_equal(a->content, b->content);
+}
+
+/**
+ * Determine whether two arrays of strings are equal
+ *
+ * \param a  First array, terminated by NULL, or NULL
+ * \param b  Second array, terminated by NULL, or NULL
+ * \return true if the arrays are equal, false otherwise
+ */
+bool strings_equal(lwc_string **a, lwc_string **b)
+{
+	if (a == b)
+		return true;
+
+	if (a == NULL || b == NULL)
+		return false;
+
+	for (; *a != NULL && *a == *b; a++, b++)
+		;
+
+	return *a == *b;
+}
+
+/**
+ * Determine whether two arrays of counters are equal
+ *
+ * \param a  First array, terminated by a blank entry, or NULL
+ * \param b  Second array, terminated by a blank entry, or NULL
+ * \return true if the arrays are equal, false otherwise
+ */
+bool counters_equal(const css_computed_counter *a,
+		const css_computed_counter *b)
+{
+	if (a == b)
+		return true;
+
+	if (a == NULL || b == NULL)
+		return false;
+
+	for (; a->name != NULL; a++, b++) {
+		if (a->name != b->name || a->value != b->value)
+			return false;
+	}
+
+	return b->name == NULL;
+}
+
+/**
+ * Determine whether two arrays of content items are equal
+ *
+ * \param a  First array, terminated by a blank entry, or NULL
+ * \param b  Second array, terminated by a blank entry, or NULL
+ * \return true if the arrays are equal, false otherwise
+ */
+bool content_equal(const css_computed_content_item *a,
+		const css_computed_content_item *b)
+{
+	if (a == b)
+		return true;
+
+	if (a == NULL || b == NULL)
+		return false;
+
+	for (; a->type != CSS_COMPUTED_CONTENT_NONE; a++, b++) {
+		if (a->type != b->type)
+			return false;
+
+		switch (a->type) {
+		case CSS_COMPUTED_CONTENT_STRING:
+			if (a->data.string != b->data.string)
+				return false;
+			break;
+		case CSS_COMPUTED_CONTENT_URI:
+			if (a->data.uri != b->data.uri)
+				return false;
+			break;
+		case CSS_COMPUTED_CONTENT_ATTR:
+			if (a->data.attr != b->data.attr)
+				return false;
+			break;
+		case CSS_COMPUTED_CONTENT_COUNTER:
+			if (a->data.counter.name != b->data.counter.name ||
+					a->data.counter.style !=
+					b->data.counter.style)
+				return false;
+			break;
+		case CSS_COMPUTED_CONTENT_COUNTERS:
+			if (a->data.counters.name != b->data.counters.name ||
+					a->data.counters.sep !=
+					b->data.counters.sep ||
+					a->data.counters.style !=
+					b->data.counters.style)
+				return false;
+			break;
+		default:
+			break;
+		}
+	}
+
+	return b->type == CSS_COMPUTED_CONTENT_NONE;
+}
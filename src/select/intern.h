@@ -0,0 +1,27 @@
+/*
+ * This file is part of LibCSS
+ * Licensed under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ */
+
+#ifndef css_select_intern_h_
+#define css_select_intern_h_
+
+#include <libcss/errors.h>
+#include <libcss/functypes.h>
+
+#include "select/computed.h"
+
+typedef struct css_style_intern css_style_intern;
+
+css_error css__style_intern_create(css_allocator_fn alloc, void *pw,
+		css_style_intern **table);
+css_error css__style_intern_destroy(css_style_intern *table);
+
+css_error css__style_intern_insert(css_style_intern *table,
+		css_computed_style **style);
+css_error css__style_intern_remove(css_style_intern *table,
+		css_computed_style *style);
+
+#endif
+
@@ -0,0 +1,536 @@
+/*
+ * This file is part of LibCSS
+ * Licensed under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ */
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "parse/propstrings.h"
+#include "select/invalidate.h"
+#include "utils/utils.h"
+
+/* Initial number of slots in the table of names */
+#define DEFAULT_SLOTS (1 << 6)
+
+/**
+ * Name used by selectors, and the nodes affected by changing it
+ */
+typedef struct invalidation_entry {
+	lwc_string *name;		/**< Name, or NULL if slot unused */
+	uint32_t hash;			/**< Caseless hash of name */
+	uint8_t type;			/**< Kind of name (css_select_change_type) */
+	uint8_t scope;			/**< Widest scope (css_select_invalidation) */
+} invalidation_entry;
+
+/**
+ * Map from the names and states tested by selectors to the scope of
+ * changes to them
+ */
+struct css_invalidation_map {
+	invalidation_entry *entries;	/**< Open addressed table of names */
+	uint32_t n_entries;		/**< Number of names in table */
+	uint32_t n_slots;		/**< Size of table, a power of 2 */
+
+	/** Node state flags tested by selectors at each scope */
+	uint32_t states[CSS_SELECT_INVALIDATE_SIBLINGS + 1];
+
+	uint8_t class_scope;		/**< Widest scope of any class */
+	uint8_t id_scope;		/**< Widest scope of any ID */
+	uint8_t class_attribute_scope;	/**< Scope of class attribute */
+	uint8_t id_attribute_scope;	/**< Scope of id attribute */
+
+	css_allocator_fn alloc;		/**< Allocation routine */
+	void *pw;			/**< Client data for allocator */
+};
+
+static css_error add_selector(css_invalidation_map *map,
+		const css_stylesheet *sheet, const css_selector *selector);
+static css_error add_detail(css_invalidation_map *map,
+		const css_stylesheet *sheet, const css_selector_detail *detail,
+		uint8_t scope);
+static css_error add_name(css_invalidation_map *map, uint8_t type,
+		lwc_string *name, uint8_t scope);
+static css_error find_name(const css_invalidation_map *map, uint8_t type,
+		lwc_string *name, uint8_t *scope);
+static uint32_t node_state_flag(const css_stylesheet *sheet, lwc_string *name);
+static bool name_is(lwc_string *name, const char *data, size_t len);
+static inline uint32_t hash_name(lwc_string *name);
+
+/**
+ * Create an invalidation map
+ *
+ * \param alloc  Memory (de)allocation function
+ * \param pw     Client-specific private data
+ * \param map    Pointer to location to receive created map
+ * \return CSS_OK on success, appropriate error otherwise
+ */
+css_error css__invalidation_map_create(css_allocator_fn alloc, void *pw,
+		css_invalidation_map **map)
+{
+	css_invalidation_map *m;
+
+	if (alloc == NULL || map == NULL)
+		return CSS_BADPARM;
+
+	m = alloc(NULL, sizeof(css_invalidation_map), pw);
+	if (m == NULL)
+		return CSS_NOMEM;
+
+	memset(m, 0, sizeof(css_invalidation_map));
+
+	m->entries = alloc(NULL, DEFAULT_SLOTS * sizeof(invalidation_entry),
+			pw);
+	if (m->entries == NULL) {
+		alloc(m, 0, pw);
+		return CSS_NOMEM;
+	}
+
+	memset(m->entries, 0, DEFAULT_SLOTS * sizeof(invalidation_entry));
+	m->n_slots = DEFAULT_SLOTS;
+
+	m->alloc = alloc;
+	m->pw = pw;
+
+	*map = m;
+
+	return CSS_OK;
+}
+
+/**
+ * Destroy an invalidation map
+ *
+ * \param map  The map to destroy
+ * \return CSS_OK on success, appropriate error otherwise
+ */
+css_error css__invalidation_map_destroy(css_invalidation_map *map)
+{
+	uint32_t i;
+
+	if (map == NULL)
+		return CSS_BADPARM;
+
+	for (i = 0; i < map->n_slots; i++) {
+		if (map->entries[i].name != NULL)
+			lwc_string_unref(map->entries[i].name);
+	}
+
+	map->alloc(map->entries, 0, map->pw);
+	map->alloc(map, 0, map->pw);
+
+	return CSS_OK;
+}
+
+/**
+ * Add the selectors in a list of rules to an invalidation map
+ *
+ * \param map    Map to add to
+ * \param sheet  Stylesheet containing rules
+ * \param rule   First rule in list
+ * \return CSS_OK on success, appropriate error otherwise
+ *
+ * Selectors of rules with no bytecode are never matched, so are omitted.
+ * Those in media blocks are added whatever the media, as the media
+ * selected for may differ between nodes.
+ */
+css_error css__invalidation_map_add_rules(css_invalidation_map *map,
+		const css_stylesheet *sheet, const css_rule *rule)
+{
+	css_error error;
+
+	if (map == NULL || sheet == NULL)
+		return CSS_BADPARM;
+
+	for (; rule != NULL; rule = rule->next) {
+		if (rule->type == CSS_RULE_SELECTOR) {
+			const css_rule_selector *r =
+					(const css_rule_selector *) rule;
+			uint32_t i;
+
+			if (r->style == NULL)
+				continue;
+
+			for (i = 0; i < rule->items; i++) {
+				error = add_selector(map, sheet,
+						r->selectors[i]);
+				if (error != CSS_OK)
+					return error;
+			}
+		} else if (rule->type == CSS_RULE_MEDIA) {
+			error = css__invalidation_map_add_rules(map, sheet,
+				((const css_rule_media *) rule)->first_child);
+			if (error != CSS_OK)
+				return error;
+		}
+	}
+
+	return CSS_OK;
+}
+
+/**
+ * Determine the nodes whose styles may be affected by a change to a node
+ *
+ * \param map     Map to consult
+ * \param change  Change made to node
+ * \param scope   Pointer to location to receive scope of change
+ * \return CSS_OK on success, appropriate error otherwise
+ */
+css_error css__invalidation_map_scope(const css_invalidation_map *map,
+		const css_select_change *change,
+		css_select_invalidation *scope)
+{
+	uint8_t s = CSS_SELECT_INVALIDATE_NONE;
+	css_error error;
+
+	if (map == NULL || change == NULL || scope == NULL)
+		return CSS_BADPARM;
+
+	switch (change->type) {
+	case CSS_SELECT_CHANGE_CLASS:
+	case CSS_SELECT_CHANGE_ID:
+	case CSS_SELECT_CHANGE_ATTRIBUTE:
+		if (change->name == NULL)
+			return CSS_BADPARM;
+
+		error = find_name(map, change->type, change->name, &s);
+		if (error != CSS_OK)
+			return error;
+
+		/* Classes and IDs are themselves attributes, so may also be
+		 * tested as such */
+		if (change->type == CSS_SELECT_CHANGE_CLASS) {
+			s = max(s, map->class_attribute_scope);
+		} else if (change->type == CSS_SELECT_CHANGE_ID) {
+			s = max(s, map->id_attribute_scope);
+		} else if (name_is(change->name, "class", SLEN("class"))) {
+			s = max(s, map->class_scope);
+		} else if (name_is(change->name, "id", SLEN("id"))) {
+			s = max(s, map->id_scope);
+		}
+		break;
+	case CSS_SELECT_CHANGE_STATE:
+		for (s = CSS_SELECT_INVALIDATE_SIBLINGS;
+				s > CSS_SELECT_INVALIDATE_NONE; s--) {
+			if ((map->states[s] & change->state) != 0)
+				break;
+		}
+		break;
+	default:
+		return CSS_BADPARM;
+	}
+
+	*scope = (css_select_invalidation) s;
+
+	return CSS_OK;
+}
+
+/******************************************************************************
+ * Private functions                                                          *
+ ******************************************************************************/
+
+/**
+ * Add the names and states tested by a selector chain to an invalidation map
+ *
+ * \param map       Map to add to
+ * \param sheet     Stylesheet containing selector
+ * \param selector  Selector chain to add
+ * \return CSS_OK on success, appropriate error otherwise
+ */
+css_error add_selector(css_invalidation_map *map,
+		const css_stylesheet *sheet, const css_selector *selector)
+{
+	uint8_t scope = CSS_SELECT_INVALIDATE_SELF;
+	const css_selector *s;
+	css_error error;
+
+	for (s = selector; s != NULL; s = s->combinator) {
+		const css_selector_detail *detail = &s->data;
+
+		do {
+			error = add_detail(map, sheet, detail, scope);
+			if (error != CSS_OK)
+				return error;
+		} while ((detail++)->next != 0);
+
+		/* The nodes matching the compound selectors to the left are
+		 * siblings or ancestors of those matching this one */
+		if (s->data.comb == CSS_COMBINATOR_SIBLING ||
+				s->data.comb == CSS_COMBINATOR_GENERIC_SIBLING) {
+			scope = CSS_SELECT_INVALIDATE_SIBLINGS;
+		} else if (s->data.comb != CSS_COMBINATOR_NONE) {
+			scope = max(scope, CSS_SELECT_INVALIDATE_DESCENDANTS);
+		}
+	}
+
+	return CSS_OK;
+}
+
+/**
+ * Add the name or state tested by a selector detail to an invalidation map
+ *
+ * \param map     Map to add to
+ * \param sheet   Stylesheet containing detail
+ * \param detail  Detail to add
+ * \param scope   Nodes affected by changing whether a node matches detail
+ * \return CSS_OK on success, appropriate error otherwise
+ */
+css_error add_detail(css_invalidation_map *map,
+		const css_stylesheet *sheet, const css_selector_detail *detail,
+		uint8_t scope)
+{
+	lwc_string *name = detail->qname.name;
+	css_error error = CSS_OK;
+
+	switch (detail->type) {
+	case CSS_SELECTOR_CLASS:
+		error = add_name(map, CSS_SELECT_CHANGE_CLASS, name, scope);
+		map->class_scope = max(map->class_scope, scope);
+		break;
+	case CSS_SELECTOR_ID:
+		error = add_name(map, CSS_SELECT_CHANGE_ID, name, scope);
+		map->id_scope = max(map->id_scope, scope);
+		break;
+	case CSS_SELECTOR_ATTRIBUTE:
+	case CSS_SELECTOR_ATTRIBUTE_EQUAL:
+	case CSS_SELECTOR_ATTRIBUTE_DASHMATCH:
+	case CSS_SELECTOR_ATTRIBUTE_INCLUDES:
+	case CSS_SELECTOR_ATTRIBUTE_PREFIX:
+	case CSS_SELECTOR_ATTRIBUTE_SUFFIX:
+	case CSS_SELECTOR_ATTRIBUTE_SUBSTRING:
+		error = add_name(map, CSS_SELECT_CHANGE_ATTRIBUTE, name, scope);
+
+		if (name_is(name, "class", SLEN("class"))) {
+			map->class_attribute_scope =
+					max(map->class_attribute_scope, scope);
+		} else if (name_is(name, "id", SLEN("id"))) {
+			map->id_attribute_scope =
+					max(map->id_attribute_scope, scope);
+		}
+		break;
+	case CSS_SELECTOR_PSEUDO_CLASS:
+		if (name == sheet->propstrings[LANG]) {
+			/* A node's language may be inherited from its
+			 * ancestors' lang attributes */
+			error = add_name(map, CSS_SELECT_CHANGE_ATTRIBUTE,
+					name, max(scope,
+					CSS_SELECT_INVALIDATE_DESCENDANTS));
+		} else {
+			map->states[scope] |= node_state_flag(sheet, name);
+		}
+		break;
+	case CSS_SELECTOR_ELEMENT:
+	case CSS_SELECTOR_PSEUDO_ELEMENT:
+		break;
+	}
+
+	return error;
+}
+
+/**
+ * Add a name to an invalidation map, widening the scope of any existing entry
+ *
+ * \param map    Map to add to
+ * \param type   Kind of name
+ * \param name   Name to add
+ * \param scope  Nodes affected by changing name
+ * \return CSS_OK on success, appropriate error otherwise
+ */
+css_error add_name(css_invalidation_map *map, uint8_t type,
+		lwc_string *name, uint8_t scope)
+{
+	uint32_t hash = hash_name(name);
+	uint32_t mask, index;
+	invalidation_entry *entry;
+	lwc_error lerror;
+
+	/* Keep the table at most half full */
+	if ((map->n_entries + 1) * 2 > map->n_slots) {
+		uint32_t n_slots = map->n_slots * 2;
+		invalidation_entry *entries, *old = map->entries;
+		uint32_t i;
+
+		entries = map->alloc(NULL, n_slots * sizeof(invalidation_entry),
+				map->pw);
+		if (entries == NULL)
+			return CSS_NOMEM;
+
+		memset(entries, 0, n_slots * sizeof(invalidation_entry));
+
+		for (i = 0; i < map->n_slots; i++) {
+			if (old[i].name == NULL)
+				continue;
+
+			index = old[i].hash & (n_slots - 1);
+			while (entries[index].name != NULL)
+				index = (index + 1) & (n_slots - 1);
+
+			entries[index] = old[i];
+		}
+
+		map->alloc(old, 0, map->pw);
+		map->entries = entries;
+		map->n_slots = n_slots;
+	}
+
+	mask = map->n_slots - 1;
+
+	for (index = hash & mask; map->entries[index].name != NULL;
+			index = (index + 1) & mask) {
+		bool match = false;
+
+		entry = &map->entries[index];
+
+		if (entry->hash != hash || entry->type != type)
+			continue;
+
+		lerror = lwc_string_caseless_isequal(entry->name, name, &match);
+		if (lerror != lwc_error_ok)
+			return css_error_from_lwc_error(lerror);
+
+		if (match) {
+			entry->scope = max(entry->scope, scope);
+			return CSS_OK;
+		}
+	}
+
+	entry = &map->entries[index];
+	entry->name = lwc_string_ref(name);
+	entry->hash = hash;
+	entry->type = type;
+	entry->scope = scope;
+
+	map->n_entries++;
+
+	return CSS_OK;
+}
+
+/**
+ * Find the scope of changes to a name in an invalidation map
+ *
+ * \param map    Map to search
+ * \param type   Kind of name
+ * \param name   Name to find
+ * \param scope  Pointer to location to receive scope, which is
+ *               CSS_SELECT_INVALIDATE_NONE if no selector uses name
+ * \return CSS_OK on success, appropriate error otherwise
+ */
+css_error find_name(const css_invalidation_map *map, uint8_t type,
+		lwc_string *name, uint8_t *scope)
+{
+	uint32_t hash = hash_name(name);
+	uint32_t mask = map->n_slots - 1;
+	uint32_t index;
+	lwc_error lerror;
+
+	*scope = CSS_SELECT_INVALIDATE_NONE;
+
+	for (index = hash & mask; map->entries[index].name != NULL;
+			index = (index + 1) & mask) {
+		const invalidation_entry *entry = &map->entries[index];
+		bool match = false;
+
+		if (entry->hash != hash || entry->type != type)
+			continue;
+
+		lerror = lwc_string_caseless_isequal(entry->name, name, &match);
+		if (lerror != lwc_error_ok)
+			return css_error_from_lwc_error(lerror);
+
+		if (match) {
+			*scope = entry->scope;
+			break;
+		}
+	}
+
+	return CSS_OK;
+}
+
+/**
+ * Determine the node state tested by a pseudo class
+ *
+ * \param sheet  Stylesheet containing pseudo class
+ * \param name   Name of pseudo class
+ * \return Node state flag, or 0 if the pseudo class tests no node state
+ */
+uint32_t node_state_flag(const css_stylesheet *sheet, lwc_string *name)
+{
+	lwc_string **strings = sheet->propstrings;
+
+	if (name == strings[ROOT])
+		return CSS_NODE_STATE_ROOT;
+	else if (name == strings[EMPTY])
+		return CSS_NODE_STATE_EMPTY;
+	else if (name == strings[LINK])
+		return CSS_NODE_STATE_LINK;
+	else if (name == strings[VISITED])
+		return CSS_NODE_STATE_VISITED;
+	else if (name == strings[HOVER])
+		return CSS_NODE_STATE_HOVER;
+	else if (name == strings[ACTIVE])
+		return CSS_NODE_STATE_ACTIVE;
+	else if (name == strings[FOCUS])
+		return CSS_NODE_STATE_FOCUS;
+	else if (name == strings[ENABLED])
+		return CSS_NODE_STATE_ENABLED;
+	else if (name == strings[DISABLED])
+		return CSS_NODE_STATE_DISABLED;
+	else if (name == strings[CHECKED])
+		return CSS_NODE_STATE_CHECKED;
+	else if (name == strings[TARGET])
+		return CSS_NODE_STATE_TARGET;
+
+	return 0;
+}
+
+/**
+ * Determine whether a name is equal to an ASCII string, ignoring case
+ *
+ * \param name  Name to consider
+ * \param data  Lower case string to compare with
+ * \param len   Length of data, in bytes
+ * \return True if name and data are equal, false otherwise
+ */
+bool name_is(lwc_string *name, const char *data, size_t len)
+{
+	const char *s = lwc_string_data(name);
+	size_t i;
+
+	if (lwc_string_length(name) != len)
+		return false;
+
+	for (i = 0; i < len; i++) {
+		char c = s[i];
+
+		if ('A' <= c && c <= 'Z')
+			c += 'a' - 'A';
+
+		if (c != data[i])
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * Name hash function -- case-insensitive FNV.
+ *
+ * \param name  Name to hash
+ * \return hash value
+ */
+uint32_t hash_name(lwc_string *name)
+{
+	uint32_t z = 0x811c9dc5;
+	const char *data = lwc_string_data(name);
+	const char *end = data + lwc_string_length(name);
+
+	while (data != end) {
+		const char c = *data++;
+
+		z *= 0x01000193;
+		z ^= c & ~0x20;
+	}
+
+	return z;
+}
+
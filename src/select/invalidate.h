@@ -0,0 +1,32 @@
+/*
+ * This file is part of LibCSS
+ * Licensed under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ */
+
+#ifndef css_select_invalidate_h_
+#define css_select_invalidate_h_
+
+#include <libwapcaplet/libwapcaplet.h>
+
+#include <libcss/errors.h>
+#include <libcss/functypes.h>
+#include <libcss/select.h>
+
+#include "stylesheet.h"
+
+typedef struct css_invalidation_map css_invalidation_map;
+
+css_error css__invalidation_map_create(css_allocator_fn alloc, void *pw,
+		css_invalidation_map **map);
+css_error css__invalidation_map_destroy(css_invalidation_map *map);
+
+css_error css__invalidation_map_add_rules(css_invalidation_map *map,
+		const css_stylesheet *sheet, const css_rule *rule);
+
+css_error css__invalidation_map_scope(const css_invalidation_map *map,
+		const css_select_change *change,
+		css_select_invalidation *scope);
+
+#endif
+
@@ -0,0 +1,333 @@
+/*
+ * This file is part of LibCSS
+ * Licensed under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ */
+
+#include <stdbool.h>
+#include <string.h>
+
+#include <libcss/select.h>
+
+#include "parse/propstrings.h"
+#include "select/program.h"
+#include "utils/utils.h"
+
+static uint32_t count_details(const css_selector *selector);
+static css_select_insn *compile_compound(css_stylesheet *sheet,
+		const css_selector *selector, css_select_insn *insn);
+static void compile_detail(css_stylesheet *sheet,
+		const css_selector_detail *detail, css_select_insn *insn);
+static uint8_t compile_combinator(const css_selector *selector);
+static uint32_t op_cost(uint8_t op);
+
+/**
+ * Compile a selector to a program, for use in selection
+ *
+ * \param sheet     Stylesheet containing selector
+ * \param selector  Selector to compile
+ * \return CSS_OK on success, appropriate error otherwise
+ *
+ * Any program the selector already has is replaced.
+ */
+css_error css__selector_compile(css_stylesheet *sheet, css_selector *selector)
+{
+	const css_selector *s;
+	css_select_insn *program, *insn;
+	uint32_t n_insns = 1;
+
+	if (sheet == NULL || selector == NULL)
+		return CSS_BADPARM;
+
+	/* One instruction per detail, one per combinator and one to match */
+	for (s = selector; s != NULL; s = s->combinator) {
+		n_insns += count_details(s);
+
+		if (s->data.comb != CSS_COMBINATOR_NONE)
+			n_insns++;
+	}
+
+	program = sheet->alloc(NULL, n_insns * sizeof(css_select_insn),
+			sheet->pw);
+	if (program == NULL)
+		return CSS_NOMEM;
+
+	insn = program;
+
+	for (s = selector; s != NULL; s = s->combinator) {
+		insn = compile_compound(sheet, s, insn);
+
+		if (s->data.comb != CSS_COMBINATOR_NONE) {
+			insn->op = compile_combinator(s);
+			insn->negate = 0;
+			insn->arg = 0;
+			insn->detail = &s->combinator->data;
+			insn++;
+		}
+	}
+
+	insn->op = CSS_OP_MATCH;
+	insn->negate = 0;
+	insn->arg = 0;
+	insn->detail = NULL;
+
+	if (selector->program != NULL)
+		sheet->alloc(selector->program, 0, sheet->pw);
+
+	selector->program = program;
+
+	return CSS_OK;
+}
+
+/******************************************************************************
+ * Private functions                                                          *
+ ******************************************************************************/
+
+/**
+ * Count the details of a compound selector, beyond its element name
+ *
+ * \param selector  Selector to consider
+ * \return Number of details
+ */
+uint32_t count_details(const css_selector *selector)
+{
+	const css_selector_detail *detail = &selector->data;
+	uint32_t n = 0;
+
+	while (detail->next != 0) {
+		detail++;
+		n++;
+	}
+
+	return n;
+}
+
+/**
+ * Compile the tests of a compound selector's details
+ *
+ * \param sheet     Stylesheet containing selector
+ * \param selector  Compound selector to compile
+ * \param insn      Location of first instruction to write
+ * \return Location following the last instruction written
+ *
+ * The element name is not tested, as the node will already have been
+ * found by name. The remaining tests are ordered by cost, so that those
+ * needing the least of the client are made first.
+ */
+css_select_insn *compile_compound(css_stylesheet *sheet,
+		const css_selector *selector, css_select_insn *insn)
+{
+	const css_selector_detail *detail = &selector->data;
+	css_select_insn *first = insn;
+	css_select_insn *i, *j;
+
+	while (detail->next != 0) {
+		detail++;
+
+		/* Element names are only tested when negated */
+		if (detail->type == CSS_SELECTOR_ELEMENT &&
+				detail->negate == 0)
+			continue;
+
+		compile_detail(sheet, detail, insn);
+		insn++;
+	}
+
+	/* Insertion sort, which keeps tests of equal cost in order */
+	for (i = first + 1; i < insn; i++) {
+		css_select_insn test = *i;
+		uint32_t cost = op_cost(test.op);
+
+		for (j = i; j > first && op_cost((j - 1)->op) > cost; j--)
+			*j = *(j - 1);
+
+		*j = test;
+	}
+
+	return insn;
+}
+
+/**
+ * Compile the test of a selector detail
+ *
+ * \param sheet   Stylesheet containing selector
+ * \param detail  Detail to compile
+ * \param insn    Instruction to write
+ */
+void compile_detail(css_stylesheet *sheet,
+		const css_selector_detail *detail, css_select_insn *insn)
+{
+	lwc_string **strings = sheet->propstrings;
+	lwc_string *name = detail->qname.name;
+
+	insn->op = CSS_OP_FALSE;
+	insn->negate = detail->negate;
+	insn->arg = 0;
+	insn->detail = detail;
+
+	switch (detail->type) {
+	case CSS_SELECTOR_ELEMENT:
+		insn->op = CSS_OP_NAME;
+		break;
+	case CSS_SELECTOR_CLASS:
+		insn->op = CSS_OP_CLASS;
+		break;
+	case CSS_SELECTOR_ID:
+		insn->op = CSS_OP_ID;
+		break;
+	case CSS_SELECTOR_PSEUDO_CLASS:
+		if (name == strings[FIRST_CHILD])
+			insn->op = CSS_OP_FIRST_CHILD;
+		else if (name == strings[NTH_CHILD])
+			insn->op = CSS_OP_NTH_CHILD;
+		else if (name == strings[NTH_LAST_CHILD])
+			insn->op = CSS_OP_NTH_LAST_CHILD;
+		else if (name == strings[NTH_OF_TYPE])
+			insn->op = CSS_OP_NTH_OF_TYPE;
+		else if (name == strings[NTH_LAST_OF_TYPE])
+			insn->op = CSS_OP_NTH_LAST_OF_TYPE;
+		else if (name == strings[LAST_CHILD])
+			insn->op = CSS_OP_LAST_CHILD;
+		else if (name == strings[FIRST_OF_TYPE])
+			insn->op = CSS_OP_FIRST_OF_TYPE;
+		else if (name == strings[LAST_OF_TYPE])
+			insn->op = CSS_OP_LAST_OF_TYPE;
+		else if (name == strings[ONLY_CHILD])
+			insn->op = CSS_OP_ONLY_CHILD;
+		else if (name == strings[ONLY_OF_TYPE])
+			insn->op = CSS_OP_ONLY_OF_TYPE;
+		else if (name == strings[ROOT])
+			insn->op = CSS_OP_ROOT;
+		else if (name == strings[EMPTY])
+			insn->op = CSS_OP_EMPTY;
+		else if (name == strings[LINK])
+			insn->op = CSS_OP_LINK;
+		else if (name == strings[VISITED])
+			insn->op = CSS_OP_VISITED;
+		else if (name == strings[HOVER])
+			insn->op = CSS_OP_HOVER;
+		else if (name == strings[ACTIVE])
+			insn->op = CSS_OP_ACTIVE;
+		else if (name == strings[FOCUS])
+			insn->op = CSS_OP_FOCUS;
+		else if (name == strings[TARGET])
+			insn->op = CSS_OP_TARGET;
+		else if (name == strings[LANG])
+			insn->op = CSS_OP_LANG;
+		else if (name == strings[ENABLED])
+			insn->op = CSS_OP_ENABLED;
+		else if (name == strings[DISABLED])
+			insn->op = CSS_OP_DISABLED;
+		else if (name == strings[CHECKED])
+			insn->op = CSS_OP_CHECKED;
+		break;
+	case CSS_SELECTOR_PSEUDO_ELEMENT:
+		insn->op = CSS_OP_PSEUDO_ELEMENT;
+
+		/* The selection context's name for ::first-letter is
+		 * interned as "first_letter", so it has never matched.
+		 * Compiled programs must match as the interpreter does. */
+		if (name == strings[FIRST_LINE])
+			insn->arg = CSS_PSEUDO_ELEMENT_FIRST_LINE;
+		else if (name == strings[BEFORE])
+			insn->arg = CSS_PSEUDO_ELEMENT_BEFORE;
+		else if (name == strings[AFTER])
+			insn->arg = CSS_PSEUDO_ELEMENT_AFTER;
+		else
+			insn->op = CSS_OP_FALSE;
+		break;
+	case CSS_SELECTOR_ATTRIBUTE:
+		insn->op = CSS_OP_ATTRIBUTE;
+		break;
+	case CSS_SELECTOR_ATTRIBUTE_EQUAL:
+		insn->op = CSS_OP_ATTRIBUTE_EQUAL;
+		break;
+	case CSS_SELECTOR_ATTRIBUTE_DASHMATCH:
+		insn->op = CSS_OP_ATTRIBUTE_DASHMATCH;
+		break;
+	case CSS_SELECTOR_ATTRIBUTE_INCLUDES:
+		insn->op = CSS_OP_ATTRIBUTE_INCLUDES;
+		break;
+	case CSS_SELECTOR_ATTRIBUTE_PREFIX:
+		insn->op = CSS_OP_ATTRIBUTE_PREFIX;
+		break;
+	case CSS_SELECTOR_ATTRIBUTE_SUFFIX:
+		insn->op = CSS_OP_ATTRIBUTE_SUFFIX;
+		break;
+	case CSS_SELECTOR_ATTRIBUTE_SUBSTRING:
+		insn->op = CSS_OP_ATTRIBUTE_SUBSTRING;
+		break;
+	}
+}
+
+/**
+ * Compile the move from a compound selector to the one it combines with
+ *
+ * \param selector  Compound selector, which has a combinator
+ * \return Operation
+ */
+uint8_t compile_combinator(const css_selector *selector)
+{
+	lwc_string *name = selector->combinator->data.qname.name;
+	bool universal = lwc_string_length(name) == 1 &&
+			lwc_string_data(name)[0] == '*';
+
+	switch (selector->data.comb) {
+	case CSS_COMBINATOR_ANCESTOR:
+		return universal ? CSS_OP_ANY_ANCESTOR : CSS_OP_ANCESTOR;
+	case CSS_COMBINATOR_PARENT:
+		return universal ? CSS_OP_ANY_PARENT : CSS_OP_PARENT;
+	case CSS_COMBINATOR_SIBLING:
+		return universal ? CSS_OP_ANY_SIBLING : CSS_OP_SIBLING;
+	case CSS_COMBINATOR_GENERIC_SIBLING:
+		return universal ? CSS_OP_ANY_GENERIC_SIBLING :
+				CSS_OP_GENERIC_SIBLING;
+	case CSS_COMBINATOR_NONE:
+		break;
+	}
+
+	return CSS_OP_FALSE;
+}
+
+/**
+ * Determine the relative cost of a test
+ *
+ * \param op  Operation of test
+ * \return Cost, for comparison with that of other tests
+ */
+uint32_t op_cost(uint8_t op)
+{
+	switch (op) {
+	case CSS_OP_FALSE:
+	case CSS_OP_PSEUDO_ELEMENT:
+		/* Made without the client */
+		return 0;
+	case CSS_OP_CLASS:
+	case CSS_OP_ID:
+	case CSS_OP_NAME:
+		return 1;
+	case CSS_OP_ATTRIBUTE:
+	case CSS_OP_ATTRIBUTE_EQUAL:
+	case CSS_OP_ATTRIBUTE_DASHMATCH:
+	case CSS_OP_ATTRIBUTE_INCLUDES:
+	case CSS_OP_ATTRIBUTE_PREFIX:
+	case CSS_OP_ATTRIBUTE_SUFFIX:
+	case CSS_OP_ATTRIBUTE_SUBSTRING:
+		return 2;
+	case CSS_OP_FIRST_CHILD:
+	case CSS_OP_LAST_CHILD:
+	case CSS_OP_ONLY_CHILD:
+	case CSS_OP_FIRST_OF_TYPE:
+	case CSS_OP_LAST_OF_TYPE:
+	case CSS_OP_ONLY_OF_TYPE:
+	case CSS_OP_NTH_CHILD:
+	case CSS_OP_NTH_LAST_CHILD:
+	case CSS_OP_NTH_OF_TYPE:
+	case CSS_OP_NTH_LAST_OF_TYPE:
+		/* Require the node's siblings to be counted */
+		return 4;
+	}
+
+	return 3;
+}
+
@@ -0,0 +1,93 @@
+/*
+ * This file is part of LibCSS
+ * Licensed under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ */
+
+#ifndef css_select_program_h_
+#define css_select_program_h_
+
+#include <stdint.h>
+
+#include <libcss/errors.h>
+
+#include "stylesheet.h"
+
+/**
+ * Selector program operations
+ *
+ * A selector is compiled to a program of tests of the details of each of
+ * its compound selectors, from right to left, separated by moves to the
+ * node matching the next compound selector. A test which fails causes the
+ * most recent move to be retried from the node it found, if its combinator
+ * permits, and the selector to be rejected otherwise.
+ */
+typedef enum css_select_op {
+	/* Tests of the current node */
+	CSS_OP_FALSE,			/**< Unsupported; never matches */
+	CSS_OP_PSEUDO_ELEMENT,		/**< Select pseudo element \a arg */
+	CSS_OP_CLASS,
+	CSS_OP_ID,
+	CSS_OP_NAME,
+	CSS_OP_ATTRIBUTE,
+	CSS_OP_ATTRIBUTE_EQUAL,
+	CSS_OP_ATTRIBUTE_DASHMATCH,
+	CSS_OP_ATTRIBUTE_INCLUDES,
+	CSS_OP_ATTRIBUTE_PREFIX,
+	CSS_OP_ATTRIBUTE_SUFFIX,
+	CSS_OP_ATTRIBUTE_SUBSTRING,
+	CSS_OP_ROOT,
+	CSS_OP_EMPTY,
+	CSS_OP_LINK,
+	CSS_OP_VISITED,
+	CSS_OP_HOVER,
+	CSS_OP_ACTIVE,
+	CSS_OP_FOCUS,
+	CSS_OP_TARGET,
+	CSS_OP_LANG,
+	CSS_OP_ENABLED,
+	CSS_OP_DISABLED,
+	CSS_OP_CHECKED,
+	CSS_OP_FIRST_CHILD,
+	CSS_OP_LAST_CHILD,
+	CSS_OP_ONLY_CHILD,
+	CSS_OP_FIRST_OF_TYPE,
+	CSS_OP_LAST_OF_TYPE,
+	CSS_OP_ONLY_OF_TYPE,
+	CSS_OP_NTH_CHILD,
+	CSS_OP_NTH_LAST_CHILD,
+	CSS_OP_NTH_OF_TYPE,
+	CSS_OP_NTH_LAST_OF_TYPE,
+
+	/* Moves to a node with the name of the next compound selector */
+	CSS_OP_ANCESTOR,
+	CSS_OP_PARENT,
+	CSS_OP_SIBLING,
+	CSS_OP_GENERIC_SIBLING,
+
+	/* Moves to a node of any name */
+	CSS_OP_ANY_ANCESTOR,
+	CSS_OP_ANY_PARENT,
+	CSS_OP_ANY_SIBLING,
+	CSS_OP_ANY_GENERIC_SIBLING,
+
+	CSS_OP_MATCH			/**< The selector matches */
+} css_select_op;
+
+/**
+ * Selector program instruction
+ */
+struct css_select_insn {
+	uint8_t op;			/**< Operation (css_select_op) */
+	uint8_t negate;			/**< Whether a test is inverted */
+	uint8_t arg;			/**< Pseudo element to select */
+
+	/** Detail tested, or the compound selector moved to, which supplies
+	 * the operands */
+	const css_selector_detail *detail;
+};
+
+css_error css__selector_compile(css_stylesheet *sheet, css_selector *selector);
+
+#endif
+
@@ -169,20 +169,23 @@ css_error css__set_content_from_hint(const css_hint *hint,
 			item++) {
 		switch (item->type) {
 		case CSS_COMPUTED_CONTENT_STRING:
-			lwc_string_unref(item->data.string);
+			css__computed_string_unref(style, item->data.string);
 			break;
 		case CSS_COMPUTED_CONTENT_URI:
-			lwc_string_unref(item->data.uri);
+			css__computed_string_unref(style, item->data.uri);
 			break;
 		case CSS_COMPUTED_CONTENT_COUNTER:
-			lwc_string_unref(item->data.counter.name);
+			css__computed_string_unref(style,
+					item->data.counter.name);
 			break;
 		case CSS_COMPUTED_CONTENT_COUNTERS:
-			lwc_string_unref(item->data.counters.name);
-			lwc_string_unref(item->data.counters.sep);
+			css__computed_string_unref(style,
+					item->data.counters.name);
+			css__computed_string_unref(style,
+					item->data.counters.sep);
 			break;
 		case CSS_COMPUTED_CONTENT_ATTR:
-			lwc_string_unref(item->data.attr);
+			css__computed_string_unref(style, item->data.attr);
 			break;
 		default:
 			break;
@@ -32,7 +32,7 @@ css_error css__set_counter_reset_from_hint(const css_hint *hint,
 	if (hint->status == CSS_COUNTER_RESET_NAMED &&
 			hint->data.counter != NULL) {
 		for (item = hint->data.counter; item->name != NULL; item++) {
-			lwc_string_unref(item->name);
+			css__computed_string_unref(style, item->name);
 		}
 	}
 
@@ -151,7 +151,7 @@ css_error css__set_cursor_from_hint(const css_hint *hint,
 
 	for (item = hint->data.strings; 
 			item != NULL && (*item) != NULL; item++) {
-		lwc_string_unref(*item);
+		css__computed_string_unref(style, *item);
 	}
 
 	if (error != CSS_OK && hint->data.strings != NULL)
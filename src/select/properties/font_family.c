@@ -122,7 +122,8 @@ css_error css__cascade_font_family(uint32_t opv, css_style *style,
 				for (item = hint.data.strings; 
 						item != NULL && (*item) != NULL;
 						item++) {
-					lwc_string_unref(*item);
+					css__computed_string_unref(
+							state->computed, *item);
 				}
 
 				if (hint.data.strings != NULL) {
@@ -166,7 +167,7 @@ css_error css__set_font_family_from_hint(const css_hint *hint,
 
 	for (item = hint->data.strings; 
 			item != NULL && (*item) != NULL; item++) {
-		lwc_string_unref(*item);
+		css__computed_string_unref(style, *item);
 	}
 
 	if (error != CSS_OK && hint->data.strings != NULL)
@@ -28,7 +28,7 @@ css_error css__set_list_style_image_from_hint(const css_hint *hint,
 	error = set_list_style_image(style, hint->status, hint->data.string);
 
 	if (hint->data.string != NULL)
-		lwc_string_unref(hint->data.string);
+		css__computed_string_unref(style, hint->data.string);
 
 	return error;
 }
@@ -368,24 +368,28 @@ static inline uint8_t get_vertical_align(
 #undef VERTICAL_ALIGN_SHIFT
 #undef VERTICAL_ALIGN_INDEX
 
-#define FONT_SIZE_INDEX 1
+#define FONT_SIZE_INDEX 0
 #define FONT_SIZE_SHIFT 0
 #define FONT_SIZE_MASK  0xff
 static inline uint8_t get_font_size(
 		const css_computed_style *style, 
 		css_fixed *length, css_unit *unit)
 {
-	uint8_t bits = style->bits[FONT_SIZE_INDEX];
-	bits &= FONT_SIZE_MASK;
-	bits >>= FONT_SIZE_SHIFT;
+	if (style->inherited != NULL) {
+		uint8_t bits = style->inherited->bits[FONT_SIZE_INDEX];
+		bits &= FONT_SIZE_MASK;
+		bits >>= FONT_SIZE_SHIFT;
 
-	/* 8bits: uuuutttt : units | type */
-	if ((bits & 0xf) == CSS_FONT_SIZE_DIMENSION) {
-		*length = style->font_size;
-		*unit = bits >> 4;
+		/* 8bits: uuuutttt : units | type */
+		if ((bits & 0xf) == CSS_FONT_SIZE_DIMENSION) {
+			*length = style->inherited->font_size;
+			*unit = bits >> 4;
+		}
+
+		return (bits & 0xf);
 	}
 
-	return (bits & 0xf);
+	return CSS_FONT_SIZE_INHERIT;
 }
 #undef FONT_SIZE_MASK
 #undef FONT_SIZE_SHIFT
@@ -503,61 +507,79 @@ static inline uint8_t get_background_image(
 #undef BACKGROUND_IMAGE_SHIFT
 #undef BACKGROUND_IMAGE_INDEX
 
-#define COLOR_INDEX 3
+#define COLOR_INDEX 1
 #define COLOR_SHIFT 0
 #define COLOR_MASK  0x1
 static inline uint8_t get_color(
 		const css_computed_style *style, 
 		css_color *color)
 {
-	uint8_t bits = style->bits[COLOR_INDEX];
-	bits &= COLOR_MASK;
-	bits >>= COLOR_SHIFT;
+	if (style->inherited != NULL) {
+		uint8_t bits = style->inherited->bits[COLOR_INDEX];
+		bits &= COLOR_MASK;
+		bits >>= COLOR_SHIFT;
 
-	/* 1bit: type */
-	*color = style->color;
+		/* 1bit: type */
+		*color = style->inherited->color;
 
-	return bits;
+		return bits;
+	}
+
+	*color = 0;
+
+	return CSS_COLOR_INHERIT;
 }
 #undef COLOR_MASK
 #undef COLOR_SHIFT
 #undef COLOR_INDEX
 
-#define LIST_STYLE_IMAGE_INDEX 4
+#define LIST_STYLE_IMAGE_INDEX 3
 #define LIST_STYLE_IMAGE_SHIFT 0
 #define LIST_STYLE_IMAGE_MASK  0x1
 static inline uint8_t get_list_style_image(
 		const css_computed_style *style, 
 		lwc_string **url)
 {
-	uint8_t bits = style->bits[LIST_STYLE_IMAGE_INDEX];
-	bits &= LIST_STYLE_IMAGE_MASK;
-	bits >>= LIST_STYLE_IMAGE_SHIFT;
+	if (style->inherited != NULL) {
+		uint8_t bits = style->inherited->bits[LIST_STYLE_IMAGE_INDEX];
+		bits &= LIST_STYLE_IMAGE_MASK;
+		bits >>= LIST_STYLE_IMAGE_SHIFT;
 
-	/* 1bit: type */
-	*url = style->list_style_image;
+		/* 1bit: type */
+		*url = style->inherited->list_style_image;
 
-	return bits;
+		return bits;
+	}
+
+	*url = NULL;
+
+	return CSS_LIST_STYLE_IMAGE_INHERIT;
 }
 #undef LIST_STYLE_IMAGE_MASK
 #undef LIST_STYLE_IMAGE_SHIFT
 #undef LIST_STYLE_IMAGE_INDEX
 
-#define QUOTES_INDEX 5
-#define QUOTES_SHIFT 0
-#define QUOTES_MASK  0x1
+#define QUOTES_INDEX 1
+#define QUOTES_SHIFT 1
+#define QUOTES_MASK  0x2
 static inline uint8_t get_quotes(
 		const css_computed_style *style, 
 		lwc_string ***quotes)
 {
-	uint8_t bits = style->bits[QUOTES_INDEX];
-	bits &= QUOTES_MASK;
-	bits >>= QUOTES_SHIFT;
+	if (style->inherited != NULL) {
+		uint8_t bits = style->inherited->bits[QUOTES_INDEX];
+		bits &= QUOTES_MASK;
+		bits >>= QUOTES_SHIFT;
 
-	/* 1bit: type */
-	*quotes = style->quotes;
+		/* 1bit: type */
+		*quotes = style->inherited->quotes;
 
-	return bits;
+		return bits;
+	}
+
+	*quotes = NULL;
+
+	return CSS_QUOTES_INHERIT;
 }
 #undef QUOTES_MASK
 #undef QUOTES_SHIFT
@@ -758,28 +780,32 @@ static inline uint8_t get_height(
 #undef HEIGHT_SHIFT
 #undef HEIGHT_INDEX
 
-#define LINE_HEIGHT_INDEX 11
+#define LINE_HEIGHT_INDEX 1
 #define LINE_HEIGHT_SHIFT 2
 #define LINE_HEIGHT_MASK  0xfc
 static inline uint8_t get_line_height(
 		const css_computed_style *style, 
 		css_fixed *length, css_unit *unit)
 {
-	uint8_t bits = style->bits[LINE_HEIGHT_INDEX];
-	bits &= LINE_HEIGHT_MASK;
-	bits >>= LINE_HEIGHT_SHIFT;
+	if (style->inherited != NULL) {
+		uint8_t bits = style->inherited->bits[LINE_HEIGHT_INDEX];
+		bits &= LINE_HEIGHT_MASK;
+		bits >>= LINE_HEIGHT_SHIFT;
 
-	/* 6bits: uuuutt : units | type */
-	if ((bits & 0x3) == CSS_LINE_HEIGHT_NUMBER || 
-			(bits & 0x3) == CSS_LINE_HEIGHT_DIMENSION) {
-		*length = style->line_height;
-	}
+		/* 6bits: uuuutt : units | type */
+		if ((bits & 0x3) == CSS_LINE_HEIGHT_NUMBER ||
+				(bits & 0x3) == CSS_LINE_HEIGHT_DIMENSION) {
+			*length = style->inherited->line_height;
+		}
 
-	if ((bits & 0x3) == CSS_LINE_HEIGHT_DIMENSION) {
-		*unit = bits >> 2;
+		if ((bits & 0x3) == CSS_LINE_HEIGHT_DIMENSION) {
+			*unit = bits >> 2;
+		}
+
+		return (bits & 0x3);
 	}
 
-	return (bits & 0x3);
+	return CSS_LINE_HEIGHT_INHERIT;
 }
 #undef LINE_HEIGHT_MASK
 #undef LINE_HEIGHT_SHIFT
@@ -1350,24 +1376,28 @@ static inline uint8_t get_text_transform(
 #undef TEXT_TRANSFORM_SHIFT
 #undef TEXT_TRANSFORM_INDEX
 
-#define TEXT_INDENT_INDEX 25
+#define TEXT_INDENT_INDEX 2
 #define TEXT_INDENT_SHIFT 3
 #define TEXT_INDENT_MASK  0xf8
 static inline uint8_t get_text_indent(
 		const css_computed_style *style, 
 		css_fixed *length, css_unit *unit)
 {
-	uint8_t bits = style->bits[TEXT_INDENT_INDEX];
-	bits &= TEXT_INDENT_MASK;
-	bits >>= TEXT_INDENT_SHIFT;
+	if (style->inherited != NULL) {
+		uint8_t bits = style->inherited->bits[TEXT_INDENT_INDEX];
+		bits &= TEXT_INDENT_MASK;
+		bits >>= TEXT_INDENT_SHIFT;
 
-	/* 5bits: uuuut : units | type */
-	if ((bits & 0x1) == CSS_TEXT_INDENT_SET) {
-		*length = style->text_indent;
-		*unit = bits >> 1;
+		/* 5bits: uuuut : units | type */
+		if ((bits & 0x1) == CSS_TEXT_INDENT_SET) {
+			*length = style->inherited->text_indent;
+			*unit = bits >> 1;
+		}
+
+		return (bits & 0x1);
 	}
 
-	return (bits & 0x1);
+	return CSS_TEXT_INDENT_INHERIT;
 }
 #undef TEXT_INDENT_MASK
 #undef TEXT_INDENT_SHIFT
@@ -1520,21 +1550,27 @@ static inline uint8_t get_text_decoration(
 #undef TEXT_DECORATION_SHIFT
 #undef TEXT_DECORATION_INDEX
 
-#define FONT_FAMILY_INDEX 28
+#define FONT_FAMILY_INDEX 2
 #define FONT_FAMILY_SHIFT 0
 #define FONT_FAMILY_MASK  0x7
 static inline uint8_t get_font_family(
 		const css_computed_style *style, 
 		lwc_string ***names)
 {
-	uint8_t bits = style->bits[FONT_FAMILY_INDEX];
-	bits &= FONT_FAMILY_MASK;
-	bits >>= FONT_FAMILY_SHIFT;
+	if (style->inherited != NULL) {
+		uint8_t bits = style->inherited->bits[FONT_FAMILY_INDEX];
+		bits &= FONT_FAMILY_MASK;
+		bits >>= FONT_FAMILY_SHIFT;
 
-	/* 3bits: type */
-	*names = style->font_family;
+		/* 3bits: type */
+		*names = style->inherited->font_family;
 
-	return bits;
+		return bits;
+	}
+
+	*names = NULL;
+
+	return CSS_FONT_FAMILY_INHERIT;
 }
 #undef FONT_FAMILY_MASK
 #undef FONT_FAMILY_SHIFT
@@ -36,7 +36,8 @@ static const css_computed_uncommon default_uncommon = {
 	NULL,
 	NULL,
 	NULL,
-	NULL
+	NULL,
+	1
 };
 
 #define ENSURE_UNCOMMON do {						\
@@ -48,6 +49,9 @@ static const css_computed_uncommon default_uncommon = {
 									\
 		memcpy(style->uncommon, &default_uncommon,		\
 				sizeof(css_computed_uncommon));		\
+	} else if (style->uncommon->refcount > 1) {			\
+		if (css__computed_style_unshare_uncommon(style) != CSS_OK) \
+			return CSS_NOMEM;				\
 	}								\
 } while(0)
 
@@ -60,7 +64,8 @@ static const css_computed_page default_page = {
 			CSS_ORPHANS_SET
 	},
 	2 << CSS_RADIX_POINT, 
-	2 << CSS_RADIX_POINT
+	2 << CSS_RADIX_POINT,
+	1
 };
 
 #define ENSURE_PAGE do {						\
@@ -72,6 +77,36 @@ static const css_computed_page default_page = {
 									\
 		memcpy(style->page, &default_page,			\
 				sizeof(css_computed_page));		\
+	} else if (style->page->refcount > 1) {				\
+		if (css__computed_style_unshare_page(style) != CSS_OK)	\
+			return CSS_NOMEM;				\
+	}								\
+} while(0)
+
+static const css_computed_inherited default_inherited = {
+	{ 0, 0, 0, 0 },
+	0,
+	0,
+	0,
+	0,
+	NULL,
+	NULL,
+	NULL,
+	1
+};
+
+#define ENSURE_INHERITED do {						\
+	if (style->inherited == NULL) {					\
+		style->inherited = style->alloc(NULL,			\
+			sizeof(css_computed_inherited), style->pw);	\
+		if (style->inherited == NULL)				\
+			return CSS_NOMEM;				\
+									\
+		memcpy(style->inherited, &default_inherited,		\
+				sizeof(css_computed_inherited));	\
+	} else if (style->inherited->refcount > 1) {			\
+		if (css__computed_style_unshare_inherited(style) != CSS_OK) \
+			return CSS_NOMEM;				\
 	}								\
 } while(0)
 
@@ -235,14 +270,14 @@ static inline css_error set_counter_increment(
 			((type & 0x1) << COUNTER_INCREMENT_SHIFT);
 
 	for (c = counters; c != NULL && c->name != NULL; c++)
-		c->name = lwc_string_ref(c->name);
+		c->name = css__computed_string_ref(style, c->name);
 
 	style->uncommon->counter_increment = counters;
 
 	/* Free existing array */
 	if (oldcounters != NULL) {
 		for (c = oldcounters; c->name != NULL; c++)
-			lwc_string_unref(c->name);
+			css__computed_string_unref(style, c->name);
 
 		if (oldcounters != counters)
 			style->alloc(oldcounters, 0, style->pw);
@@ -275,14 +310,14 @@ static inline css_error set_counter_reset(
 			((type & 0x1) << COUNTER_RESET_SHIFT);
 
 	for (c = counters; c != NULL && c->name != NULL; c++)
-		c->name = lwc_string_ref(c->name);
+		c->name = css__computed_string_ref(style, c->name);
 
 	style->uncommon->counter_reset = counters;
 
 	/* Free existing array */
 	if (oldcounters != NULL) {
 		for (c = oldcounters; c->name != NULL; c++)
-			lwc_string_unref(c->name);
+			css__computed_string_unref(style, c->name);
 
 		if (oldcounters != counters)
 			style->alloc(oldcounters, 0, style->pw);
@@ -315,14 +350,14 @@ static inline css_error set_cursor(
 			((type & 0x1f) << CURSOR_SHIFT);
 
 	for (s = urls; s != NULL && *s != NULL; s++)
-		*s = lwc_string_ref(*s);
+		*s = css__computed_string_ref(style, *s);
 
 	style->uncommon->cursor = urls;
 
 	/* Free existing array */
 	if (oldurls != NULL) {
 		for (s = oldurls; *s != NULL; s++)
-			lwc_string_unref(*s);
+			css__computed_string_unref(style, *s);
 
 		if (oldurls != urls)
 			style->alloc(oldurls, 0, style->pw);
@@ -417,23 +452,26 @@ static inline css_error set_content(
 			c->type != CSS_COMPUTED_CONTENT_NONE; c++) {
 		switch (c->type) {
 		case CSS_COMPUTED_CONTENT_STRING:
-			c->data.string = lwc_string_ref(c->data.string);
+			c->data.string = css__computed_string_ref(style,
+					c->data.string);
 			break;
 		case CSS_COMPUTED_CONTENT_URI:
-			c->data.uri = lwc_string_ref(c->data.uri);
+			c->data.uri = css__computed_string_ref(style,
+					c->data.uri);
 			break;
 		case CSS_COMPUTED_CONTENT_ATTR:
-			c->data.attr = lwc_string_ref(c->data.attr);
+			c->data.attr = css__computed_string_ref(style,
+					c->data.attr);
 			break;
 		case CSS_COMPUTED_CONTENT_COUNTER:
-			c->data.counter.name =
-				lwc_string_ref(c->data.counter.name);
+			c->data.counter.name = css__computed_string_ref(style,
+					c->data.counter.name);
 			break;
 		case CSS_COMPUTED_CONTENT_COUNTERS:
-			c->data.counters.name = 
-				lwc_string_ref(c->data.counters.name);
-			c->data.counters.sep = 
-				lwc_string_ref(c->data.counters.sep);
+			c->data.counters.name = css__computed_string_ref(style,
+					c->data.counters.name);
+			c->data.counters.sep = css__computed_string_ref(style,
+					c->data.counters.sep);
 			break;
 		default:
 			break;
@@ -448,20 +486,26 @@ static inline css_error set_content(
 				c->type != CSS_COMPUTED_CONTENT_NONE; c++) {
 			switch (c->type) {
 			case CSS_COMPUTED_CONTENT_STRING:
-				lwc_string_unref(c->data.string);
+				css__computed_string_unref(style,
+						c->data.string);
 				break;
 			case CSS_COMPUTED_CONTENT_URI:
-				lwc_string_unref(c->data.uri);
+				css__computed_string_unref(style,
+						c->data.uri);
 				break;
 			case CSS_COMPUTED_CONTENT_ATTR:
-				lwc_string_unref(c->data.attr);
+				css__computed_string_unref(style,
+						c->data.attr);
 				break;
 			case CSS_COMPUTED_CONTENT_COUNTER:
-				lwc_string_unref(c->data.counter.name);
+				css__computed_string_unref(style,
+						c->data.counter.name);
 				break;
 			case CSS_COMPUTED_CONTENT_COUNTERS:
-				lwc_string_unref(c->data.counters.name);
-				lwc_string_unref(c->data.counters.sep);
+				css__computed_string_unref(style,
+						c->data.counters.name);
+				css__computed_string_unref(style,
+						c->data.counters.sep);
 				break;
 			default:
 				break;
@@ -500,20 +544,30 @@ static inline css_error set_vertical_align(
 #undef VERTICAL_ALIGN_SHIFT
 #undef VERTICAL_ALIGN_INDEX
 
-#define FONT_SIZE_INDEX 1
+#define FONT_SIZE_INDEX 0
 #define FONT_SIZE_SHIFT 0
 #define FONT_SIZE_MASK  0xff
 static inline css_error set_font_size(
 		css_computed_style *style, uint8_t type, 
 		css_fixed length, css_unit unit)
 {
-	uint8_t *bits = &style->bits[FONT_SIZE_INDEX];
+	uint8_t *bits;
+
+	if (style->inherited == NULL) {
+		if (type == CSS_FONT_SIZE_INHERIT) {
+			return CSS_OK;
+		}
+	}
+
+	ENSURE_INHERITED;
+
+	bits = &style->inherited->bits[FONT_SIZE_INDEX];
 
 	/* 8bits: uuuutttt : units | type */
 	*bits = (*bits & ~FONT_SIZE_MASK) |
 			(((type & 0xf) | (unit << 4)) << FONT_SIZE_SHIFT);
 
-	style->font_size = length;
+	style->inherited->font_size = length;
 
 	return CSS_OK;
 }
@@ -620,13 +674,14 @@ static inline css_error set_background_image(
 			((type & 0x1) << BACKGROUND_IMAGE_SHIFT);
 
 	if (url != NULL) {
-                style->background_image = lwc_string_ref(url);
+                style->background_image = css__computed_string_ref(style,
+				url);
 	} else {
 		style->background_image = NULL;
 	}
 
 	if (oldurl != NULL)
-		lwc_string_unref(oldurl);
+		css__computed_string_unref(style, oldurl);
 
 	return CSS_OK;
 }
@@ -634,20 +689,30 @@ static inline css_error set_background_image(
 #undef BACKGROUND_IMAGE_SHIFT
 #undef BACKGROUND_IMAGE_INDEX
 
-#define COLOR_INDEX 3
+#define COLOR_INDEX 1
 #define COLOR_SHIFT 0
 #define COLOR_MASK  0x1
 static inline css_error set_color(
 		css_computed_style *style, uint8_t type, 
 		css_color color)
 {
-	uint8_t *bits = &style->bits[COLOR_INDEX];
+	uint8_t *bits;
+
+	if (style->inherited == NULL) {
+		if (type == CSS_COLOR_INHERIT) {
+			return CSS_OK;
+		}
+	}
+
+	ENSURE_INHERITED;
+
+	bits = &style->inherited->bits[COLOR_INDEX];
 
 	/* 1bit: type */
 	*bits = (*bits & ~COLOR_MASK) |
 			((type & 0x1) << COLOR_SHIFT);
 
-	style->color = color;
+	style->inherited->color = color;
 
 	return CSS_OK;
 }
@@ -655,28 +720,40 @@ static inline css_error set_color(
 #undef COLOR_SHIFT
 #undef COLOR_INDEX
 
-#define LIST_STYLE_IMAGE_INDEX 4
+#define LIST_STYLE_IMAGE_INDEX 3
 #define LIST_STYLE_IMAGE_SHIFT 0
 #define LIST_STYLE_IMAGE_MASK  0x1
 static inline css_error set_list_style_image(
 		css_computed_style *style, uint8_t type, 
 		lwc_string *url)
 {
-	uint8_t *bits = &style->bits[LIST_STYLE_IMAGE_INDEX];
-	lwc_string *oldurl = style->list_style_image;
+	uint8_t *bits;
+	lwc_string *oldurl;
+
+	if (style->inherited == NULL) {
+		if (type == CSS_LIST_STYLE_IMAGE_INHERIT && url == NULL) {
+			return CSS_OK;
+		}
+	}
+
+	ENSURE_INHERITED;
+
+	bits = &style->inherited->bits[LIST_STYLE_IMAGE_INDEX];
+	oldurl = style->inherited->list_style_image;
 
 	/* 1bit: type */
 	*bits = (*bits & ~LIST_STYLE_IMAGE_MASK) |
 			((type & 0x1) << LIST_STYLE_IMAGE_SHIFT);
 
 	if (url != NULL) {
-		style->list_style_image = lwc_string_ref(url);
+		style->inherited->list_style_image =
+				css__computed_string_ref(style, url);
 	} else {
-		style->list_style_image = NULL;
+		style->inherited->list_style_image = NULL;
 	}
 
 	if (oldurl != NULL)
-		lwc_string_unref(oldurl);
+		css__computed_string_unref(style, oldurl);
 
 	return CSS_OK;
 }
@@ -684,30 +761,41 @@ static inline css_error set_list_style_image(
 #undef LIST_STYLE_IMAGE_SHIFT
 #undef LIST_STYLE_IMAGE_INDEX
 
-#define QUOTES_INDEX 5
-#define QUOTES_SHIFT 0
-#define QUOTES_MASK  0x1
+#define QUOTES_INDEX 1
+#define QUOTES_SHIFT 1
+#define QUOTES_MASK  0x2
 static inline css_error set_quotes(
 		css_computed_style *style, uint8_t type, 
 		lwc_string **quotes)
 {
-	uint8_t *bits = &style->bits[QUOTES_INDEX];
-	lwc_string **oldquotes = style->quotes;
+	uint8_t *bits;
+	lwc_string **oldquotes;
 	lwc_string **s;
 
+	if (style->inherited == NULL) {
+		if (type == CSS_QUOTES_INHERIT && quotes == NULL) {
+			return CSS_OK;
+		}
+	}
+
+	ENSURE_INHERITED;
+
+	bits = &style->inherited->bits[QUOTES_INDEX];
+	oldquotes = style->inherited->quotes;
+
 	/* 1bit: type */
 	*bits = (*bits & ~QUOTES_MASK) |
 			((type & 0x1) << QUOTES_SHIFT);
 
 	for (s = quotes; s != NULL && *s != NULL; s++)
-		*s = lwc_string_ref(*s);
+		*s = css__computed_string_ref(style, *s);
 
-	style->quotes = quotes;
+	style->inherited->quotes = quotes;
 
 	/* Free current quotes */
 	if (oldquotes != NULL) {
 		for (s = oldquotes; *s != NULL; s++)
-			lwc_string_unref(*s);
+			css__computed_string_unref(style, *s);
 
 		if (oldquotes != quotes)
 			style->alloc(oldquotes, 0, style->pw);
@@ -908,20 +996,30 @@ static inline css_error set_height(
 #undef HEIGHT_SHIFT
 #undef HEIGHT_INDEX
 
-#define LINE_HEIGHT_INDEX 11
+#define LINE_HEIGHT_INDEX 1
 #define LINE_HEIGHT_SHIFT 2
 #define LINE_HEIGHT_MASK  0xfc
 static inline css_error set_line_height(
 		css_computed_style *style, uint8_t type, 
 		css_fixed length, css_unit unit)
 {
-	uint8_t *bits = &style->bits[LINE_HEIGHT_INDEX];
+	uint8_t *bits;
+
+	if (style->inherited == NULL) {
+		if (type == CSS_LINE_HEIGHT_INHERIT) {
+			return CSS_OK;
+		}
+	}
+
+	ENSURE_INHERITED;
+
+	bits = &style->inherited->bits[LINE_HEIGHT_INDEX];
 
 	/* 6bits: uuuutt : units | type */
 	*bits = (*bits & ~LINE_HEIGHT_MASK) |
 			(((type & 0x3) | (unit << 2)) << LINE_HEIGHT_SHIFT);
 
-	style->line_height = length;
+	style->inherited->line_height = length;
 
 	return CSS_OK;
 }
@@ -1481,20 +1579,30 @@ static inline css_error set_text_transform(
 #undef TEXT_TRANSFORM_SHIFT
 #undef TEXT_TRANSFORM_INDEX
 
-#define TEXT_INDENT_INDEX 25
+#define TEXT_INDENT_INDEX 2
 #define TEXT_INDENT_SHIFT 3
 #define TEXT_INDENT_MASK  0xf8
 static inline css_error set_text_indent(
 		css_computed_style *style, uint8_t type, 
 		css_fixed length, css_unit unit)
 {
-	uint8_t *bits = &style->bits[TEXT_INDENT_INDEX];
+	uint8_t *bits;
+
+	if (style->inherited == NULL) {
+		if (type == CSS_TEXT_INDENT_INHERIT) {
+			return CSS_OK;
+		}
+	}
+
+	ENSURE_INHERITED;
+
+	bits = &style->inherited->bits[TEXT_INDENT_INDEX];
 
 	/* 5bits: uuuut : units | type */
 	*bits = (*bits & ~TEXT_INDENT_MASK) |
 			(((type & 0x1) | (unit << 1)) << TEXT_INDENT_SHIFT);
 
-	style->text_indent = length;
+	style->inherited->text_indent = length;
 
 	return CSS_OK;
 }
@@ -1611,30 +1719,41 @@ static inline css_error set_text_decoration(
 #undef TEXT_DECORATION_SHIFT
 #undef TEXT_DECORATION_INDEX
 
-#define FONT_FAMILY_INDEX 28
+#define FONT_FAMILY_INDEX 2
 #define FONT_FAMILY_SHIFT 0
 #define FONT_FAMILY_MASK  0x7
 static inline css_error set_font_family(
 		css_computed_style *style, uint8_t type, 
 		lwc_string **names)
 {
-	uint8_t *bits = &style->bits[FONT_FAMILY_INDEX];
-	lwc_string **oldnames = style->font_family;
+	uint8_t *bits;
+	lwc_string **oldnames;
 	lwc_string **s;
 
+	if (style->inherited == NULL) {
+		if (type == CSS_FONT_FAMILY_INHERIT && names == NULL) {
+			return CSS_OK;
+		}
+	}
+
+	ENSURE_INHERITED;
+
+	bits = &style->inherited->bits[FONT_FAMILY_INDEX];
+	oldnames = style->inherited->font_family;
+
 	/* 3bits: type */
 	*bits = (*bits & ~FONT_FAMILY_MASK) |
 			((type & 0x7) << FONT_FAMILY_SHIFT);
 
 	for (s = names; s != NULL && *s != NULL; s++)
-		*s = lwc_string_ref(*s);
+		*s = css__computed_string_ref(style, *s);
 
-	style->font_family = names;
+	style->inherited->font_family = names;
 
 	/* Free existing families */
 	if (oldnames != NULL) {
 		for (s = oldnames; *s != NULL; s++)
-			lwc_string_unref(*s);
+			css__computed_string_unref(style, *s);
 
 		if (oldnames != names)
 			style->alloc(oldnames, 0, style->pw);
@@ -6,6 +6,7 @@
  */
 
 #include <assert.h>
+#include <stddef.h>
 #include <string.h>
 
 #include <libwapcaplet/libwapcaplet.h>
@@ -15,9 +16,13 @@
 #include "bytecode/bytecode.h"
 #include "bytecode/opcodes.h"
 #include "stylesheet.h"
+#include "select/bloom.h"
 #include "select/computed.h"
 #include "select/dispatch.h"
 #include "select/hash.h"
+#include "select/intern.h"
+#include "select/invalidate.h"
+#include "select/program.h"
 #include "select/propset.h"
 #include "select/font_face.h"
 #include "select/select.h"
@@ -27,6 +32,18 @@
 /* Define this to enable verbose messages when matching selector chains */
 #undef DEBUG_CHAIN_MATCHING
 
+/* Number of recently styled nodes considered for style sharing */
+#define CSS_SELECT_SHARE_SIZE 8
+
+/* Number of compounds of a selector chain whose outcome may be memoised */
+#define CSS_SELECT_MEMO_DEPTH 8
+
+/* Number of nodes whose positions among their siblings are cached */
+#define CSS_SELECT_SIBLING_INDICES 64
+
+/* Number of parents whose numbers of children are cached */
+#define CSS_SELECT_SIBLING_TOTALS 16
+
 /**
  * Container for stylesheet selection info
  */
@@ -36,6 +53,148 @@ typedef struct css_select_sheet {
 	uint64_t media;			/**< Applicable media */
 } css_select_sheet;
 
+/**
+ * Sheet whose selectors are held in a selection context's index
+ */
+typedef struct css_select_source {
+	const css_stylesheet *sheet;	/**< Stylesheet */
+	uint32_t top;			/**< Index of top-level sheet in ctx */
+	uint32_t parent;		/**< Source of importing sheet, or
+					 * CSS_SELECT_SOURCE_NONE */
+	uint64_t media;			/**< Media of top-level sheet and of
+					 * each import rule leading to it */
+} css_select_source;
+
+/* Parent of the source of a top-level sheet */
+#define CSS_SELECT_SOURCE_NONE UINT32_MAX
+
+/**
+ * Ancestor pushed into a selection context's ancestor filter
+ */
+typedef struct css_select_bloom_node {
+	void *node;			/**< Client node */
+	uint32_t n_hashes;		/**< Number of hashes it added */
+} css_select_bloom_node;
+
+/**
+ * Ancestor of the node being visited by a subtree walk
+ */
+typedef struct css_select_walk_frame {
+	void *node;			/**< Client node */
+	const css_computed_style *style;/**< Composed style of node */
+} css_select_walk_frame;
+
+/**
+ * Rule matched by a node, recorded so that it may be replayed for a sibling
+ */
+typedef struct css_select_share_match {
+	const css_style *style;		/**< Style to cascade */
+	uint32_t specificity;		/**< Specificity of matching selector */
+	css_origin origin;		/**< Origin of containing sheet */
+	css_pseudo_element pseudo;	/**< Pseudo element style applies to */
+} css_select_share_match;
+
+/**
+ * Test of a node-specific selector detail, recorded for revalidation
+ */
+typedef struct css_select_share_test {
+	const css_selector_detail *detail;	/**< Detail tested */
+	bool match;			/**< Whether the node matched it */
+} css_select_share_test;
+
+/**
+ * Outcome of matching a compound selector against a node, as memoised
+ */
+typedef enum css_select_memo_result {
+	CSS_SELECT_MEMO_UNKNOWN,	/**< Not memoised */
+	CSS_SELECT_MEMO_MISMATCH,	/**< Compound doesn't match node */
+	CSS_SELECT_MEMO_REJECT,		/**< Compound matches node, but those
+					 * it is combined with don't */
+	CSS_SELECT_MEMO_MATCH		/**< Compound, and those it is combined
+					 * with, match */
+} css_select_memo_result;
+
+/**
+ * Ancestor match memo entry
+ *
+ * The compound is a selector of a chain, or the instruction moving to the
+ * node it is tested against in the chain's program. Only nodes moved to
+ * from the node being styled are memoised. Matching never backtracks, so
+ * once a compound matches a node, the outcome of the whole chain depends
+ * only on that node.
+ */
+typedef struct css_select_memo_entry {
+	const void *compound;		/**< Compound, or NULL if unused */
+	void *node;			/**< Node compound was tested against */
+	css_select_memo_result result;	/**< Outcome */
+} css_select_memo_entry;
+
+/**
+ * Compounds of a chain found to match nodes, awaiting the chain's outcome
+ */
+typedef struct css_select_memo_path {
+	const void *compound[CSS_SELECT_MEMO_DEPTH];	/**< Compounds */
+	void *node[CSS_SELECT_MEMO_DEPTH];	/**< Nodes they matched */
+	uint32_t n;			/**< Number of compounds */
+} css_select_memo_path;
+
+/**
+ * Position of a node among its siblings, cached for the current pass
+ */
+typedef struct css_select_sibling_index {
+	void *node;			/**< Node, or NULL if entry unused */
+	/** Number of preceding siblings, then of those with the node's
+	 * name, or -1 if not known */
+	int32_t index[2];
+} css_select_sibling_index;
+
+/**
+ * Number of children of a node, cached for the current pass
+ */
+typedef struct css_select_sibling_total {
+	void *parent;			/**< Parent, or NULL if entry unused */
+	lwc_string *name;		/**< Name of children counted, or NULL
+					 * if all were counted */
+	int32_t total;			/**< Number of children */
+} css_select_sibling_total;
+
+/**
+ * Style sharing cache entry
+ *
+ * Records the rules matched by a recently styled node, along with the
+ * outcome of every test made against the node itself, beyond its name,
+ * classes and ID. Selector matching is deterministic, so any other node 
+ * with the same name, classes and parent (and no ID) for which those tests
+ * have the same outcomes matches the same rules. The cascade may then be
+ * replayed for it without matching any selectors.
+ */
+struct css_select_share_entry {
+	bool valid;			/**< Whether entry may be shared */
+
+	void *parent;			/**< Parent of styled node */
+	uint64_t media;			/**< Media types styled for */
+	uint32_t pseudo_mask;		/**< Pseudo elements styled for */
+	css_qname element;		/**< Name of styled node */
+	lwc_string **classes;		/**< Classes of styled node */
+	uint32_t n_classes;		/**< Number of classes */
+	uint32_t classes_size;		/**< Allocated size of classes */
+	lwc_string **attributes;	/**< Attribute names of styled node */
+	uint32_t n_attributes;		/**< Number of attribute names */
+	uint32_t attributes_size;	/**< Allocated size of attributes */
+	uint32_t keyed_state;		/**< States selectors were found by */
+
+	css_select_share_match *matches;/**< Matched rules, in cascade order */
+	uint32_t n_matches;		/**< Number of matched rules */
+	uint32_t matches_size;		/**< Allocated size of matches */
+
+	css_select_share_test *tests;	/**< Node-specific tests made */
+	uint32_t n_tests;		/**< Number of tests */
+	uint32_t tests_size;		/**< Allocated size of tests */
+
+	css_origin origin;		/**< Final origin after matching */
+	uint32_t specificity;		/**< Final specificity after matching */
+};
+
 /**
  * CSS selection context
  */
@@ -44,9 +203,65 @@ struct css_select_ctx {
 
 	css_select_sheet *sheets;	/**< Array of sheets */
 
+	/** Selectors of all sheets and their imports, or NULL if the sheets
+	 * have changed since it was built */
+	css_selector_hash *index;
+	css_select_source *sources;	/**< Sheets in index, in cascade order */
+	uint32_t n_sources;		/**< Number of sources */
+	uint32_t sources_size;		/**< Allocated size of sources */
+	/** Scopes of changes to nodes, or NULL if not built since the sheets
+	 * last changed */
+	css_invalidation_map *invalidation;
+	bool borrowed;			/**< Whether indices are another ctx's */
+
 	css_allocator_fn alloc;		/**< Allocation routine */
 	void *pw;			/**< Client-specific private data */
 
+	bool frozen;			/**< Whether the sheets are fixed */
+	bool shared;			/**< Whether many threads may use ctx */
+
+	bool in_pass;			/**< Whether a selection pass is active */
+
+	css_bloom bloom;		/**< Filter of pushed ancestors */
+	css_select_bloom_node *bloom_nodes;	/**< Stack of pushed ancestors */
+	uint32_t n_bloom_nodes;		/**< Number of pushed ancestors */
+	uint32_t bloom_nodes_size;	/**< Allocated size of bloom_nodes */
+	uint32_t *bloom_hashes;		/**< Hashes added by pushed ancestors */
+	uint32_t n_bloom_hashes;	/**< Number of hashes added */
+	uint32_t bloom_hashes_size;	/**< Allocated size of bloom_hashes */
+
+	css_select_walk_frame *walk;	/**< Stack of subtree walk ancestors */
+	uint32_t n_walk;		/**< Number of ancestors on stack */
+	uint32_t walk_size;		/**< Allocated size of walk */
+
+	/** Heap of hash chains being merged, unless the ctx is shared */
+	struct css_select_chain *chains;
+	uint32_t chains_size;		/**< Allocated size of chains */
+
+	/** Style sharing cache, valid for the current pass only */
+	css_select_share_entry share[CSS_SELECT_SHARE_SIZE];
+	uint32_t next_share;		/**< Next sharing cache entry to use */
+
+	/** Ancestor match memo, valid for the current pass only, or NULL
+	 * if the client has not enabled it */
+	css_select_memo_entry *memo;
+	uint32_t memo_size;		/**< Number of entries in memo */
+	bool memo_used;			/**< Whether memo has entries */
+
+	/** Positions of recently considered nodes among their siblings,
+	 * valid for the current pass only */
+	css_select_sibling_index indices[CSS_SELECT_SIBLING_INDICES];
+	/** Numbers of children of recently considered parents, valid for
+	 * the current pass only */
+	css_select_sibling_total totals[CSS_SELECT_SIBLING_TOTALS];
+
+	/** Table of the styles composed by subtree selection, or NULL if
+	 * the client has not enabled interning */
+	css_style_intern *intern;
+
+	/** Style holding the initial values of uninherited properties */
+	css_computed_style initial;
+
 	/* Useful interned strings */
 	lwc_string *universal;
 	lwc_string *first_child;
@@ -110,6 +325,33 @@ typedef struct css_select_rule_source {
 	uint32_t class;
 } css_select_rule_source;
 
+/**
+ * Cursor into a hash chain of selectors which may match a node
+ */
+typedef struct css_select_chain {
+	const css_selector_hash_entry *entry;	/**< Current entry */
+	css_select_rule_source src;	/**< Chain the cursor walks */
+	uint32_t order;			/**< Tie-breaker between chains */
+} css_select_chain;
+
+/* Number of chains which may be merged without allocation */
+#define CSS_SELECT_CHAINS_SIZE 16
+
+/**
+ * Determine whether a handler table is of a supported version
+ *
+ * \param handler  Handler table to consider
+ * \return true if supported, false otherwise
+ */
+static inline bool handler_supported(const css_select_handler *handler)
+{
+	if (handler->handler_version == CSS_SELECT_HANDLER_VERSION_1)
+		return true;
+
+	/* Version 2 handlers must report the state of nodes */
+	return handler->handler_version == CSS_SELECT_HANDLER_VERSION_2 &&
+			handler->node_state != NULL;
+}
 
 static css_error set_hint(css_select_state *state, uint32_t prop);
 static css_error set_initial(css_select_state *state, 
@@ -119,20 +361,100 @@ static css_error set_initial(css_select_state *state,
 static css_error intern_strings(css_select_ctx *ctx);
 static void destroy_strings(css_select_ctx *ctx);
 
-static css_error select_from_sheet(css_select_ctx *ctx, 
-		const css_stylesheet *sheet, css_origin origin,
+static css_error freeze_rules(const css_rule *rule);
+static css_error freeze_selector(const css_selector *selector);
+static css_error freeze_string(lwc_string *str);
+static lwc_string *client_string_ref(const css_select_ctx *ctx,
+		lwc_string *str);
+static void client_string_unref(const css_select_ctx *ctx, lwc_string *str);
+
+static css_error index_build(css_select_ctx *ctx);
+static css_error index_add_rules(css_select_ctx *ctx, const css_rule *rule,
+		uint32_t source, uint32_t *count);
+static void index_destroy(css_select_ctx *ctx);
+static css_error invalidation_build(css_select_ctx *ctx);
+
+static void share_clear(css_select_ctx *ctx, css_select_share_entry *share);
+static void share_flush(css_select_ctx *ctx);
+static css_error share_find(css_select_ctx *ctx, void *parent,
+		css_select_state *state, css_select_share_entry **result);
+static css_select_share_entry *share_begin(css_select_ctx *ctx, 
+		void *parent);
+static css_error share_commit(css_select_ctx *ctx,
+		css_select_share_entry *share, css_select_state *state);
+static css_error share_record(css_select_ctx *ctx, 
+		const css_selector *selector, css_pseudo_element pseudo,
+		css_select_state *state);
+static css_error share_record_test(css_select_ctx *ctx, 
+		const css_selector_detail *detail, bool match,
+		css_select_state *state);
+static void memo_flush(css_select_ctx *ctx);
+static css_select_memo_result memo_find(css_select_ctx *ctx,
+		const void *compound, void *node);
+static void memo_store(css_select_ctx *ctx, const void *compound,
+		void *node, css_select_memo_result result);
+static void memo_push(css_select_memo_path *path, const void *compound,
+		void *node);
+static void memo_mismatch(css_select_ctx *ctx, css_select_memo_path *path,
+		const void *compound, void *node);
+static void memo_resolve(css_select_ctx *ctx,
+		const css_select_memo_path *path, css_select_memo_result result);
+static void sibling_flush(css_select_ctx *ctx);
+static css_error sibling_index(css_select_ctx *ctx, css_select_state *state,
+		void *node, const css_qname *name, int32_t *index);
+static css_error count_siblings(css_select_ctx *ctx, css_select_state *state,
+		void *node, bool same_name, bool after, int32_t *count);
+static css_error bloom_prepare(css_select_ctx *ctx, 
+		const css_qname *element, lwc_string *id, 
+		lwc_string **classes, uint32_t n_classes, uint32_t *n_hashes);
+static void bloom_commit(css_select_ctx *ctx, void *node, uint32_t n_hashes);
+static css_error select_style(css_select_ctx *ctx, void *node, void *parent,
+		uint64_t media, uint32_t pseudo_mask,
+		const css_stylesheet *inline_style,
+		css_select_handler *handler, void *pw, bool push,
+		css_select_results *reuse, css_select_results **result);
+static css_error initial_build(css_select_ctx *ctx);
+static css_error ensure_style(css_select_ctx *ctx, css_select_state *state,
+		css_pseudo_element pseudo);
+static void release_classes(css_select_ctx *ctx,
+		const css_select_handler *handler, lwc_string **classes,
+		uint32_t n_classes);
+static css_error walk_push(css_select_ctx *ctx, void *node, 
+		const css_computed_style *style);
+static css_error select_subtree_node(css_select_ctx *ctx, void *node,
+		void *parent, const css_computed_style *parent_style,
+		uint64_t media, css_select_handler *handler, void *pw,
+		css_select_visitor *visitor, bool push,
+		const css_computed_style **style);
+static css_error share_replay(css_select_ctx *ctx, 
+		const css_select_share_entry *share, css_select_state *state);
+
+static css_error match_selectors(css_select_ctx *ctx,
 		css_select_state *state);
-static css_error match_selectors_in_sheet(css_select_ctx *ctx, 
-		const css_stylesheet *sheet, css_select_state *state);
 static css_error match_selector_chain(css_select_ctx *ctx, 
-		const css_selector *selector, css_select_state *state);
+		const css_selector *selector, css_select_state *state,
+		bool *matched);
+static css_error run_program(css_select_ctx *ctx,
+		const css_select_insn *program, css_select_state *state,
+		bool *match, css_pseudo_element *pseudo_element);
+static css_error match_test(css_select_ctx *ctx, void *node,
+		const css_select_insn *insn, css_select_state *state,
+		bool *match);
+static css_error fetch_node_state(css_select_state *state, void *node,
+		uint32_t *flags);
+static css_error match_node_state(css_select_state *state, void *node,
+		uint32_t flag, bool *match);
+static css_error interpret_chain(css_select_ctx *ctx,
+		const css_selector *selector, css_select_state *state,
+		bool *match, css_pseudo_element *pseudo_element);
 static css_error match_named_combinator(css_select_ctx *ctx, 
 		css_combinator type, const css_selector *selector, 
-		css_select_state *state, void *node, void **next_node);
+		css_select_state *state, void *node, void **next_node,
+		css_select_memo_result *memo);
 static css_error match_universal_combinator(css_select_ctx *ctx, 
 		css_combinator type, const css_selector *selector, 
-		css_select_state *state, void *node, bool may_optimise,
-		bool *rejected_by_cache, void **next_node);
+		css_select_state *state, void *node, void **next_node,
+		css_select_memo_result *memo);
 static css_error match_details(css_select_ctx *ctx, void *node, 
 		const css_selector_detail *detail, css_select_state *state, 
 		bool *match, css_pseudo_element *pseudo_element);
@@ -183,6 +505,12 @@ css_error css_select_ctx_create(css_allocator_fn alloc, void *pw,
 	c->alloc = alloc;
 	c->pw = pw;
 
+	error = initial_build(c);
+	if (error != CSS_OK) {
+		css_select_ctx_destroy(c);
+		return error;
+	}
+
 	*result = c;
 
 	return CSS_OK;
@@ -196,11 +524,47 @@ css_error css_select_ctx_create(css_allocator_fn alloc, void *pw,
  */
 css_error css_select_ctx_destroy(css_select_ctx *ctx)
 {
+	uint32_t i;
+
 	if (ctx == NULL)
 		return CSS_BADPARM;
 
 	destroy_strings(ctx);
 
+	share_flush(ctx);
+	sibling_flush(ctx);
+
+	for (i = 0; i < CSS_SELECT_SHARE_SIZE; i++) {
+		if (ctx->share[i].classes != NULL)
+			ctx->alloc(ctx->share[i].classes, 0, ctx->pw);
+		if (ctx->share[i].attributes != NULL)
+			ctx->alloc(ctx->share[i].attributes, 0, ctx->pw);
+		if (ctx->share[i].matches != NULL)
+			ctx->alloc(ctx->share[i].matches, 0, ctx->pw);
+		if (ctx->share[i].tests != NULL)
+			ctx->alloc(ctx->share[i].tests, 0, ctx->pw);
+	}
+
+	if (ctx->bloom_nodes != NULL)
+		ctx->alloc(ctx->bloom_nodes, 0, ctx->pw);
+
+	if (ctx->bloom_hashes != NULL)
+		ctx->alloc(ctx->bloom_hashes, 0, ctx->pw);
+
+	if (ctx->walk != NULL)
+		ctx->alloc(ctx->walk, 0, ctx->pw);
+
+	if (ctx->chains != NULL)
+		ctx->alloc(ctx->chains, 0, ctx->pw);
+
+	if (ctx->memo != NULL)
+		ctx->alloc(ctx->memo, 0, ctx->pw);
+
+	if (ctx->intern != NULL)
+		css__style_intern_destroy(ctx->intern);
+
+	index_destroy(ctx);
+
 	if (ctx->sheets != NULL)
 		ctx->alloc(ctx->sheets, 0, ctx->pw);
 
@@ -248,6 +612,10 @@ css_error css_select_ctx_insert_sheet(css_select_ctx *ctx,
 	if (ctx == NULL || sheet == NULL)
 		return CSS_BADPARM;
 
+	/* The sheets of a frozen context may not be changed */
+	if (ctx->frozen)
+		return CSS_INVALID;
+
 	/* Inline styles cannot be inserted into a selection context */
 	if (sheet->inline_style)
 		return CSS_INVALID;
@@ -276,6 +644,12 @@ css_error css_select_ctx_insert_sheet(css_select_ctx *ctx,
 
 	ctx->n_sheets++;
 
+	/* Styles recorded against the old set of sheets are now stale, as
+	 * is the index, which is rebuilt when next required */
+	share_flush(ctx);
+	memo_flush(ctx);
+	index_destroy(ctx);
+
 	return CSS_OK;
 }
 
@@ -294,6 +668,9 @@ css_error css_select_ctx_remove_sheet(css_select_ctx *ctx,
 	if (ctx == NULL || sheet == NULL)
 		return CSS_BADPARM;
 
+	if (ctx->frozen)
+		return CSS_INVALID;
+
 	for (index = 0; index < ctx->n_sheets; index++) {
 		if (ctx->sheets[index].sheet == sheet)
 			break;
@@ -307,6 +684,10 @@ css_error css_select_ctx_remove_sheet(css_select_ctx *ctx,
 
 	ctx->n_sheets--;
 
+	share_flush(ctx);
+	memo_flush(ctx);
+	index_destroy(ctx);
+
 	return CSS_OK;
 
 }
@@ -351,186 +732,2210 @@ css_error css_select_ctx_get_sheet(css_select_ctx *ctx, uint32_t index,
 }
 
 /**
- * Select a style for the given node
+ * Freeze a selection context, so that it may be used by many threads
  *
- * \param ctx             Selection context to use
- * \param node            Node to select style for
- * \param media           Currently active media types
- * \param inline_style    Corresponding inline style for node, or NULL
- * \param handler         Dispatch table of handler functions
- * \param pw              Client-specific private data for handler functions
- * \param result          Pointer to location to receive result set
- * \return CSS_OK on success, appropriate error otherwise.
+ * \param ctx  Selection context to freeze
+ * \return CSS_OK on success, appropriate error otherwise
  *
- * In computing the style, no reference is made to the parent node's
- * style. Therefore, the resultant computed style is not ready for
- * immediate use, as some properties may be marked as inherited.
- * Use css_computed_style_compose() to obtain a fully computed style.
+ * Once frozen, the context's sheets may not be changed, and neither may
+ * the sheets themselves. The context itself is then not modified by
+ * css_select_style() and css_select_font_faces(), which any number of
+ * threads may call with it at once.
  *
- * This two-step approach to style computation is designed to allow
- * the client to store the partially computed style and efficiently
- * update the fully computed style for a node when layout changes.
+ * Passes, the ancestor filter and subtree selection require state which
+ * is private to a single thread, so may not be used with a frozen context
+ * directly. Instead, each thread should use its own clone of the context.
+ * See css_select_ctx_clone().
+ *
+ * LibWapcaplet is not itself thread-safe, so selecting with a frozen
+ * context, or a clone of it, neither interns strings nor modifies their
+ * reference counts. Freezing interns the caseless forms of the strings
+ * used by the sheets' selectors; the client must do likewise for the
+ * strings describing its document. Strings which the handler returns,
+ * whether from node_name, node_id and node_classes or in hints, are
+ * borrowed: the handler must not reference them. Those describing a node
+ * must remain valid until selection returns or, within a pass, until the
+ * pass ends.
+ *
+ * Computed styles selected with the context likewise borrow their strings,
+ * from the context's sheets, any inline style and the handler's hints, so
+ * must be destroyed before those are. They may only be composed with
+ * parents which also borrow their strings, such as other styles selected
+ * with the context or its clones.
  */
-css_error css_select_style(css_select_ctx *ctx, void *node,
-		uint64_t media, const css_stylesheet *inline_style,
-		css_select_handler *handler, void *pw,
-		css_select_results **result)
+css_error css_select_ctx_freeze(css_select_ctx *ctx)
 {
-	uint32_t i, j;
+	uint32_t i;
 	css_error error;
-	css_select_state state;
-	void *parent = NULL;
 
-	if (ctx == NULL || node == NULL || result == NULL || handler == NULL ||
-			handler->handler_version != 
-					CSS_SELECT_HANDLER_VERSION_1)
+	if (ctx == NULL)
 		return CSS_BADPARM;
 
-	/* Set up the selection state */
-	memset(&state, 0, sizeof(css_select_state));
-	state.node = node;
-	state.media = media;
-	state.handler = handler;
-	state.pw = pw;
-	state.next_reject = state.reject_cache +
-			(N_ELEMENTS(state.reject_cache) - 1);
+	if (ctx->frozen)
+		return CSS_OK;
 
-	/* Allocate the result set */
-	state.results = ctx->alloc(NULL, sizeof(css_select_results), ctx->pw);
-	if (state.results == NULL)
-		return CSS_NOMEM;
+	/* Neither a pass nor the ancestor filter may be active */
+	if (ctx->in_pass || ctx->n_bloom_nodes > 0)
+		return CSS_INVALID;
 
-	state.results->alloc = ctx->alloc;
-	state.results->pw = ctx->pw;
+	/* Neither selection nor queries of the scope of changes may need
+	 * to build anything once frozen */
+	if (ctx->index == NULL) {
+		error = index_build(ctx);
+		if (error != CSS_OK)
+			return error;
+	}
 
-	for (i = 0; i < CSS_PSEUDO_ELEMENT_COUNT; i++)
-		state.results->styles[i] = NULL;
+	if (ctx->invalidation == NULL) {
+		error = invalidation_build(ctx);
+		if (error != CSS_OK)
+			return error;
+	}
 
-	/* Base element style is guaranteed to exist */
-	error = css_computed_style_create(ctx->alloc, ctx->pw,
-			&state.results->styles[CSS_PSEUDO_ELEMENT_NONE]);
-	if (error != CSS_OK) {
-		ctx->alloc(state.results, 0, ctx->pw);
-		return error;
+	for (i = 0; i < ctx->n_sheets; i++) {
+		error = freeze_rules(ctx->sheets[i].sheet->rule_list);
+		if (error != CSS_OK)
+			return error;
 	}
 
-	error = handler->parent_node(pw, node, &parent);
-	if (error != CSS_OK)
-		goto cleanup;
+	ctx->frozen = true;
+	ctx->shared = true;
 
-	/* Get node's name */
-	error = handler->node_name(pw, node, &state.element);
-	if (error != CSS_OK)
-		return error;
+	return CSS_OK;
+}
 
-	/* Get node's ID, if any */
-	error = handler->node_id(pw, node, &state.id);
-	if (error != CSS_OK)
-		goto cleanup;
+/**
+ * Create a clone of a frozen selection context, for use by a single thread
+ *
+ * \param ctx     Frozen selection context
+ * \param result  Pointer to location to receive clone
+ * \return CSS_OK on success,
+ *         CSS_BADPARM on bad parameters,
+ *         CSS_INVALID if the context is not frozen,
+ *         CSS_NOMEM on memory exhaustion
+ *
+ * The clone uses the same sheets and index as the context, and is also
+ * frozen, so borrows strings in the same way, but has its own state for
+ * passes, the ancestor filter and subtree selection. It must only be used
+ * by one thread at a time, and must be destroyed with
+ * css_select_ctx_destroy() before the context is.
+ *
+ * Clones should be created, and destroyed, by the thread which created
+ * the context, as doing so references strings.
+ */
+css_error css_select_ctx_clone(css_select_ctx *ctx, css_select_ctx **result)
+{
+	css_select_ctx *c;
+	css_error error;
 
-	/* Get node's classes, if any */
-	/** \todo Do we really want to force the client to allocate a new array 
-	 * every time we call this? It seems hugely inefficient, given they can 
-	 * cache the data. */
-	error = handler->node_classes(pw, node,	
-			&state.classes, &state.n_classes);
-	if (error != CSS_OK)
-		goto cleanup;
+	if (ctx == NULL || result == NULL)
+		return CSS_BADPARM;
 
-	/* Iterate through the top-level stylesheets, selecting styles
-	 * from those which apply to our current media requirements and
-	 * are not disabled */
-	for (i = 0; i < ctx->n_sheets; i++) {
-		const css_select_sheet s = ctx->sheets[i];
+	if (ctx->frozen == false)
+		return CSS_INVALID;
 
-		if ((s.media & media) != 0 &&
-				s.sheet->disabled == false) {
-			error = select_from_sheet(ctx, s.sheet, 
-					s.origin, &state);
-			if (error != CSS_OK)
-				goto cleanup;
+	error = css_select_ctx_create(ctx->alloc, ctx->pw, &c);
+	if (error != CSS_OK)
+		return error;
+
+	if (ctx->n_sheets > 0) {
+		c->sheets = ctx->alloc(NULL,
+				ctx->n_sheets * sizeof(css_select_sheet),
+				ctx->pw);
+		if (c->sheets == NULL) {
+			css_select_ctx_destroy(c);
+			return CSS_NOMEM;
 		}
-	}
 
-	/* Consider any inline style for the node */
-	if (inline_style != NULL) {
-		css_rule_selector *sel = 
-				(css_rule_selector *) inline_style->rule_list;
+		memcpy(c->sheets, ctx->sheets,
+				ctx->n_sheets * sizeof(css_select_sheet));
+		c->n_sheets = ctx->n_sheets;
+	}
 
-		/* Sanity check style */
-		if (inline_style->rule_count != 1 ||
-			inline_style->rule_list->type != CSS_RULE_SELECTOR || 
-				inline_style->rule_list->items != 0) {
-			error = CSS_INVALID;
-			goto cleanup;
-		}
+	c->index = ctx->index;
+	c->sources = ctx->sources;
+	c->n_sources = ctx->n_sources;
+	c->invalidation = ctx->invalidation;
+	c->borrowed = true;
 
-		/* No bytecode if input was empty or wholly invalid */
-		if (sel->style != NULL) {
-			/* Inline style applies to base element only */
-			state.current_pseudo = CSS_PSEUDO_ELEMENT_NONE;
-			state.computed = state.results->styles[
-					CSS_PSEUDO_ELEMENT_NONE];
+	c->frozen = true;
 
-			error = cascade_style(sel->style, &state);
-			if (error != CSS_OK)
-				goto cleanup;
-		}
-	}
+	*result = c;
 
-	/* Take account of presentational hints and fix up any remaining
-	 * unset properties. */
+	return CSS_OK;
+}
 
-	/* Base element */
-	state.current_pseudo = CSS_PSEUDO_ELEMENT_NONE;
-	state.computed = state.results->styles[CSS_PSEUDO_ELEMENT_NONE];
-	for (i = 0; i < CSS_N_PROPERTIES; i++) {
-		const prop_state *prop = 
-				&state.props[i][CSS_PSEUDO_ELEMENT_NONE];
+/**
+ * Determine the nodes whose styles may be affected by a change to a node
+ *
+ * \param ctx     Selection context
+ * \param change  Change made to the node
+ * \param scope   Pointer to location to receive nodes affected
+ * \return CSS_OK on success, appropriate error otherwise
+ *
+ * The scope is determined from the positions in which the selectors of the
+ * context's sheets use the class, ID, attribute or node state changed. If
+ * they test it only of the node being styled, only the changed node may
+ * need restyling. If they test it of ancestors or preceding siblings, the
+ * changed node's descendants or following siblings may also need it.
+ *
+ * Where a value is replaced by another, such as when a node's ID changes,
+ * the scope is the wider of those for the old and new values. Nodes which
+ * are not restyled, but inherit from those which are, must still have
+ * their styles composed again.
+ */
+css_error css_select_ctx_invalidation(css_select_ctx *ctx,
+		const css_select_change *change,
+		css_select_invalidation *scope)
+{
+	css_error error;
 
-		/* Apply presentational hints if the property is unset or 
-		 * the existing property value did not come from an author 
-		 * stylesheet or a user sheet using !important. */
-		if (prop->set == false ||
-				(prop->origin != CSS_ORIGIN_AUTHOR &&
-				prop->important == false)) {
-			error = set_hint(&state, i);
-			if (error != CSS_OK)
-				goto cleanup;
-		}
+	if (ctx == NULL || change == NULL || scope == NULL)
+		return CSS_BADPARM;
 
-		/* If the property is still unset or it's set to inherit 
-		 * and we're the root element, then set it to its initial 
-		 * value. */
-		if (prop->set == false || 
-				(parent == NULL && 
-				prop->inherit == true)) {
-			error = set_initial(&state, i, 
-					CSS_PSEUDO_ELEMENT_NONE, parent);
-			if (error != CSS_OK)
-				goto cleanup;
-		}
+	/* Frozen contexts build the map when frozen */
+	if (ctx->invalidation == NULL) {
+		error = invalidation_build(ctx);
+		if (error != CSS_OK)
+			return error;
 	}
 
-	/* Pseudo elements, if any */
-	for (j = CSS_PSEUDO_ELEMENT_NONE + 1; j < CSS_PSEUDO_ELEMENT_COUNT; j++) {
-		state.current_pseudo = j;
-		state.computed = state.results->styles[j];
+	return css__invalidation_map_scope(ctx->invalidation, change, scope);
+}
 
-		/* Skip non-existent pseudo elements */
-		if (state.computed == NULL)
-			continue;
+/**
+ * Begin a selection pass
+ *
+ * \param ctx  Selection context
+ * \return CSS_OK on success, appropriate error otherwise
+ *
+ * Within a pass, the selection context may share the results of selector
+ * matching between sibling nodes with the same name and classes, rather
+ * than matching each of them individually. If the client has enabled the
+ * ancestor match memo with css_select_ctx_set_memo_size(), it may also
+ * remember the outcome of matching compound selectors against ancestors
+ * and siblings. The positions of nodes among their siblings are also
+ * remembered, so that styling the children of a node in order need not
+ * count the siblings of each. The client must therefore ensure that the
+ * document tree,
+ * and the state of the nodes within it (e.g. hover, attributes, etc),
+ * does not change until the pass is ended with css_select_ctx_end_pass().
+ *
+ * Beginning a pass while one is already active discards any state held
+ * for the existing pass.
+ */
+css_error css_select_ctx_begin_pass(css_select_ctx *ctx)
+{
+	if (ctx == NULL)
+		return CSS_BADPARM;
 
-		for (i = 0; i < CSS_N_PROPERTIES; i++) {
-			const prop_state *prop = &state.props[i][j];
+	if (ctx->shared)
+		return CSS_INVALID;
 
-			/* If the property is still unset then set it 
-			 * to its initial value. */
-			if (prop->set == false) {
-				error = set_initial(&state, i, j, parent);
-				if (error != CSS_OK)
-					goto cleanup;
+	share_flush(ctx);
+	memo_flush(ctx);
+	sibling_flush(ctx);
+
+	ctx->in_pass = true;
+
+	return CSS_OK;
+}
+
+/**
+ * End a selection pass
+ *
+ * \param ctx  Selection context
+ * \return CSS_OK on success, appropriate error otherwise
+ */
+css_error css_select_ctx_end_pass(css_select_ctx *ctx)
+{
+	if (ctx == NULL)
+		return CSS_BADPARM;
+
+	if (ctx->shared)
+		return CSS_INVALID;
+
+	share_flush(ctx);
+	memo_flush(ctx);
+	sibling_flush(ctx);
+
+	ctx->in_pass = false;
+
+	return CSS_OK;
+}
+
+/**
+ * Set the size of a selection context's ancestor match memo
+ *
+ * \param ctx   Selection context
+ * \param size  Number of entries, which is rounded up to a power of 2, or
+ *              0 to disable the memo
+ * \return CSS_OK on success, appropriate error otherwise
+ *
+ * Within a pass, the memo records whether each compound selector to the
+ * left of a combinator matched the ancestors and siblings of the node
+ * being selected for that it was tested against. Nodes sharing those
+ * ancestors need not test them again, which is worthwhile where the
+ * client's handlers are expensive. Each entry records one compound and
+ * node, and entries are replaced as the memo fills, so sheets with many
+ * selectors need many entries. The memo is disabled by default, and for
+ * cloned contexts.
+ *
+ * The size may not be changed during a pass.
+ */
+css_error css_select_ctx_set_memo_size(css_select_ctx *ctx, uint32_t size)
+{
+	css_select_memo_entry *temp = NULL;
+	uint32_t n = 0;
+
+	if (ctx == NULL || size > (1u << 31))
+		return CSS_BADPARM;
+
+	if (ctx->shared || ctx->in_pass)
+		return CSS_INVALID;
+
+	if (size > 0) {
+		n = 1;
+		while (n < size)
+			n *= 2;
+
+		temp = ctx->alloc(ctx->memo,
+				n * sizeof(css_select_memo_entry), ctx->pw);
+		if (temp == NULL)
+			return CSS_NOMEM;
+
+		memset(temp, 0, n * sizeof(css_select_memo_entry));
+	} else if (ctx->memo != NULL) {
+		ctx->alloc(ctx->memo, 0, ctx->pw);
+	}
+
+	ctx->memo = temp;
+	ctx->memo_size = n;
+	ctx->memo_used = false;
+
+	return CSS_OK;
+}
+
+/**
+ * Enable or disable the interning of a selection context's styles
+ *
+ * \param ctx     Selection context
+ * \param intern  Whether to intern styles
+ * \return CSS_OK on success, appropriate error otherwise
+ *
+ * Once enabled, the composed styles passed to the visitor by
+ * css_select_subtree() are interned: a style with the same contents as one
+ * previously handed out, and not yet destroyed, is replaced by a further
+ * reference to that style. Other styles may be interned by the client with
+ * css_select_ctx_intern_style(). Interned styles from the same context are
+ * therefore equal if, and only if, they are the same object.
+ *
+ * Interned styles are immutable, and each reference is released with
+ * css_computed_style_destroy(), by the thread using the context. Disabling
+ * interning, or destroying the context, leaves styles already handed out
+ * valid, but they are not interned again. Interning is disabled by default,
+ * and for cloned contexts.
+ */
+css_error css_select_ctx_set_interning(css_select_ctx *ctx, bool intern)
+{
+	css_error error;
+
+	if (ctx == NULL)
+		return CSS_BADPARM;
+
+	if (ctx->shared)
+		return CSS_INVALID;
+
+	if (intern && ctx->intern == NULL) {
+		error = css__style_intern_create(ctx->alloc, ctx->pw,
+				&ctx->intern);
+		if (error != CSS_OK)
+			return error;
+	} else if (intern == false && ctx->intern != NULL) {
+		css__style_intern_destroy(ctx->intern);
+		ctx->intern = NULL;
+	}
+
+	return CSS_OK;
+}
+
+/**
+ * Intern a computed style
+ *
+ * \param ctx    Selection context, with interning enabled
+ * \param style  Pointer to style to intern, replaced by the interned style
+ * \return CSS_OK on success, appropriate error otherwise
+ *
+ * If the context has handed out a style with the same contents, the given
+ * style is destroyed, and a further reference to that style is returned in
+ * its place. Otherwise, the given style itself becomes interned. Either
+ * way, the client holds one reference to the resulting style, which must
+ * not be modified. Styles which are already interned are left unchanged.
+ *
+ * Styles obtained from css_select_style() are not interned, as the client
+ * may compose into them. They may be interned once fully composed.
+ */
+css_error css_select_ctx_intern_style(css_select_ctx *ctx,
+		css_computed_style **style)
+{
+	if (ctx == NULL || style == NULL || *style == NULL)
+		return CSS_BADPARM;
+
+	if (ctx->shared || ctx->intern == NULL)
+		return CSS_INVALID;
+
+	return css__style_intern_insert(ctx->intern, style);
+}
+
+/**
+ * Push a node into a selection context's ancestor filter
+ *
+ * \param ctx      Selection context
+ * \param node     Node to push
+ * \param handler  Dispatch table of handler functions
+ * \param pw       Client-specific private data for handler functions
+ * \return CSS_OK on success, appropriate error otherwise
+ *
+ * The ancestor filter records the names, IDs and classes of the ancestors
+ * of the node being selected for, allowing selectors which require 
+ * ancestors the node does not have to be rejected without walking the
+ * document tree. Clients should push each node before selecting styles 
+ * for its children, and pop it again afterwards. The filter is only used
+ * when the most recently pushed node is the parent of the node being
+ * selected for (or when the filter is empty and the node is the root).
+ */
+css_error css_select_bloom_push(css_select_ctx *ctx, void *node,
+		css_select_handler *handler, void *pw)
+{
+	css_qname element = { NULL, NULL };
+	lwc_string *id = NULL;
+	lwc_string **classes = NULL;
+	uint32_t n_classes = 0;
+	uint32_t n;
+	css_error error;
+
+	if (ctx == NULL || node == NULL || handler == NULL ||
+			handler_supported(handler) == false)
+		return CSS_BADPARM;
+
+	if (ctx->shared)
+		return CSS_INVALID;
+
+	error = handler->node_name(pw, node, &element);
+	if (error != CSS_OK)
+		return error;
+
+	error = handler->node_id(pw, node, &id);
+	if (error != CSS_OK)
+		goto cleanup;
+
+	error = handler->node_classes(pw, node, &classes, &n_classes);
+	if (error != CSS_OK)
+		goto cleanup;
+
+	error = bloom_prepare(ctx, &element, id, classes, n_classes, &n);
+	if (error != CSS_OK)
+		goto cleanup;
+
+	bloom_commit(ctx, node, n);
+
+	error = CSS_OK;
+
+cleanup:
+	release_classes(ctx, handler, classes, n_classes);
+
+	client_string_unref(ctx, id);
+
+	client_string_unref(ctx, element.ns);
+	client_string_unref(ctx, element.name);
+
+	return error;
+}
+
+/**
+ * Pop the most recently pushed node from a selection context's ancestor filter
+ *
+ * \param ctx  Selection context
+ * \return CSS_OK on success, 
+ *         CSS_BADPARM on bad parameters,
+ *         CSS_INVALID if the filter is empty
+ */
+css_error css_select_bloom_pop(css_select_ctx *ctx)
+{
+	css_select_bloom_node *top;
+
+	if (ctx == NULL)
+		return CSS_BADPARM;
+
+	if (ctx->shared || ctx->n_bloom_nodes == 0)
+		return CSS_INVALID;
+
+	top = &ctx->bloom_nodes[--ctx->n_bloom_nodes];
+
+	for (; top->n_hashes > 0; top->n_hashes--) {
+		css_bloom_remove(&ctx->bloom, 
+				ctx->bloom_hashes[--ctx->n_bloom_hashes]);
+	}
+
+	return CSS_OK;
+}
+
+/**
+ * Select a style for the given node
+ *
+ * \param ctx             Selection context to use
+ * \param node            Node to select style for
+ * \param media           Currently active media types
+ * \param inline_style    Corresponding inline style for node, or NULL
+ * \param handler         Dispatch table of handler functions
+ * \param pw              Client-specific private data for handler functions
+ * \param result          Pointer to location to receive result set
+ * \return CSS_OK on success, appropriate error otherwise.
+ *
+ * In computing the style, no reference is made to the parent node's
+ * style. Therefore, the resultant computed style is not ready for
+ * immediate use, as some properties may be marked as inherited.
+ * Use css_computed_style_compose() to obtain a fully computed style.
+ *
+ * This two-step approach to style computation is designed to allow
+ * the client to store the partially computed style and efficiently
+ * update the fully computed style for a node when layout changes.
+ */
+css_error css_select_style(css_select_ctx *ctx, void *node,
+		uint64_t media, const css_stylesheet *inline_style,
+		css_select_handler *handler, void *pw,
+		css_select_results **result)
+{
+	css_error error;
+	void *parent = NULL;
+
+	if (ctx == NULL || node == NULL || result == NULL || handler == NULL ||
+			handler_supported(handler) == false)
+		return CSS_BADPARM;
+
+	error = handler->parent_node(pw, node, &parent);
+	if (error != CSS_OK)
+		return error;
+
+	return select_style(ctx, node, parent, media,
+			CSS_PSEUDO_ELEMENT_MASK_ALL, inline_style,
+			handler, pw, false, NULL, result);
+}
+
+/**
+ * Select a style for the given node, reusing an existing result set
+ *
+ * \param ctx             Selection context to use
+ * \param node            Node to select style for
+ * \param media           Currently active media types
+ * \param inline_style    Corresponding inline style for node, or NULL
+ * \param handler         Dispatch table of handler functions
+ * \param pw              Client-specific private data for handler functions
+ * \param results         Result set to replace the contents of
+ * \return CSS_OK on success, appropriate error otherwise.
+ *
+ * As css_select_style(), except that the styles previously held by the
+ * result set, which must have been obtained from this function,
+ * css_select_style() or css_select_subtree(), are replaced. The memory
+ * of the old styles is reused for the new ones where possible.
+ *
+ * The result set remains the client's to destroy, even if an error is
+ * returned. In that case, its styles are unspecified.
+ */
+css_error css_select_style_into(css_select_ctx *ctx, void *node,
+		uint64_t media, const css_stylesheet *inline_style,
+		css_select_handler *handler, void *pw,
+		css_select_results *results)
+{
+	css_error error;
+	void *parent = NULL;
+
+	if (ctx == NULL || node == NULL || results == NULL ||
+			handler == NULL || handler_supported(handler) == false)
+		return CSS_BADPARM;
+
+	error = handler->parent_node(pw, node, &parent);
+	if (error != CSS_OK)
+		return error;
+
+	return select_style(ctx, node, parent, media,
+			CSS_PSEUDO_ELEMENT_MASK_ALL, inline_style,
+			handler, pw, false, results, &results);
+}
+
+/**
+ * Select the styles of the given node and some of its pseudo elements
+ *
+ * \param ctx             Selection context to use
+ * \param node            Node to select style for
+ * \param media           Currently active media types
+ * \param pseudo_mask     Mask of pseudo elements to select styles for
+ * \param inline_style    Corresponding inline style for node, or NULL
+ * \param handler         Dispatch table of handler functions
+ * \param pw              Client-specific private data for handler functions
+ * \param result          Pointer to location to receive result set
+ * \return CSS_OK on success, appropriate error otherwise.
+ *
+ * As css_select_style(), except that only the pseudo elements in the
+ * mask, formed with CSS_PSEUDO_ELEMENT_MASK(), are styled. The rules of
+ * any others are not considered at all, and their styles are left NULL.
+ * The style of the base element is always selected.
+ *
+ * A client which lays out only the base element in a pass may style
+ * nodes without their pseudo elements, and select them again with the
+ * pseudo elements it needs later.
+ */
+css_error css_select_style_masked(css_select_ctx *ctx, void *node,
+		uint64_t media, uint32_t pseudo_mask,
+		const css_stylesheet *inline_style,
+		css_select_handler *handler, void *pw,
+		css_select_results **result)
+{
+	css_error error;
+	void *parent = NULL;
+
+	if (ctx == NULL || node == NULL || result == NULL || handler == NULL ||
+			handler_supported(handler) == false ||
+			(pseudo_mask & ~CSS_PSEUDO_ELEMENT_MASK_ALL) != 0)
+		return CSS_BADPARM;
+
+	error = handler->parent_node(pw, node, &parent);
+	if (error != CSS_OK)
+		return error;
+
+	return select_style(ctx, node, parent, media, pseudo_mask,
+			inline_style, handler, pw, false, NULL, result);
+}
+
+/**
+ * Destroy a selection result set
+ *
+ * \param results  Result set to destroy
+ * \return CSS_OK on success, appropriate error otherwise
+ */
+css_error css_select_results_destroy(css_select_results *results)
+{
+	uint32_t i;
+
+	if (results == NULL)
+		return CSS_BADPARM;
+
+	if (results->styles != NULL) {
+		for (i = 0; i < CSS_PSEUDO_ELEMENT_COUNT; i++) {
+			if (results->styles[i] != NULL)
+				css_computed_style_destroy(results->styles[i]);
+		}
+	}
+
+	results->alloc(results, 0, results->pw);
+
+	return CSS_OK;
+}
+
+/**
+ * Select, compose and visit the styles of all nodes in a subtree
+ *
+ * \param ctx      Selection context to use
+ * \param root     Root node of subtree
+ * \param media    Currently active media types
+ * \param handler  Dispatch table of handler functions
+ * \param pw       Client-specific private data for handler and visitor
+ * \param visitor  Dispatch table of visitor functions
+ * \return CSS_OK on success, appropriate error otherwise.
+ *
+ * The subtree is walked in document order, using the visitor's
+ * first_child and next_sibling functions. Each node's style is selected
+ * and composed with that of its parent, as are any of its pseudo element
+ * styles with the node's own, and the result set is passed to the 
+ * visitor's visit function. If the root has a parent, its composed style 
+ * is obtained from the visitor's parent_style function.
+ *
+ * Ownership of each result set passes to the client, which must not
+ * destroy any of them until this function has returned: the composed
+ * styles of a node's ancestors are used in composing its own.
+ *
+ * If the context interns styles, see css_select_ctx_set_interning(), each
+ * composed style is interned before being visited.
+ *
+ * Unlike successive calls to css_select_style(), the ancestor filter is
+ * maintained and a selection pass is used (if one is not already active)
+ * without the client's involvement, and each node's parent is already
+ * known. The document tree must not change during the walk. Any error 
+ * returned by a visitor function abandons the walk.
+ */
+css_error css_select_subtree(css_select_ctx *ctx, void *root,
+		uint64_t media, css_select_handler *handler, void *pw,
+		css_select_visitor *visitor)
+{
+	const css_computed_style *root_parent_style = NULL;
+	const css_computed_style *parent_style, *style;
+	void *root_parent = NULL;
+	void *node, *parent;
+	uint32_t base, n_bloom_nodes;
+	bool end_pass = false;
+	css_error error;
+
+	if (ctx == NULL || root == NULL || handler == NULL || 
+			handler_supported(handler) == false ||
+			visitor == NULL || visitor->visitor_version != 
+					CSS_SELECT_VISITOR_VERSION_1)
+		return CSS_BADPARM;
+
+	if (ctx->shared)
+		return CSS_INVALID;
+
+	/* Any ancestors pushed by us or by a failed walk are popped again
+	 * on exit, as are the entries on the walk stack */
+	base = ctx->n_walk;
+	n_bloom_nodes = ctx->n_bloom_nodes;
+
+	error = handler->parent_node(pw, root, &root_parent);
+	if (error != CSS_OK)
+		return error;
+
+	if (root_parent != NULL) {
+		error = visitor->parent_style(pw, root, &root_parent_style);
+		if (error != CSS_OK)
+			return error;
+
+		/* Fill the ancestor filter with the root's ancestors, unless
+		 * the client has already done so */
+		if (n_bloom_nodes == 0 || ctx->bloom_nodes[
+				n_bloom_nodes - 1].node != root_parent) {
+			for (node = root_parent; node != NULL; node = parent) {
+				error = walk_push(ctx, node, NULL);
+				if (error != CSS_OK)
+					goto cleanup;
+
+				error = handler->parent_node(pw, node, &parent);
+				if (error != CSS_OK)
+					goto cleanup;
+			}
+
+			while (ctx->n_walk > base) {
+				error = css_select_bloom_push(ctx, 
+						ctx->walk[--ctx->n_walk].node,
+						handler, pw);
+				if (error != CSS_OK)
+					goto cleanup;
+			}
+		}
+	}
+
+	/* Siblings within the subtree may share styles */
+	if (ctx->in_pass == false) {
+		css_select_ctx_begin_pass(ctx);
+		end_pass = true;
+	}
+
+	node = root;
+	parent = root_parent;
+	parent_style = root_parent_style;
+
+	for (;;) {
+		void *next = NULL;
+
+		error = visitor->first_child(pw, node, &next);
+		if (error != CSS_OK)
+			goto cleanup;
+
+		/* Nodes with children are pushed into the ancestor filter */
+		error = select_subtree_node(ctx, node, parent, parent_style,
+				media, handler, pw, visitor, next != NULL, 
+				&style);
+		if (error != CSS_OK)
+			goto cleanup;
+
+		if (next != NULL) {
+			/* Descend into the node's children */
+			error = walk_push(ctx, node, style);
+			if (error != CSS_OK)
+				goto cleanup;
+
+			parent = node;
+			parent_style = style;
+			node = next;
+			continue;
+		}
+
+		/* Find the next node in document order, ascending as far as
+		 * necessary, until we return to the root */
+		while (node != root) {
+			error = visitor->next_sibling(pw, node, &next);
+			if (error != CSS_OK)
+				goto cleanup;
+
+			if (next != NULL)
+				break;
+
+			node = ctx->walk[--ctx->n_walk].node;
+			css_select_bloom_pop(ctx);
+
+			if (ctx->n_walk > base) {
+				parent = ctx->walk[ctx->n_walk - 1].node;
+				parent_style = ctx->walk[ctx->n_walk - 1].style;
+			} else {
+				parent = root_parent;
+				parent_style = root_parent_style;
+			}
+		}
+
+		if (node == root)
+			break;
+
+		node = next;
+	}
+
+	error = CSS_OK;
+
+cleanup:
+	ctx->n_walk = base;
+
+	while (ctx->n_bloom_nodes > n_bloom_nodes)
+		css_select_bloom_pop(ctx);
+
+	if (end_pass)
+		css_select_ctx_end_pass(ctx);
+
+	return error;
+}
+
+/**
+ * Search a selection context for defined font faces
+ *
+ * \param ctx          Selection context
+ * \param media        Currently active media types
+ * \param font_family  Font family to search for
+ * \param result       Pointer to location to receive result
+ * \return CSS_OK on success, appropriate error otherwise.
+ */
+css_error css_select_font_faces(css_select_ctx *ctx,
+		uint64_t media, lwc_string *font_family,
+		css_select_font_faces_results **result)
+{
+	uint32_t i;
+	css_error error;
+	css_select_font_faces_state state;
+	uint32_t n_font_faces;
+	
+	if (ctx == NULL || font_family == NULL || result == NULL)
+		return CSS_BADPARM;
+
+	memset(&state, 0, sizeof(css_select_font_faces_state));
+	state.font_family = font_family;
+	state.media = media;
+	
+	/* Iterate through the top-level stylesheets, selecting font-faces
+	 * from those which apply to our current media requirements and
+	 * are not disabled */
+	for (i = 0; i < ctx->n_sheets; i++) {
+		const css_select_sheet s = ctx->sheets[i];
+		
+		if ((s.media & media) != 0 &&
+				s.sheet->disabled == false) {
+			error = select_font_faces_from_sheet(ctx, s.sheet,
+					s.origin, &state);
+			if (error != CSS_OK)
+				goto cleanup;
+		}
+	}
+	
+	n_font_faces = state.ua_font_faces.count + 
+			state.user_font_faces.count +
+			state.author_font_faces.count;
+				
+	
+	if (n_font_faces > 0) {
+		/* We found some matching faces.  Make a results structure with
+		 * the font faces in priority order. */
+		css_select_font_faces_results *results;
+		
+		results = ctx->alloc(NULL, 
+				sizeof(css_select_font_faces_results),
+				ctx->pw);
+		if (results == NULL) {
+			error = CSS_NOMEM;
+			goto cleanup;
+		}
+		
+		results->alloc = ctx->alloc;
+		results->pw = ctx->pw;
+		
+		results->font_faces = ctx->alloc(NULL, 
+				n_font_faces * sizeof(css_font_face *),
+				ctx->pw);
+		if (results->font_faces == NULL) {
+			ctx->alloc(results, 0, ctx->pw);
+			error = CSS_NOMEM;
+			goto cleanup;
+		}
+
+		results->n_font_faces = n_font_faces;
+		
+		i = 0;
+		if (state.ua_font_faces.count != 0) {
+			memcpy(results->font_faces, 
+					state.ua_font_faces.font_faces,
+					sizeof(css_font_face *) * 
+						state.ua_font_faces.count);
+			
+			i += state.ua_font_faces.count;
+		}
+				
+		if (state.user_font_faces.count != 0) {
+			memcpy(results->font_faces + i, 
+					state.user_font_faces.font_faces,
+					sizeof(css_font_face *) * 
+						state.user_font_faces.count);
+			i += state.user_font_faces.count;
+		}
+		
+		if (state.author_font_faces.count != 0) {
+			memcpy(results->font_faces + i, 
+					state.author_font_faces.font_faces,
+					sizeof(css_font_face *) * 
+						state.author_font_faces.count);
+		}
+
+		*result = results;
+	}
+	
+	error = CSS_OK;
+	
+cleanup:
+	if (state.ua_font_faces.count != 0) 
+		ctx->alloc(state.ua_font_faces.font_faces, 0, ctx->pw);
+
+	if (state.user_font_faces.count != 0) 
+		ctx->alloc(state.user_font_faces.font_faces, 0, ctx->pw);
+	
+	if (state.author_font_faces.count != 0) 
+		ctx->alloc(state.author_font_faces.font_faces, 0, ctx->pw);
+	
+	return error;
+}
+
+/**
+ * Destroy a font-face result set
+ *
+ * \param results  Result set to destroy
+ * \return CSS_OK on success, appropriate error otherwise
+ */
+css_error css_select_font_faces_results_destroy(
+		css_select_font_faces_results *results)
+{
+	if (results == NULL)
+		return CSS_BADPARM;
+	
+	if (results->font_faces != NULL) {
+		/* Don't destroy the individual css_font_faces, they're owned
+		   by their respective sheets */
+		results->alloc(results->font_faces, 0, results->pw);
+	}
+	
+	results->alloc(results, 0, results->pw);
+	
+	return CSS_OK;
+}
+
+/******************************************************************************
+ * Selection engine internals below here                                      *
+ ******************************************************************************/
+
+css_error intern_strings(css_select_ctx *ctx)
+{
+	lwc_error error;
+
+	/* Universal selector */
+	error = lwc_intern_string("*", SLEN("*"), &ctx->universal);
+	if (error != lwc_error_ok)
+		return css_error_from_lwc_error(error);
+
+	/* Pseudo classes */
+	error = lwc_intern_string(
+			"first-child", SLEN("first-child"), 
+			&ctx->first_child);
+	if (error != lwc_error_ok)
+		return css_error_from_lwc_error(error);
+
+	error = lwc_intern_string(
+			"link", SLEN("link"), 
+			&ctx->link);
+	if (error != lwc_error_ok)
+		return css_error_from_lwc_error(error);
+
+	error = lwc_intern_string(
+			"visited", SLEN("visited"), 
+			&ctx->visited);
+	if (error != lwc_error_ok)
+		return css_error_from_lwc_error(error);
+
+	error = lwc_intern_string(
+			"hover", SLEN("hover"), 
+			&ctx->hover);
+	if (error != lwc_error_ok)
+		return css_error_from_lwc_error(error);
+
+	error = lwc_intern_string(
+			"active", SLEN("active"), 
+			&ctx->active);
+	if (error != lwc_error_ok)
+		return css_error_from_lwc_error(error);
+
+	error = lwc_intern_string(
+			"focus", SLEN("focus"), 
+			&ctx->focus);
+	if (error != lwc_error_ok)
+		return css_error_from_lwc_error(error);
+
+	error = lwc_intern_string(
+			"nth-child", SLEN("nth-child"),
+			&ctx->nth_child);
+	if (error != lwc_error_ok)
+		return css_error_from_lwc_error(error);
+
+	error = lwc_intern_string(
+			"nth-last-child", SLEN("nth-last-child"),
+			&ctx->nth_last_child);
+	if (error != lwc_error_ok)
+		return css_error_from_lwc_error(error);
+
+	error = lwc_intern_string(
+			"nth-of-type", SLEN("nth-of-type"),
+			&ctx->nth_of_type);
+	if (error != lwc_error_ok)
+		return css_error_from_lwc_error(error);
+
+	error = lwc_intern_string(
+			"nth-last-of-type", SLEN("nth-last-of-type"),
+			&ctx->nth_last_of_type);
+	if (error != lwc_error_ok)
+		return css_error_from_lwc_error(error);
+
+	error = lwc_intern_string(
+			"last-child", SLEN("last-child"),
+			&ctx->last_child);
+	if (error != lwc_error_ok)
+		return css_error_from_lwc_error(error);
+
+	error = lwc_intern_string(
+			"first-of-type", SLEN("first-of-type"),
+			&ctx->first_of_type);
+	if (error != lwc_error_ok)
+		return css_error_from_lwc_error(error);
+
+	error = lwc_intern_string(
+			"last-of-type", SLEN("last-of-type"),
+			&ctx->last_of_type);
+	if (error != lwc_error_ok)
+		return css_error_from_lwc_error(error);
+
+	error = lwc_intern_string(
+			"only-child", SLEN("only-child"),
+			&ctx->only_child);
+	if (error != lwc_error_ok)
+		return css_error_from_lwc_error(error);
+
+	error = lwc_intern_string(
+			"only-of-type", SLEN("only-of-type"),
+			&ctx->only_of_type);
+	if (error != lwc_error_ok)
+		return css_error_from_lwc_error(error);
+
+	error = lwc_intern_string(
+			"root", SLEN("root"),
+			&ctx->root);
+	if (error != lwc_error_ok)
+		return css_error_from_lwc_error(error);
+
+	error = lwc_intern_string(
+			"empty", SLEN("empty"),
+			&ctx->empty);
+	if (error != lwc_error_ok)
+		return css_error_from_lwc_error(error);
+
+	error = lwc_intern_string(
+			"target", SLEN("target"),
+			&ctx->target);
+	if (error != lwc_error_ok)
+		return css_error_from_lwc_error(error);
+
+	error = lwc_intern_string(
+			"lang", SLEN("lang"),
+			&ctx->lang);
+	if (error != lwc_error_ok)
+		return css_error_from_lwc_error(error);
+
+	error = lwc_intern_string(
+			"enabled", SLEN("enabled"),
+			&ctx->enabled);
+	if (error != lwc_error_ok)
+		return css_error_from_lwc_error(error);
+
+	error = lwc_intern_string(
+			"disabled", SLEN("disabled"),
+			&ctx->disabled);
+	if (error != lwc_error_ok)
+		return css_error_from_lwc_error(error);
+
+	error = lwc_intern_string(
+			"checked", SLEN("checked"),
+			&ctx->checked);
+	if (error != lwc_error_ok)
+		return css_error_from_lwc_error(error);
+
+	/* Pseudo elements */
+	error = lwc_intern_string(
+			"first-line", SLEN("first-line"), 
+			&ctx->first_line);
+	if (error != lwc_error_ok)
+		return css_error_from_lwc_error(error);
+
+	error = lwc_intern_string(
+			"first_letter", SLEN("first-letter"),
+			&ctx->first_letter);
+	if (error != lwc_error_ok)
+		return css_error_from_lwc_error(error);
+
+	error = lwc_intern_string(
+			"before", SLEN("before"), 
+			&ctx->before);
+	if (error != lwc_error_ok)
+		return css_error_from_lwc_error(error);
+
+	error = lwc_intern_string(
+			"after", SLEN("after"), 
+			&ctx->after);
+	if (error != lwc_error_ok)
+		return css_error_from_lwc_error(error);
+
+	return CSS_OK;
+}
+
+void destroy_strings(css_select_ctx *ctx)
+{
+	if (ctx->universal != NULL)
+		lwc_string_unref(ctx->universal);
+	if (ctx->first_child != NULL)
+		lwc_string_unref(ctx->first_child);
+	if (ctx->link != NULL)
+		lwc_string_unref(ctx->link);
+	if (ctx->visited != NULL)
+		lwc_string_unref(ctx->visited);
+	if (ctx->hover != NULL)
+		lwc_string_unref(ctx->hover);
+	if (ctx->active != NULL)
+		lwc_string_unref(ctx->active);
+	if (ctx->focus != NULL)
+		lwc_string_unref(ctx->focus);
+	if (ctx->nth_child != NULL)
+		lwc_string_unref(ctx->nth_child);
+	if (ctx->nth_last_child != NULL)
+		lwc_string_unref(ctx->nth_last_child);
+	if (ctx->nth_of_type != NULL)
+		lwc_string_unref(ctx->nth_of_type);
+	if (ctx->nth_last_of_type != NULL)
+		lwc_string_unref(ctx->nth_last_of_type);
+	if (ctx->last_child != NULL)
+		lwc_string_unref(ctx->last_child);
+	if (ctx->first_of_type != NULL)
+		lwc_string_unref(ctx->first_of_type);
+	if (ctx->last_of_type != NULL)
+		lwc_string_unref(ctx->last_of_type);
+	if (ctx->only_child != NULL)
+		lwc_string_unref(ctx->only_child);
+	if (ctx->only_of_type != NULL)
+		lwc_string_unref(ctx->only_of_type);
+	if (ctx->root != NULL)
+		lwc_string_unref(ctx->root);
+	if (ctx->empty != NULL)
+		lwc_string_unref(ctx->empty);
+	if (ctx->target != NULL)
+		lwc_string_unref(ctx->target);
+	if (ctx->lang != NULL)
+		lwc_string_unref(ctx->lang);
+	if (ctx->enabled != NULL)
+		lwc_string_unref(ctx->enabled);
+	if (ctx->disabled != NULL)
+		lwc_string_unref(ctx->disabled);
+	if (ctx->checked != NULL)
+		lwc_string_unref(ctx->checked);
+	if (ctx->first_line != NULL)
+		lwc_string_unref(ctx->first_line);
+	if (ctx->first_letter != NULL)
+		lwc_string_unref(ctx->first_letter);
+	if (ctx->before != NULL)
+		lwc_string_unref(ctx->before);
+	if (ctx->after != NULL)
+		lwc_string_unref(ctx->after);
+}
+
+/**
+ * Intern the caseless forms of the strings used by a list of rules
+ *
+ * \param rule  First rule in list
+ * \return CSS_OK on success, appropriate error otherwise
+ */
+css_error freeze_rules(const css_rule *rule)
+{
+	css_error error;
+
+	for (; rule != NULL; rule = rule->next) {
+		if (rule->type == CSS_RULE_SELECTOR) {
+			const css_rule_selector *r =
+					(const css_rule_selector *) rule;
+			uint32_t i;
+
+			for (i = 0; i < rule->items; i++) {
+				error = freeze_selector(r->selectors[i]);
+				if (error != CSS_OK)
+					return error;
+			}
+		} else if (rule->type == CSS_RULE_MEDIA) {
+			error = freeze_rules(
+				((const css_rule_media *) rule)->first_child);
+			if (error != CSS_OK)
+				return error;
+		} else if (rule->type == CSS_RULE_IMPORT) {
+			const css_stylesheet *sheet =
+				((const css_rule_import *) rule)->sheet;
+
+			if (sheet != NULL) {
+				error = freeze_rules(sheet->rule_list);
+				if (error != CSS_OK)
+					return error;
+			}
+		}
+	}
+
+	return CSS_OK;
+}
+
+/**
+ * Intern the caseless forms of the strings used by a selector chain
+ *
+ * \param selector  Selector to consider
+ * \return CSS_OK on success, appropriate error otherwise
+ */
+css_error freeze_selector(const css_selector *selector)
+{
+	const css_selector *s;
+	css_error error;
+
+	for (s = selector; s != NULL; s = s->combinator) {
+		const css_selector_detail *detail = &s->data;
+
+		while (detail != NULL) {
+			error = freeze_string(detail->qname.name);
+			if (error != CSS_OK)
+				return error;
+
+			if (detail->value_type ==
+					CSS_SELECTOR_DETAIL_VALUE_STRING &&
+					detail->value.string != NULL) {
+				error = freeze_string(detail->value.string);
+				if (error != CSS_OK)
+					return error;
 			}
+
+			if (detail->next)
+				detail++;
+			else
+				detail = NULL;
+		}
+	}
+
+	return CSS_OK;
+}
+
+/**
+ * Intern the caseless form of a string
+ *
+ * \param str  String to consider
+ * \return CSS_OK on success, appropriate error otherwise
+ */
+css_error freeze_string(lwc_string *str)
+{
+	lwc_error lerror;
+	bool match;
+
+	/* Comparing a string caselessly interns its caseless form */
+	lerror = lwc_string_caseless_isequal(str, str, &match);
+	if (lerror != lwc_error_ok)
+		return css_error_from_lwc_error(lerror);
+
+	return CSS_OK;
+}
+
+/**
+ * Reference a string obtained from the client, unless the context borrows it
+ *
+ * \param ctx  Selection context
+ * \param str  String to reference
+ * \return \a str
+ */
+lwc_string *client_string_ref(const css_select_ctx *ctx, lwc_string *str)
+{
+	return ctx->frozen ? str : lwc_string_ref(str);
+}
+
+/**
+ * Release a string obtained from the client, unless the context borrows it
+ *
+ * \param ctx  Selection context
+ * \param str  String to release, or NULL
+ *
+ * Frozen contexts, and their clones, borrow the strings the client's
+ * handler returns, so that selection does not modify reference counts.
+ */
+void client_string_unref(const css_select_ctx *ctx, lwc_string *str)
+{
+	if (str != NULL && ctx->frozen == false)
+		lwc_string_unref(str);
+}
+
+/**
+ * Release the contents of a style sharing cache entry
+ *
+ * \param ctx    Selection context
+ * \param share  Entry to clear
+ */
+void share_clear(css_select_ctx *ctx, css_select_share_entry *share)
+{
+	uint32_t i;
+
+	if (share->valid == false)
+		return;
+
+	for (i = 0; i < share->n_classes; i++)
+		client_string_unref(ctx, share->classes[i]);
+	share->n_classes = 0;
+
+	for (i = 0; i < share->n_attributes; i++)
+		client_string_unref(ctx, share->attributes[i]);
+	share->n_attributes = 0;
+
+	client_string_unref(ctx, share->element.ns);
+	client_string_unref(ctx, share->element.name);
+
+	share->valid = false;
+}
+
+/**
+ * Discard the contents of a selection context's style sharing cache
+ *
+ * \param ctx  Selection context
+ */
+void share_flush(css_select_ctx *ctx)
+{
+	uint32_t i;
+
+	for (i = 0; i < CSS_SELECT_SHARE_SIZE; i++)
+		share_clear(ctx, &ctx->share[i]);
+
+	ctx->next_share = 0;
+}
+
+/**
+ * Find a style sharing cache entry usable for the current node
+ *
+ * \param ctx     Selection context
+ * \param parent  Parent of node being selected for
+ * \param state   Selection state
+ * \param result  Pointer to location to receive entry, or NULL if none
+ * \return CSS_OK on success, appropriate error otherwise
+ */
+css_error share_find(css_select_ctx *ctx, void *parent,
+		css_select_state *state, css_select_share_entry **result)
+{
+	css_pseudo_element pseudo;
+	uint32_t i, j;
+	css_error error;
+
+	*result = NULL;
+
+	for (i = 0; i < CSS_SELECT_SHARE_SIZE; i++) {
+		css_select_share_entry *share = &ctx->share[i];
+
+		if (share->valid == false || share->parent != parent ||
+				share->media != state->media ||
+				share->pseudo_mask != state->pseudo_mask ||
+				share->element.name != state->element.name ||
+				share->element.ns != state->element.ns ||
+				share->n_classes != state->n_classes ||
+				share->n_attributes != state->n_attributes ||
+				share->keyed_state != state->keyed_state)
+			continue;
+
+		/* Interned, so pointer comparison suffices */
+		if (state->n_classes > 0 && memcmp(share->classes, 
+				state->classes, state->n_classes * 
+				sizeof(lwc_string *)) != 0)
+			continue;
+
+		/* Selectors were found by the node's attribute names, so
+		 * they must be the same */
+		if (state->n_attributes > 0 && memcmp(share->attributes,
+				state->attributes, state->n_attributes *
+				sizeof(lwc_string *)) != 0)
+			continue;
+
+		/* Revalidate the tests made against the styled node */
+		for (j = 0; j < share->n_tests; j++) {
+			bool match = false;
+
+			error = match_detail(ctx, state->node, 
+					share->tests[j].detail, state, 
+					&match, &pseudo);
+			if (error != CSS_OK)
+				return error;
+
+			if (match != share->tests[j].match)
+				break;
+		}
+
+		if (j == share->n_tests) {
+			*result = share;
+			break;
+		}
+	}
+
+	return CSS_OK;
+}
+
+/**
+ * Claim a style sharing cache entry to record the current node's rules in
+ *
+ * \param ctx     Selection context
+ * \param parent  Parent of node being selected for
+ * \return Pointer to (invalid) entry
+ *
+ * The least recently committed entry is replaced.
+ */
+css_select_share_entry *share_begin(css_select_ctx *ctx, void *parent)
+{
+	css_select_share_entry *share = &ctx->share[ctx->next_share];
+
+	share_clear(ctx, share);
+
+	share->parent = parent;
+	share->n_matches = 0;
+	share->n_tests = 0;
+
+	return share;
+}
+
+/**
+ * Make the rules recorded for the current node available for sharing
+ *
+ * \param ctx    Selection context
+ * \param share  Entry rules were recorded in
+ * \param state  Selection state
+ * \return CSS_OK on success, appropriate error otherwise
+ */
+css_error share_commit(css_select_ctx *ctx, css_select_share_entry *share,
+		css_select_state *state)
+{
+	uint32_t i;
+
+	/* Copy the node's class list, which the client may own */
+	if (state->n_classes > share->classes_size) {
+		lwc_string **temp;
+
+		temp = ctx->alloc(share->classes,
+				state->n_classes * sizeof(lwc_string *),
+				ctx->pw);
+		if (temp == NULL)
+			return CSS_NOMEM;
+
+		share->classes = temp;
+		share->classes_size = state->n_classes;
+	}
+
+	/* And its attribute names, if selectors were found by them */
+	if (state->n_attributes > share->attributes_size) {
+		lwc_string **temp;
+
+		temp = ctx->alloc(share->attributes,
+				state->n_attributes * sizeof(lwc_string *),
+				ctx->pw);
+		if (temp == NULL)
+			return CSS_NOMEM;
+
+		share->attributes = temp;
+		share->attributes_size = state->n_attributes;
+	}
+
+	for (i = 0; i < state->n_classes; i++)
+		share->classes[i] = client_string_ref(ctx, state->classes[i]);
+	share->n_classes = state->n_classes;
+
+	for (i = 0; i < state->n_attributes; i++) {
+		share->attributes[i] = client_string_ref(ctx,
+				state->attributes[i]);
+	}
+	share->n_attributes = state->n_attributes;
+
+	share->keyed_state = state->keyed_state;
+
+	share->media = state->media;
+	share->pseudo_mask = state->pseudo_mask;
+
+	share->element.ns = state->element.ns != NULL ?
+			client_string_ref(ctx, state->element.ns) : NULL;
+	share->element.name = client_string_ref(ctx, state->element.name);
+
+	/* Any inline style is cascaded using the state left by matching */
+	share->origin = state->current_origin;
+	share->specificity = state->current_specificity;
+
+	share->valid = true;
+
+	ctx->next_share = (ctx->next_share + 1) % CSS_SELECT_SHARE_SIZE;
+
+	return CSS_OK;
+}
+
+/**
+ * Record a rule matched by the current node
+ *
+ * \param ctx       Selection context
+ * \param selector  Selector which matched
+ * \param pseudo    Pseudo element the rule applies to
+ * \param state     Selection state
+ * \return CSS_OK on success, appropriate error otherwise
+ */
+css_error share_record(css_select_ctx *ctx, const css_selector *selector,
+		css_pseudo_element pseudo, css_select_state *state)
+{
+	css_select_share_entry *share = state->share;
+	css_select_share_match *match;
+
+	if (share->n_matches == share->matches_size) {
+		uint32_t size = share->matches_size == 0 ? 
+				16 : share->matches_size * 2;
+		css_select_share_match *temp;
+
+		temp = ctx->alloc(share->matches, 
+				size * sizeof(css_select_share_match), ctx->pw);
+		if (temp == NULL)
+			return CSS_NOMEM;
+
+		share->matches = temp;
+		share->matches_size = size;
+	}
+
+	match = &share->matches[share->n_matches++];
+	match->style = ((css_rule_selector *) selector->rule)->style;
+	match->specificity = selector->specificity;
+	match->origin = state->current_origin;
+	match->pseudo = pseudo;
+
+	return CSS_OK;
+}
+
+/**
+ * Record the outcome of testing a selector detail against the current node
+ *
+ * \param ctx     Selection context
+ * \param detail  Detail tested
+ * \param match   Whether the node matched the detail
+ * \param state   Selection state
+ * \return CSS_OK on success, appropriate error otherwise
+ */
+css_error share_record_test(css_select_ctx *ctx, 
+		const css_selector_detail *detail, bool match,
+		css_select_state *state)
+{
+	css_select_share_entry *share = state->share;
+
+	if (share->n_tests == share->tests_size) {
+		uint32_t size = share->tests_size == 0 ? 
+				8 : share->tests_size * 2;
+		css_select_share_test *temp;
+
+		temp = ctx->alloc(share->tests, 
+				size * sizeof(css_select_share_test), ctx->pw);
+		if (temp == NULL)
+			return CSS_NOMEM;
+
+		share->tests = temp;
+		share->tests_size = size;
+	}
+
+	share->tests[share->n_tests].detail = detail;
+	share->tests[share->n_tests].match = match;
+	share->n_tests++;
+
+	return CSS_OK;
+}
+
+/**
+ * Discard every entry of a selection context's ancestor match memo
+ *
+ * \param ctx  Selection context
+ */
+void memo_flush(css_select_ctx *ctx)
+{
+	if (ctx->memo_used == false)
+		return;
+
+	memset(ctx->memo, 0, ctx->memo_size * sizeof(css_select_memo_entry));
+
+	ctx->memo_used = false;
+}
+
+/**
+ * Find the memo entry for a compound and node
+ *
+ * \param ctx       Selection context, whose memo must be enabled
+ * \param compound  Compound to consider
+ * \param node      Node to consider
+ * \return Entry, which may be for another compound and node
+ */
+static inline css_select_memo_entry *memo_entry(css_select_ctx *ctx,
+		const void *compound, void *node)
+{
+	uintptr_t index = ((uintptr_t) compound >> 3) * 0x9e3779b1u;
+
+	index ^= (uintptr_t) node >> 4;
+
+	return &ctx->memo[index & (ctx->memo_size - 1)];
+}
+
+/**
+ * Retrieve the memoised outcome of matching a compound against a node
+ *
+ * \param ctx       Selection context
+ * \param compound  Compound to consider
+ * \param node      Node to consider
+ * \return Outcome, or CSS_SELECT_MEMO_UNKNOWN if not memoised, or if the
+ *         memo is disabled or not in use
+ */
+css_select_memo_result memo_find(css_select_ctx *ctx, const void *compound,
+		void *node)
+{
+	const css_select_memo_entry *entry;
+
+	if (ctx->memo == NULL || ctx->in_pass == false)
+		return CSS_SELECT_MEMO_UNKNOWN;
+
+	entry = memo_entry(ctx, compound, node);
+	if (entry->compound != compound || entry->node != node)
+		return CSS_SELECT_MEMO_UNKNOWN;
+
+	return entry->result;
+}
+
+/**
+ * Memoise the outcome of matching a compound against a node
+ *
+ * \param ctx       Selection context
+ * \param compound  Compound matched
+ * \param node      Node matched against
+ * \param result    Outcome
+ *
+ * Outside a pass, or if the memo is disabled, nothing is memoised. Any
+ * entry for another compound and node is replaced.
+ */
+void memo_store(css_select_ctx *ctx, const void *compound, void *node,
+		css_select_memo_result result)
+{
+	css_select_memo_entry *entry;
+
+	if (ctx->memo == NULL || ctx->in_pass == false)
+		return;
+
+	entry = memo_entry(ctx, compound, node);
+	entry->compound = compound;
+	entry->node = node;
+	entry->result = result;
+
+	ctx->memo_used = true;
+}
+
+/**
+ * Note that a compound is being matched against a node
+ *
+ * \param path      Path of compounds matched so far
+ * \param compound  Compound being matched
+ * \param node      Node it is being matched against
+ *
+ * Compounds beyond the depth of the path are not memoised.
+ */
+void memo_push(css_select_memo_path *path, const void *compound, void *node)
+{
+	if (path->n == CSS_SELECT_MEMO_DEPTH)
+		return;
+
+	path->compound[path->n] = compound;
+	path->node[path->n] = node;
+	path->n++;
+}
+
+/**
+ * Memoise that a compound doesn't match a node
+ *
+ * \param ctx       Selection context
+ * \param path      Path of compounds matched so far
+ * \param compound  Compound matched
+ * \param node      Node matched against
+ *
+ * The compound is removed from the path, if it is there.
+ */
+void memo_mismatch(css_select_ctx *ctx, css_select_memo_path *path,
+		const void *compound, void *node)
+{
+	if (path->n > 0 && path->compound[path->n - 1] == compound &&
+			path->node[path->n - 1] == node)
+		path->n--;
+
+	memo_store(ctx, compound, node, CSS_SELECT_MEMO_MISMATCH);
+}
+
+/**
+ * Memoise the outcome of a chain for every compound on its path
+ *
+ * \param ctx     Selection context
+ * \param path    Path of compounds matched
+ * \param result  Outcome of chain, CSS_SELECT_MEMO_REJECT or _MATCH
+ */
+void memo_resolve(css_select_ctx *ctx, const css_select_memo_path *path,
+		css_select_memo_result result)
+{
+	uint32_t i;
+
+	if (ctx->memo == NULL || ctx->in_pass == false)
+		return;
+
+	for (i = 0; i < path->n; i++)
+		memo_store(ctx, path->compound[i], path->node[i], result);
+}
+
+/**
+ * Forget the positions and numbers of siblings cached for a pass
+ *
+ * \param ctx  Selection context
+ */
+void sibling_flush(css_select_ctx *ctx)
+{
+	uint32_t i;
+
+	for (i = 0; i < CSS_SELECT_SIBLING_TOTALS; i++)
+		client_string_unref(ctx, ctx->totals[i].name);
+
+	memset(ctx->indices, 0, sizeof(ctx->indices));
+	memset(ctx->totals, 0, sizeof(ctx->totals));
+}
+
+/**
+ * Find the number of siblings preceding a node, consulting the pass' cache
+ *
+ * \param ctx    Selection context
+ * \param state  Selection state
+ * \param node   Node to consider
+ * \param name   Name of node, or NULL to count siblings of any name
+ * \param index  Pointer to location to receive number of siblings
+ * \return CSS_OK on success, appropriate error otherwise
+ *
+ * If the preceding sibling's position is cached, the node's follows from it
+ * without counting, so styling the children of a node in document order
+ * counts the siblings of only the first.
+ */
+css_error sibling_index(css_select_ctx *ctx, css_select_state *state,
+		void *node, const css_qname *name, int32_t *index)
+{
+	const uint32_t which = (name != NULL) ? 1 : 0;
+	css_select_sibling_index *entry, *prev_entry;
+	void *prev = NULL;
+	css_error error;
+
+	entry = &ctx->indices[((uintptr_t) node >> 4) %
+			CSS_SELECT_SIBLING_INDICES];
+
+	if (entry->node == node && entry->index[which] >= 0) {
+		*index = entry->index[which];
+		return CSS_OK;
+	}
+
+	if (name != NULL) {
+		error = state->handler->named_generic_sibling_node(state->pw,
+				node, name, &prev);
+	} else {
+		error = state->handler->sibling_node(state->pw, node, &prev);
+	}
+	if (error != CSS_OK)
+		return error;
+
+	prev_entry = &ctx->indices[((uintptr_t) prev >> 4) %
+			CSS_SELECT_SIBLING_INDICES];
+
+	if (prev == NULL) {
+		*index = 0;
+	} else if (prev_entry->node == prev &&
+			prev_entry->index[which] >= 0) {
+		*index = prev_entry->index[which] + 1;
+	} else {
+		error = state->handler->node_count_siblings(state->pw, node,
+				name != NULL, false, index);
+		if (error != CSS_OK)
+			return error;
+	}
+
+	if (entry->node != node) {
+		entry->node = node;
+		entry->index[0] = -1;
+		entry->index[1] = -1;
+	}
+
+	entry->index[which] = *index;
+
+	return CSS_OK;
+}
+
+/**
+ * Count the siblings of a node, consulting the pass' cache
+ *
+ * \param ctx        Selection context
+ * \param state      Selection state
+ * \param node       Node to consider
+ * \param same_name  Only count siblings with the same name as the node
+ * \param after      Count siblings after the node, rather than before
+ * \param count      Pointer to location to receive number of siblings
+ * \return CSS_OK on success, appropriate error otherwise
+ *
+ * Outside a pass, the client is always asked to count. Within one, siblings
+ * after a node are found by subtracting its position from the number of its
+ * parent's children, which is counted once.
+ */
+css_error count_siblings(css_select_ctx *ctx, css_select_state *state,
+		void *node, bool same_name, bool after, int32_t *count)
+{
+	css_select_sibling_total *total;
+	css_qname qname = { NULL, NULL };
+	const css_qname *name = NULL;
+	lwc_string *key = NULL;
+	void *parent = NULL;
+	int32_t index;
+	css_error error;
+
+	if (ctx->in_pass == false) {
+		return state->handler->node_count_siblings(state->pw, node,
+				same_name, after, count);
+	}
+
+	if (same_name && node == state->node) {
+		name = &state->element;
+	} else if (same_name) {
+		error = state->handler->node_name(state->pw, node, &qname);
+		if (error != CSS_OK)
+			return error;
+
+		name = &qname;
+	}
+
+	if (name != NULL)
+		key = name->name;
+
+	error = sibling_index(ctx, state, node, name, &index);
+	if (error != CSS_OK || after == false) {
+		*count = index;
+		goto cleanup;
+	}
+
+	error = state->handler->parent_node(state->pw, node, &parent);
+	if (error != CSS_OK)
+		goto cleanup;
+
+	if (parent == NULL) {
+		error = state->handler->node_count_siblings(state->pw, node,
+				same_name, true, count);
+		goto cleanup;
+	}
+
+	total = &ctx->totals[(((uintptr_t) parent ^ (uintptr_t) key) >> 4) %
+			CSS_SELECT_SIBLING_TOTALS];
+
+	if (total->parent == parent && total->name == key) {
+		*count = total->total - index - 1;
+		goto cleanup;
+	}
+
+	error = state->handler->node_count_siblings(state->pw, node,
+			same_name, true, count);
+	if (error != CSS_OK)
+		goto cleanup;
+
+	client_string_unref(ctx, total->name);
+
+	total->parent = parent;
+	total->name = (key != NULL) ? client_string_ref(ctx, key) : NULL;
+	total->total = index + *count + 1;
+
+cleanup:
+	client_string_unref(ctx, qname.ns);
+	client_string_unref(ctx, qname.name);
+
+	return error;
+}
+
+/**
+ * Cascade the rules recorded in a style sharing cache entry
+ *
+ * \param ctx    Selection context
+ * \param share  Entry to replay
+ * \param state  Selection state
+ * \return CSS_OK on success, appropriate error otherwise
+ */
+css_error share_replay(css_select_ctx *ctx, 
+		const css_select_share_entry *share, css_select_state *state)
+{
+	uint32_t i;
+	css_error error;
+
+	for (i = 0; i < share->n_matches; i++) {
+		const css_select_share_match *match = &share->matches[i];
+
+		/* Ensure that the appropriate computed style exists */
+		error = ensure_style(ctx, state, match->pseudo);
+		if (error != CSS_OK)
+			return error;
+
+		state->current_origin = match->origin;
+		state->current_specificity = match->specificity;
+		state->current_pseudo = match->pseudo;
+		state->computed = state->results->styles[match->pseudo];
+
+		error = cascade_style(match->style, state);
+		if (error != CSS_OK)
+			return error;
+	}
+
+	state->current_origin = share->origin;
+	state->current_specificity = share->specificity;
+
+	return CSS_OK;
+}
+
+/**
+ * Hash a node's name, ID and classes for the ancestor filter
+ *
+ * \param ctx        Selection context
+ * \param element    Node's name
+ * \param id         Node's ID, or NULL
+ * \param classes    Node's classes
+ * \param n_classes  Number of classes
+ * \param n_hashes   Pointer to location to receive number of hashes
+ * \return CSS_OK on success, appropriate error otherwise
+ *
+ * The hashes are stored after those of the pushed ancestors, but are not
+ * added to the filter until bloom_commit() is called.
+ */
+css_error bloom_prepare(css_select_ctx *ctx, const css_qname *element,
+		lwc_string *id, lwc_string **classes, uint32_t n_classes,
+		uint32_t *n_hashes)
+{
+	uint32_t *hashes;
+	uint32_t i, n = 0;
+
+	/* Ensure there's space for the node and its hashes */
+	if (ctx->n_bloom_nodes == ctx->bloom_nodes_size) {
+		uint32_t size = ctx->bloom_nodes_size == 0 ? 
+				32 : ctx->bloom_nodes_size * 2;
+		css_select_bloom_node *temp;
+
+		temp = ctx->alloc(ctx->bloom_nodes, 
+				size * sizeof(css_select_bloom_node), ctx->pw);
+		if (temp == NULL)
+			return CSS_NOMEM;
+
+		ctx->bloom_nodes = temp;
+		ctx->bloom_nodes_size = size;
+	}
+
+	if (ctx->n_bloom_hashes + 2 + n_classes > ctx->bloom_hashes_size) {
+		uint32_t size = ctx->bloom_hashes_size == 0 ?
+				64 : ctx->bloom_hashes_size * 2;
+		uint32_t *temp;
+
+		while (size < ctx->n_bloom_hashes + 2 + n_classes)
+			size *= 2;
+
+		temp = ctx->alloc(ctx->bloom_hashes, 
+				size * sizeof(uint32_t), ctx->pw);
+		if (temp == NULL)
+			return CSS_NOMEM;
+
+		ctx->bloom_hashes = temp;
+		ctx->bloom_hashes_size = size;
+	}
+
+	hashes = &ctx->bloom_hashes[ctx->n_bloom_hashes];
+
+	hashes[n++] = css_bloom_hash(element->name);
+	if (id != NULL)
+		hashes[n++] = css_bloom_hash(id);
+	for (i = 0; i < n_classes; i++)
+		hashes[n++] = css_bloom_hash(classes[i]);
+
+	*n_hashes = n;
+
+	return CSS_OK;
+}
+
+/**
+ * Push a node, whose hashes have been prepared, into the ancestor filter
+ *
+ * \param ctx       Selection context
+ * \param node      Node to push
+ * \param n_hashes  Number of hashes prepared by bloom_prepare()
+ */
+void bloom_commit(css_select_ctx *ctx, void *node, uint32_t n_hashes)
+{
+	uint32_t i;
+
+	for (i = 0; i < n_hashes; i++) {
+		css_bloom_add(&ctx->bloom, 
+				ctx->bloom_hashes[ctx->n_bloom_hashes + i]);
+	}
+
+	ctx->n_bloom_hashes += n_hashes;
+
+	ctx->bloom_nodes[ctx->n_bloom_nodes].node = node;
+	ctx->bloom_nodes[ctx->n_bloom_nodes].n_hashes = n_hashes;
+	ctx->n_bloom_nodes++;
+}
+
+/**
+ * Select a style for the given node
+ *
+ * \param ctx             Selection context to use
+ * \param node            Node to select style for
+ * \param parent          Parent of node, or NULL if node is the root
+ * \param media           Currently active media types
+ * \param pseudo_mask     Mask of pseudo elements to select styles for
+ * \param inline_style    Corresponding inline style for node, or NULL
+ * \param handler         Dispatch table of handler functions
+ * \param pw              Client-specific private data for handler functions
+ * \param push            Whether to push node into the ancestor filter
+ * \param reuse           Result set to reuse, or NULL to create one
+ * \param result          Pointer to location to receive result set
+ * \return CSS_OK on success, appropriate error otherwise.
+ */
+css_error select_style(css_select_ctx *ctx, void *node, void *parent,
+		uint64_t media, uint32_t pseudo_mask,
+		const css_stylesheet *inline_style,
+		css_select_handler *handler, void *pw, bool push,
+		css_select_results *reuse, css_select_results **result)
+{
+	uint32_t i;
+	uint32_t n_hashes = 0;
+	css_error error;
+	css_select_state state;
+	css_select_share_entry *share = NULL;
+
+	/* Index the sheets' selectors, if they have changed */
+	if (ctx->index == NULL) {
+		error = index_build(ctx);
+		if (error != CSS_OK)
+			return error;
+	}
+
+	/* Set up the selection state. Property state is valid only once
+	 * touched, so is left uninitialised. */
+	memset(&state, 0, offsetof(css_select_state, props));
+	state.node = node;
+	state.media = media;
+	state.pseudo_mask = pseudo_mask | CSS_PSEUDO_ELEMENT_MASK(
+			CSS_PSEUDO_ELEMENT_NONE);
+	state.handler = handler;
+	state.pw = pw;
+
+	if (reuse != NULL) {
+		/* Pseudo element styles are set aside, to be reused if the
+		 * pseudo elements are styled again */
+		state.results = reuse;
+
+		for (i = CSS_PSEUDO_ELEMENT_NONE + 1;
+				i < CSS_PSEUDO_ELEMENT_COUNT; i++) {
+			state.spare[i] = reuse->styles[i];
+			reuse->styles[i] = NULL;
+		}
+
+		state.spare[CSS_PSEUDO_ELEMENT_NONE] =
+				reuse->styles[CSS_PSEUDO_ELEMENT_NONE];
+		reuse->styles[CSS_PSEUDO_ELEMENT_NONE] = NULL;
+	} else {
+		/* Allocate the result set */
+		state.results = ctx->alloc(NULL,
+				sizeof(css_select_results), ctx->pw);
+		if (state.results == NULL)
+			return CSS_NOMEM;
+
+		state.results->alloc = ctx->alloc;
+		state.results->pw = ctx->pw;
+
+		for (i = 0; i < CSS_PSEUDO_ELEMENT_COUNT; i++)
+			state.results->styles[i] = NULL;
+	}
+
+	/* Base element style is guaranteed to exist */
+	error = ensure_style(ctx, &state, CSS_PSEUDO_ELEMENT_NONE);
+	if (error != CSS_OK)
+		goto cleanup;
+
+	/* The ancestor filter is only usable if the client has pushed the
+	 * node's ancestors into it */
+	if (ctx->n_bloom_nodes > 0 ? 
+			ctx->bloom_nodes[ctx->n_bloom_nodes - 1].node == parent :
+			parent == NULL)
+		state.bloom = &ctx->bloom;
+
+	/* Get node's name */
+	error = handler->node_name(pw, node, &state.element);
+	if (error != CSS_OK)
+		goto cleanup;
+
+	/* Get node's ID, if any */
+	error = handler->node_id(pw, node, &state.id);
+	if (error != CSS_OK)
+		goto cleanup;
+
+	/* Get node's classes, if any */
+	error = handler->node_classes(pw, node,	
+			&state.classes, &state.n_classes);
+	if (error != CSS_OK)
+		goto cleanup;
+
+	/* Get the names of the node's attributes, if selectors are found by
+	 * them and the client can supply them */
+	if (handler->handler_version != CSS_SELECT_HANDLER_VERSION_1 &&
+			handler->node_attribute_names != NULL &&
+			css__selector_hash_has_attributes(ctx->index)) {
+		error = handler->node_attribute_names(pw, node,
+				&state.attributes, &state.n_attributes);
+		if (error != CSS_OK)
+			goto cleanup;
+
+		state.attributes_known = true;
+	}
+
+	/* Find the node states selectors are to be found by. Those keyed by
+	 * states the node lacks cannot match, but the states of a node are
+	 * only to hand with a version 2 handler. */
+	state.keyed_state = css__selector_hash_states(ctx->index);
+	if (state.keyed_state != 0 &&
+			handler->handler_version != CSS_SELECT_HANDLER_VERSION_1) {
+		uint32_t flags;
+
+		error = fetch_node_state(&state, node, &flags);
+		if (error != CSS_OK)
+			goto cleanup;
+
+		state.keyed_state &= flags;
+	}
+
+	/* If the node is to be pushed into the ancestor filter, hash its
+	 * name, ID and classes now, while we still own them */
+	if (push) {
+		error = bloom_prepare(ctx, &state.element, state.id, 
+				state.classes, state.n_classes, &n_hashes);
+		if (error != CSS_OK)
+			goto cleanup;
+	}
+
+	/* Within a pass, nodes without an ID may be able to share the rules
+	 * matched by a recently styled sibling */
+	if (ctx->in_pass && state.id == NULL) {
+		error = share_find(ctx, parent, &state, &share);
+		if (error != CSS_OK)
+			goto cleanup;
+
+		if (share == NULL)
+			state.share = share_begin(ctx, parent);
+	}
+
+	if (share != NULL) {
+		/* Found one: simply cascade the rules it matched */
+		error = share_replay(ctx, share, &state);
+		if (error != CSS_OK)
+			goto cleanup;
+	} else {
+		/* Select styles from the sheets which apply to our current
+		 * media requirements and are not disabled */
+		error = match_selectors(ctx, &state);
+		if (error != CSS_OK)
+			goto cleanup;
+
+		/* Make the rules we matched available for sharing, unless
+		 * matching depended upon the node's siblings */
+		if (state.share != NULL) {
+			error = share_commit(ctx, state.share, &state);
+			if (error != CSS_OK)
+				goto cleanup;
+		}
+	}
+
+	/* Consider any inline style for the node */
+	if (inline_style != NULL) {
+		css_rule_selector *sel = 
+				(css_rule_selector *) inline_style->rule_list;
+
+		/* Sanity check style */
+		if (inline_style->rule_count != 1 ||
+			inline_style->rule_list->type != CSS_RULE_SELECTOR || 
+				inline_style->rule_list->items != 0) {
+			error = CSS_INVALID;
+			goto cleanup;
+		}
+
+		/* No bytecode if input was empty or wholly invalid */
+		if (sel->style != NULL) {
+			/* Inline style applies to base element only */
+			state.current_pseudo = CSS_PSEUDO_ELEMENT_NONE;
+			state.computed = state.results->styles[
+					CSS_PSEUDO_ELEMENT_NONE];
+
+			error = cascade_style(sel->style, &state);
+			if (error != CSS_OK)
+				goto cleanup;
+		}
+	}
+
+	/* Take account of presentational hints and fix up any remaining
+	 * unset properties. */
+
+	/* Base element */
+	state.current_pseudo = CSS_PSEUDO_ELEMENT_NONE;
+	state.computed = state.results->styles[CSS_PSEUDO_ELEMENT_NONE];
+	for (i = 0; i < CSS_N_PROPERTIES; i++) {
+		const prop_state *prop = 
+				&state.props[CSS_PSEUDO_ELEMENT_NONE][i];
+
+		/* Apply presentational hints if the property is unset or 
+		 * the existing property value did not come from an author 
+		 * stylesheet or a user sheet using !important. */
+		if (prop_touched(&state, CSS_PSEUDO_ELEMENT_NONE, i) == false ||
+				(prop->origin != CSS_ORIGIN_AUTHOR &&
+				prop->important == false)) {
+			error = set_hint(&state, i);
+			if (error != CSS_OK)
+				goto cleanup;
+		}
+
+		/* If we're the root element and the property is still
+		 * unset or it's set to inherit, then set it to its initial
+		 * value. Otherwise, unset properties already have their
+		 * initial values, as styles start as copies of the
+		 * context's template. */
+		if (parent == NULL &&
+				(prop_touched(&state,
+					CSS_PSEUDO_ELEMENT_NONE, i) == false ||
+				prop->inherit == true)) {
+			error = set_initial(&state, i, 
+					CSS_PSEUDO_ELEMENT_NONE, parent);
+			if (error != CSS_OK)
+				goto cleanup;
 		}
 	}
 
@@ -547,431 +2952,265 @@ css_error css_select_style(css_select_ctx *ctx, void *node,
 			goto cleanup;
 	}
 
+	/* The node's descendants may now be selected with the filter */
+	if (push)
+		bloom_commit(ctx, node, n_hashes);
+
 	*result = state.results;
 	error = CSS_OK;
 
 cleanup:
-	/* Only clean up the results if there's an error. 
-	 * If there is no error, we're going to pass ownership of 
+	/* Only clean up the results if there's an error, and they are
+	 * ours. If there is no error, we're going to pass ownership of
 	 * the results to the client */
-	if (error != CSS_OK && state.results != NULL) {
+	if (error != CSS_OK && reuse == NULL) {
 		css_select_results_destroy(state.results);
 	}
 
-	if (state.classes != NULL) {
-		for (i = 0; i < state.n_classes; i++)
-			lwc_string_unref(state.classes[i]);
-
-		ctx->alloc(state.classes, 0, ctx->pw);
+	/* Discard any styles which were not reused */
+	for (i = 0; i < CSS_PSEUDO_ELEMENT_COUNT; i++) {
+		if (state.spare[i] != NULL)
+			css_computed_style_destroy(state.spare[i]);
 	}
 
-	if (state.id != NULL)
-		lwc_string_unref(state.id);
+	release_classes(ctx, handler, state.classes, state.n_classes);
 
-	if (state.element.ns != NULL)
-		lwc_string_unref(state.element.ns);
-	lwc_string_unref(state.element.name);
+	client_string_unref(ctx, state.id);
+
+	client_string_unref(ctx, state.element.ns);
+	client_string_unref(ctx, state.element.name);
 
 	return error;
 }
 
 /**
- * Destroy a selection result set
+ * Build a selection context's template style
  *
- * \param results  Result set to destroy
+ * \param ctx  Selection context
  * \return CSS_OK on success, appropriate error otherwise
+ *
+ * The template holds the initial value of every uninherited property, and
+ * leaves inherited properties set to inherit, as an unset property of any
+ * element other than the root must be. Styles start as copies of it, so
+ * that only the properties which are set need be computed. Properties in
+ * the extension blocks are not considered, as the blocks are created
+ * holding their initial values.
  */
-css_error css_select_results_destroy(css_select_results *results)
+css_error initial_build(css_select_ctx *ctx)
 {
+	css_select_state state;
 	uint32_t i;
+	css_error error;
 
-	if (results == NULL)
-		return CSS_BADPARM;
+	ctx->initial.alloc = ctx->alloc;
+	ctx->initial.pw = ctx->pw;
 
-	if (results->styles != NULL) {
-		for (i = 0; i < CSS_PSEUDO_ELEMENT_COUNT; i++) {
-			if (results->styles[i] != NULL)
-				css_computed_style_destroy(results->styles[i]);
+	/* No initial value of an uninherited property depends upon the
+	 * client, so no handler is needed */
+	memset(&state, 0, offsetof(css_select_state, props));
+	state.media = CSS_MEDIA_ALL;
+	state.computed = &ctx->initial;
+
+	for (i = 0; i < CSS_N_PROPERTIES; i++) {
+		if (prop_dispatch[i].inherited == false &&
+				prop_dispatch[i].group == GROUP_NORMAL) {
+			error = prop_dispatch[i].initial(&state);
+			if (error != CSS_OK)
+				return error;
 		}
 	}
 
-	results->alloc(results, 0, results->pw);
-
 	return CSS_OK;
 }
 
 /**
- * Search a selection context for defined font faces
+ * Ensure that the computed style for a pseudo element exists
  *
- * \param ctx          Selection context
- * \param media        Currently active media types
- * \param font_family  Font family to search for
- * \param result       Pointer to location to receive result
- * \return CSS_OK on success, appropriate error otherwise.
+ * \param ctx     Selection context
+ * \param state   Selection state
+ * \param pseudo  Pseudo element whose style is required
+ * \return CSS_OK on success, appropriate error otherwise
+ *
+ * A style set aside from a reused result set is preferred to a new one,
+ * unless it is shared. Either way, the style starts as a copy of the
+ * context's template.
  */
-css_error css_select_font_faces(css_select_ctx *ctx,
-		uint64_t media, lwc_string *font_family,
-		css_select_font_faces_results **result)
+css_error ensure_style(css_select_ctx *ctx, css_select_state *state,
+		css_pseudo_element pseudo)
 {
-	uint32_t i;
+	css_computed_style *style = state->spare[pseudo];
 	css_error error;
-	css_select_font_faces_state state;
-	uint32_t n_font_faces;
-	
-	if (ctx == NULL || font_family == NULL || result == NULL)
-		return CSS_BADPARM;
 
-	memset(&state, 0, sizeof(css_select_font_faces_state));
-	state.font_family = font_family;
-	state.media = media;
-	
-	/* Iterate through the top-level stylesheets, selecting font-faces
-	 * from those which apply to our current media requirements and
-	 * are not disabled */
-	for (i = 0; i < ctx->n_sheets; i++) {
-		const css_select_sheet s = ctx->sheets[i];
-		
-		if ((s.media & media) != 0 &&
-				s.sheet->disabled == false) {
-			error = select_font_faces_from_sheet(ctx, s.sheet,
-					s.origin, &state);
-			if (error != CSS_OK)
-				goto cleanup;
-		}
-	}
-	
-	n_font_faces = state.ua_font_faces.count + 
-			state.user_font_faces.count +
-			state.author_font_faces.count;
-				
-	
-	if (n_font_faces > 0) {
-		/* We found some matching faces.  Make a results structure with
-		 * the font faces in priority order. */
-		css_select_font_faces_results *results;
-		
-		results = ctx->alloc(NULL, 
-				sizeof(css_select_font_faces_results),
-				ctx->pw);
-		if (results == NULL) {
-			error = CSS_NOMEM;
-			goto cleanup;
-		}
-		
-		results->alloc = ctx->alloc;
-		results->pw = ctx->pw;
-		
-		results->font_faces = ctx->alloc(NULL, 
-				n_font_faces * sizeof(css_font_face *),
-				ctx->pw);
-		if (results->font_faces == NULL) {
-			ctx->alloc(results, 0, ctx->pw);
-			error = CSS_NOMEM;
-			goto cleanup;
-		}
+	if (state->results->styles[pseudo] != NULL)
+		return CSS_OK;
 
-		results->n_font_faces = n_font_faces;
-		
-		i = 0;
-		if (state.ua_font_faces.count != 0) {
-			memcpy(results->font_faces, 
-					state.ua_font_faces.font_faces,
-					sizeof(css_font_face *) * 
-						state.ua_font_faces.count);
-			
-			i += state.ua_font_faces.count;
-		}
-				
-		if (state.user_font_faces.count != 0) {
-			memcpy(results->font_faces + i, 
-					state.user_font_faces.font_faces,
-					sizeof(css_font_face *) * 
-						state.user_font_faces.count);
-			i += state.user_font_faces.count;
-		}
-		
-		if (state.author_font_faces.count != 0) {
-			memcpy(results->font_faces + i, 
-					state.author_font_faces.font_faces,
-					sizeof(css_font_face *) * 
-						state.author_font_faces.count);
-		}
+	/* Shared styles may not be modified, so are not reused */
+	if (style != NULL && css__computed_style_shared(style)) {
+		css_computed_style_destroy(style);
+		style = NULL;
+	}
 
-		*result = results;
+	if (style == NULL) {
+		error = css_computed_style_create(ctx->alloc, ctx->pw,
+				&style);
+		if (error != CSS_OK)
+			return error;
 	}
-	
-	error = CSS_OK;
-	
-cleanup:
-	if (state.ua_font_faces.count != 0) 
-		ctx->alloc(state.ua_font_faces.font_faces, 0, ctx->pw);
 
-	if (state.user_font_faces.count != 0) 
-		ctx->alloc(state.user_font_faces.font_faces, 0, ctx->pw);
-	
-	if (state.author_font_faces.count != 0) 
-		ctx->alloc(state.author_font_faces.font_faces, 0, ctx->pw);
-	
-	return error;
+	state->spare[pseudo] = NULL;
+	state->results->styles[pseudo] = style;
+
+	error = css__computed_style_reset(style, &ctx->initial);
+	if (error != CSS_OK)
+		return error;
+
+	/* Styles selected with a frozen context borrow the strings of its
+	 * sheets, so that selecting does not modify their reference counts */
+	style->borrowed = ctx->frozen;
+
+	return CSS_OK;
 }
 
 /**
- * Destroy a font-face result set
+ * Release a node's class list, as obtained from the client
  *
- * \param results  Result set to destroy
- * \return CSS_OK on success, appropriate error otherwise
+ * \param ctx        Selection context
+ * \param handler    Dispatch table of handler functions
+ * \param classes    Node's classes, or NULL
+ * \param n_classes  Number of classes
  */
-css_error css_select_font_faces_results_destroy(
-		css_select_font_faces_results *results)
-{
-	if (results == NULL)
-		return CSS_BADPARM;
-	
-	if (results->font_faces != NULL) {
-		/* Don't destroy the individual css_font_faces, they're owned
-		   by their respective sheets */
-		results->alloc(results->font_faces, 0, results->pw);
-	}
-	
-	results->alloc(results, 0, results->pw);
-	
-	return CSS_OK;
-}
-
-/******************************************************************************
- * Selection engine internals below here                                      *
- ******************************************************************************/
-
-css_error intern_strings(css_select_ctx *ctx)
+void release_classes(css_select_ctx *ctx, const css_select_handler *handler,
+		lwc_string **classes, uint32_t n_classes)
 {
-	lwc_error error;
-
-	/* Universal selector */
-	error = lwc_intern_string("*", SLEN("*"), &ctx->universal);
-	if (error != lwc_error_ok)
-		return css_error_from_lwc_error(error);
-
-	/* Pseudo classes */
-	error = lwc_intern_string(
-			"first-child", SLEN("first-child"), 
-			&ctx->first_child);
-	if (error != lwc_error_ok)
-		return css_error_from_lwc_error(error);
-
-	error = lwc_intern_string(
-			"link", SLEN("link"), 
-			&ctx->link);
-	if (error != lwc_error_ok)
-		return css_error_from_lwc_error(error);
-
-	error = lwc_intern_string(
-			"visited", SLEN("visited"), 
-			&ctx->visited);
-	if (error != lwc_error_ok)
-		return css_error_from_lwc_error(error);
-
-	error = lwc_intern_string(
-			"hover", SLEN("hover"), 
-			&ctx->hover);
-	if (error != lwc_error_ok)
-		return css_error_from_lwc_error(error);
-
-	error = lwc_intern_string(
-			"active", SLEN("active"), 
-			&ctx->active);
-	if (error != lwc_error_ok)
-		return css_error_from_lwc_error(error);
-
-	error = lwc_intern_string(
-			"focus", SLEN("focus"), 
-			&ctx->focus);
-	if (error != lwc_error_ok)
-		return css_error_from_lwc_error(error);
-
-	error = lwc_intern_string(
-			"nth-child", SLEN("nth-child"),
-			&ctx->nth_child);
-	if (error != lwc_error_ok)
-		return css_error_from_lwc_error(error);
-
-	error = lwc_intern_string(
-			"nth-last-child", SLEN("nth-last-child"),
-			&ctx->nth_last_child);
-	if (error != lwc_error_ok)
-		return css_error_from_lwc_error(error);
-
-	error = lwc_intern_string(
-			"nth-of-type", SLEN("nth-of-type"),
-			&ctx->nth_of_type);
-	if (error != lwc_error_ok)
-		return css_error_from_lwc_error(error);
+	uint32_t i;
 
-	error = lwc_intern_string(
-			"nth-last-of-type", SLEN("nth-last-of-type"),
-			&ctx->nth_last_of_type);
-	if (error != lwc_error_ok)
-		return css_error_from_lwc_error(error);
+	/* From version 2, the client retains ownership of the list */
+	if (classes == NULL ||
+			handler->handler_version != CSS_SELECT_HANDLER_VERSION_1)
+		return;
 
-	error = lwc_intern_string(
-			"last-child", SLEN("last-child"),
-			&ctx->last_child);
-	if (error != lwc_error_ok)
-		return css_error_from_lwc_error(error);
+	for (i = 0; i < n_classes; i++)
+		client_string_unref(ctx, classes[i]);
 
-	error = lwc_intern_string(
-			"first-of-type", SLEN("first-of-type"),
-			&ctx->first_of_type);
-	if (error != lwc_error_ok)
-		return css_error_from_lwc_error(error);
+	ctx->alloc(classes, 0, ctx->pw);
+}
 
-	error = lwc_intern_string(
-			"last-of-type", SLEN("last-of-type"),
-			&ctx->last_of_type);
-	if (error != lwc_error_ok)
-		return css_error_from_lwc_error(error);
+/**
+ * Push a node onto a selection context's subtree walk stack
+ *
+ * \param ctx    Selection context
+ * \param node   Node to push
+ * \param style  Composed style of node, or NULL
+ * \return CSS_OK on success, appropriate error otherwise
+ */
+css_error walk_push(css_select_ctx *ctx, void *node, 
+		const css_computed_style *style)
+{
+	if (ctx->n_walk == ctx->walk_size) {
+		uint32_t size = ctx->walk_size == 0 ? 32 : ctx->walk_size * 2;
+		css_select_walk_frame *temp;
 
-	error = lwc_intern_string(
-			"only-child", SLEN("only-child"),
-			&ctx->only_child);
-	if (error != lwc_error_ok)
-		return css_error_from_lwc_error(error);
+		temp = ctx->alloc(ctx->walk, 
+				size * sizeof(css_select_walk_frame), ctx->pw);
+		if (temp == NULL)
+			return CSS_NOMEM;
 
-	error = lwc_intern_string(
-			"only-of-type", SLEN("only-of-type"),
-			&ctx->only_of_type);
-	if (error != lwc_error_ok)
-		return css_error_from_lwc_error(error);
+		ctx->walk = temp;
+		ctx->walk_size = size;
+	}
 
-	error = lwc_intern_string(
-			"root", SLEN("root"),
-			&ctx->root);
-	if (error != lwc_error_ok)
-		return css_error_from_lwc_error(error);
+	ctx->walk[ctx->n_walk].node = node;
+	ctx->walk[ctx->n_walk].style = style;
+	ctx->n_walk++;
 
-	error = lwc_intern_string(
-			"empty", SLEN("empty"),
-			&ctx->empty);
-	if (error != lwc_error_ok)
-		return css_error_from_lwc_error(error);
+	return CSS_OK;
+}
 
-	error = lwc_intern_string(
-			"target", SLEN("target"),
-			&ctx->target);
-	if (error != lwc_error_ok)
-		return css_error_from_lwc_error(error);
+/**
+ * Select, compose and visit the style of a node within a subtree
+ *
+ * \param ctx           Selection context to use
+ * \param node          Node to select style for
+ * \param parent        Parent of node, or NULL if node is the root
+ * \param parent_style  Composed style of parent, or NULL if none
+ * \param media         Currently active media types
+ * \param handler       Dispatch table of handler functions
+ * \param pw            Client-specific private data
+ * \param visitor       Dispatch table of visitor functions
+ * \param push          Whether to push node into the ancestor filter
+ * \param style         Pointer to location to receive composed style
+ * \return CSS_OK on success, appropriate error otherwise
+ */
+css_error select_subtree_node(css_select_ctx *ctx, void *node,
+		void *parent, const css_computed_style *parent_style,
+		uint64_t media, css_select_handler *handler, void *pw,
+		css_select_visitor *visitor, bool push,
+		const css_computed_style **style)
+{
+	const css_stylesheet *inline_style = NULL;
+	css_select_results *results;
+	css_computed_style *base;
+	uint32_t i;
+	css_error error;
 
-	error = lwc_intern_string(
-			"lang", SLEN("lang"),
-			&ctx->lang);
-	if (error != lwc_error_ok)
-		return css_error_from_lwc_error(error);
+	error = visitor->node_inline_style(pw, node, &inline_style);
+	if (error != CSS_OK)
+		return error;
 
-	error = lwc_intern_string(
-			"enabled", SLEN("enabled"),
-			&ctx->enabled);
-	if (error != lwc_error_ok)
-		return css_error_from_lwc_error(error);
+	error = select_style(ctx, node, parent, media,
+			CSS_PSEUDO_ELEMENT_MASK_ALL, inline_style,
+			handler, pw, push, NULL, &results);
+	if (error != CSS_OK)
+		return error;
 
-	error = lwc_intern_string(
-			"disabled", SLEN("disabled"),
-			&ctx->disabled);
-	if (error != lwc_error_ok)
-		return css_error_from_lwc_error(error);
+	base = results->styles[CSS_PSEUDO_ELEMENT_NONE];
 
-	error = lwc_intern_string(
-			"checked", SLEN("checked"),
-			&ctx->checked);
-	if (error != lwc_error_ok)
-		return css_error_from_lwc_error(error);
+	/* Compose the base style with the parent's, then any pseudo 
+	 * element styles with the base style, all in place */
+	if (parent_style != NULL) {
+		error = css_computed_style_compose(parent_style, base, 
+				handler->compute_font_size, pw, base);
+		if (error != CSS_OK) {
+			css_select_results_destroy(results);
+			return error;
+		}
+	}
 
-	/* Pseudo elements */
-	error = lwc_intern_string(
-			"first-line", SLEN("first-line"), 
-			&ctx->first_line);
-	if (error != lwc_error_ok)
-		return css_error_from_lwc_error(error);
+	for (i = CSS_PSEUDO_ELEMENT_NONE + 1; i < CSS_PSEUDO_ELEMENT_COUNT; i++) {
+		if (results->styles[i] == NULL)
+			continue;
 
-	error = lwc_intern_string(
-			"first_letter", SLEN("first-letter"),
-			&ctx->first_letter);
-	if (error != lwc_error_ok)
-		return css_error_from_lwc_error(error);
+		error = css_computed_style_compose(base, results->styles[i],
+				handler->compute_font_size, pw, 
+				results->styles[i]);
+		if (error != CSS_OK) {
+			css_select_results_destroy(results);
+			return error;
+		}
+	}
 
-	error = lwc_intern_string(
-			"before", SLEN("before"), 
-			&ctx->before);
-	if (error != lwc_error_ok)
-		return css_error_from_lwc_error(error);
+	/* The composed styles are finished, so may now be interned */
+	for (i = 0; i < CSS_PSEUDO_ELEMENT_COUNT; i++) {
+		if (ctx->intern == NULL || results->styles[i] == NULL)
+			continue;
 
-	error = lwc_intern_string(
-			"after", SLEN("after"), 
-			&ctx->after);
-	if (error != lwc_error_ok)
-		return css_error_from_lwc_error(error);
+		error = css__style_intern_insert(ctx->intern,
+				&results->styles[i]);
+		if (error != CSS_OK) {
+			css_select_results_destroy(results);
+			return error;
+		}
+	}
 
-	return CSS_OK;
-}
+	*style = results->styles[CSS_PSEUDO_ELEMENT_NONE];
 
-void destroy_strings(css_select_ctx *ctx)
-{
-	if (ctx->universal != NULL)
-		lwc_string_unref(ctx->universal);
-	if (ctx->first_child != NULL)
-		lwc_string_unref(ctx->first_child);
-	if (ctx->link != NULL)
-		lwc_string_unref(ctx->link);
-	if (ctx->visited != NULL)
-		lwc_string_unref(ctx->visited);
-	if (ctx->hover != NULL)
-		lwc_string_unref(ctx->hover);
-	if (ctx->active != NULL)
-		lwc_string_unref(ctx->active);
-	if (ctx->focus != NULL)
-		lwc_string_unref(ctx->focus);
-	if (ctx->nth_child != NULL)
-		lwc_string_unref(ctx->nth_child);
-	if (ctx->nth_last_child != NULL)
-		lwc_string_unref(ctx->nth_last_child);
-	if (ctx->nth_of_type != NULL)
-		lwc_string_unref(ctx->nth_of_type);
-	if (ctx->nth_last_of_type != NULL)
-		lwc_string_unref(ctx->nth_last_of_type);
-	if (ctx->last_child != NULL)
-		lwc_string_unref(ctx->last_child);
-	if (ctx->first_of_type != NULL)
-		lwc_string_unref(ctx->first_of_type);
-	if (ctx->last_of_type != NULL)
-		lwc_string_unref(ctx->last_of_type);
-	if (ctx->only_child != NULL)
-		lwc_string_unref(ctx->only_child);
-	if (ctx->only_of_type != NULL)
-		lwc_string_unref(ctx->only_of_type);
-	if (ctx->root != NULL)
-		lwc_string_unref(ctx->root);
-	if (ctx->empty != NULL)
-		lwc_string_unref(ctx->empty);
-	if (ctx->target != NULL)
-		lwc_string_unref(ctx->target);
-	if (ctx->lang != NULL)
-		lwc_string_unref(ctx->lang);
-	if (ctx->enabled != NULL)
-		lwc_string_unref(ctx->enabled);
-	if (ctx->disabled != NULL)
-		lwc_string_unref(ctx->disabled);
-	if (ctx->checked != NULL)
-		lwc_string_unref(ctx->checked);
-	if (ctx->first_line != NULL)
-		lwc_string_unref(ctx->first_line);
-	if (ctx->first_letter != NULL)
-		lwc_string_unref(ctx->first_letter);
-	if (ctx->before != NULL)
-		lwc_string_unref(ctx->before);
-	if (ctx->after != NULL)
-		lwc_string_unref(ctx->after);
+	/* Ownership of the results passes to the client */
+	return visitor->visit(pw, node, results);
 }
 
 css_error set_hint(css_select_state *state, uint32_t prop)
 {
+	prop_state *existing;
 	css_hint hint;
 	css_error error;
 
@@ -990,12 +3229,11 @@ css_error set_hint(css_select_state *state, uint32_t prop)
 		return error;
 
 	/* Keep selection state in sync with reality */
-	state->props[prop][CSS_PSEUDO_ELEMENT_NONE].set = 1;
-	state->props[prop][CSS_PSEUDO_ELEMENT_NONE].specificity = 0;
-	state->props[prop][CSS_PSEUDO_ELEMENT_NONE].origin = CSS_ORIGIN_AUTHOR;
-	state->props[prop][CSS_PSEUDO_ELEMENT_NONE].important = 0;
-	state->props[prop][CSS_PSEUDO_ELEMENT_NONE].inherit = 
-			(hint.status == 0);
+	existing = prop_touch(state, CSS_PSEUDO_ELEMENT_NONE, prop);
+	existing->specificity = 0;
+	existing->origin = CSS_ORIGIN_AUTHOR;
+	existing->important = 0;
+	existing->inherit = (hint.status == 0);
 
 	return CSS_OK;
 }
@@ -1023,9 +3261,10 @@ css_error set_initial(css_select_state *state,
 		 * the extension block has yet to be allocated. In that 
 		 * case, we do nothing and leave it to the property 
 		 * accessors to return the initial values for the 
-		 * property.
+		 * property. The block of inherited properties is an
+		 * exception, as its accessors return inherit in its absence.
 		 */
-		if (group == GROUP_NORMAL) {
+		if (group == GROUP_NORMAL || group == GROUP_INHERITED) {
 			error = prop_dispatch[prop].initial(state);
 			if (error != CSS_OK)
 				return error;
@@ -1047,69 +3286,299 @@ css_error set_initial(css_select_state *state,
 		}
 	}
 
-	return CSS_OK;
-}
+	return CSS_OK;
+}
+
+#define IMPORT_STACK_SIZE 256
+
+/**
+ * Build a selection context's index of the selectors in its sheets
+ *
+ * \param ctx  Selection context
+ * \return CSS_OK on success, appropriate error otherwise
+ *
+ * Every sheet, including those imported, is a source of selectors. Sources
+ * are numbered in the order in which the cascade considers them: imported
+ * sheets precede the sheet importing them, in the order of their import
+ * rules. The index orders selectors with the same specificity by source,
+ * so a single probe of it yields them in cascade order.
+ *
+ * Whether a source applies depends upon the media being selected for, so
+ * all imported sheets are indexed. See source_applies().
+ */
+css_error index_build(css_select_ctx *ctx)
+{
+	const css_rule *import_stack[IMPORT_STACK_SIZE];
+	uint32_t first_stack[IMPORT_STACK_SIZE];
+	uint32_t i, k, n_slots, count = 0;
+	css_error error;
+
+	index_destroy(ctx);
+
+	/* Number the sources, finding each sheet's imports first */
+	for (i = 0; i < ctx->n_sheets; i++) {
+		const css_stylesheet *s = ctx->sheets[i].sheet;
+		const css_rule *rule = s->rule_list;
+		uint32_t first = ctx->n_sources;
+		uint32_t sp = 0;
+
+		do {
+			/* Find first non-charset rule, if we're at the
+			 * list head */
+			if (rule == s->rule_list) {
+				while (rule != NULL &&
+						rule->type == CSS_RULE_CHARSET)
+					rule = rule->next;
+			}
+
+			if (rule != NULL && rule->type == CSS_RULE_IMPORT) {
+				const css_rule_import *import =
+						(const css_rule_import *) rule;
+
+				if (import->sheet != NULL) {
+					if (sp >= IMPORT_STACK_SIZE)
+						return CSS_NOMEM;
+
+					import_stack[sp] = rule;
+					first_stack[sp++] = first;
+
+					s = import->sheet;
+					rule = s->rule_list;
+					first = ctx->n_sources;
+				} else {
+					rule = rule->next;
+				}
+			} else {
+				/* Gone past import rules in this sheet */
+				css_select_source *src;
+
+				if (ctx->n_sources == ctx->sources_size) {
+					uint32_t size = ctx->sources_size == 0 ?
+						8 : ctx->sources_size * 2;
+					css_select_source *temp;
+
+					temp = ctx->alloc(ctx->sources, size *
+						sizeof(css_select_source),
+						ctx->pw);
+					if (temp == NULL)
+						return CSS_NOMEM;
+
+					ctx->sources = temp;
+					ctx->sources_size = size;
+				}
+
+				src = &ctx->sources[ctx->n_sources];
+				src->sheet = s;
+				src->top = i;
+				src->parent = CSS_SELECT_SOURCE_NONE;
+
+				/* Sheets imported directly are yet to be
+				 * given a parent */
+				for (k = first; k < ctx->n_sources; k++) {
+					if (ctx->sources[k].parent ==
+							CSS_SELECT_SOURCE_NONE)
+						ctx->sources[k].parent =
+								ctx->n_sources;
+				}
+
+				if (sp > 0) {
+					sp--;
+					src->media = ((const css_rule_import *)
+						import_stack[sp])->media;
+					rule = import_stack[sp]->next;
+					s = import_stack[sp]->parent;
+					first = first_stack[sp];
+				} else {
+					src->media = ctx->sheets[i].media;
+					s = NULL;
+				}
+
+				ctx->n_sources++;
+			}
+		} while (s != NULL);
+	}
+
+	/* Restrict each source to the media of the sources importing it.
+	 * Importing sheets follow those they import. */
+	for (k = ctx->n_sources; k > 0; k--) {
+		css_select_source *src = &ctx->sources[k - 1];
+
+		if (src->parent != CSS_SELECT_SOURCE_NONE)
+			src->media &= ctx->sources[src->parent].media;
+	}
+
+	/* Size the index for the number of selectors */
+	for (k = 0; k < ctx->n_sources; k++) {
+		error = index_add_rules(ctx, ctx->sources[k].sheet->rule_list,
+				k, &count);
+		if (error != CSS_OK)
+			return error;
+	}
+
+	for (n_slots = 64; n_slots < count; n_slots *= 2)
+		;
+
+	error = css__selector_hash_create_sized(ctx->alloc, ctx->pw, n_slots,
+			&ctx->index);
+	if (error != CSS_OK)
+		return error;
+
+	/* Hash the selectors in bulk */
+	css__selector_hash_defer(ctx->index);
+
+	for (k = 0; k < ctx->n_sources; k++) {
+		error = index_add_rules(ctx, ctx->sources[k].sheet->rule_list,
+				k, NULL);
+		if (error != CSS_OK) {
+			index_destroy(ctx);
+			return error;
+		}
+	}
+
+	error = css__selector_hash_build(ctx->index);
+	if (error != CSS_OK) {
+		index_destroy(ctx);
+		return error;
+	}
+
+	return CSS_OK;
+}
+
+/**
+ * Add the selectors in a list of rules to a selection context's index
+ *
+ * \param ctx     Selection context
+ * \param rule    First rule in list
+ * \param source  Source of the rules
+ * \param count   Pointer to location to add count of selectors to, or NULL
+ *                to add the selectors to the index
+ * \return CSS_OK on success, appropriate error otherwise
+ *
+ * Selectors of rules with no bytecode are never matched, so are omitted.
+ */
+css_error index_add_rules(css_select_ctx *ctx, const css_rule *rule,
+		uint32_t source, uint32_t *count)
+{
+	css_error error;
+
+	for (; rule != NULL; rule = rule->next) {
+		if (rule->type == CSS_RULE_SELECTOR) {
+			const css_rule_selector *r =
+					(const css_rule_selector *) rule;
+			uint32_t i;
+
+			if (r->style == NULL)
+				continue;
+
+			if (count != NULL) {
+				*count += rule->items;
+				continue;
+			}
+
+			for (i = 0; i < rule->items; i++) {
+				error = css__selector_hash_insert_from(
+						ctx->index, r->selectors[i],
+						source);
+				if (error != CSS_OK)
+					return error;
+			}
+		} else if (rule->type == CSS_RULE_MEDIA) {
+			error = index_add_rules(ctx,
+				((const css_rule_media *) rule)->first_child,
+				source, count);
+			if (error != CSS_OK)
+				return error;
+		}
+	}
+
+	return CSS_OK;
+}
+
+/**
+ * Build a selection context's invalidation map
+ *
+ * \param ctx  Selection context
+ * \return CSS_OK on success, appropriate error otherwise
+ *
+ * The map is built from the sheets in the context's index, which is
+ * built first if necessary.
+ */
+css_error invalidation_build(css_select_ctx *ctx)
+{
+	css_invalidation_map *map;
+	uint32_t k;
+	css_error error;
+
+	if (ctx->index == NULL) {
+		error = index_build(ctx);
+		if (error != CSS_OK)
+			return error;
+	}
 
-#define IMPORT_STACK_SIZE 256
+	error = css__invalidation_map_create(ctx->alloc, ctx->pw, &map);
+	if (error != CSS_OK)
+		return error;
 
-css_error select_from_sheet(css_select_ctx *ctx, const css_stylesheet *sheet, 
-		css_origin origin, css_select_state *state)
-{
-	const css_stylesheet *s = sheet;
-	const css_rule *rule = s->rule_list;
-	uint32_t sp = 0;
-	const css_rule *import_stack[IMPORT_STACK_SIZE];
+	for (k = 0; k < ctx->n_sources; k++) {
+		const css_stylesheet *sheet = ctx->sources[k].sheet;
 
-	do {
-		/* Find first non-charset rule, if we're at the list head */
-		if (rule == s->rule_list) {
-			while (rule != NULL && rule->type == CSS_RULE_CHARSET)
-				rule = rule->next;
+		error = css__invalidation_map_add_rules(map, sheet,
+				sheet->rule_list);
+		if (error != CSS_OK) {
+			css__invalidation_map_destroy(map);
+			return error;
 		}
+	}
 
-		if (rule != NULL && rule->type == CSS_RULE_IMPORT) {
-			/* Current rule is an import */
-			const css_rule_import *import = 
-					(const css_rule_import *) rule;
+	ctx->invalidation = map;
 
-			if (import->sheet != NULL &&
-					(import->media & state->media) != 0) {
-				/* It's applicable, so process it */
-				if (sp >= IMPORT_STACK_SIZE)
-					return CSS_NOMEM;
+	return CSS_OK;
+}
 
-				import_stack[sp++] = rule;
+/**
+ * Discard a selection context's index
+ *
+ * \param ctx  Selection context
+ */
+void index_destroy(css_select_ctx *ctx)
+{
+	if (ctx->borrowed == false) {
+		if (ctx->index != NULL)
+			css__selector_hash_destroy(ctx->index);
 
-				s = import->sheet;
-				rule = s->rule_list;
-			} else {
-				/* Not applicable; skip over it */
-				rule = rule->next;
-			}
-		} else {
-			/* Gone past import rules in this sheet */
-			css_error error;
+		if (ctx->sources != NULL)
+			ctx->alloc(ctx->sources, 0, ctx->pw);
 
-			/* Process this sheet */
-			state->sheet = s;
-			state->current_origin = origin;
+		if (ctx->invalidation != NULL)
+			css__invalidation_map_destroy(ctx->invalidation);
+	}
 
-			error = match_selectors_in_sheet(ctx, s, state);
-			if (error != CSS_OK)
-				return error;
+	ctx->index = NULL;
+	ctx->sources = NULL;
+	ctx->invalidation = NULL;
+	ctx->n_sources = 0;
+	ctx->sources_size = 0;
+	ctx->borrowed = false;
+}
 
-			/* Find next sheet to process */
-			if (sp > 0) {
-				sp--;
-				rule = import_stack[sp]->next;
-				s = import_stack[sp]->parent;
-			} else {
-				s = NULL;
-			}
-		}
-	} while (s != NULL);
+/**
+ * Determine whether a source of selectors applies to the given media
+ *
+ * \param ctx     Selection context
+ * \param source  Source to consider
+ * \param media   Currently active media types
+ * \return true if the source's selectors apply, false otherwise
+ *
+ * The source applies if its top-level sheet is enabled, and that sheet and
+ * every import rule leading to the source apply to the media.
+ */
+static inline bool source_applies(const css_select_ctx *ctx, uint32_t source,
+		uint64_t media)
+{
+	const css_select_source *src = &ctx->sources[source];
 
-	return CSS_OK;
+	return (src->media & media) != 0 &&
+			ctx->sheets[src->top].sheet->disabled == false;
 }
 
 static inline bool _rule_applies_to_media(const css_rule *rule, uint64_t media)
@@ -1250,284 +3719,909 @@ static css_error select_font_faces_from_sheet(css_select_ctx *ctx,
 
 #undef IMPORT_STACK_SIZE
 
-static inline bool _selectors_pending(const css_selector **node,
-		const css_selector **id, const css_selector ***classes,
-		uint32_t n_classes, const css_selector **univ)
+/**
+ * Compare the cascade order of two selector hash entries
+ *
+ * \param a  First entry
+ * \param b  Second entry
+ * \return <0 if a is to be processed before b, >0 if after, 0 if equal
+ */
+static inline int _selector_compare(const css_selector_hash_entry *a,
+		const css_selector_hash_entry *b)
+{
+	/* Sort by specificity */
+	if (a->specificity != b->specificity)
+		return a->specificity < b->specificity ? -1 : 1;
+
+	/* Then by source -- earliest wins */
+	if (a->source != b->source)
+		return a->source < b->source ? -1 : 1;
+
+	/* Then by rule index -- earliest wins */
+	if (a->index != b->index)
+		return a->index < b->index ? -1 : 1;
+
+	return 0;
+}
+
+/**
+ * Determine whether one chain's current selector precedes another's
+ *
+ * \param a  First chain
+ * \param b  Second chain
+ * \return true if a's selector is to be processed first
+ */
+static inline bool _chain_precedes(const css_select_chain *a,
+		const css_select_chain *b)
+{
+	int cmp = _selector_compare(a->entry, b->entry);
+
+	return cmp < 0 || (cmp == 0 && a->order < b->order);
+}
+
+/**
+ * Restore the heap property below a chain in a heap of chains
+ *
+ * \param heap    Heap of chains
+ * \param n       Number of chains in heap
+ * \param i       Index of chain which may be out of place
+ */
+static void _chain_heap_sift_down(css_select_chain *heap, uint32_t n,
+		uint32_t i)
+{
+	css_select_chain chain = heap[i];
+
+	while (2 * i + 1 < n) {
+		uint32_t child = 2 * i + 1;
+
+		if (child + 1 < n && _chain_precedes(&heap[child + 1],
+				&heap[child]))
+			child++;
+
+		if (_chain_precedes(&heap[child], &chain) == false)
+			break;
+
+		heap[i] = heap[child];
+		i = child;
+	}
+
+	heap[i] = chain;
+}
+
+/**
+ * Add a chain to a heap of chains, unless it is empty
+ *
+ * \param heap      Heap of chains, with space for another
+ * \param n         Pointer to number of chains in heap, updated on exit
+ * \param entry     First entry in chain
+ * \param source    Hash the chain belongs to
+ * \param class     Index of class the chain is for, if any
+ */
+static void _chain_heap_push(css_select_chain *heap, uint32_t *n,
+		const css_selector_hash_entry *entry, int source,
+		uint32_t class)
+{
+	css_select_chain chain;
+	uint32_t i = *n;
+
+	if (entry->sel == NULL)
+		return;
+
+	chain.entry = entry;
+	chain.src.source = source;
+	chain.src.class = class;
+	chain.order = i;
+
+	while (i > 0 && _chain_precedes(&chain, &heap[(i - 1) / 2])) {
+		heap[i] = heap[(i - 1) / 2];
+		i = (i - 1) / 2;
+	}
+
+	heap[i] = chain;
+	(*n)++;
+}
+
+static bool _rule_good_for_element_name(const css_selector *selector,
+		css_select_rule_source *src, css_select_state *state)
+{
+	/* If source of rule is element or universal hash, we know the
+	 * element name is a match.  If it comes from the class or id hash,
+	 * we have to test for a match */
+	if (src->source == CSS_SELECT_RULE_SRC_ID ||
+			src->source == CSS_SELECT_RULE_SRC_CLASS) {
+		if (lwc_string_length(selector->data.qname.name) != 1 ||
+				lwc_string_data(
+					selector->data.qname.name)[0] != '*') {
+			bool match;
+			if (lwc_string_caseless_isequal(
+					selector->data.qname.name,
+					state->element.name,
+					&match) == lwc_error_ok &&
+					match == false) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+css_error match_selectors(css_select_ctx *ctx, css_select_state *state)
+{
+	const uint32_t n_classes = state->n_classes;
+	uint32_t i = 0;
+	const css_selector_hash_entry *selectors;
+	css_select_chain local[CSS_SELECT_CHAINS_SIZE];
+	css_select_chain *heap = local;
+	uint32_t n_chains = 0, n_heap = 0, n_states;
+	uint32_t last_source = 0, last_specificity = 0;
+	uint32_t partitions;
+	css_pseudo_element pseudo;
+	uint64_t fingerprint;
+	css_error error;
+
+	/* Only the partitions of the index for the pseudo elements being
+	 * styled, which hold any selectors, need be searched */
+	partitions = state->pseudo_mask &
+			css__selector_hash_partitions(ctx->index);
+
+	/* Within each, one chain each for the node's name, ID and the
+	 * universal selector, one for each of its classes and states, and
+	 * one for each of its attributes, or for all attributes if they are
+	 * unknown. Unless the ctx is shared, its heap is kept for reuse. */
+	for (i = 0, n_states = 0; i < 32; i++) {
+		if ((state->keyed_state & (1u << i)) != 0)
+			n_states++;
+	}
+
+	for (pseudo = CSS_PSEUDO_ELEMENT_NONE;
+			pseudo < CSS_PSEUDO_ELEMENT_COUNT; pseudo++) {
+		if ((partitions & CSS_PSEUDO_ELEMENT_MASK(pseudo)) != 0) {
+			n_heap += n_classes + 3 + n_states +
+				(state->attributes_known ?
+					state->n_attributes : 1);
+		}
+	}
+
+	if (ctx->shared == false) {
+		if (n_heap > ctx->chains_size) {
+			uint32_t size = ctx->chains_size;
+			css_select_chain *temp;
+
+			if (size == 0)
+				size = CSS_SELECT_CHAINS_SIZE;
+			while (size < n_heap)
+				size *= 2;
+
+			temp = ctx->alloc(ctx->chains,
+					size * sizeof(css_select_chain),
+					ctx->pw);
+			if (temp == NULL)
+				return CSS_NOMEM;
+
+			ctx->chains = temp;
+			ctx->chains_size = size;
+		}
+
+		heap = ctx->chains;
+	} else if (n_heap > CSS_SELECT_CHAINS_SIZE) {
+		heap = ctx->alloc(NULL, n_heap *
+				sizeof(css_select_chain), ctx->pw);
+		if (heap == NULL)
+			return CSS_NOMEM;
+	}
+
+	/* Fingerprint the node's name, ID and classes, so that selectors
+	 * requiring others may be rejected without consulting the client */
+	fingerprint = css_bloom_fingerprint(
+			css_bloom_hash(state->element.name));
+	if (state->id != NULL)
+		fingerprint |= css_bloom_fingerprint(css_bloom_hash(state->id));
+	for (i = 0; state->classes != NULL && i < n_classes; i++) {
+		fingerprint |= css_bloom_fingerprint(
+				css_bloom_hash(state->classes[i]));
+	}
+
+	for (pseudo = CSS_PSEUDO_ELEMENT_NONE;
+			pseudo < CSS_PSEUDO_ELEMENT_COUNT; pseudo++) {
+		if ((partitions & CSS_PSEUDO_ELEMENT_MASK(pseudo)) == 0)
+			continue;
+
+		/* Find hash chain that applies to current node */
+		error = css__selector_hash_find(ctx->index, pseudo,
+				&state->element, &selectors);
+		if (error != CSS_OK)
+			goto cleanup;
+		_chain_heap_push(heap, &n_chains, selectors,
+				CSS_SELECT_RULE_SRC_ELEMENT, 0);
+
+		if (state->id != NULL) {
+			/* Find hash chain for node ID */
+			error = css__selector_hash_find_by_id(ctx->index,
+					pseudo, state->id, &selectors);
+			if (error != CSS_OK)
+				goto cleanup;
+			_chain_heap_push(heap, &n_chains, selectors,
+					CSS_SELECT_RULE_SRC_ID, 0);
+		}
+
+		/* Find hash chain for universal selector */
+		error = css__selector_hash_find_universal(ctx->index, pseudo,
+				&selectors);
+		if (error != CSS_OK)
+			goto cleanup;
+		_chain_heap_push(heap, &n_chains, selectors,
+				CSS_SELECT_RULE_SRC_UNIVERSAL, 0);
+
+		/* Find hash chains for node classes */
+		for (i = 0; state->classes != NULL && i < n_classes; i++) {
+			error = css__selector_hash_find_by_class(ctx->index,
+					pseudo, state->classes[i],
+					&selectors);
+			if (error != CSS_OK)
+				goto cleanup;
+			_chain_heap_push(heap, &n_chains, selectors,
+					CSS_SELECT_RULE_SRC_CLASS, i);
+		}
+
+		/* Find hash chains for node states */
+		for (i = 0; i < 32; i++) {
+			if ((state->keyed_state & (1u << i)) == 0)
+				continue;
+
+			error = css__selector_hash_find_by_state(ctx->index,
+					pseudo, 1u << i, &selectors);
+			if (error != CSS_OK)
+				goto cleanup;
+			_chain_heap_push(heap, &n_chains, selectors,
+					CSS_SELECT_RULE_SRC_UNIVERSAL, 0);
+		}
+
+		/* Find hash chains for node attributes */
+		if (state->attributes_known) {
+			for (i = 0; i < state->n_attributes; i++) {
+				error = css__selector_hash_find_by_attribute(
+						ctx->index, pseudo,
+						state->attributes[i],
+						&selectors);
+				if (error != CSS_OK)
+					goto cleanup;
+				_chain_heap_push(heap, &n_chains, selectors,
+						CSS_SELECT_RULE_SRC_UNIVERSAL,
+						0);
+			}
+		} else {
+			error = css__selector_hash_find_any_attribute(
+					ctx->index, pseudo, &selectors);
+			if (error != CSS_OK)
+				goto cleanup;
+			_chain_heap_push(heap, &n_chains, selectors,
+					CSS_SELECT_RULE_SRC_UNIVERSAL, 0);
+		}
+	}
+
+	/* Process matching selectors, if any. Selectors must be matched in
+	 * ascending order of specificity, source and rule index. (c.f.
+	 * css__outranks_existing()) The chains are kept in a heap, so the
+	 * least specific/earliest occurring selector is at its root. */
+	while (n_chains > 0) {
+		css_select_chain *chain = &heap[0];
+		const css_selector *selector = chain->entry->sel;
+		uint32_t source = chain->entry->source;
+		bool matched = false;
+
+		/* Ignore any selectors requiring a name, ID or class which
+		 * the node lacks, contained in rules which are a child of an
+		 * @media block that doesn't match the current media
+		 * requirements, or from sheets which don't apply. */
+		if ((selector->fingerprint & ~fingerprint) == 0 &&
+				(selector->media & state->media) != 0 &&
+				source_applies(ctx, source, state->media) &&
+				_rule_good_for_element_name(selector,
+					&chain->src, state)) {
+			state->sheet = ctx->sources[source].sheet;
+			state->current_origin =
+				ctx->sheets[ctx->sources[source].top].origin;
+
+			error = match_selector_chain(ctx, selector, state,
+					&matched);
+			if (error != CSS_OK)
+				goto cleanup;
+
+			/* Selectors from the same source are considered in
+			 * sheet order, so this is the last match in sheet
+			 * order if its source is no earlier */
+			if (matched && source >= last_source) {
+				last_source = source;
+				last_specificity = selector->specificity;
+			}
+		}
+
+		/* Advance the chain we extracted the processed selector
+		 * from, dropping it from the heap once it is exhausted */
+		error = css__selector_hash_next(chain->entry, &chain->entry);
+		if (error != CSS_OK)
+			goto cleanup;
+
+		if (chain->entry->sel == NULL)
+			heap[0] = heap[--n_chains];
+
+		_chain_heap_sift_down(heap, n_chains, 0);
+	}
+
+	/* Any inline style is cascaded with the origin of the last sheet
+	 * which applies, and the specificity of the last selector matched,
+	 * in sheet order */
+	for (i = ctx->n_sheets; i > 0; i--) {
+		const css_select_sheet *sheet = &ctx->sheets[i - 1];
+
+		if ((sheet->media & state->media) != 0 &&
+				sheet->sheet->disabled == false) {
+			state->current_origin = sheet->origin;
+			break;
+		}
+	}
+
+	state->current_specificity = last_specificity;
+
+	error = CSS_OK;
+cleanup:
+	if (heap != local && heap != ctx->chains)
+		ctx->alloc(heap, 0, ctx->pw);
+
+	return error;
+}
+
+css_error match_selector_chain(css_select_ctx *ctx, 
+		const css_selector *selector, css_select_state *state,
+		bool *matched)
 {
-	bool pending = false;
+	bool match = false;
+	css_pseudo_element pseudo = CSS_PSEUDO_ELEMENT_NONE;
+	css_error error;
 	uint32_t i;
 
-	pending |= *node != NULL;
-	pending |= *id != NULL;
-	pending |= *univ != NULL;
+#ifdef DEBUG_CHAIN_MATCHING
+	fprintf(stderr, "matching: ");
+	dump_chain(selector);
+	fprintf(stderr, "\n");
+#endif
+
+	/* Reject the chain outright if the ancestor filter shows that the
+	 * node lacks any of the ancestors it requires */
+	if (state->bloom != NULL) {
+		for (i = 0; i < CSS_SELECTOR_ANCESTOR_HASHES && 
+				selector->ancestor_hashes[i] != 0; i++) {
+			if (css_bloom_may_contain(state->bloom, 
+					selector->ancestor_hashes[i]) == false)
+				return CSS_OK;
+		}
+	}
+
+	/* Run the program compiled from the selector, if any */
+	if (selector->program != NULL) {
+		error = run_program(ctx, selector->program, state,
+				&match, &pseudo);
+	} else {
+		error = interpret_chain(ctx, selector, state, &match, &pseudo);
+	}
+	if (error != CSS_OK)
+		return error;
+
+	/* No match, so reject selector chain */
+	if (match == false)
+		return CSS_OK;
+
+	/* If we got here, then the entire selector chain matched, so cascade */
+	state->current_specificity = selector->specificity;
+	*matched = true;
 
-	if (classes != NULL && n_classes > 0) {
-		for (i = 0; i < n_classes; i++)
-			pending |= *(classes[i]) != NULL;
+	/* Record the match, so that it may be shared */
+	if (state->share != NULL) {
+		error = share_record(ctx, selector, pseudo, state);
+		if (error != CSS_OK)
+			return error;
 	}
 
-	return pending;
+	/* Ensure that the appropriate computed style exists */
+	error = ensure_style(ctx, state, pseudo);
+	if (error != CSS_OK)
+		return error;
+
+	state->current_pseudo = pseudo;
+	state->computed = state->results->styles[pseudo];
+
+	return cascade_style(((css_rule_selector *) selector->rule)->style,
+			state);
 }
 
-static inline bool _selector_less_specific(const css_selector *ref, 
-		const css_selector *cand)
+/**
+ * Obtain the state of a node, calling the client only if it is not cached
+ *
+ * \param state  Selection state
+ * \param node   Node to consider
+ * \param flags  Pointer to location to receive css_node_state_flags
+ * \return CSS_OK on success, appropriate error otherwise
+ */
+css_error fetch_node_state(css_select_state *state, void *node,
+		uint32_t *flags)
 {
-	bool result = true;
+	css_select_node_state *entry;
+	css_error error;
+
+	if (node == state->node) {
+		if (state->node_state_valid == false) {
+			error = state->handler->node_state(state->pw, node,
+					&state->node_state);
+			if (error != CSS_OK)
+				return error;
+
+			state->node_state_valid = true;
+		}
+
+		*flags = state->node_state;
+
+		return CSS_OK;
+	}
 
-	if (cand == NULL)
-		return false;
+	entry = &state->node_states[((uintptr_t) node >> 4) %
+			CSS_SELECT_NODE_STATES];
 
-	if (ref == NULL)
-		return true;
+	if (entry->node != node) {
+		error = state->handler->node_state(state->pw, node,
+				&entry->flags);
+		if (error != CSS_OK) {
+			entry->node = NULL;
+			return error;
+		}
 
-	/* Sort by specificity */
-	if (cand->specificity < ref->specificity) {
-		result = true;
-	} else if (ref->specificity < cand->specificity) {
-		result = false;
-	} else {
-		/* Then by rule index -- earliest wins */
-		if (cand->rule->index < ref->rule->index)
-			result = true;
-		else
-			result = false;
+		entry->node = node;
 	}
 
-	return result;
+	*flags = entry->flags;
+
+	return CSS_OK;
 }
 
-static const css_selector *_selector_next(const css_selector **node,
-		const css_selector **id, const css_selector ***classes,
-		uint32_t n_classes, const css_selector **univ,
-		css_select_rule_source *src)
+/**
+ * Determine whether a node is in a given state
+ *
+ * \param state  Selection state
+ * \param node   Node to test
+ * \param flag   State to test for (one of css_node_state_flags)
+ * \param match  Pointer to location to receive result
+ * \return CSS_OK on success, appropriate error otherwise
+ */
+css_error match_node_state(css_select_state *state, void *node,
+		uint32_t flag, bool *match)
 {
-	const css_selector *ret = NULL;
+	css_select_handler *handler = state->handler;
+	uint32_t flags = 0;
+	css_error error;
 
-	if (_selector_less_specific(ret, *node)) {
-		ret = *node;
-		src->source = CSS_SELECT_RULE_SRC_ELEMENT;
-	}
+	/* From version 2, the client reports all of a node's state at once */
+	if (handler->handler_version != CSS_SELECT_HANDLER_VERSION_1) {
+		error = fetch_node_state(state, node, &flags);
+		if (error == CSS_OK)
+			*match = (flags & flag) != 0;
 
-	if (_selector_less_specific(ret, *id)) {
-		ret = *id;
-		src->source = CSS_SELECT_RULE_SRC_ID;
+		return error;
 	}
 
-	if (_selector_less_specific(ret, *univ)) {
-		ret = *univ;
-		src->source = CSS_SELECT_RULE_SRC_UNIVERSAL;
+	switch (flag) {
+	case CSS_NODE_STATE_ROOT:
+		return handler->node_is_root(state->pw, node, match);
+	case CSS_NODE_STATE_EMPTY:
+		return handler->node_is_empty(state->pw, node, match);
+	case CSS_NODE_STATE_LINK:
+		return handler->node_is_link(state->pw, node, match);
+	case CSS_NODE_STATE_VISITED:
+		return handler->node_is_visited(state->pw, node, match);
+	case CSS_NODE_STATE_HOVER:
+		return handler->node_is_hover(state->pw, node, match);
+	case CSS_NODE_STATE_ACTIVE:
+		return handler->node_is_active(state->pw, node, match);
+	case CSS_NODE_STATE_FOCUS:
+		return handler->node_is_focus(state->pw, node, match);
+	case CSS_NODE_STATE_ENABLED:
+		return handler->node_is_enabled(state->pw, node, match);
+	case CSS_NODE_STATE_DISABLED:
+		return handler->node_is_disabled(state->pw, node, match);
+	case CSS_NODE_STATE_CHECKED:
+		return handler->node_is_checked(state->pw, node, match);
+	case CSS_NODE_STATE_TARGET:
+		return handler->node_is_target(state->pw, node, match);
 	}
 
-	if (classes != NULL && n_classes > 0) {
-		uint32_t i;
-
-		for (i = 0; i < n_classes; i++) {
-			if (_selector_less_specific(ret, *(classes[i]))) {
-				ret = *(classes[i]);
-				src->source = CSS_SELECT_RULE_SRC_CLASS;
-				src->class = i;
-			}
-		}
-	}
+	*match = false;
 
-	return ret;
+	return CSS_OK;
 }
 
-static bool _rule_good_for_element_name(const css_selector *selector,
-		css_select_rule_source *src, css_select_state *state)
+static inline bool match_nth(int32_t a, int32_t b, int32_t count)
 {
-	/* If source of rule is element or universal hash, we know the
-	 * element name is a match.  If it comes from the class or id hash,
-	 * we have to test for a match */
-	if (src->source == CSS_SELECT_RULE_SRC_ID ||
-			src->source == CSS_SELECT_RULE_SRC_CLASS) {
-		if (lwc_string_length(selector->data.qname.name) != 1 ||
-				lwc_string_data(
-					selector->data.qname.name)[0] != '*') {
-			bool match;
-			if (lwc_string_caseless_isequal(
-					selector->data.qname.name,
-					state->element.name,
-					&match) == lwc_error_ok &&
-					match == false) {
-				return false;
-			}
+	if (a == 0) {
+		return count == b;
+	} else {
+		const int32_t delta = count - b;
+
+		/* (count - b) / a is positive or (count - b) is 0 */
+		if (((delta > 0) == (a > 0)) || delta == 0) {
+			/* (count - b) / a is integer */
+			return (delta % a == 0);
 		}
+
+		return false;
 	}
+}
 
-	return true;
+/**
+ * Determine whether a program instruction moves only to an adjacent node
+ *
+ * \param move  Instruction moving to another node
+ * \return true if only the node moved to may match the following tests,
+ *         false if nodes beyond it may be sought
+ */
+static inline bool move_adjacent(const css_select_insn *move)
+{
+	return move->op == CSS_OP_PARENT || move->op == CSS_OP_SIBLING ||
+			move->op == CSS_OP_ANY_PARENT ||
+			move->op == CSS_OP_ANY_SIBLING;
 }
 
-css_error match_selectors_in_sheet(css_select_ctx *ctx, 
-		const css_stylesheet *sheet, css_select_state *state)
+/**
+ * Run a selector's program against the node being selected for
+ *
+ * \param ctx             Selection context
+ * \param program         Program to run
+ * \param state           Selection state
+ * \param match           Pointer to location to receive result
+ * \param pseudo_element  Pointer to location to receive pseudo element
+ * \return CSS_OK on success, appropriate error otherwise
+ *
+ * The program must match exactly those nodes which interpret_chain()
+ * would match. Within a pass, the compounds tested against nodes moved to
+ * are memoised by the instruction moving to them.
+ */
+css_error run_program(css_select_ctx *ctx, const css_select_insn *program,
+		css_select_state *state, bool *match,
+		css_pseudo_element *pseudo_element)
 {
-	static const css_selector *empty_selector = NULL;
-	const uint32_t n_classes = state->n_classes;
-	uint32_t i = 0;
-	const css_selector **node_selectors = &empty_selector;
-	css_selector_hash_iterator node_iterator;
-	const css_selector **id_selectors = &empty_selector;
-	css_selector_hash_iterator id_iterator;
-	const css_selector ***class_selectors = NULL;
-	css_selector_hash_iterator class_iterator;
-	const css_selector **univ_selectors = &empty_selector;
-	css_selector_hash_iterator univ_iterator;
-	css_select_rule_source src = { CSS_SELECT_RULE_SRC_ELEMENT, 0 };
+	css_select_handler *handler = state->handler;
+	const css_select_insn *insn = program;
+	const css_select_insn *move = NULL;
+	css_pseudo_element pseudo = CSS_PSEUDO_ELEMENT_NONE;
+	css_select_memo_path path;
+	void *node = state->node;
 	css_error error;
 
-	/* Find hash chain that applies to current node */
-	error = css__selector_hash_find(sheet->selectors, 
-			&state->element, &node_iterator, 
-			&node_selectors);
-	if (error != CSS_OK)
-		goto cleanup;
+	path.n = 0;
 
-	if (state->classes != NULL && n_classes > 0) {
-		/* Find hash chains for node classes */
-		class_selectors = ctx->alloc(NULL, 
-				n_classes * sizeof(css_selector **), 
-				ctx->pw);
-		if (class_selectors == NULL) {
-			error = CSS_NOMEM;
-			goto cleanup;
-		}
+	while (true) {
+		bool m = false;
 
-		for (i = 0; i < n_classes; i++) {
-			error = css__selector_hash_find_by_class(
-					sheet->selectors, state->classes[i],
-					&class_iterator, &class_selectors[i]);
+		switch (insn->op) {
+		case CSS_OP_MATCH:
+			memo_resolve(ctx, &path, CSS_SELECT_MEMO_MATCH);
+			*match = true;
+			*pseudo_element = pseudo;
+			return CSS_OK;
+		case CSS_OP_PSEUDO_ELEMENT:
+			pseudo = insn->arg;
+			insn++;
+			continue;
+		case CSS_OP_ANCESTOR:
+			error = handler->named_ancestor_node(state->pw, node,
+					&insn->detail->qname, &node);
+			break;
+		case CSS_OP_PARENT:
+			error = handler->named_parent_node(state->pw, node,
+					&insn->detail->qname, &node);
+			break;
+		case CSS_OP_SIBLING:
+		case CSS_OP_GENERIC_SIBLING:
+		case CSS_OP_ANY_SIBLING:
+		case CSS_OP_ANY_GENERIC_SIBLING:
+			/* The node's siblings differ from those of any node
+			 * which might share its style, so sibling
+			 * combinators prevent it */
+			if (node == state->node)
+				state->share = NULL;
+
+			if (insn->op == CSS_OP_SIBLING) {
+				error = handler->named_sibling_node(state->pw,
+						node, &insn->detail->qname,
+						&node);
+			} else if (insn->op == CSS_OP_GENERIC_SIBLING) {
+				error = handler->named_generic_sibling_node(
+						state->pw, node,
+						&insn->detail->qname, &node);
+			} else {
+				error = handler->sibling_node(state->pw,
+						node, &node);
+			}
+			break;
+		case CSS_OP_ANY_ANCESTOR:
+		case CSS_OP_ANY_PARENT:
+			error = handler->parent_node(state->pw, node, &node);
+			break;
+		default:
+			/* Test the current node */
+			error = match_test(ctx, node, insn, state, &m);
 			if (error != CSS_OK)
-				goto cleanup;
+				return error;
+
+			if (m) {
+				insn++;
+				continue;
+			}
+
+			if (move != NULL)
+				memo_mismatch(ctx, &path, move, node);
+
+			/* Failed. Ancestors and generic siblings may be
+			 * sought beyond the node, but only adjacent nodes
+			 * are valid for other combinators, so give up. */
+			if (move == NULL || move_adjacent(move)) {
+				memo_resolve(ctx, &path,
+						CSS_SELECT_MEMO_REJECT);
+				*match = false;
+				return CSS_OK;
+			}
+
+			insn = move;
+			continue;
 		}
-	}
 
-	if (state->id != NULL) {
-		/* Find hash chain for node ID */
-		error = css__selector_hash_find_by_id(sheet->selectors, 
-				state->id, &id_iterator, &id_selectors);
+		/* Moved to another node */
 		if (error != CSS_OK)
-			goto cleanup;
-	}
+			return error;
 
-	/* Find hash chain for universal selector */
-	error = css__selector_hash_find_universal(sheet->selectors,
-			&univ_iterator, &univ_selectors);
-	if (error != CSS_OK)
-		goto cleanup;
+		/* No match for combinator, so reject selector chain */
+		if (node == NULL) {
+			memo_resolve(ctx, &path, CSS_SELECT_MEMO_REJECT);
+			*match = false;
+			return CSS_OK;
+		}
 
-	/* Process matching selectors, if any */
-	while (_selectors_pending(node_selectors, id_selectors, 
-			class_selectors, n_classes, univ_selectors)) {
-		const css_selector *selector;
+		/* Test the new node against the compound selector, unless
+		 * the outcome is already known */
+		move = insn;
+		insn++;
 
-		/* Selectors must be matched in ascending order of specificity
-		 * and rule index. (c.f. css__outranks_existing())
-		 *
-		 * Pick the least specific/earliest occurring selector.
-		 */
-		selector = _selector_next(node_selectors, id_selectors,
-				class_selectors, n_classes, univ_selectors,
-				&src);
-
-		/* We know there are selectors pending, so should have a
-		 * selector here */
-		assert(selector != NULL);
-
-		/* No bytecode if rule body is empty or wholly invalid --
-		 * Only interested in rules with bytecode */
-		if (((css_rule_selector *) selector->rule)->style != NULL) {
-			/* Ignore any selectors contained in rules which are a
-			 * child of an @media block that doesn't match the
-			 * current media requirements. */
-			if (_rule_applies_to_media(selector->rule,
-					state->media)) {
-				if (_rule_good_for_element_name(selector, &src,
-						state)) {
-					error = match_selector_chain(
-							ctx, selector,
-							state);
-					if (error != CSS_OK)
-						goto cleanup;
-				}
+		switch (memo_find(ctx, move, node)) {
+		case CSS_SELECT_MEMO_UNKNOWN:
+			memo_push(&path, move, node);
+			break;
+		case CSS_SELECT_MEMO_MISMATCH:
+			if (move_adjacent(move) == false) {
+				insn = move;
+				break;
 			}
+			/* Fall through */
+		case CSS_SELECT_MEMO_REJECT:
+			memo_resolve(ctx, &path, CSS_SELECT_MEMO_REJECT);
+			*match = false;
+			return CSS_OK;
+		case CSS_SELECT_MEMO_MATCH:
+			memo_resolve(ctx, &path, CSS_SELECT_MEMO_MATCH);
+			*match = true;
+			*pseudo_element = pseudo;
+			return CSS_OK;
 		}
+	}
+}
 
-		/* Advance to next selector in whichever chain we extracted 
-		 * the processed selector from. */
-		switch (src.source) {
-		case CSS_SELECT_RULE_SRC_ELEMENT:
-			error = node_iterator(
-					node_selectors,	&node_selectors);
-			break;
+/**
+ * Make one of a selector program's tests of a node
+ *
+ * \param ctx    Selection context
+ * \param node   Node to test
+ * \param insn   Instruction making test
+ * \param state  Selection state
+ * \param match  Pointer to location to receive result
+ * \return CSS_OK on success, appropriate error otherwise
+ */
+css_error match_test(css_select_ctx *ctx, void *node,
+		const css_select_insn *insn, css_select_state *state,
+		bool *match)
+{
+	css_select_handler *handler = state->handler;
+	const css_selector_detail *detail = insn->detail;
+	int32_t count = 0, other = 0;
+	bool is_root = false;
+	css_error error = CSS_OK;
 
-		case CSS_SELECT_RULE_SRC_ID:
-			error = id_iterator(
-					id_selectors, &id_selectors);
-			break;
+	*match = false;
 
-		case CSS_SELECT_RULE_SRC_UNIVERSAL:
-			error = univ_iterator(
-					univ_selectors, &univ_selectors);
+	switch (insn->op) {
+	case CSS_OP_CLASS:
+		error = handler->node_has_class(state->pw, node,
+				detail->qname.name, match);
+		break;
+	case CSS_OP_ID:
+		error = handler->node_has_id(state->pw, node,
+				detail->qname.name, match);
+		break;
+	case CSS_OP_NAME:
+		error = handler->node_has_name(state->pw, node,
+				&detail->qname, match);
+		break;
+	case CSS_OP_ATTRIBUTE:
+		error = handler->node_has_attribute(state->pw, node,
+				&detail->qname, match);
+		break;
+	case CSS_OP_ATTRIBUTE_EQUAL:
+		error = handler->node_has_attribute_equal(state->pw, node,
+				&detail->qname, detail->value.string, match);
+		break;
+	case CSS_OP_ATTRIBUTE_DASHMATCH:
+		error = handler->node_has_attribute_dashmatch(state->pw, node,
+				&detail->qname, detail->value.string, match);
+		break;
+	case CSS_OP_ATTRIBUTE_INCLUDES:
+		error = handler->node_has_attribute_includes(state->pw, node,
+				&detail->qname, detail->value.string, match);
+		break;
+	case CSS_OP_ATTRIBUTE_PREFIX:
+		error = handler->node_has_attribute_prefix(state->pw, node,
+				&detail->qname, detail->value.string, match);
+		break;
+	case CSS_OP_ATTRIBUTE_SUFFIX:
+		error = handler->node_has_attribute_suffix(state->pw, node,
+				&detail->qname, detail->value.string, match);
+		break;
+	case CSS_OP_ATTRIBUTE_SUBSTRING:
+		error = handler->node_has_attribute_substring(state->pw, node,
+				&detail->qname, detail->value.string, match);
+		break;
+	case CSS_OP_ROOT:
+		error = match_node_state(state, node, CSS_NODE_STATE_ROOT,
+				match);
+		break;
+	case CSS_OP_EMPTY:
+		error = match_node_state(state, node, CSS_NODE_STATE_EMPTY,
+				match);
+		break;
+	case CSS_OP_LINK:
+		error = match_node_state(state, node, CSS_NODE_STATE_LINK,
+				match);
+		break;
+	case CSS_OP_VISITED:
+		error = match_node_state(state, node, CSS_NODE_STATE_VISITED,
+				match);
+		break;
+	case CSS_OP_HOVER:
+		error = match_node_state(state, node, CSS_NODE_STATE_HOVER,
+				match);
+		break;
+	case CSS_OP_ACTIVE:
+		error = match_node_state(state, node, CSS_NODE_STATE_ACTIVE,
+				match);
+		break;
+	case CSS_OP_FOCUS:
+		error = match_node_state(state, node, CSS_NODE_STATE_FOCUS,
+				match);
+		break;
+	case CSS_OP_TARGET:
+		error = match_node_state(state, node, CSS_NODE_STATE_TARGET,
+				match);
+		break;
+	case CSS_OP_LANG:
+		error = handler->node_is_lang(state->pw, node,
+				detail->value.string, match);
+		break;
+	case CSS_OP_ENABLED:
+		error = match_node_state(state, node, CSS_NODE_STATE_ENABLED,
+				match);
+		break;
+	case CSS_OP_DISABLED:
+		error = match_node_state(state, node, CSS_NODE_STATE_DISABLED,
+				match);
+		break;
+	case CSS_OP_CHECKED:
+		error = match_node_state(state, node, CSS_NODE_STATE_CHECKED,
+				match);
+		break;
+	case CSS_OP_FIRST_CHILD:
+	case CSS_OP_LAST_CHILD:
+	case CSS_OP_ONLY_CHILD:
+	case CSS_OP_NTH_CHILD:
+	case CSS_OP_NTH_LAST_CHILD:
+	case CSS_OP_FIRST_OF_TYPE:
+	case CSS_OP_LAST_OF_TYPE:
+	case CSS_OP_ONLY_OF_TYPE:
+	case CSS_OP_NTH_OF_TYPE:
+	case CSS_OP_NTH_LAST_OF_TYPE:
+	{
+		const bool of_type = insn->op == CSS_OP_FIRST_OF_TYPE ||
+				insn->op == CSS_OP_LAST_OF_TYPE ||
+				insn->op == CSS_OP_ONLY_OF_TYPE ||
+				insn->op == CSS_OP_NTH_OF_TYPE ||
+				insn->op == CSS_OP_NTH_LAST_OF_TYPE;
+		const bool after = insn->op == CSS_OP_LAST_CHILD ||
+				insn->op == CSS_OP_NTH_LAST_CHILD ||
+				insn->op == CSS_OP_LAST_OF_TYPE ||
+				insn->op == CSS_OP_NTH_LAST_OF_TYPE;
+
+		/* The root element has no siblings to count */
+		error = match_node_state(state, node, CSS_NODE_STATE_ROOT,
+				&is_root);
+		if (error != CSS_OK || is_root)
 			break;
 
-		case CSS_SELECT_RULE_SRC_CLASS:
-			error = class_iterator(
-					class_selectors[src.class],
-					&class_selectors[src.class]);
+		error = count_siblings(ctx, state, node,
+				of_type, after, &count);
+		if (error != CSS_OK)
 			break;
+
+		if (insn->op == CSS_OP_ONLY_CHILD ||
+				insn->op == CSS_OP_ONLY_OF_TYPE) {
+			/* Those after must be counted too */
+			error = count_siblings(ctx, state, node,
+					of_type, true, &other);
+			if (error != CSS_OK)
+				break;
 		}
 
-		if (error != CSS_OK)
-			goto cleanup;
+		if (insn->op == CSS_OP_NTH_CHILD ||
+				insn->op == CSS_OP_NTH_LAST_CHILD ||
+				insn->op == CSS_OP_NTH_OF_TYPE ||
+				insn->op == CSS_OP_NTH_LAST_OF_TYPE) {
+			*match = match_nth(detail->value.nth.a,
+					detail->value.nth.b, count + 1);
+		} else {
+			*match = (count == 0 && other == 0);
+		}
+	}
+		break;
+	default:
+		/* Unsupported, so never matches */
+		break;
 	}
 
-	error = CSS_OK;
-cleanup:
-	if (class_selectors != NULL)
-		ctx->alloc(class_selectors, 0, ctx->pw);
-
-	return error;
-}
-
-static void update_reject_cache(css_select_state *state, 
-		css_combinator comb, const css_selector *s)
-{
-	const css_selector_detail *detail = &s->data;
-	const css_selector_detail *next_detail = NULL;
+	/* Invert match, if the test requests it */
+	if (error == CSS_OK && insn->negate != 0)
+		*match = !*match;
 
-	if (detail->next)
-		next_detail = detail + 1;
-
-	if (state->next_reject < state->reject_cache ||
-			comb != CSS_COMBINATOR_ANCESTOR ||
-			next_detail == NULL ||
-			next_detail->next != 0 ||
-			(next_detail->type != CSS_SELECTOR_CLASS &&
-			 next_detail->type != CSS_SELECTOR_ID))
-		return;
+	/* Beyond its name, classes and ID, anything we test about the node
+	 * itself must be revalidated before its style may be shared */
+	if (error == CSS_OK && state->share != NULL && node == state->node &&
+			detail->type != CSS_SELECTOR_ELEMENT &&
+			detail->type != CSS_SELECTOR_CLASS &&
+			detail->type != CSS_SELECTOR_ID &&
+			detail->type != CSS_SELECTOR_PSEUDO_ELEMENT)
+		error = share_record_test(ctx, detail, *match, state);
 
-	/* Insert */
-	state->next_reject->type = next_detail->type;
-	state->next_reject->value = next_detail->qname.name;
-	state->next_reject--;
+	return error;
 }
 
-css_error match_selector_chain(css_select_ctx *ctx, 
-		const css_selector *selector, css_select_state *state)
+/**
+ * Match a selector chain by interpreting its structure
+ *
+ * \param ctx             Selection context
+ * \param selector        Selector to match
+ * \param state           Selection state
+ * \param match           Pointer to location to receive result
+ * \param pseudo_element  Pointer to location to receive pseudo element
+ * \return CSS_OK on success, appropriate error otherwise
+ *
+ * This is the reference implementation of selector matching, used for
+ * selectors which have not been compiled. Within a pass, the selectors
+ * of the chain tested against nodes other than the node being selected
+ * for are memoised.
+ */
+css_error interpret_chain(css_select_ctx *ctx, const css_selector *selector,
+		css_select_state *state, bool *match,
+		css_pseudo_element *pseudo_element)
 {
 	const css_selector *s = selector;
 	void *node = state->node;
 	const css_selector_detail *detail = &s->data;
-	bool match = false, may_optimise = true;
-	bool rejected_by_cache;
-	css_pseudo_element pseudo;
+	css_select_memo_path path;
 	css_error error;
 
-#ifdef DEBUG_CHAIN_MATCHING
-	fprintf(stderr, "matching: ");
-	dump_chain(selector);
-	fprintf(stderr, "\n");
-#endif
+	path.n = 0;
 
 	/* Match the details of the first selector in the chain. 
 	 *
@@ -1536,58 +4630,62 @@ css_error match_selector_chain(css_select_ctx *ctx,
 	 * any selector chains containing pseudo elements anywhere 
 	 * else.
 	 */
-	error = match_details(ctx, node, detail, state, &match, &pseudo);
+	error = match_details(ctx, node, detail, state, match,
+			pseudo_element);
 	if (error != CSS_OK)
 		return error;
 
 	/* Details don't match, so reject selector chain */
-	if (match == false)
+	if (*match == false)
 		return CSS_OK;
 
 	/* Iterate up the selector chain, matching combinators */
 	do {
+		css_select_memo_result memo = CSS_SELECT_MEMO_UNKNOWN;
 		void *next_node = NULL;
 
+		/* The node's siblings differ from those of any node which 
+		 * might share its style, so sibling combinators prevent it */
+		if (node == state->node && 
+				(s->data.comb == CSS_COMBINATOR_SIBLING ||
+				s->data.comb == CSS_COMBINATOR_GENERIC_SIBLING))
+			state->share = NULL;
+
 		/* Consider any combinator on this selector */
 		if (s->data.comb != CSS_COMBINATOR_NONE &&
 				s->combinator->data.qname.name != 
 					ctx->universal) {
 			/* Named combinator */
-			may_optimise &= 
-				(s->data.comb == CSS_COMBINATOR_ANCESTOR || 
-				 s->data.comb == CSS_COMBINATOR_PARENT);
-
 			error = match_named_combinator(ctx, s->data.comb, 
-					s->combinator, state, node, &next_node);
+					s->combinator, state, node, &next_node,
+					&memo);
 			if (error != CSS_OK)
 				return error;
-
-			/* No match for combinator, so reject selector chain */
-			if (next_node == NULL)
-				return CSS_OK;
 		} else if (s->data.comb != CSS_COMBINATOR_NONE) {
 			/* Universal combinator */
-			may_optimise &= 
-				(s->data.comb == CSS_COMBINATOR_ANCESTOR || 
-				 s->data.comb == CSS_COMBINATOR_PARENT);
-
 			error = match_universal_combinator(ctx, s->data.comb, 
 					s->combinator, state, node, 
-					may_optimise, &rejected_by_cache,
-					&next_node);
+					&next_node, &memo);
 			if (error != CSS_OK)
 				return error;
+		}
 
-			/* No match for combinator, so reject selector chain */
-			if (next_node == NULL) {
-				if (may_optimise && s == selector &&
-						rejected_by_cache == false) {
-					update_reject_cache(state, s->data.comb,
-							s->combinator);
-				}
-
+		if (s->data.comb != CSS_COMBINATOR_NONE) {
+			/* No match for combinator, or the outcome of the rest
+			 * of the chain is known, so reject selector chain */
+			if (next_node == NULL ||
+					memo == CSS_SELECT_MEMO_REJECT) {
+				memo_resolve(ctx, &path,
+						CSS_SELECT_MEMO_REJECT);
+				*match = false;
 				return CSS_OK;
 			}
+
+			/* The rest of the chain is known to match */
+			if (memo == CSS_SELECT_MEMO_MATCH)
+				break;
+
+			memo_push(&path, s->combinator, next_node);
 		}
 
 		/* Details matched, so progress to combining selector */
@@ -1595,27 +4693,15 @@ css_error match_selector_chain(css_select_ctx *ctx,
 		node = next_node;
 	} while (s != NULL);
 
-	/* If we got here, then the entire selector chain matched, so cascade */
-	state->current_specificity = selector->specificity;
-
-	/* Ensure that the appropriate computed style exists */
-	if (state->results->styles[pseudo] == NULL) {
-		error = css_computed_style_create(ctx->alloc, ctx->pw, 
-				&state->results->styles[pseudo]); 
-		if (error != CSS_OK)
-			return error;
-	}
-
-	state->current_pseudo = pseudo;
-	state->computed = state->results->styles[pseudo];
+	/* If we got here, then the entire selector chain matched */
+	memo_resolve(ctx, &path, CSS_SELECT_MEMO_MATCH);
 
-	return cascade_style(((css_rule_selector *) selector->rule)->style, 
-			state);
+	return CSS_OK;
 }
 
 css_error match_named_combinator(css_select_ctx *ctx, css_combinator type,
 		const css_selector *selector, css_select_state *state, 
-		void *node, void **next_node)
+		void *node, void **next_node, css_select_memo_result *memo)
 {
 	const css_selector_detail *detail = &selector->data;
 	void *n = node;
@@ -1655,11 +4741,21 @@ css_error match_named_combinator(css_select_ctx *ctx, css_combinator type,
 		}
 
 		if (n != NULL) {
-			/* Match its details */
-			error = match_details(ctx, n, detail, state, 
-					&match, NULL);
-			if (error != CSS_OK)
-				return error;
+			/* Match its details, unless the outcome is known */
+			*memo = memo_find(ctx, selector, n);
+			if (*memo == CSS_SELECT_MEMO_UNKNOWN) {
+				error = match_details(ctx, n, detail, state,
+						&match, NULL);
+				if (error != CSS_OK)
+					return error;
+
+				if (match == false) {
+					memo_store(ctx, selector, n,
+						CSS_SELECT_MEMO_MISMATCH);
+				}
+			} else {
+				match = (*memo != CSS_SELECT_MEMO_MISMATCH);
+			}
 
 			/* If we found a match, use it */
 			if (match == true)
@@ -1681,47 +4777,12 @@ css_error match_named_combinator(css_select_ctx *ctx, css_combinator type,
 
 css_error match_universal_combinator(css_select_ctx *ctx, css_combinator type,
 		const css_selector *selector, css_select_state *state,
-		void *node, bool may_optimise, bool *rejected_by_cache,
-		void **next_node)
+		void *node, void **next_node, css_select_memo_result *memo)
 {
 	const css_selector_detail *detail = &selector->data;
-	const css_selector_detail *next_detail = NULL;
 	void *n = node;
 	css_error error;
 
-	if (detail->next)
-		next_detail = detail + 1;
-
-	*rejected_by_cache = false;
-
-	/* Consult reject cache first */
-	if (may_optimise && (type == CSS_COMBINATOR_ANCESTOR || 
-			     type == CSS_COMBINATOR_PARENT) && 
-			next_detail != NULL &&
-			(next_detail->type == CSS_SELECTOR_CLASS || 
-			 next_detail->type == CSS_SELECTOR_ID)) {
-		reject_item *reject = state->next_reject + 1;
-		reject_item *last = state->reject_cache +
-				N_ELEMENTS(state->reject_cache) - 1;
-		bool match = false;
-
-		while (reject <= last) {
-			/* Perform pessimistic matching (may hurt quirks) */
-			if (reject->type == next_detail->type &&
-					lwc_string_isequal(reject->value, 
-						next_detail->qname.name, 
-						&match) == lwc_error_ok &&
-				 	match) {
-				/* Found it: can't match */
-				*next_node = NULL;
-				*rejected_by_cache = true;
-				return CSS_OK;
-			}
-
-			reject++;
-		}
-	}
-
 	do {
 		bool match = false;
 
@@ -1744,11 +4805,21 @@ css_error match_universal_combinator(css_select_ctx *ctx, css_combinator type,
 		}
 
 		if (n != NULL) {
-			/* Match its details */
-			error = match_details(ctx, n, detail, state, 
-					&match, NULL);
-			if (error != CSS_OK)
-				return error;
+			/* Match its details, unless the outcome is known */
+			*memo = memo_find(ctx, selector, n);
+			if (*memo == CSS_SELECT_MEMO_UNKNOWN) {
+				error = match_details(ctx, n, detail, state,
+						&match, NULL);
+				if (error != CSS_OK)
+					return error;
+
+				if (match == false) {
+					memo_store(ctx, selector, n,
+						CSS_SELECT_MEMO_MISMATCH);
+				}
+			} else {
+				match = (*memo != CSS_SELECT_MEMO_MISMATCH);
+			}
 
 			/* If we found a match, use it */
 			if (match == true)
@@ -1815,23 +4886,6 @@ css_error match_details(css_select_ctx *ctx, void *node,
 	return CSS_OK;
 }
 
-static inline bool match_nth(int32_t a, int32_t b, int32_t count)
-{
-	if (a == 0) {
-		return count == b;
-	} else {
-		const int32_t delta = count - b;
-
-		/* (count - b) / a is positive or (count - b) is 0 */
-		if (((delta > 0) == (a > 0)) || delta == 0) {
-			/* (count - b) / a is integer */
-			return (delta % a == 0);
-		}
-
-		return false;
-	}
-}
-
 css_error match_detail(css_select_ctx *ctx, void *node, 
 		const css_selector_detail *detail, css_select_state *state, 
 		bool *match, css_pseudo_element *pseudo_element)
@@ -1858,7 +4912,8 @@ css_error match_detail(css_select_ctx *ctx, void *node,
 				detail->qname.name, match);
 		break;
 	case CSS_SELECTOR_PSEUDO_CLASS:
-		error = state->handler->node_is_root(state->pw, node, &is_root);
+		error = match_node_state(state, node, CSS_NODE_STATE_ROOT,
+				&is_root);
 		if (error != CSS_OK)
 			return error;
 
@@ -1866,7 +4921,7 @@ css_error match_detail(css_select_ctx *ctx, void *node,
 				detail->qname.name == ctx->first_child) {
 			int32_t num_before = 0;
 
-			error = state->handler->node_count_siblings(state->pw, 
+			error = count_siblings(ctx, state,
 					node, false, false, &num_before);
 			if (error == CSS_OK)
 				*match = (num_before == 0);
@@ -1874,7 +4929,7 @@ css_error match_detail(css_select_ctx *ctx, void *node,
 				detail->qname.name == ctx->nth_child) {
 			int32_t num_before = 0;
 
-			error = state->handler->node_count_siblings(state->pw, 
+			error = count_siblings(ctx, state,
 					node, false, false, &num_before);
 			if (error == CSS_OK) {
 				int32_t a = detail->value.nth.a;
@@ -1886,7 +4941,7 @@ css_error match_detail(css_select_ctx *ctx, void *node,
 				detail->qname.name == ctx->nth_last_child) {
 			int32_t num_after = 0;
 
-			error = state->handler->node_count_siblings(state->pw, 
+			error = count_siblings(ctx, state,
 					node, false, true, &num_after);
 			if (error == CSS_OK) {
 				int32_t a = detail->value.nth.a;
@@ -1898,7 +4953,7 @@ css_error match_detail(css_select_ctx *ctx, void *node,
 				detail->qname.name == ctx->nth_of_type) {
 			int32_t num_before = 0;
 
-			error = state->handler->node_count_siblings(state->pw, 
+			error = count_siblings(ctx, state,
 					node, true, false, &num_before);
 			if (error == CSS_OK) {
 				int32_t a = detail->value.nth.a;
@@ -1910,7 +4965,7 @@ css_error match_detail(css_select_ctx *ctx, void *node,
 				detail->qname.name == ctx->nth_last_of_type) {
 			int32_t num_after = 0;
 
-			error = state->handler->node_count_siblings(state->pw, 
+			error = count_siblings(ctx, state,
 					node, true, true, &num_after);
 			if (error == CSS_OK) {
 				int32_t a = detail->value.nth.a;
@@ -1922,7 +4977,7 @@ css_error match_detail(css_select_ctx *ctx, void *node,
 				detail->qname.name == ctx->last_child) {
 			int32_t num_after = 0;
 
-			error = state->handler->node_count_siblings(state->pw,
+			error = count_siblings(ctx, state,
 					node, false, true, &num_after);
 			if (error == CSS_OK)
 				*match = (num_after == 0);
@@ -1930,7 +4985,7 @@ css_error match_detail(css_select_ctx *ctx, void *node,
 				detail->qname.name == ctx->first_of_type) {
 			int32_t num_before = 0;
 
-			error = state->handler->node_count_siblings(state->pw, 
+			error = count_siblings(ctx, state,
 					node, true, false, &num_before);
 			if (error == CSS_OK)
 				*match = (num_before == 0);
@@ -1938,7 +4993,7 @@ css_error match_detail(css_select_ctx *ctx, void *node,
 				detail->qname.name == ctx->last_of_type) {
 			int32_t num_after = 0;
 
-			error = state->handler->node_count_siblings(state->pw, 
+			error = count_siblings(ctx, state,
 					node, true, true, &num_after);
 			if (error == CSS_OK)
 				*match = (num_after == 0);
@@ -1946,12 +5001,11 @@ css_error match_detail(css_select_ctx *ctx, void *node,
 				detail->qname.name == ctx->only_child) {
 			int32_t num_before = 0, num_after = 0;
 
-			error = state->handler->node_count_siblings(state->pw, 
+			error = count_siblings(ctx, state,
 					node, false, false, &num_before);
 			if (error == CSS_OK) {
-				error = state->handler->node_count_siblings(
-						state->pw, node, false, true,
-						&num_after);
+				error = count_siblings(ctx, state,
+						node, false, true, &num_after);
 				if (error == CSS_OK)
 					*match = (num_before == 0) && 
 							(num_after == 0);
@@ -1960,12 +5014,11 @@ css_error match_detail(css_select_ctx *ctx, void *node,
 				detail->qname.name == ctx->only_of_type) {
 			int32_t num_before = 0, num_after = 0;
 
-			error = state->handler->node_count_siblings(state->pw, 
+			error = count_siblings(ctx, state,
 					node, true, false, &num_before);
 			if (error == CSS_OK) {
-				error = state->handler->node_count_siblings(
-						state->pw, node, true, true,
-						&num_after);
+				error = count_siblings(ctx, state,
+						node, true, true, &num_after);
 				if (error == CSS_OK)
 					*match = (num_before == 0) && 
 							(num_after == 0);
@@ -1973,38 +5026,38 @@ css_error match_detail(css_select_ctx *ctx, void *node,
 		} else if (detail->qname.name == ctx->root) {
 			*match = is_root;
 		} else if (detail->qname.name == ctx->empty) {
-			error = state->handler->node_is_empty(state->pw,
-					node, match);
+			error = match_node_state(state, node,
+					CSS_NODE_STATE_EMPTY, match);
 		} else if (detail->qname.name == ctx->link) {
-			error = state->handler->node_is_link(state->pw,
-					node, match);
+			error = match_node_state(state, node,
+					CSS_NODE_STATE_LINK, match);
 		} else if (detail->qname.name == ctx->visited) {
-			error = state->handler->node_is_visited(state->pw,
-					node, match);
+			error = match_node_state(state, node,
+					CSS_NODE_STATE_VISITED, match);
 		} else if (detail->qname.name == ctx->hover) {
-			error = state->handler->node_is_hover(state->pw,
-					node, match);
+			error = match_node_state(state, node,
+					CSS_NODE_STATE_HOVER, match);
 		} else if (detail->qname.name == ctx->active) {
-			error = state->handler->node_is_active(state->pw,
-					node, match);
+			error = match_node_state(state, node,
+					CSS_NODE_STATE_ACTIVE, match);
 		} else if (detail->qname.name == ctx->focus) {
-			error = state->handler->node_is_focus(state->pw,
-					node, match);
+			error = match_node_state(state, node,
+					CSS_NODE_STATE_FOCUS, match);
 		} else if (detail->qname.name == ctx->target) {
-			error = state->handler->node_is_target(state->pw,
-					node, match);
+			error = match_node_state(state, node,
+					CSS_NODE_STATE_TARGET, match);
 		} else if (detail->qname.name == ctx->lang) {
 			error = state->handler->node_is_lang(state->pw,
 					node, detail->value.string, match);
 		} else if (detail->qname.name == ctx->enabled) {
-			error = state->handler->node_is_enabled(state->pw,
-					node, match);
+			error = match_node_state(state, node,
+					CSS_NODE_STATE_ENABLED, match);
 		} else if (detail->qname.name == ctx->disabled) {
-			error = state->handler->node_is_disabled(state->pw,
-					node, match);
+			error = match_node_state(state, node,
+					CSS_NODE_STATE_DISABLED, match);
 		} else if (detail->qname.name == ctx->checked) {
-			error = state->handler->node_is_checked(state->pw,
-					node, match);
+			error = match_node_state(state, node,
+					CSS_NODE_STATE_CHECKED, match);
 		} else
 			*match = false;
 		break;
@@ -2062,6 +5115,15 @@ css_error match_detail(css_select_ctx *ctx, void *node,
 	if (error == CSS_OK && detail->negate != 0)
 		*match = !*match;
 
+	/* Beyond its name, classes and ID, anything we test about the node
+	 * itself must be revalidated before its style may be shared */
+	if (error == CSS_OK && state->share != NULL && node == state->node &&
+			detail->type != CSS_SELECTOR_ELEMENT &&
+			detail->type != CSS_SELECTOR_CLASS &&
+			detail->type != CSS_SELECTOR_ID &&
+			detail->type != CSS_SELECTOR_PSEUDO_ELEMENT)
+		error = share_record_test(ctx, detail, *match, state);
+
 	return error;
 }
 
@@ -2089,7 +5151,7 @@ css_error cascade_style(const css_style *style, css_select_state *state)
 bool css__outranks_existing(uint16_t op, bool important, css_select_state *state,
 		bool inherit)
 {
-	prop_state *existing = &state->props[op][state->current_pseudo];
+	prop_state *existing = &state->props[state->current_pseudo][op];
 	bool outranks = false;
 
 	/* Sorting on origin & importance gives the following:
@@ -2128,7 +5190,7 @@ bool css__outranks_existing(uint16_t op, bool important, css_select_state *state
 	 * is greater than or equal to that of the existing property.
 	 */
 
-	if (existing->set == 0) {
+	if (prop_touched(state, state->current_pseudo, op) == false) {
 		/* Property hasn't been set before, new one wins */
 		outranks = true;
 	} else {
@@ -2178,7 +5240,7 @@ bool css__outranks_existing(uint16_t op, bool important, css_select_state *state
 	if (outranks) {
 		/* The new property is about to replace the old one.
 		 * Update our state to reflect this. */
-		existing->set = 1;
+		existing = prop_touch(state, state->current_pseudo, op);
 		existing->specificity = state->current_specificity;
 		existing->origin = state->current_origin;
 		existing->important = important;
@@ -14,19 +14,27 @@
 #include <libcss/select.h>
 
 #include "stylesheet.h"
+#include "select/bloom.h"
+
+typedef struct css_select_share_entry css_select_share_entry;
+
+/* Number of nodes whose state is cached during a selection */
+#define CSS_SELECT_NODE_STATES 16
 
 /**
- * Item in the reject cache (only class and id types are valid)
+ * Cached state of a node, as reported by the client
  */
-typedef struct reject_item {
-	lwc_string *value;
-	css_selector_type type;
-} reject_item;
+typedef struct css_select_node_state {
+	void *node;			/* Node, or NULL if entry unused */
+	uint32_t flags;			/* Node's css_node_state_flags */
+} css_select_node_state;
+
+/* Number of words in a bitmap of properties */
+#define CSS_PROP_WORDS ((CSS_N_PROPERTIES + 31) / 32)
 
 typedef struct prop_state {
 	uint32_t specificity;		/* Specificity of property in result */
-	unsigned int set       : 1,	/* Whether property is set in result */
-	             origin    : 2,	/* Origin of property in result */
+	unsigned int origin    : 2,	/* Origin of property in result */
 	             important : 1,	/* Importance of property in result */
 	             inherit   : 1;	/* Property is set to inherit */
 } prop_state;
@@ -37,7 +45,10 @@ typedef struct prop_state {
 typedef struct css_select_state {
 	void *node;			/* Node we're selecting for */
 	uint64_t media;			/* Currently active media types */
+	uint32_t pseudo_mask;		/* Pseudo elements to select for */
 	css_select_results *results;	/* Result set to populate */
+	/* Styles set aside from a reused result set, to be reused */
+	css_computed_style *spare[CSS_PSEUDO_ELEMENT_COUNT];
 
 	css_pseudo_element current_pseudo;	/* Current pseudo element */
 	css_computed_style *computed;	/* Computed style to populate */
@@ -54,13 +65,60 @@ typedef struct css_select_state {
 	lwc_string *id;			/* Node id, if any */
 	lwc_string **classes;		/* Node classes, if any */
 	uint32_t n_classes;		/* Number of classes */
+	lwc_string **attributes;	/* Names of node attributes, if known */
+	uint32_t n_attributes;		/* Number of attribute names */
+	bool attributes_known;		/* Whether attribute names are known */
+	uint32_t keyed_state;		/* Node states to find selectors by */
+
+	const css_bloom *bloom;		/* Ancestor filter, or NULL */
+
+	css_select_share_entry *share;	/* Sharing entry to record in, or NULL */
 
-	reject_item reject_cache[128];	/* Reject cache (filled from end) */
-	reject_item *next_reject;	/* Next free slot in reject cache */
+	/* State of the node we're selecting for, and whether it's known */
+	bool node_state_valid;
+	uint32_t node_state;
+	/* States of other nodes considered, indexed by address */
+	css_select_node_state node_states[CSS_SELECT_NODE_STATES];
 
-	prop_state props[CSS_N_PROPERTIES][CSS_PSEUDO_ELEMENT_COUNT];
+	/* Properties set in each pseudo element's result, as bitmaps */
+	uint32_t touched[CSS_PSEUDO_ELEMENT_COUNT][CSS_PROP_WORDS];
+
+	/* State of each property set in a result. Entries are valid only
+	 * once the property is touched, so need no initialisation. This
+	 * must remain the last member. */
+	prop_state props[CSS_PSEUDO_ELEMENT_COUNT][CSS_N_PROPERTIES];
 } css_select_state;
 
+/**
+ * Determine whether a property has been set in a pseudo element's result
+ *
+ * \param state   Selection state
+ * \param pseudo  Pseudo element
+ * \param prop    Property to consider
+ * \return True if the property is set, false otherwise
+ */
+static inline bool prop_touched(const css_select_state *state,
+		css_pseudo_element pseudo, uint32_t prop)
+{
+	return (state->touched[pseudo][prop >> 5] & (1u << (prop & 31))) != 0;
+}
+
+/**
+ * Mark a property as set in a pseudo element's result
+ *
+ * \param state   Selection state
+ * \param pseudo  Pseudo element
+ * \param prop    Property to mark
+ * \return Pointer to the property's state, to be filled in
+ */
+static inline prop_state *prop_touch(css_select_state *state,
+		css_pseudo_element pseudo, uint32_t prop)
+{
+	state->touched[pseudo][prop >> 5] |= 1u << (prop & 31);
+
+	return &state->props[pseudo][prop];
+}
+
 static inline void advance_bytecode(css_style *style, uint32_t n_bytes)
 {
 	style->used -= (n_bytes / sizeof(css_code_t));
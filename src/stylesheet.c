@@ -14,12 +14,21 @@
 #include "parse/language.h"
 #include "utils/parserutilserror.h"
 #include "utils/utils.h"
+#include "select/bloom.h"
 #include "select/dispatch.h"
 #include "select/font_face.h"
+#include "select/program.h"
 
 static css_error _add_selectors(css_stylesheet *sheet, css_rule *rule);
 static css_error _remove_selectors(css_stylesheet *sheet, css_rule *rule);
+#ifndef CSS_SELECT_INTERPRETER
+static css_error _compile_selectors(css_stylesheet *sheet, css_rule *rule);
+#endif
+static uint64_t _rule_media(const css_rule *rule);
+static void _set_rule_media(css_rule *rule, uint64_t media);
 static size_t _rule_size(const css_rule *rule);
+static uint32_t _pseudo_class_state(const css_stylesheet *sheet,
+		lwc_string *name);
 
 /**
  * Add a string to a stylesheet's string vector.
@@ -203,6 +212,9 @@ css_error css_stylesheet_create(const css_stylesheet_params *params,
 		return error;
 	}
 
+	/* Selectors are hashed in bulk, once parsing is complete */
+	css__selector_hash_defer(sheet->selectors);
+
 	len = strlen(params->url) + 1;
 	sheet->url = alloc(NULL, len, alloc_pw);
 	if (sheet->url == NULL) {
@@ -343,7 +355,7 @@ css_error css_stylesheet_append_data(css_stylesheet *sheet,
  */
 css_error css_stylesheet_data_done(css_stylesheet *sheet)
 {
-	const css_rule *r;
+	css_rule *r;
 	css_error error;
 
 	if (sheet == NULL)
@@ -369,6 +381,21 @@ css_error css_stylesheet_data_done(css_stylesheet *sheet)
 		sheet->cached_style = NULL;
 	}
 
+	/* Hash the selectors parsed */
+	error = css__selector_hash_build(sheet->selectors);
+	if (error != CSS_OK)
+		return error;
+
+#ifndef CSS_SELECT_INTERPRETER
+	/* Compile the selectors, now that they are complete. Otherwise,
+	 * selection interprets them directly. */
+	for (r = sheet->rule_list; r != NULL; r = r->next) {
+		error = _compile_selectors(sheet, r);
+		if (error != CSS_OK)
+			return error;
+	}
+#endif
+
 	/* Determine if there are any pending imports */
 	for (r = sheet->rule_list; r != NULL; r = r->next) {
 		const css_rule_import *i = (const css_rule_import *) r;
@@ -839,6 +866,16 @@ css_error css__stylesheet_selector_create(css_stylesheet *sheet,
 			sel->specificity = 0;
 	}
 
+	/* A matching node must have the element's name */
+	if (lwc_string_length(qname->name) != 1 ||
+			lwc_string_data(qname->name)[0] != '*') {
+		sel->fingerprint = css_bloom_fingerprint(
+				css_bloom_hash(qname->name));
+	}
+
+	/* Until its rule is added to the sheet, it applies to all media */
+	sel->media = CSS_MEDIA_ALL;
+
 	sel->data.comb = CSS_COMBINATOR_NONE;
 
 	*selector = sel;
@@ -906,6 +943,10 @@ css_error css__stylesheet_selector_destroy(css_stylesheet *sheet,
 	}
 		     
 	
+	/* Destroy its program */
+	if (selector->program != NULL)
+		sheet->alloc(selector->program, 0, sheet->pw);
+
 	/* Destroy this selector */
 	sheet->alloc(selector, 0, sheet->pw);
 
@@ -1020,6 +1061,38 @@ css_error css__stylesheet_selector_append_specific(css_stylesheet *sheet,
 		break;
 	}
 
+	/* And its fingerprint, if a matching node must have the ID or
+	 * class */
+	if (detail->negate == 0 && (detail->type == CSS_SELECTOR_CLASS ||
+			detail->type == CSS_SELECTOR_ID)) {
+		(*parent)->fingerprint |= css_bloom_fingerprint(
+				css_bloom_hash(detail->qname.name));
+	}
+
+	/* And the state a matching node must have */
+	if (detail->negate == 0 && detail->type == CSS_SELECTOR_PSEUDO_CLASS) {
+		(*parent)->node_state |= _pseudo_class_state(sheet,
+				detail->qname.name);
+	}
+
+	/* And the pseudo element it selects. As in matching, the last
+	 * pseudo element given takes effect. */
+	if (detail->type == CSS_SELECTOR_PSEUDO_ELEMENT) {
+		lwc_string **strings = sheet->propstrings;
+		lwc_string *name = detail->qname.name;
+
+		if (name == strings[FIRST_LINE])
+			(*parent)->pseudo_element =
+					CSS_PSEUDO_ELEMENT_FIRST_LINE;
+		else if (name == strings[FIRST_LETTER])
+			(*parent)->pseudo_element =
+					CSS_PSEUDO_ELEMENT_FIRST_LETTER;
+		else if (name == strings[BEFORE])
+			(*parent)->pseudo_element = CSS_PSEUDO_ELEMENT_BEFORE;
+		else if (name == strings[AFTER])
+			(*parent)->pseudo_element = CSS_PSEUDO_ELEMENT_AFTER;
+	}
+
 	return CSS_OK;
 }
 
@@ -1040,6 +1113,7 @@ css_error css__stylesheet_selector_combine(css_stylesheet *sheet,
 		css_combinator type, css_selector *a, css_selector *b)
 {
 	const css_selector_detail *det;
+	uint32_t n = 0, i;
 
 	if (sheet == NULL || a == NULL || b == NULL)
 		return CSS_BADPARM;
@@ -1061,6 +1135,35 @@ css_error css__stylesheet_selector_combine(css_stylesheet *sheet,
 	/* And propagate A's specificity to B */
 	b->specificity += a->specificity;
 
+	/* Any node matching A is an ancestor of one matching B, so A's 
+	 * name, IDs and classes must be in B's ancestor filter. */
+	if (type == CSS_COMBINATOR_ANCESTOR || type == CSS_COMBINATOR_PARENT) {
+		for (det = &a->data; det != NULL && 
+				n < CSS_SELECTOR_ANCESTOR_HASHES; ) {
+			if (det->negate == 0 && 
+					(det->type == CSS_SELECTOR_CLASS ||
+					det->type == CSS_SELECTOR_ID ||
+					(det->type == CSS_SELECTOR_ELEMENT && 
+					(lwc_string_length(
+						det->qname.name) != 1 ||
+					lwc_string_data(
+						det->qname.name)[0] != '*')))) {
+				b->ancestor_hashes[n++] = 
+						css_bloom_hash(det->qname.name);
+			}
+
+			det = (det->next != 0) ? det + 1 : NULL;
+		}
+	}
+
+	/* As must anything required of A's own ancestors, regardless of 
+	 * the combinator, as siblings share ancestors. */
+	for (i = 0; i < CSS_SELECTOR_ANCESTOR_HASHES && 
+			a->ancestor_hashes[i] != 0 &&
+			n < CSS_SELECTOR_ANCESTOR_HASHES; i++) {
+		b->ancestor_hashes[n++] = a->ancestor_hashes[i];
+	}
+
 	return CSS_OK;
 }
 
@@ -1384,6 +1487,10 @@ css_error css__stylesheet_rule_set_media(css_stylesheet *sheet,
 	/* Set the rule's media */
 	r->media = media;
 
+	/* And that of any selectors it already contains */
+	_set_rule_media(rule, _rule_media(
+			rule->ptype == CSS_RULE_PARENT_RULE ? rule->parent : NULL));
+
 	return CSS_OK;
 }
 
@@ -1438,6 +1545,10 @@ css_error css__stylesheet_add_rule(css_stylesheet *sheet, css_rule *rule,
 	 */
 	rule->index = sheet->rule_count;
 
+	/* Record the media to which the rule's selectors apply, so that
+	 * selection need not consider any enclosing @media blocks */
+	_set_rule_media(rule, _rule_media(parent));
+
 	/* Add any selectors to the hash */
 	error = _add_selectors(sheet, rule);
 	if (error != CSS_OK)
@@ -1649,6 +1760,106 @@ css_error _remove_selectors(css_stylesheet *sheet, css_rule *rule)
 	return CSS_OK;
 }
 
+#ifndef CSS_SELECT_INTERPRETER
+/**
+ * Compile the selectors in a rule
+ *
+ * \param sheet	 Stylesheet containing rule
+ * \param rule	 Rule to consider
+ * \return CSS_OK on success, appropriate error otherwise
+ */
+css_error _compile_selectors(css_stylesheet *sheet, css_rule *rule)
+{
+	css_error error;
+
+	switch (rule->type) {
+	case CSS_RULE_SELECTOR:
+	{
+		css_rule_selector *s = (css_rule_selector *) rule;
+		int32_t i;
+
+		for (i = 0; i < rule->items; i++) {
+			error = css__selector_compile(sheet, s->selectors[i]);
+			if (error != CSS_OK)
+				return error;
+		}
+	}
+		break;
+	case CSS_RULE_MEDIA:
+	{
+		css_rule_media *m = (css_rule_media *) rule;
+		css_rule *r;
+
+		for (r = m->first_child; r != NULL; r = r->next) {
+			error = _compile_selectors(sheet, r);
+			if (error != CSS_OK)
+				return error;
+		}
+	}
+		break;
+	}
+
+	return CSS_OK;
+}
+#endif
+
+/**
+ * Determine the media to which the contents of a rule apply
+ *
+ * \param rule  Rule to consider, or NULL for the top level of a sheet
+ * \return Media types
+ *
+ * The media are those of the rule and any @media blocks containing it.
+ */
+uint64_t _rule_media(const css_rule *rule)
+{
+	uint64_t media = CSS_MEDIA_ALL;
+
+	while (rule != NULL) {
+		if (rule->type == CSS_RULE_MEDIA)
+			media &= ((const css_rule_media *) rule)->media;
+
+		if (rule->ptype == CSS_RULE_PARENT_RULE)
+			rule = rule->parent;
+		else
+			rule = NULL;
+	}
+
+	return media;
+}
+
+/**
+ * Record the media to which the selectors in a rule apply
+ *
+ * \param rule   Rule to consider
+ * \param media  Media to which the rule's context applies
+ */
+void _set_rule_media(css_rule *rule, uint64_t media)
+{
+	switch (rule->type) {
+	case CSS_RULE_SELECTOR:
+	{
+		css_rule_selector *s = (css_rule_selector *) rule;
+		int32_t i;
+
+		for (i = 0; i < rule->items; i++)
+			s->selectors[i]->media = media;
+	}
+		break;
+	case CSS_RULE_MEDIA:
+	{
+		css_rule_media *m = (css_rule_media *) rule;
+		css_rule *r;
+
+		for (r = m->first_child; r != NULL; r = r->next)
+			_set_rule_media(r, media & m->media);
+	}
+		break;
+	default:
+		break;
+	}
+}
+
 /**
  * Calculate the size of a rule
  *
@@ -1671,6 +1882,17 @@ size_t _rule_size(const css_rule *r)
 		bytes += r->items * sizeof(css_selector *);
 		for (i = 0; i < r->items; i++) {
 			const css_selector *s = rs->selectors[i];
+			const css_select_insn *insn = s->program;
+
+			/* And any program, up to its final instruction */
+			if (insn != NULL) {
+				while (insn->op != CSS_OP_MATCH) {
+					bytes += sizeof(css_select_insn);
+					insn++;
+				}
+
+				bytes += sizeof(css_select_insn);
+			}
 
 			do {
 				const css_selector_detail *d = &s->data;
@@ -1732,3 +1954,41 @@ size_t _rule_size(const css_rule *r)
 
 	return bytes;
 }
+
+/**
+ * Determine the node state required by a pseudo class
+ *
+ * \param sheet  Stylesheet containing the pseudo class
+ * \param name   Name of the pseudo class
+ * \return Mask of css_node_state_flags, or 0 if the pseudo class does not
+ *         depend upon the node's state alone
+ */
+uint32_t _pseudo_class_state(const css_stylesheet *sheet, lwc_string *name)
+{
+	lwc_string **strings = sheet->propstrings;
+
+	if (name == strings[ROOT])
+		return CSS_NODE_STATE_ROOT;
+	else if (name == strings[EMPTY])
+		return CSS_NODE_STATE_EMPTY;
+	else if (name == strings[LINK])
+		return CSS_NODE_STATE_LINK;
+	else if (name == strings[VISITED])
+		return CSS_NODE_STATE_VISITED;
+	else if (name == strings[HOVER])
+		return CSS_NODE_STATE_HOVER;
+	else if (name == strings[ACTIVE])
+		return CSS_NODE_STATE_ACTIVE;
+	else if (name == strings[FOCUS])
+		return CSS_NODE_STATE_FOCUS;
+	else if (name == strings[ENABLED])
+		return CSS_NODE_STATE_ENABLED;
+	else if (name == strings[DISABLED])
+		return CSS_NODE_STATE_DISABLED;
+	else if (name == strings[CHECKED])
+		return CSS_NODE_STATE_CHECKED;
+	else if (name == strings[TARGET])
+		return CSS_NODE_STATE_TARGET;
+
+	return 0;
+}
@@ -24,6 +24,7 @@
 
 typedef struct css_rule css_rule;
 typedef struct css_selector css_selector;
+typedef struct css_select_insn css_select_insn;
 
 typedef struct css_style {
 	css_code_t *bytecode;	      /**< Pointer to bytecode */
@@ -91,6 +92,29 @@ struct css_selector {
 #define CSS_SPECIFICITY_D 0x00000001
 	uint32_t specificity;			/**< Specificity of selector */
 
+#define CSS_SELECTOR_ANCESTOR_HASHES 4
+	/** Ancestor filter hashes of names, IDs and classes which must be 
+	 * present amongst the ancestors of a matching node (0 terminated, 
+	 * unless full) */
+	uint32_t ancestor_hashes[CSS_SELECTOR_ANCESTOR_HASHES];
+
+	/** Fingerprint of the name, IDs and classes which a matching node
+	 * must have (c.f. css_bloom_fingerprint()) */
+	uint64_t fingerprint;
+
+	/** Mask of css_node_state_flags which a matching node must have */
+	uint32_t node_state;
+
+	/** Pseudo element the selector selects, which determines the
+	 * partition of a selector hash it is held in (css_pseudo_element) */
+	uint8_t pseudo_element;
+
+	/** Program compiled from the selector, for selection, or NULL */
+	css_select_insn *program;
+
+	/** Media to which the selector's rule applies, within its sheet */
+	uint64_t media;
+
 	css_selector_detail data;		/**< Selector data */
 };
 
@@ -0,0 +1,112 @@
+/*
+ * The reads of computed styles made by a box layout pass, for the computed
+ * style accessor benchmark.
+ *
+ * select-accessors.c includes this to read styles with the library's
+ * exported accessors, and select-accessors-inline.c to read them with the
+ * inline ones. READ_STYLES names the function defined.
+ */
+
+#ifndef test_accessors_h_
+#define test_accessors_h_
+
+#include <libcss/computed.h>
+
+#define MIX(sum, value) ((sum) = (sum) * 31 + (uint32_t) (value))
+
+/**
+ * Read the properties a layout pass needs of a sequence of boxes
+ *
+ * \param styles    Computed style of each box
+ * \param n_styles  Number of boxes
+ * \return Checksum of the values read
+ */
+uint32_t READ_STYLES(css_computed_style * const *styles, uint32_t n_styles)
+{
+	uint32_t sum = 0;
+	uint32_t i;
+
+	for (i = 0; i < n_styles; i++) {
+		const css_computed_style *style = styles[i];
+		css_fixed length = 0;
+		css_unit unit = CSS_UNIT_PX;
+		css_color color = 0;
+		int32_t z_index = 0;
+
+		MIX(sum, css_computed_display(style, false));
+		MIX(sum, css_computed_position(style));
+		MIX(sum, css_computed_float(style));
+		MIX(sum, css_computed_clear(style));
+		MIX(sum, css_computed_overflow(style));
+		MIX(sum, css_computed_white_space(style));
+		MIX(sum, css_computed_text_align(style));
+		MIX(sum, css_computed_visibility(style));
+
+		MIX(sum, css_computed_width(style, &length, &unit));
+		MIX(sum, length + unit);
+		MIX(sum, css_computed_height(style, &length, &unit));
+		MIX(sum, length + unit);
+		MIX(sum, css_computed_min_width(style, &length, &unit));
+		MIX(sum, length + unit);
+		MIX(sum, css_computed_max_width(style, &length, &unit));
+		MIX(sum, length + unit);
+
+		MIX(sum, css_computed_top(style, &length, &unit));
+		MIX(sum, length + unit);
+		MIX(sum, css_computed_right(style, &length, &unit));
+		MIX(sum, length + unit);
+		MIX(sum, css_computed_bottom(style, &length, &unit));
+		MIX(sum, length + unit);
+		MIX(sum, css_computed_left(style, &length, &unit));
+		MIX(sum, length + unit);
+
+		MIX(sum, css_computed_margin_top(style, &length, &unit));
+		MIX(sum, length + unit);
+		MIX(sum, css_computed_margin_right(style, &length, &unit));
+		MIX(sum, length + unit);
+		MIX(sum, css_computed_margin_bottom(style, &length, &unit));
+		MIX(sum, length + unit);
+		MIX(sum, css_computed_margin_left(style, &length, &unit));
+		MIX(sum, length + unit);
+
+		MIX(sum, css_computed_padding_top(style, &length, &unit));
+		MIX(sum, length + unit);
+		MIX(sum, css_computed_padding_right(style, &length, &unit));
+		MIX(sum, length + unit);
+		MIX(sum, css_computed_padding_bottom(style, &length, &unit));
+		MIX(sum, length + unit);
+		MIX(sum, css_computed_padding_left(style, &length, &unit));
+		MIX(sum, length + unit);
+
+		MIX(sum, css_computed_border_top_style(style));
+		MIX(sum, css_computed_border_top_width(style, &length, &unit));
+		MIX(sum, length + unit);
+		MIX(sum, css_computed_border_left_style(style));
+		MIX(sum, css_computed_border_left_width(style, &length, &unit));
+		MIX(sum, length + unit);
+
+		MIX(sum, css_computed_font_size(style, &length, &unit));
+		MIX(sum, length + unit);
+		MIX(sum, css_computed_line_height(style, &length, &unit));
+		MIX(sum, length + unit);
+		MIX(sum, css_computed_text_indent(style, &length, &unit));
+		MIX(sum, length + unit);
+		MIX(sum, css_computed_letter_spacing(style, &length, &unit));
+		MIX(sum, length + unit);
+		MIX(sum, css_computed_vertical_align(style, &length, &unit));
+		MIX(sum, length + unit);
+
+		MIX(sum, css_computed_color(style, &color));
+		MIX(sum, color);
+		MIX(sum, css_computed_background_color(style, &color));
+		MIX(sum, color);
+		MIX(sum, css_computed_z_index(style, &z_index));
+		MIX(sum, z_index);
+	}
+
+	return sum;
+}
+
+#undef MIX
+
+#endif
@@ -0,0 +1,14 @@
+/*
+ * Computed style accessor benchmark: reads with inline accessors
+ */
+
+#define CSS_COMPUTED_INLINE
+
+#include <libcss/libcss.h>
+
+#define READ_STYLES read_styles_inline
+
+uint32_t read_styles_inline(css_computed_style * const *styles,
+		uint32_t n_styles);
+
+#include "accessors.h"
@@ -0,0 +1,211 @@
+/*
+ * Computed style accessor benchmark
+ *
+ * Reads the properties a layout pass needs of many boxes, first with the
+ * library's exported accessors and then with the inline ones which clients
+ * get by defining CSS_COMPUTED_INLINE. Both must read the same values.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <libcss/libcss.h>
+
+#include "select/computed.h"
+#include "select/propset.h"
+#include "utils/utils.h"
+
+#include "testutils.h"
+
+#define READ_STYLES read_styles
+
+uint32_t read_styles(css_computed_style * const *styles, uint32_t n_styles);
+uint32_t read_styles_inline(css_computed_style * const *styles,
+		uint32_t n_styles);
+
+#include "accessors.h"
+
+/* Number of distinct styles, and of boxes using them */
+#define N_STYLES 64
+#define N_BOXES 4096
+
+/* Number of times the boxes are read */
+#define N_ITERATIONS 200
+
+static uint32_t seed = 1;
+
+static void *myrealloc(void *data, size_t len, void *pw);
+static css_error compute_font_size(void *pw, const css_hint *parent,
+		css_hint *size);
+static css_computed_style *create_style(const css_computed_style *parent);
+static uint32_t next_random(uint32_t range);
+static double now(void);
+
+int main(int argc, char **argv)
+{
+	static css_computed_style *styles[N_STYLES];
+	static css_computed_style *boxes[N_BOXES];
+	css_computed_style *root;
+	uint32_t sum = 0, sum_inline = 0;
+	double start, elapsed, elapsed_inline;
+	uint32_t i;
+
+	UNUSED(argc);
+	UNUSED(argv);
+
+	root = create_style(NULL);
+
+	for (i = 0; i < N_STYLES; i++)
+		styles[i] = create_style(root);
+
+	for (i = 0; i < N_BOXES; i++)
+		boxes[i] = styles[next_random(N_STYLES)];
+
+	/* The same values are read either way */
+	assert(read_styles(boxes, N_BOXES) ==
+			read_styles_inline(boxes, N_BOXES));
+
+	start = now();
+
+	for (i = 0; i < N_ITERATIONS; i++)
+		sum += read_styles(boxes, N_BOXES);
+
+	elapsed = now() - start;
+
+	start = now();
+
+	for (i = 0; i < N_ITERATIONS; i++)
+		sum_inline += read_styles_inline(boxes, N_BOXES);
+
+	elapsed_inline = now() - start;
+
+	assert(sum == sum_inline);
+
+	printf("%d boxes, %d distinct styles, %d iterations\n",
+			N_BOXES, N_STYLES, N_ITERATIONS);
+	printf("exported accessors: %.1f ms (%.1f ns per box)\n",
+			elapsed * 1000,
+			elapsed * 1e9 / (N_BOXES * N_ITERATIONS));
+	printf("inline accessors: %.1f ms (%.1f ns per box)\n",
+			elapsed_inline * 1000,
+			elapsed_inline * 1e9 / (N_BOXES * N_ITERATIONS));
+
+	for (i = 0; i < N_STYLES; i++)
+		assert(css_computed_style_destroy(styles[i]) == CSS_OK);
+
+	assert(css_computed_style_destroy(root) == CSS_OK);
+
+	printf("PASS\n");
+
+	return 0;
+}
+
+void *myrealloc(void *data, size_t len, void *pw)
+{
+	UNUSED(pw);
+
+	return realloc(data, len);
+}
+
+/* Every keyword size is 16px, so relative sizes need no table */
+css_error compute_font_size(void *pw, const css_hint *parent, css_hint *size)
+{
+	UNUSED(pw);
+	UNUSED(parent);
+
+	if (size->status != CSS_FONT_SIZE_DIMENSION) {
+		size->data.length.value = INTTOFIX(16);
+		size->data.length.unit = CSS_UNIT_PX;
+		size->status = CSS_FONT_SIZE_DIMENSION;
+	}
+
+	return CSS_OK;
+}
+
+/**
+ * Create a computed style with some random box properties
+ *
+ * \param parent  Style to compose the new one with, or NULL for the root
+ * \return Pointer to style
+ */
+css_computed_style *create_style(const css_computed_style *parent)
+{
+	static const uint8_t displays[] = {
+		CSS_DISPLAY_BLOCK, CSS_DISPLAY_INLINE,
+		CSS_DISPLAY_INLINE_BLOCK, CSS_DISPLAY_TABLE_CELL
+	};
+	static const uint8_t positions[] = {
+		CSS_POSITION_STATIC, CSS_POSITION_RELATIVE,
+		CSS_POSITION_ABSOLUTE
+	};
+	css_computed_style *style;
+
+	assert(css_computed_style_create(myrealloc, NULL,
+			&style) == CSS_OK);
+	assert(css_computed_style_initialise(style, NULL, NULL) == CSS_OK);
+
+	if (parent == NULL) {
+		assert(set_font_size(style, CSS_FONT_SIZE_DIMENSION,
+				INTTOFIX(16), CSS_UNIT_PX) == CSS_OK);
+		assert(set_color(style, CSS_COLOR_COLOR,
+				0xff000000) == CSS_OK);
+
+		return style;
+	}
+
+	assert(set_display(style, displays[next_random(4)]) == CSS_OK);
+	assert(set_position(style, positions[next_random(3)]) == CSS_OK);
+
+	assert(set_width(style, CSS_WIDTH_SET, INTTOFIX(next_random(800)),
+			CSS_UNIT_PX) == CSS_OK);
+	assert(set_top(style, CSS_TOP_SET, INTTOFIX(next_random(20)),
+			CSS_UNIT_EM) == CSS_OK);
+	assert(set_margin_left(style, CSS_MARGIN_SET,
+			INTTOFIX(next_random(20)), CSS_UNIT_PX) == CSS_OK);
+	assert(set_padding_top(style, CSS_PADDING_SET,
+			INTTOFIX(next_random(10)), CSS_UNIT_EM) == CSS_OK);
+	assert(set_border_top_style(style,
+			CSS_BORDER_STYLE_SOLID) == CSS_OK);
+	assert(set_border_top_width(style, CSS_BORDER_WIDTH_WIDTH,
+			INTTOFIX(next_random(4)), CSS_UNIT_PX) == CSS_OK);
+
+	if (next_random(2) == 0) {
+		assert(set_line_height(style, CSS_LINE_HEIGHT_NUMBER,
+				FLTTOFIX(1.5), CSS_UNIT_PX) == CSS_OK);
+	}
+
+	if (next_random(4) == 0) {
+		assert(set_letter_spacing(style, CSS_LETTER_SPACING_SET,
+				INTTOFIX(1), CSS_UNIT_PX) == CSS_OK);
+	}
+
+	assert(set_z_index(style, CSS_Z_INDEX_SET,
+			next_random(10)) == CSS_OK);
+
+	assert(css_computed_style_compose(parent, style, compute_font_size,
+			NULL, style) == CSS_OK);
+
+	return style;
+}
+
+uint32_t next_random(uint32_t range)
+{
+	seed = seed * 1103515245 + 12345;
+
+	return (seed >> 16) % range;
+}
+
+double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
@@ -26,11 +26,20 @@ typedef struct node {
 	uint32_t n_attrs;
 	attribute *attrs;
 
+	/** Names of attributes, each given once regardless of case */
+	uint32_t n_attr_names;
+	lwc_string **attr_names;
+
 	struct node *parent;
 	struct node *next;
 	struct node *prev;
 	struct node *children;
 	struct node *last_child;
+
+	/** Dynamic css_node_state_flags, given by "state" attributes */
+	uint32_t state;
+
+	css_select_results *results;
 } node;
 
 typedef struct sheet_ctx {
@@ -60,8 +69,11 @@ typedef struct line_ctx {
 	uint32_t pseudo_element;
 	node *target;
 	
+	css_select_handler *handler;
+
 	lwc_string *attr_class;
 	lwc_string *attr_id;
+	lwc_string *attr_state;
 } line_ctx;
 
 static bool handle_line(const char *data, size_t datalen, void *pw);
@@ -72,13 +84,22 @@ static void css__parse_media_list(const char **data, size_t *len, uint64_t *medi
 static void css__parse_pseudo_list(const char **data, size_t *len, 
 		uint32_t *element);
 static void css__parse_expected(line_ctx *ctx, const char *data, size_t len);
+static uint32_t state_flag(const char *data, size_t len);
 static void run_test(line_ctx *ctx, const char *exp, size_t explen);
+static void run_test_handler(line_ctx *ctx, const char *exp, size_t explen);
+static void select_tree(css_select_ctx *select, line_ctx *ctx, node *root);
+static uint32_t push_ancestors(css_select_ctx *select, line_ctx *ctx, 
+		node *n);
+static void check_tree(css_select_ctx *select, line_ctx *ctx, node *n,
+		const css_computed_style *parent_style);
 static void destroy_tree(node *root);
 
 static css_error node_name(void *pw, void *node,
 		css_qname *qname);
 static css_error node_classes(void *pw, void *node,
 		lwc_string ***classes, uint32_t *n_classes);
+static css_error node_classes_v2(void *pw, void *node,
+		lwc_string ***classes, uint32_t *n_classes);
 static css_error node_id(void *pw, void *node,
 		lwc_string **id);
 static css_error named_ancestor_node(void *pw, void *node,
@@ -146,6 +167,9 @@ static css_error node_is_checked(void *pw, void *node, bool *match);
 static css_error node_is_target(void *pw, void *node, bool *match);
 static css_error node_is_lang(void *pw, void *node,
 		lwc_string *lang, bool *match);
+static css_error node_state(void *pw, void *node, uint32_t *flags);
+static css_error node_attribute_names(void *pw, void *node,
+		lwc_string ***names, uint32_t *n_names);
 static css_error node_presentational_hint(void *pw, void *node,
 		uint32_t property, css_hint *hint);
 static css_error ua_default_for_property(void *pw, uint32_t property,
@@ -153,6 +177,14 @@ static css_error ua_default_for_property(void *pw, uint32_t property,
 static css_error compute_font_size(void *pw, const css_hint *parent,
 		css_hint *size);
 
+static css_error first_child(void *pw, void *node, void **child);
+static css_error next_sibling(void *pw, void *node, void **sibling);
+static css_error node_inline_style(void *pw, void *node,
+		const css_stylesheet **inline_style);
+static css_error parent_style(void *pw, void *node,
+		const css_computed_style **style);
+static css_error visit(void *pw, void *node, css_select_results *results);
+
 static css_select_handler select_handler = {
 	CSS_SELECT_HANDLER_VERSION_1,
 
@@ -190,7 +222,61 @@ static css_select_handler select_handler = {
 	node_is_lang,
 	node_presentational_hint,
 	ua_default_for_property,
-	compute_font_size
+	compute_font_size,
+	NULL,			/* node_state; unused in version 1 */
+	NULL			/* node_attribute_names; unused in version 1 */
+};
+
+static css_select_handler select_handler_v2 = {
+	CSS_SELECT_HANDLER_VERSION_2,
+
+	node_name,
+	node_classes_v2,
+	node_id,
+	named_ancestor_node,
+	named_parent_node,
+	named_sibling_node,
+	named_generic_sibling_node,
+	parent_node,
+	sibling_node,
+	node_has_name,
+	node_has_class,
+	node_has_id,
+	node_has_attribute,
+	node_has_attribute_equal,
+	node_has_attribute_dashmatch,
+	node_has_attribute_includes,
+	node_has_attribute_prefix,
+	node_has_attribute_suffix,
+	node_has_attribute_substring,
+	NULL,			/* node_is_root; replaced by node_state */
+	node_count_siblings,
+	NULL,			/* node_is_empty */
+	NULL,			/* node_is_link */
+	NULL,			/* node_is_visited */
+	NULL,			/* node_is_hover */
+	NULL,			/* node_is_active */
+	NULL,			/* node_is_focus */
+	NULL,			/* node_is_enabled */
+	NULL,			/* node_is_disabled */
+	NULL,			/* node_is_checked */
+	NULL,			/* node_is_target */
+	node_is_lang,
+	node_presentational_hint,
+	ua_default_for_property,
+	compute_font_size,
+	node_state,
+	node_attribute_names
+};
+
+static css_select_visitor select_visitor = {
+	CSS_SELECT_VISITOR_VERSION_1,
+
+	first_child,
+	next_sibling,
+	node_inline_style,
+	parent_style,
+	visit
 };
 
 static void *myrealloc(void *data, size_t len, void *pw)
@@ -237,6 +323,7 @@ int main(int argc, char **argv)
 
 	lwc_intern_string("class", SLEN("class"), &ctx.attr_class);
 	lwc_intern_string("id", SLEN("id"), &ctx.attr_id);
+	lwc_intern_string("state", SLEN("state"), &ctx.attr_state);
 	
 	assert(css__parse_testfile(argv[1], handle_line, &ctx) == true);
 	
@@ -248,6 +335,7 @@ int main(int argc, char **argv)
 	
 	lwc_string_unref(ctx.attr_class);
 	lwc_string_unref(ctx.attr_id);
+	lwc_string_unref(ctx.attr_state);
 	
 	lwc_iterate_strings(printing_lwc_iterator, NULL);
 	
@@ -392,6 +480,9 @@ void css__parse_tree_data(line_ctx *ctx, const char *data, size_t len)
 	 * 
 	 * <element> ::= [^=*[:space:]]+
 	 * <attr>    ::= [^=*[:space:]]+ '=' [^[:space:]]*
+	 *
+	 * Attributes named "state" give a dynamic state of the element,
+	 * such as hover or checked (c.f. state_flag()).
 	 */
 
 	while (p < end && isspace(*p)) {
@@ -470,6 +561,8 @@ void css__parse_tree_data(line_ctx *ctx, const char *data, size_t len)
 	} else {
 		/* New attribute */
 		attribute *attr;
+		bool match = false;
+		uint32_t i;
 
 		attribute *temp = realloc(ctx->current->attrs,
 			(ctx->current->n_attrs + 1) * sizeof(attribute));
@@ -483,6 +576,32 @@ void css__parse_tree_data(line_ctx *ctx, const char *data, size_t len)
 		lwc_intern_string(value, valuelen, &attr->value);
 
 		ctx->current->n_attrs++;
+
+		/* Record its name, unless another attribute has it */
+		for (i = 0; i < ctx->current->n_attr_names; i++) {
+			assert(lwc_string_caseless_isequal(attr->name,
+					ctx->current->attr_names[i],
+					&match) == lwc_error_ok);
+			if (match)
+				break;
+		}
+
+		if (i == ctx->current->n_attr_names) {
+			lwc_string **names = realloc(ctx->current->attr_names,
+					(i + 1) * sizeof(lwc_string *));
+			assert(names != NULL);
+
+			names[i] = attr->name;
+
+			ctx->current->attr_names = names;
+			ctx->current->n_attr_names++;
+		}
+
+		/* State attributes give the node's dynamic state */
+		assert(lwc_string_caseless_isequal(attr->name,
+				ctx->attr_state, &match) == lwc_error_ok);
+		if (match)
+			ctx->current->state |= state_flag(value, valuelen);
 	}
 }
 
@@ -682,6 +801,38 @@ void css__parse_pseudo_list(const char **data, size_t *len, uint32_t *element)
 	*len = end - p;
 }
 
+uint32_t state_flag(const char *data, size_t len)
+{
+	static const struct {
+		const char *name;
+		uint32_t flag;
+	} states[] = {
+		{ "link", CSS_NODE_STATE_LINK },
+		{ "visited", CSS_NODE_STATE_VISITED },
+		{ "hover", CSS_NODE_STATE_HOVER },
+		{ "active", CSS_NODE_STATE_ACTIVE },
+		{ "focus", CSS_NODE_STATE_FOCUS },
+		{ "enabled", CSS_NODE_STATE_ENABLED },
+		{ "disabled", CSS_NODE_STATE_DISABLED },
+		{ "checked", CSS_NODE_STATE_CHECKED },
+		{ "target", CSS_NODE_STATE_TARGET }
+	};
+	size_t i;
+
+	/* <state> ::= link | visited | hover | active | focus | enabled |
+	 *             disabled | checked | target */
+
+	for (i = 0; i < sizeof(states) / sizeof(states[0]); i++) {
+		if (strlen(states[i].name) == len &&
+				strncasecmp(data, states[i].name, len) == 0)
+			return states[i].flag;
+	}
+
+	assert(0 && "Unknown state");
+
+	return 0;
+}
+
 void css__parse_expected(line_ctx *ctx, const char *data, size_t len)
 {
 	while (ctx->expused + len >= ctx->explen) {
@@ -701,15 +852,48 @@ void css__parse_expected(line_ctx *ctx, const char *data, size_t len)
 }
 
 void run_test(line_ctx *ctx, const char *exp, size_t explen)
+{
+	uint32_t i;
+	static int testnum;
+
+	testnum++;
+
+	/* Select with a version 1 handler, which is asked about each state
+	 * of a node in turn, and whose nodes' attribute names are unknown,
+	 * so that every selector keyed by an attribute is tried. Then select
+	 * with a version 2 handler, which reports the states of a node at
+	 * once, along with the names of its attributes. */
+	ctx->handler = &select_handler;
+	run_test_handler(ctx, exp, explen);
+
+	ctx->handler = &select_handler_v2;
+	run_test_handler(ctx, exp, explen);
+
+	/* Clean up */
+	destroy_tree(ctx->tree);
+
+	for (i = 0; i < ctx->n_sheets; i++) {
+		css_stylesheet_destroy(ctx->sheets[i].sheet);
+	}
+
+	ctx->tree = NULL;
+	ctx->current = NULL;
+	ctx->depth = 0;
+	ctx->n_sheets = 0;
+	free(ctx->sheets);
+	ctx->sheets = NULL;
+	ctx->target = NULL;
+
+	printf("Test %d: PASS\n", testnum);
+}
+
+void run_test_handler(line_ctx *ctx, const char *exp, size_t explen)
 {
 	css_select_ctx *select;
 	css_select_results *results;
-	uint32_t i;
+	uint32_t i, depth;
 	char *buf;
 	size_t buflen;
-	static int testnum;
-
-	UNUSED(exp);
 
 	buf = malloc(8192);
 	if (buf == NULL) {
@@ -725,10 +909,8 @@ void run_test(line_ctx *ctx, const char *exp, size_t explen)
 				ctx->sheets[i].media) == CSS_OK);
 	}
 
-	testnum++;
-
 	assert(css_select_style(select, ctx->target, ctx->media, NULL, 
-			&select_handler, ctx, &results) == CSS_OK);
+			ctx->handler, ctx, &results) == CSS_OK);
 
 	assert(results->styles[ctx->pseudo_element] != NULL);
 
@@ -742,27 +924,174 @@ void run_test(line_ctx *ctx, const char *exp, size_t explen)
 		assert(0 && "Result doesn't match expected");
 	}
 
+	css_select_results_destroy(results);
+
+	/* Select again within a pass, having first styled the rest of the
+	 * tree, so that the target may share a sibling's style, and using
+	 * the ancestor filter and a memo small enough to fill */
+	assert(css_select_ctx_set_memo_size(select, 16) == CSS_OK);
+	assert(css_select_ctx_begin_pass(select) == CSS_OK);
+
+	select_tree(select, ctx, ctx->tree);
+
+	depth = push_ancestors(select, ctx, ctx->target->parent);
+
+	assert(css_select_style(select, ctx->target, ctx->media, NULL, 
+			ctx->handler, ctx, &results) == CSS_OK);
+
+	while (depth-- > 0)
+		assert(css_select_bloom_pop(select) == CSS_OK);
+
+	assert(results->styles[ctx->pseudo_element] != NULL);
+
+	buflen = 8192;
+	dump_computed_style(results->styles[ctx->pseudo_element], buf, &buflen);
+
+	if (8192 - buflen != explen || memcmp(buf, exp, explen) != 0) {
+		printf("Expected (%u):\n%.*s\n", 
+				(int) explen, (int) explen, exp);
+		printf("Result in pass (%u):\n%.*s\n", (int) (8192 - buflen),
+			(int) (8192 - buflen), buf);
+		assert(0 && "Result in pass doesn't match expected");
+	}
+
+	assert(css_select_ctx_end_pass(select) == CSS_OK);
+
+	/* Select for the whole tree at once, then for the subtree rooted 
+	 * at the target, checking that the composed styles match those 
+	 * obtained by selecting for each node individually. The styles
+	 * are interned, and outlive the selection context. */
+	assert(css_select_ctx_set_interning(select, true) == CSS_OK);
+
+	assert(css_select_subtree(select, ctx->tree, ctx->media,
+			ctx->handler, ctx, &select_visitor) == CSS_OK);
+
+	check_tree(select, ctx, ctx->tree, NULL);
+
+	assert(css_select_subtree(select, ctx->target, ctx->media,
+			ctx->handler, ctx, &select_visitor) == CSS_OK);
+
+	check_tree(select, ctx, ctx->tree, NULL);
+
 	/* Clean up */
 	css_select_results_destroy(results);
 	css_select_ctx_destroy(select);
 
-	destroy_tree(ctx->tree);
+	free(buf);
+}
 
-	for (i = 0; i < ctx->n_sheets; i++) {
-		css_stylesheet_destroy(ctx->sheets[i].sheet);
+void select_tree(css_select_ctx *select, line_ctx *ctx, node *root)
+{
+	css_select_results *results;
+	node *n;
+
+	if (root == ctx->target)
+		return;
+
+	assert(css_select_style(select, root, ctx->media, NULL, 
+			ctx->handler, ctx, &results) == CSS_OK);
+
+	css_select_results_destroy(results);
+
+	assert(css_select_bloom_push(select, root, 
+			ctx->handler, ctx) == CSS_OK);
+
+	for (n = root->children; n != NULL; n = n->next)
+		select_tree(select, ctx, n);
+
+	assert(css_select_bloom_pop(select) == CSS_OK);
+}
+
+uint32_t push_ancestors(css_select_ctx *select, line_ctx *ctx, node *n)
+{
+	uint32_t depth;
+
+	if (n == NULL)
+		return 0;
+
+	depth = push_ancestors(select, ctx, n->parent);
+
+	assert(css_select_bloom_push(select, n, 
+			ctx->handler, ctx) == CSS_OK);
+
+	return depth + 1;
+}
+
+void check_tree(css_select_ctx *select, line_ctx *ctx, node *n,
+		const css_computed_style *parent_style)
+{
+	css_select_results *results;
+	css_computed_style *composed[CSS_PSEUDO_ELEMENT_COUNT];
+	const css_computed_style *expected[CSS_PSEUDO_ELEMENT_COUNT];
+	char *buf, *exp;
+	size_t buflen, explen;
+	uint32_t i;
+	node *c;
+
+	buf = malloc(8192);
+	exp = malloc(8192);
+	assert(buf != NULL && exp != NULL);
+
+	assert(n->results != NULL);
+
+	assert(css_select_style(select, n, ctx->media, NULL, 
+			ctx->handler, ctx, &results) == CSS_OK);
+
+	for (i = 0; i < CSS_PSEUDO_ELEMENT_COUNT; i++) {
+		const css_computed_style *parent = 
+				i == CSS_PSEUDO_ELEMENT_NONE ? parent_style :
+				expected[CSS_PSEUDO_ELEMENT_NONE];
+
+		composed[i] = NULL;
+		expected[i] = results->styles[i];
+
+		if (results->styles[i] == NULL) {
+			assert(n->results->styles[i] == NULL);
+			continue;
+		}
+
+		assert(n->results->styles[i] != NULL);
+
+		/* The root element's style needs no composition */
+		if (parent != NULL) {
+			assert(css_computed_style_create(myrealloc, NULL, 
+					&composed[i]) == CSS_OK);
+
+			assert(css_computed_style_compose(parent, 
+					results->styles[i], compute_font_size,
+					ctx, composed[i]) == CSS_OK);
+
+			expected[i] = composed[i];
+		}
+
+		explen = 8192;
+		dump_computed_style(expected[i], exp, &explen);
+		buflen = 8192;
+		dump_computed_style(n->results->styles[i], buf, &buflen);
+
+		if (buflen != explen || memcmp(buf, exp, 8192 - explen) != 0) {
+			printf("Expected (%u):\n%.*s\n", 
+					(int) (8192 - explen), 
+					(int) (8192 - explen), exp);
+			printf("Result in subtree (%u):\n%.*s\n", 
+					(int) (8192 - buflen),
+					(int) (8192 - buflen), buf);
+			assert(0 && "Result in subtree doesn't match expected");
+		}
 	}
 
-	ctx->tree = NULL;
-	ctx->current = NULL;
-	ctx->depth = 0;
-	ctx->n_sheets = 0;
-	free(ctx->sheets);
-	ctx->sheets = NULL;
-	ctx->target = NULL;
+	for (c = n->children; c != NULL; c = c->next)
+		check_tree(select, ctx, c, expected[CSS_PSEUDO_ELEMENT_NONE]);
 
-	free(buf);
+	for (i = 0; i < CSS_PSEUDO_ELEMENT_COUNT; i++) {
+		if (composed[i] != NULL)
+			css_computed_style_destroy(composed[i]);
+	}
 
-	printf("Test %d: PASS\n", testnum);
+	css_select_results_destroy(results);
+
+	free(exp);
+	free(buf);
 }
 
 void destroy_tree(node *root)
@@ -782,6 +1111,10 @@ void destroy_tree(node *root)
 	}
 	
 	free(root->attrs);
+	free(root->attr_names);
+
+	if (root->results != NULL)
+		css_select_results_destroy(root->results);
 	
 	lwc_string_unref(root->name);
 	free(root);
@@ -832,6 +1165,34 @@ css_error node_classes(void *pw, void *n,
 
 }
 
+css_error node_classes_v2(void *pw, void *n,
+		lwc_string ***classes, uint32_t *n_classes)
+{
+	node *node = n;
+	uint32_t i;
+	line_ctx *lc = pw;
+
+	for (i = 0; i < node->n_attrs; i++) {
+		bool amatch = false;
+		assert(lwc_string_caseless_isequal(
+				node->attrs[i].name, lc->attr_class, &amatch) ==
+				lwc_error_ok);
+		if (amatch == true)
+			break;
+	}
+
+	/* The tree retains ownership of the class, and of the array */
+	if (i != node->n_attrs) {
+		*classes = &node->attrs[i].value;
+		*n_classes = 1;
+	} else {
+		*classes = NULL;
+		*n_classes = 0;
+	}
+
+	return CSS_OK;
+}
+
 css_error node_id(void *pw, void *n,
 		lwc_string **id)
 {
@@ -960,6 +1321,64 @@ css_error sibling_node(void *pw, void *n, void **sibling)
 	return CSS_OK;
 }
 
+css_error first_child(void *pw, void *n, void **child)
+{
+	node *node = n;
+
+	UNUSED(pw);
+
+	*child = (void *) node->children;
+
+	return CSS_OK;
+}
+
+css_error next_sibling(void *pw, void *n, void **sibling)
+{
+	node *node = n;
+
+	UNUSED(pw);
+
+	*sibling = (void *) node->next;
+
+	return CSS_OK;
+}
+
+css_error node_inline_style(void *pw, void *n, 
+		const css_stylesheet **inline_style)
+{
+	UNUSED(pw);
+	UNUSED(n);
+
+	*inline_style = NULL;
+
+	return CSS_OK;
+}
+
+css_error parent_style(void *pw, void *n, const css_computed_style **style)
+{
+	node *node = n;
+
+	UNUSED(pw);
+
+	*style = node->parent->results->styles[CSS_PSEUDO_ELEMENT_NONE];
+
+	return CSS_OK;
+}
+
+css_error visit(void *pw, void *n, css_select_results *results)
+{
+	node *node = n;
+
+	UNUSED(pw);
+
+	if (node->results != NULL)
+		css_select_results_destroy(node->results);
+
+	node->results = results;
+
+	return CSS_OK;
+}
+
 css_error node_has_name(void *pw, void *n,
 		const css_qname *qname,
 		bool *match)
@@ -1070,7 +1489,7 @@ css_error node_has_attribute_equal(void *pw, void *n,
 	
 	if (*match == true) {
 		assert(lwc_string_caseless_isequal(
-				node->attrs[i].name, value, match) == 
+				node->attrs[i].value, value, match) == 
 				lwc_error_ok);
 	}
 	
@@ -1362,9 +1781,8 @@ css_error node_is_link(void *pw, void *n, bool *match)
 	node *node = n;
 
 	UNUSED(pw);
-	UNUSED(node);
 
-	*match = false;
+	*match = (node->state & CSS_NODE_STATE_LINK) != 0;
 
 	return CSS_OK;
 }
@@ -1374,9 +1792,8 @@ css_error node_is_visited(void *pw, void *n, bool *match)
 	node *node = n;
 
 	UNUSED(pw);
-	UNUSED(node);
 
-	*match = false;
+	*match = (node->state & CSS_NODE_STATE_VISITED) != 0;
 
 	return CSS_OK;
 }
@@ -1386,9 +1803,8 @@ css_error node_is_hover(void *pw, void *n, bool *match)
 	node *node = n;
 
 	UNUSED(pw);
-	UNUSED(node);
 
-	*match = false;
+	*match = (node->state & CSS_NODE_STATE_HOVER) != 0;
 
 	return CSS_OK;
 }
@@ -1398,9 +1814,8 @@ css_error node_is_active(void *pw, void *n, bool *match)
 	node *node = n;
 
 	UNUSED(pw);
-	UNUSED(node);
 
-	*match = false;
+	*match = (node->state & CSS_NODE_STATE_ACTIVE) != 0;
 
 	return CSS_OK;
 }
@@ -1410,9 +1825,8 @@ css_error node_is_focus(void *pw, void *n, bool *match)
 	node *node = n;
 
 	UNUSED(pw);
-	UNUSED(node);
 
-	*match = false;
+	*match = (node->state & CSS_NODE_STATE_FOCUS) != 0;
 
 	return CSS_OK;
 }
@@ -1422,9 +1836,8 @@ css_error node_is_enabled(void *pw, void *n, bool *match)
 	node *node = n;
 
 	UNUSED(pw);
-	UNUSED(node);
 
-	*match = false;
+	*match = (node->state & CSS_NODE_STATE_ENABLED) != 0;
 
 	return CSS_OK;
 }
@@ -1434,9 +1847,8 @@ css_error node_is_disabled(void *pw, void *n, bool *match)
 	node *node = n;
 
 	UNUSED(pw);
-	UNUSED(node);
 
-	*match = false;
+	*match = (node->state & CSS_NODE_STATE_DISABLED) != 0;
 
 	return CSS_OK;
 }
@@ -1446,9 +1858,8 @@ css_error node_is_checked(void *pw, void *n, bool *match)
 	node *node = n;
 
 	UNUSED(pw);
-	UNUSED(node);
 
-	*match = false;
+	*match = (node->state & CSS_NODE_STATE_CHECKED) != 0;
 
 	return CSS_OK;
 }
@@ -1458,9 +1869,8 @@ css_error node_is_target(void *pw, void *n, bool *match)
 	node *node = n;
 
 	UNUSED(pw);
-	UNUSED(node);
 
-	*match = false;
+	*match = (node->state & CSS_NODE_STATE_TARGET) != 0;
 
 	return CSS_OK;
 }
@@ -1480,6 +1890,37 @@ css_error node_is_lang(void *pw, void *n,
 	return CSS_OK;
 }
 
+css_error node_state(void *pw, void *n, uint32_t *flags)
+{
+	node *node = n;
+
+	UNUSED(pw);
+
+	*flags = node->state;
+
+	if (node->parent == NULL)
+		*flags |= CSS_NODE_STATE_ROOT;
+
+	if (node->children == NULL)
+		*flags |= CSS_NODE_STATE_EMPTY;
+
+	return CSS_OK;
+}
+
+css_error node_attribute_names(void *pw, void *n,
+		lwc_string ***names, uint32_t *n_names)
+{
+	node *node = n;
+
+	UNUSED(pw);
+
+	/* The tree retains ownership of the names, and of the array */
+	*names = node->attr_names;
+	*n_names = node->n_attr_names;
+
+	return CSS_OK;
+}
+
 css_error node_presentational_hint(void *pw, void *node,
 		uint32_t property, css_hint *hint)
 {
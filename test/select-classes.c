@@ -0,0 +1,802 @@
+/*
+ * Many-class selection benchmark
+ *
+ * Styles a generated document, in the manner of a utility CSS framework,
+ * whose elements each have many classes, and each class a few rules.
+ * Every class has a distinct numeric value, and rules for later classes
+ * occur later in the sheet, so the value of each property set by them
+ * must be that of the element's greatest class.
+ *
+ * The document is styled both into new result sets and, once warmed up,
+ * into a reused one, which must require no allocation. It is then styled
+ * without the elements' ::before pseudo elements, whose rules must not
+ * take effect.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <libcss/libcss.h>
+#include <libcss/computed.h>
+#include <libcss/select.h>
+#include <libcss/stylesheet.h>
+
+#include "utils/utils.h"
+
+#include "testutils.h"
+
+/* Number of utility classes in the stylesheet */
+#define N_UTILITIES 400
+
+/* Minimum and maximum number of classes of each element */
+#define MIN_CLASSES 10
+#define MAX_CLASSES 24
+
+/* Number of containers, and of elements in each */
+#define N_CONTAINERS 50
+#define N_CHILDREN 20
+
+/* Number of times the document is styled */
+#define N_ITERATIONS 10
+
+typedef struct node {
+	lwc_string *name;
+	lwc_string *classes[MAX_CLASSES];
+	uint32_t n_classes;
+	uint32_t greatest;		/* Greatest class of element */
+
+	struct node *parent;
+	struct node *next;
+	struct node *prev;
+	struct node *children;
+	struct node *last_child;
+} node;
+
+static node **nodes;
+static uint32_t n_nodes;
+
+static lwc_string *utilities[N_UTILITIES];
+
+static uint32_t seed = 1;
+
+/* Number of calls made to the allocator */
+static uint32_t n_allocs;
+
+static node *create_node(node *parent, lwc_string *name);
+static void destroy_node(node *n);
+static lwc_string *intern(const char *data);
+static uint32_t next_random(uint32_t range);
+static double now(void);
+static char *create_sheet_data(void);
+static void check_results(const node *n, const css_select_results *results,
+		bool before);
+
+static css_error node_name(void *pw, void *node,
+		css_qname *qname);
+static css_error node_classes(void *pw, void *node,
+		lwc_string ***classes, uint32_t *n_classes);
+static css_error node_id(void *pw, void *node,
+		lwc_string **id);
+static css_error named_ancestor_node(void *pw, void *node,
+		const css_qname *qname,
+		void **ancestor);
+static css_error named_parent_node(void *pw, void *node,
+		const css_qname *qname,
+		void **parent);
+static css_error named_sibling_node(void *pw, void *node,
+		const css_qname *qname,
+		void **sibling);
+static css_error named_generic_sibling_node(void *pw, void *node,
+		const css_qname *qname,
+		void **sibling);
+static css_error parent_node(void *pw, void *node, void **parent);
+static css_error sibling_node(void *pw, void *node, void **sibling);
+static css_error node_has_name(void *pw, void *node,
+		const css_qname *qname,
+		bool *match);
+static css_error node_has_class(void *pw, void *node,
+		lwc_string *name,
+		bool *match);
+static css_error node_has_id(void *pw, void *node,
+		lwc_string *name,
+		bool *match);
+static css_error node_has_attribute(void *pw, void *node,
+		const css_qname *qname,
+		bool *match);
+static css_error node_has_attribute_value(void *pw, void *node,
+		const css_qname *qname,
+		lwc_string *value,
+		bool *match);
+static css_error node_count_siblings(void *pw, void *node,
+		bool same_name, bool after, int32_t *count);
+static css_error node_is_lang(void *pw, void *node,
+		lwc_string *lang,
+		bool *match);
+static css_error node_presentational_hint(void *pw, void *node,
+		uint32_t property, css_hint *hint);
+static css_error ua_default_for_property(void *pw, uint32_t property,
+		css_hint *hint);
+static css_error compute_font_size(void *pw, const css_hint *parent,
+		css_hint *size);
+static css_error node_state(void *pw, void *node, uint32_t *flags);
+static css_error node_attribute_names(void *pw, void *node,
+		lwc_string ***names, uint32_t *n_names);
+
+static css_select_handler select_handler = {
+	CSS_SELECT_HANDLER_VERSION_2,
+
+	node_name,
+	node_classes,
+	node_id,
+	named_ancestor_node,
+	named_parent_node,
+	named_sibling_node,
+	named_generic_sibling_node,
+	parent_node,
+	sibling_node,
+	node_has_name,
+	node_has_class,
+	node_has_id,
+	node_has_attribute,
+	node_has_attribute_value,	/* equal */
+	node_has_attribute_value,	/* dashmatch */
+	node_has_attribute_value,	/* includes */
+	node_has_attribute_value,	/* prefix */
+	node_has_attribute_value,	/* suffix */
+	node_has_attribute_value,	/* substring */
+	NULL,			/* root */
+	node_count_siblings,
+	NULL,			/* empty */
+	NULL,			/* link */
+	NULL,			/* visited */
+	NULL,			/* hover */
+	NULL,			/* active */
+	NULL,			/* focus */
+	NULL,			/* enabled */
+	NULL,			/* disabled */
+	NULL,			/* checked */
+	NULL,			/* target */
+	node_is_lang,
+	node_presentational_hint,
+	ua_default_for_property,
+	compute_font_size,
+	node_state,
+	node_attribute_names
+};
+
+static void *myrealloc(void *data, size_t len, void *pw)
+{
+	UNUSED(pw);
+
+	n_allocs++;
+
+	return realloc(data, len);
+}
+
+static css_error resolve_url(void *pw,
+		const char *base, lwc_string *rel, lwc_string **abs)
+{
+	UNUSED(pw);
+	UNUSED(base);
+
+	*abs = lwc_string_ref(rel);
+
+	return CSS_OK;
+}
+
+int main(int argc, char **argv)
+{
+	css_stylesheet_params params;
+	css_stylesheet *sheet;
+	css_select_ctx *select;
+	css_select_results *results = NULL;
+	lwc_string *name_div, *name_span;
+	char *sheet_data, buf[16];
+	double start, elapsed, elapsed_into, elapsed_masked;
+	uint32_t i, j, k, n_classes = 0, warm_allocs = 0;
+	node *root, *body, *container, *n;
+
+	UNUSED(argc);
+	UNUSED(argv);
+
+	for (i = 0; i < N_UTILITIES; i++) {
+		snprintf(buf, sizeof(buf), "u%" PRIu32, i);
+		utilities[i] = intern(buf);
+	}
+
+	/* Create the document */
+	name_div = intern("div");
+	name_span = intern("span");
+
+	nodes = malloc(N_CONTAINERS * N_CHILDREN * sizeof(node *));
+	assert(nodes != NULL);
+
+	root = create_node(NULL, intern("html"));
+	body = create_node(root, intern("body"));
+
+	for (i = 0; i < N_CONTAINERS; i++) {
+		container = create_node(body, lwc_string_ref(name_div));
+
+		for (j = 0; j < N_CHILDREN; j++) {
+			n = create_node(container, lwc_string_ref(
+					j % 2 == 0 ? name_div : name_span));
+
+			n->n_classes = MIN_CLASSES +
+				next_random(MAX_CLASSES - MIN_CLASSES + 1);
+			for (k = 0; k < n->n_classes; k++) {
+				uint32_t u = next_random(N_UTILITIES);
+
+				n->classes[k] = lwc_string_ref(utilities[u]);
+				if (u > n->greatest)
+					n->greatest = u;
+			}
+
+			n_classes += n->n_classes;
+			nodes[n_nodes++] = n;
+		}
+	}
+
+	lwc_string_unref(name_div);
+	lwc_string_unref(name_span);
+
+	/* Create the selection context */
+	params.params_version = CSS_STYLESHEET_PARAMS_VERSION_1;
+	params.level = CSS_LEVEL_21;
+	params.charset = "UTF-8";
+	params.url = "foo";
+	params.title = "foo";
+	params.allow_quirks = false;
+	params.inline_style = false;
+	params.resolve = resolve_url;
+	params.resolve_pw = NULL;
+	params.import = NULL;
+	params.import_pw = NULL;
+	params.color = NULL;
+	params.color_pw = NULL;
+	params.font = NULL;
+	params.font_pw = NULL;
+
+	sheet_data = create_sheet_data();
+
+	assert(css_stylesheet_create(&params, myrealloc, NULL,
+			&sheet) == CSS_OK);
+	assert(css_stylesheet_append_data(sheet,
+			(const uint8_t *) sheet_data,
+			strlen(sheet_data)) == CSS_NEEDDATA);
+	assert(css_stylesheet_data_done(sheet) == CSS_OK);
+
+	assert(css_select_ctx_create(myrealloc, NULL, &select) == CSS_OK);
+	assert(css_select_ctx_append_sheet(select, sheet, CSS_ORIGIN_AUTHOR,
+			CSS_MEDIA_ALL) == CSS_OK);
+
+	/* Style the elements into new result sets */
+	start = now();
+
+	for (j = 0; j < N_ITERATIONS; j++) {
+		for (i = 0; i < n_nodes; i++) {
+			assert(css_select_style(select, nodes[i],
+					CSS_MEDIA_SCREEN, NULL,
+					&select_handler, NULL,
+					&results) == CSS_OK);
+
+			check_results(nodes[i], results, true);
+
+			css_select_results_destroy(results);
+		}
+	}
+
+	elapsed = now() - start;
+
+	/* Style them into a single result set. Once it has been used, no
+	 * more allocation is required. */
+	assert(css_select_style(select, nodes[0], CSS_MEDIA_SCREEN, NULL,
+			&select_handler, NULL, &results) == CSS_OK);
+
+	start = now();
+
+	for (j = 0; j < N_ITERATIONS; j++) {
+		if (j == 1)
+			warm_allocs = n_allocs;
+
+		for (i = 0; i < n_nodes; i++) {
+			assert(css_select_style_into(select, nodes[i],
+					CSS_MEDIA_SCREEN, NULL,
+					&select_handler, NULL,
+					results) == CSS_OK);
+
+			check_results(nodes[i], results, true);
+		}
+	}
+
+	elapsed_into = now() - start;
+
+	assert(n_allocs == warm_allocs);
+
+	css_select_results_destroy(results);
+
+	/* Style them without their pseudo elements */
+	start = now();
+
+	for (j = 0; j < N_ITERATIONS; j++) {
+		for (i = 0; i < n_nodes; i++) {
+			assert(css_select_style_masked(select, nodes[i],
+					CSS_MEDIA_SCREEN, CSS_PSEUDO_ELEMENT_MASK(
+						CSS_PSEUDO_ELEMENT_NONE),
+					NULL, &select_handler, NULL,
+					&results) == CSS_OK);
+
+			check_results(nodes[i], results, false);
+
+			css_select_results_destroy(results);
+		}
+	}
+
+	elapsed_masked = now() - start;
+
+	printf("%" PRIu32 " elements, %.1f classes each, %d iterations\n",
+			n_nodes, (double) n_classes / n_nodes, N_ITERATIONS);
+	printf("new results: %.1f ms (%.2f us per element)\n",
+			elapsed * 1000,
+			elapsed * 1e6 / (n_nodes * N_ITERATIONS));
+	printf("reused results: %.1f ms (%.2f us per element)\n",
+			elapsed_into * 1000,
+			elapsed_into * 1e6 / (n_nodes * N_ITERATIONS));
+	printf("without pseudo elements: %.1f ms (%.2f us per element)\n",
+			elapsed_masked * 1000,
+			elapsed_masked * 1e6 / (n_nodes * N_ITERATIONS));
+
+	/* Clean up */
+	css_select_ctx_destroy(select);
+	css_stylesheet_destroy(sheet);
+	free(sheet_data);
+
+	destroy_node(root);
+	free(nodes);
+
+	for (i = 0; i < N_UTILITIES; i++)
+		lwc_string_unref(utilities[i]);
+
+	printf("PASS\n");
+
+	return 0;
+}
+
+char *create_sheet_data(void)
+{
+	static const char *rule_fmt =
+		".u%" PRIu32 " { z-index: %" PRIu32 "; }\n"
+		".u%" PRIu32 ":hover { z-index: auto; }\n"
+		"div .u%" PRIu32 " { margin-left: %" PRIu32 "px; }\n"
+		".u%" PRIu32 " + .u%" PRIu32 " { margin-right: 1px; }\n"
+		".u%" PRIu32 "::before { z-index: %" PRIu32 "; }\n";
+	size_t size = 256 * N_UTILITIES, len = 0;
+	char *data = malloc(size);
+	uint32_t i;
+
+	assert(data != NULL);
+
+	len += snprintf(data + len, size - len,
+			"div { display: block; }\n"
+			"span { display: inline; }\n"
+			"* { padding-left: 0; }\n");
+
+	for (i = 0; i < N_UTILITIES; i++) {
+		len += snprintf(data + len, size - len, rule_fmt,
+				i, i, i, i, i, i, (i + 1) % N_UTILITIES,
+				i, i);
+		assert(len < size);
+	}
+
+	/* No node has attributes, or is hovered, so these never match */
+	len += snprintf(data + len, size - len,
+			"[title], :hover { z-index: auto; }\n");
+	assert(len < size);
+
+	return data;
+}
+
+void check_results(const node *n, const css_select_results *results,
+		bool before)
+{
+	const css_computed_style *style =
+			results->styles[CSS_PSEUDO_ELEMENT_NONE];
+	css_fixed length;
+	css_unit unit;
+	int32_t z_index;
+
+	assert(css_computed_z_index(style, &z_index) == CSS_Z_INDEX_SET);
+	/* The z-index is reported in fixed point */
+	assert(z_index == INTTOFIX(n->greatest));
+
+	assert(css_computed_margin_left(style, &length, &unit) ==
+			CSS_MARGIN_SET);
+	assert(length == INTTOFIX(n->greatest) && unit == CSS_UNIT_PX);
+
+	/* Each class styles the element's ::before too, if it is selected */
+	style = results->styles[CSS_PSEUDO_ELEMENT_BEFORE];
+
+	if (before == false) {
+		assert(style == NULL);
+		return;
+	}
+
+	assert(style != NULL);
+	assert(css_computed_z_index(style, &z_index) == CSS_Z_INDEX_SET);
+	assert(z_index == INTTOFIX(n->greatest));
+}
+
+node *create_node(node *parent, lwc_string *name)
+{
+	node *n = calloc(1, sizeof(node));
+
+	assert(n != NULL);
+
+	n->name = name;
+
+	if (parent != NULL) {
+		n->parent = parent;
+
+		if (parent->children == NULL) {
+			parent->children = n;
+		} else {
+			parent->last_child->next = n;
+			n->prev = parent->last_child;
+		}
+
+		parent->last_child = n;
+	}
+
+	return n;
+}
+
+void destroy_node(node *n)
+{
+	node *c, *next;
+	uint32_t i;
+
+	for (c = n->children; c != NULL; c = next) {
+		next = c->next;
+		destroy_node(c);
+	}
+
+	lwc_string_unref(n->name);
+
+	for (i = 0; i < n->n_classes; i++)
+		lwc_string_unref(n->classes[i]);
+
+	free(n);
+}
+
+lwc_string *intern(const char *data)
+{
+	lwc_string *str;
+
+	assert(lwc_intern_string(data, strlen(data), &str) == lwc_error_ok);
+
+	return str;
+}
+
+uint32_t next_random(uint32_t range)
+{
+	seed = seed * 1103515245 + 12345;
+
+	return (seed >> 16) % range;
+}
+
+double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static bool node_is_named(node *n, const css_qname *qname)
+{
+	bool match;
+
+	assert(lwc_string_caseless_isequal(qname->name, n->name,
+			&match) == lwc_error_ok);
+
+	return match;
+}
+
+css_error node_name(void *pw, void *n, css_qname *qname)
+{
+	node *node = n;
+
+	UNUSED(pw);
+
+	qname->ns = NULL;
+	qname->name = lwc_string_ref(node->name);
+
+	return CSS_OK;
+}
+
+css_error node_classes(void *pw, void *n,
+		lwc_string ***classes, uint32_t *n_classes)
+{
+	node *node = n;
+
+	UNUSED(pw);
+
+	/* The node retains ownership of its classes */
+	*classes = node->classes;
+	*n_classes = node->n_classes;
+
+	return CSS_OK;
+}
+
+css_error node_id(void *pw, void *n, lwc_string **id)
+{
+	UNUSED(pw);
+	UNUSED(n);
+
+	*id = NULL;
+
+	return CSS_OK;
+}
+
+css_error named_ancestor_node(void *pw, void *n,
+		const css_qname *qname, void **ancestor)
+{
+	node *node = n;
+
+	UNUSED(pw);
+
+	for (node = node->parent; node != NULL; node = node->parent) {
+		if (node_is_named(node, qname))
+			break;
+	}
+
+	*ancestor = (void *) node;
+
+	return CSS_OK;
+}
+
+css_error named_parent_node(void *pw, void *n,
+		const css_qname *qname, void **parent)
+{
+	node *node = n;
+
+	UNUSED(pw);
+
+	*parent = NULL;
+	if (node->parent != NULL && node_is_named(node->parent, qname))
+		*parent = (void *) node->parent;
+
+	return CSS_OK;
+}
+
+css_error named_sibling_node(void *pw, void *n,
+		const css_qname *qname, void **sibling)
+{
+	node *node = n;
+
+	UNUSED(pw);
+
+	*sibling = NULL;
+	if (node->prev != NULL && node_is_named(node->prev, qname))
+		*sibling = (void *) node->prev;
+
+	return CSS_OK;
+}
+
+css_error named_generic_sibling_node(void *pw, void *n,
+		const css_qname *qname, void **sibling)
+{
+	node *node = n;
+
+	UNUSED(pw);
+
+	for (node = node->prev; node != NULL; node = node->prev) {
+		if (node_is_named(node, qname))
+			break;
+	}
+
+	*sibling = (void *) node;
+
+	return CSS_OK;
+}
+
+css_error parent_node(void *pw, void *n, void **parent)
+{
+	node *node = n;
+
+	UNUSED(pw);
+
+	*parent = (void *) node->parent;
+
+	return CSS_OK;
+}
+
+css_error sibling_node(void *pw, void *n, void **sibling)
+{
+	node *node = n;
+
+	UNUSED(pw);
+
+	*sibling = (void *) node->prev;
+
+	return CSS_OK;
+}
+
+css_error node_has_name(void *pw, void *n,
+		const css_qname *qname, bool *match)
+{
+	UNUSED(pw);
+
+	*match = node_is_named(n, qname);
+
+	return CSS_OK;
+}
+
+css_error node_has_class(void *pw, void *n,
+		lwc_string *name, bool *match)
+{
+	node *node = n;
+	uint32_t i;
+
+	UNUSED(pw);
+
+	/* Classes are case-sensitive in HTML */
+	*match = false;
+	for (i = 0; i < node->n_classes; i++) {
+		if (name == node->classes[i])
+			*match = true;
+	}
+
+	return CSS_OK;
+}
+
+css_error node_has_id(void *pw, void *n,
+		lwc_string *name, bool *match)
+{
+	UNUSED(pw);
+	UNUSED(n);
+	UNUSED(name);
+
+	*match = false;
+
+	return CSS_OK;
+}
+
+css_error node_has_attribute(void *pw, void *n,
+		const css_qname *qname, bool *match)
+{
+	UNUSED(pw);
+	UNUSED(n);
+	UNUSED(qname);
+
+	*match = false;
+
+	return CSS_OK;
+}
+
+css_error node_has_attribute_value(void *pw, void *n,
+		const css_qname *qname, lwc_string *value, bool *match)
+{
+	UNUSED(pw);
+	UNUSED(n);
+	UNUSED(qname);
+	UNUSED(value);
+
+	*match = false;
+
+	return CSS_OK;
+}
+
+css_error node_count_siblings(void *pw, void *n,
+		bool same_name, bool after, int32_t *count)
+{
+	node *node = n;
+	lwc_string *name = node->name;
+	int32_t cnt = 0;
+
+	UNUSED(pw);
+
+	for (node = after ? node->next : node->prev; node != NULL;
+			node = after ? node->next : node->prev) {
+		/* Names are interned, and all lower case */
+		if (same_name == false || node->name == name)
+			cnt++;
+	}
+
+	*count = cnt;
+
+	return CSS_OK;
+}
+
+
+css_error node_is_lang(void *pw, void *n,
+		lwc_string *lang, bool *match)
+{
+	UNUSED(pw);
+	UNUSED(n);
+	UNUSED(lang);
+
+	*match = false;
+
+	return CSS_OK;
+}
+
+css_error node_presentational_hint(void *pw, void *node,
+		uint32_t property, css_hint *hint)
+{
+	UNUSED(pw);
+	UNUSED(node);
+	UNUSED(property);
+	UNUSED(hint);
+
+	return CSS_PROPERTY_NOT_SET;
+}
+
+css_error ua_default_for_property(void *pw, uint32_t property, css_hint *hint)
+{
+	UNUSED(pw);
+
+	if (property == CSS_PROP_COLOR) {
+		hint->data.color = 0xff000000;
+		hint->status = CSS_COLOR_COLOR;
+	} else if (property == CSS_PROP_FONT_FAMILY) {
+		hint->data.strings = NULL;
+		hint->status = CSS_FONT_FAMILY_SANS_SERIF;
+	} else if (property == CSS_PROP_QUOTES) {
+		hint->data.strings = NULL;
+		hint->status = CSS_QUOTES_NONE;
+	} else if (property == CSS_PROP_VOICE_FAMILY) {
+		hint->data.strings = NULL;
+		hint->status = 0;
+	} else {
+		return CSS_INVALID;
+	}
+
+	return CSS_OK;
+}
+
+css_error compute_font_size(void *pw, const css_hint *parent, css_hint *size)
+{
+	UNUSED(pw);
+	UNUSED(parent);
+	UNUSED(size);
+
+	/* Styles are not composed, so no font size need be computed */
+	return CSS_INVALID;
+}
+
+css_error node_state(void *pw, void *n, uint32_t *flags)
+{
+	node *node = n;
+
+	UNUSED(pw);
+
+	*flags = 0;
+
+	if (node->parent == NULL)
+		*flags |= CSS_NODE_STATE_ROOT;
+
+	if (node->children == NULL)
+		*flags |= CSS_NODE_STATE_EMPTY;
+
+	return CSS_OK;
+}
+
+css_error node_attribute_names(void *pw, void *n,
+		lwc_string ***names, uint32_t *n_names)
+{
+	UNUSED(pw);
+	UNUSED(n);
+
+	/* No node has attributes */
+	*names = NULL;
+	*n_names = 0;
+
+	return CSS_OK;
+}
@@ -0,0 +1,334 @@
+/*
+ * Selector hash growth test
+ *
+ * A stylesheet with many class, ID and element selectors is parsed. Its
+ * selector hash must have grown to keep its chains short, and must still
+ * find every selector by name.
+ *
+ * Selectors are then inserted into and removed from a hash once it has
+ * been built in bulk, and once it has grown, whose chains are laid out
+ * together. Every chain must keep its selectors in cascade order.
+ */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libcss/libcss.h>
+
+#include "stylesheet.h"
+#include "select/hash.h"
+#include "utils/utils.h"
+
+#include "testutils.h"
+
+#define N_CLASSES (5000)
+#define N_IDS (500)
+#define N_TYPES (500)
+
+/* Chains are kept to a few selectors, but names may collide */
+#define MAX_CHAIN (16)
+
+/* Selectors sharing a class, and distinct ones which grow the hash */
+#define N_SAME (5)
+#define N_GROW (64)
+
+static void *myrealloc(void *data, size_t len, void *pw)
+{
+	UNUSED(pw);
+
+	return realloc(data, len);
+}
+
+static css_error resolve_url(void *pw,
+		const char *base, lwc_string *rel, lwc_string **abs)
+{
+	UNUSED(pw);
+	UNUSED(base);
+
+	*abs = lwc_string_ref(rel);
+
+	return CSS_OK;
+}
+
+static char *create_sheet_data(void)
+{
+	size_t size = 64 * (N_CLASSES + N_IDS + N_TYPES), len = 0;
+	char *data = malloc(size);
+	uint32_t i;
+
+	assert(data != NULL);
+
+	for (i = 0; i < N_CLASSES; i++) {
+		len += snprintf(data + len, size - len,
+				".c%" PRIu32 " { z-index: 1; }\n", i);
+	}
+
+	for (i = 0; i < N_IDS; i++) {
+		len += snprintf(data + len, size - len,
+				"#i%" PRIu32 " { z-index: 2; }\n", i);
+	}
+
+	for (i = 0; i < N_TYPES; i++) {
+		len += snprintf(data + len, size - len,
+				"e%" PRIu32 " { z-index: 3; }\n", i);
+	}
+
+	assert(len < size);
+
+	return data;
+}
+
+static uint32_t count_matches(const css_selector_hash_entry *entry)
+{
+	uint32_t count = 0;
+
+	while (entry->sel != NULL) {
+		count++;
+
+		assert(css__selector_hash_next(entry, &entry) == CSS_OK);
+	}
+
+	return count;
+}
+
+static void check_finds(css_selector_hash *hash, const char *format,
+		uint32_t n, bool element)
+{
+	const css_selector_hash_entry *entry;
+	char buf[32];
+	uint32_t i;
+
+	for (i = 0; i < n; i++) {
+		lwc_string *name;
+
+		snprintf(buf, sizeof(buf), format, i);
+		assert(lwc_intern_string(buf, strlen(buf),
+				&name) == lwc_error_ok);
+
+		if (element) {
+			css_qname qname = { NULL, name };
+
+			assert(css__selector_hash_find(hash,
+					CSS_PSEUDO_ELEMENT_NONE, &qname,
+					&entry) == CSS_OK);
+		} else if (format[0] == 'c') {
+			assert(css__selector_hash_find_by_class(hash,
+					CSS_PSEUDO_ELEMENT_NONE, name,
+					&entry) == CSS_OK);
+		} else {
+			assert(css__selector_hash_find_by_id(hash,
+					CSS_PSEUDO_ELEMENT_NONE, name,
+					&entry) == CSS_OK);
+		}
+
+		/* Each name keys exactly one selector */
+		assert(count_matches(entry) == 1);
+
+		lwc_string_unref(name);
+	}
+}
+
+static css_stylesheet *create_sheet(const char *data)
+{
+	css_stylesheet_params params;
+	css_stylesheet *sheet;
+
+	params.params_version = CSS_STYLESHEET_PARAMS_VERSION_1;
+	params.level = CSS_LEVEL_21;
+	params.charset = "UTF-8";
+	params.url = "foo";
+	params.title = "foo";
+	params.allow_quirks = false;
+	params.inline_style = false;
+	params.resolve = resolve_url;
+	params.resolve_pw = NULL;
+	params.import = NULL;
+	params.import_pw = NULL;
+	params.color = NULL;
+	params.color_pw = NULL;
+	params.font = NULL;
+	params.font_pw = NULL;
+
+	assert(css_stylesheet_create(&params, myrealloc, NULL,
+			&sheet) == CSS_OK);
+	assert(css_stylesheet_append_data(sheet, (const uint8_t *) data,
+			strlen(data)) == CSS_NEEDDATA);
+	assert(css_stylesheet_data_done(sheet) == CSS_OK);
+
+	return sheet;
+}
+
+static lwc_string *intern(const char *data)
+{
+	lwc_string *name;
+
+	assert(lwc_intern_string(data, strlen(data), &name) == lwc_error_ok);
+
+	return name;
+}
+
+/* The chain of a class must hold exactly the given selectors, in order */
+static void check_chain(css_selector_hash *hash, lwc_string *name,
+		css_selector **expected, uint32_t n)
+{
+	const css_selector_hash_entry *entry;
+	uint32_t i;
+
+	assert(css__selector_hash_find_by_class(hash,
+			CSS_PSEUDO_ELEMENT_NONE, name, &entry) == CSS_OK);
+
+	for (i = 0; i < n; i++) {
+		assert(entry->sel == expected[i]);
+
+		assert(css__selector_hash_next(entry, &entry) == CSS_OK);
+	}
+
+	assert(entry->sel == NULL);
+}
+
+static void check_updates(void)
+{
+	css_selector *same[N_SAME], *grow[N_GROW];
+	css_selector *expected[N_SAME];
+	css_selector_hash_stats stats;
+	css_selector_hash *hash;
+	css_stylesheet *sheet;
+	lwc_string *name;
+	css_rule *rule;
+	char buf[32];
+	char *data;
+	size_t size = 32 * (N_SAME + N_GROW), len = 0;
+	uint32_t i;
+
+	data = malloc(size);
+	assert(data != NULL);
+
+	for (i = 0; i < N_SAME; i++)
+		len += snprintf(data + len, size - len, ".s { z-index: 1; }\n");
+
+	for (i = 0; i < N_GROW; i++) {
+		len += snprintf(data + len, size - len,
+				".g%" PRIu32 " { z-index: 2; }\n", i);
+	}
+
+	assert(len < size);
+
+	sheet = create_sheet(data);
+	free(data);
+
+	/* Every rule has one selector, in the order of the data */
+	rule = sheet->rule_list;
+
+	for (i = 0; i < N_SAME + N_GROW; i++) {
+		css_rule_selector *r = (css_rule_selector *) rule;
+
+		assert(rule != NULL && rule->type == CSS_RULE_SELECTOR);
+
+		if (i < N_SAME)
+			same[i] = r->selectors[0];
+		else
+			grow[i - N_SAME] = r->selectors[0];
+
+		rule = rule->next;
+	}
+
+	name = intern("s");
+
+	assert(css__selector_hash_create_sized(myrealloc, NULL, 4,
+			&hash) == CSS_OK);
+
+	/* Build a chain, then insert into and remove from it */
+	assert(css__selector_hash_defer(hash) == CSS_OK);
+	assert(css__selector_hash_insert(hash, same[0]) == CSS_OK);
+	assert(css__selector_hash_insert(hash, same[2]) == CSS_OK);
+	assert(css__selector_hash_build(hash) == CSS_OK);
+
+	assert(css__selector_hash_insert(hash, same[1]) == CSS_OK);
+	assert(css__selector_hash_insert(hash, same[3]) == CSS_OK);
+
+	check_chain(hash, name, same, 4);
+
+	assert(css__selector_hash_remove(hash, same[2]) == CSS_OK);
+
+	expected[0] = same[0];
+	expected[1] = same[1];
+	expected[2] = same[3];
+	check_chain(hash, name, expected, 3);
+
+	/* Grow the hash, then insert into and remove from its chains */
+	for (i = 0; i < N_GROW; i++)
+		assert(css__selector_hash_insert(hash, grow[i]) == CSS_OK);
+
+	assert(css__selector_hash_stats(hash, &stats) == CSS_OK);
+	assert(stats.n_slots > 4);
+
+	assert(css__selector_hash_insert(hash, same[4]) == CSS_OK);
+	assert(css__selector_hash_insert(hash, same[2]) == CSS_OK);
+
+	check_chain(hash, name, same, N_SAME);
+
+	for (i = 0; i < N_GROW; i += 2)
+		assert(css__selector_hash_remove(hash, grow[i]) == CSS_OK);
+
+	for (i = 0; i < N_GROW; i++) {
+		lwc_string *g;
+
+		snprintf(buf, sizeof(buf), "g%" PRIu32, i);
+		g = intern(buf);
+
+		check_chain(hash, g, &grow[i], i % 2);
+
+		lwc_string_unref(g);
+	}
+
+	check_chain(hash, name, same, N_SAME);
+
+	assert(css__selector_hash_destroy(hash) == CSS_OK);
+	assert(css_stylesheet_destroy(sheet) == CSS_OK);
+
+	lwc_string_unref(name);
+}
+
+int main(int argc, char **argv)
+{
+	css_stylesheet *sheet;
+	css_selector_hash_stats stats;
+	char *data;
+
+	UNUSED(argc);
+	UNUSED(argv);
+
+	data = create_sheet_data();
+
+	sheet = create_sheet(data);
+	free(data);
+
+	/* The sheet's hash began with few slots, so must have grown */
+	assert(css__selector_hash_stats(sheet->selectors,
+			&stats) == CSS_OK);
+
+	printf("%zu selectors in %zu of %zu slots, longest chain %zu\n",
+			stats.n_entries, stats.n_used, stats.n_slots,
+			stats.max_chain);
+
+	assert(stats.n_entries == N_CLASSES + N_IDS + N_TYPES);
+	assert(stats.n_used <= stats.n_entries);
+	assert(stats.n_slots >= (N_CLASSES + N_IDS + N_TYPES) / 2);
+	assert(stats.max_chain <= MAX_CHAIN);
+
+	check_finds(sheet->selectors, "c%" PRIu32, N_CLASSES, false);
+	check_finds(sheet->selectors, "i%" PRIu32, N_IDS, false);
+	check_finds(sheet->selectors, "e%" PRIu32, N_TYPES, true);
+
+	assert(css_stylesheet_destroy(sheet) == CSS_OK);
+
+	check_updates();
+
+	printf("PASS\n");
+
+	return 0;
+}
+
@@ -0,0 +1,140 @@
+/*
+ * Computed style interning test
+ *
+ * Many styles, few of them distinct, are interned by a selection context.
+ * Equal styles must become the same object, distinct ones must not, and
+ * interned styles must remain valid once the context is destroyed.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libcss/libcss.h>
+
+#include "select/computed.h"
+#include "select/propset.h"
+#include "utils/utils.h"
+
+#include "testutils.h"
+
+#define N_STYLES (1000)
+#define N_DISTINCT (10)
+#define N_UNIQUE (5000)
+
+static void *myrealloc(void *data, size_t len, void *pw)
+{
+	UNUSED(pw);
+
+	return realloc(data, len);
+}
+
+/* Styles with an odd z-index also have a cursor, in an uncommon block */
+static css_computed_style *make_style(int32_t z_index, lwc_string *cursor)
+{
+	css_computed_style *style;
+
+	assert(css_computed_style_create(myrealloc, NULL,
+			&style) == CSS_OK);
+	assert(css_computed_style_initialise(style, NULL, NULL) == CSS_OK);
+	assert(set_z_index(style, CSS_Z_INDEX_SET, z_index) == CSS_OK);
+
+	if (z_index % 2 != 0) {
+		lwc_string **urls = malloc(2 * sizeof(lwc_string *));
+
+		assert(urls != NULL);
+
+		urls[0] = cursor;
+		urls[1] = NULL;
+
+		assert(set_cursor(style, CSS_CURSOR_POINTER, urls) == CSS_OK);
+	}
+
+	return style;
+}
+
+int main(int argc, char **argv)
+{
+	static css_computed_style *styles[N_STYLES];
+	static css_computed_style *unique[N_UNIQUE];
+	css_computed_style *style;
+	css_select_ctx *ctx;
+	lwc_string *cursor;
+	uint32_t i, j;
+
+	UNUSED(argc);
+	UNUSED(argv);
+
+	assert(lwc_intern_string("hand.cur", SLEN("hand.cur"),
+			&cursor) == lwc_error_ok);
+
+	assert(css_select_ctx_create(myrealloc, NULL, &ctx) == CSS_OK);
+
+	/* Styles may only be interned once interning is enabled */
+	style = make_style(0, cursor);
+	assert(css_select_ctx_intern_style(ctx, &style) == CSS_INVALID);
+	assert(css_computed_style_destroy(style) == CSS_OK);
+
+	assert(css_select_ctx_set_interning(ctx, true) == CSS_OK);
+
+	for (i = 0; i < N_STYLES; i++) {
+		styles[i] = make_style(i % N_DISTINCT, cursor);
+
+		assert(css_select_ctx_intern_style(ctx,
+				&styles[i]) == CSS_OK);
+
+		/* Equal styles are the same object */
+		assert(styles[i] == styles[i % N_DISTINCT]);
+	}
+
+	for (i = 0; i < N_DISTINCT; i++) {
+		for (j = i + 1; j < N_DISTINCT; j++)
+			assert(styles[i] != styles[j]);
+	}
+
+	/* Interning an interned style leaves it alone */
+	style = styles[0];
+	assert(css_select_ctx_intern_style(ctx, &style) == CSS_OK);
+	assert(style == styles[0]);
+
+	/* Interned styles may not be modified */
+	assert(css_computed_style_compose(styles[1], styles[0], NULL, NULL,
+			styles[0]) == CSS_INVALID);
+
+	/* The table grows to hold many distinct styles */
+	for (i = 0; i < N_UNIQUE; i++) {
+		unique[i] = make_style(N_DISTINCT + i, cursor);
+		style = unique[i];
+
+		assert(css_select_ctx_intern_style(ctx,
+				&unique[i]) == CSS_OK);
+		assert(unique[i] == style);
+	}
+
+	for (i = 0; i < N_UNIQUE; i++)
+		assert(css_computed_style_destroy(unique[i]) == CSS_OK);
+
+	/* Releasing some references leaves the others valid, even once
+	 * the context is destroyed */
+	for (i = N_STYLES / 2; i < N_STYLES; i++)
+		assert(css_computed_style_destroy(styles[i]) == CSS_OK);
+
+	assert(css_select_ctx_destroy(ctx) == CSS_OK);
+
+	for (i = 0; i < N_STYLES / 2; i++) {
+		int32_t z_index = 0;
+
+		assert(css_computed_z_index(styles[i],
+				&z_index) == CSS_Z_INDEX_SET);
+		assert(z_index == (int32_t) (i % N_DISTINCT));
+
+		assert(css_computed_style_destroy(styles[i]) == CSS_OK);
+	}
+
+	lwc_string_unref(cursor);
+
+	printf("PASS\n");
+
+	return 0;
+}
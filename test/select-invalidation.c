@@ -0,0 +1,210 @@
+/*
+ * Invalidation scope test
+ *
+ * A selection context is asked which nodes may need restyling after
+ * various changes to a node, both before and after it is frozen.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libcss/libcss.h>
+#include <libcss/select.h>
+#include <libcss/stylesheet.h>
+
+#include "utils/utils.h"
+
+#include "testutils.h"
+
+typedef struct expectation {
+	css_select_change_type type;
+	const char *name;		/* Name changed, or NULL for state */
+	uint32_t state;			/* State changed */
+	css_select_invalidation scope;	/* Expected scope */
+} expectation;
+
+static const char *sheet_data =
+	"p.self { color: red; }\n"
+	".outer span { color: green; }\n"
+	"div > #child { color: blue; }\n"
+	".before + p, .before2 ~ p { color: #000; }\n"
+	".before2 ~ p .deep { color: #111; }\n"
+	"a:hover, div:focus p { color: #222; }\n"
+	"li:checked + li { color: #333; }\n"
+	"[title] { color: #444; }\n"
+	"div[href] p { color: #555; }\n"
+	"p:lang(en) { color: #777; }\n"
+	"p:not(.negated) { color: #888; }\n"
+	"p.both, .both p { color: #999; }\n"
+	"@media print { .printed p { color: #aaa; } }\n"
+	".unused { }\n";
+
+static const expectation expectations[] = {
+	{ CSS_SELECT_CHANGE_CLASS, "self", 0, CSS_SELECT_INVALIDATE_SELF },
+	{ CSS_SELECT_CHANGE_CLASS, "SELF", 0, CSS_SELECT_INVALIDATE_SELF },
+	{ CSS_SELECT_CHANGE_CLASS, "outer", 0,
+			CSS_SELECT_INVALIDATE_DESCENDANTS },
+	{ CSS_SELECT_CHANGE_CLASS, "before", 0,
+			CSS_SELECT_INVALIDATE_SIBLINGS },
+	{ CSS_SELECT_CHANGE_CLASS, "before2", 0,
+			CSS_SELECT_INVALIDATE_SIBLINGS },
+	{ CSS_SELECT_CHANGE_CLASS, "deep", 0, CSS_SELECT_INVALIDATE_SELF },
+	{ CSS_SELECT_CHANGE_CLASS, "negated", 0, CSS_SELECT_INVALIDATE_SELF },
+	{ CSS_SELECT_CHANGE_CLASS, "both", 0,
+			CSS_SELECT_INVALIDATE_DESCENDANTS },
+	{ CSS_SELECT_CHANGE_CLASS, "printed", 0,
+			CSS_SELECT_INVALIDATE_DESCENDANTS },
+	{ CSS_SELECT_CHANGE_CLASS, "unused", 0, CSS_SELECT_INVALIDATE_NONE },
+	{ CSS_SELECT_CHANGE_CLASS, "absent", 0, CSS_SELECT_INVALIDATE_NONE },
+	{ CSS_SELECT_CHANGE_CLASS, "child", 0, CSS_SELECT_INVALIDATE_NONE },
+
+	{ CSS_SELECT_CHANGE_ID, "child", 0, CSS_SELECT_INVALIDATE_SELF },
+	{ CSS_SELECT_CHANGE_ID, "outer", 0, CSS_SELECT_INVALIDATE_NONE },
+
+	{ CSS_SELECT_CHANGE_ATTRIBUTE, "title", 0,
+			CSS_SELECT_INVALIDATE_SELF },
+	{ CSS_SELECT_CHANGE_ATTRIBUTE, "href", 0,
+			CSS_SELECT_INVALIDATE_DESCENDANTS },
+	{ CSS_SELECT_CHANGE_ATTRIBUTE, "lang", 0,
+			CSS_SELECT_INVALIDATE_DESCENDANTS },
+	{ CSS_SELECT_CHANGE_ATTRIBUTE, "class", 0,
+			CSS_SELECT_INVALIDATE_SIBLINGS },
+	{ CSS_SELECT_CHANGE_ATTRIBUTE, "id", 0, CSS_SELECT_INVALIDATE_SELF },
+	{ CSS_SELECT_CHANGE_ATTRIBUTE, "alt", 0, CSS_SELECT_INVALIDATE_NONE },
+
+	{ CSS_SELECT_CHANGE_STATE, NULL, CSS_NODE_STATE_HOVER,
+			CSS_SELECT_INVALIDATE_SELF },
+	{ CSS_SELECT_CHANGE_STATE, NULL, CSS_NODE_STATE_FOCUS,
+			CSS_SELECT_INVALIDATE_DESCENDANTS },
+	{ CSS_SELECT_CHANGE_STATE, NULL, CSS_NODE_STATE_CHECKED,
+			CSS_SELECT_INVALIDATE_SIBLINGS },
+	{ CSS_SELECT_CHANGE_STATE, NULL,
+			CSS_NODE_STATE_HOVER | CSS_NODE_STATE_FOCUS,
+			CSS_SELECT_INVALIDATE_DESCENDANTS },
+	{ CSS_SELECT_CHANGE_STATE, NULL, CSS_NODE_STATE_VISITED,
+			CSS_SELECT_INVALIDATE_NONE },
+};
+
+static void *myrealloc(void *data, size_t len, void *pw)
+{
+	UNUSED(pw);
+
+	return realloc(data, len);
+}
+
+static css_error resolve_url(void *pw,
+		const char *base, lwc_string *rel, lwc_string **abs)
+{
+	UNUSED(pw);
+	UNUSED(base);
+
+	*abs = lwc_string_ref(rel);
+
+	return CSS_OK;
+}
+
+static void check_expectations(css_select_ctx *select)
+{
+	size_t i;
+
+	for (i = 0; i < sizeof(expectations) / sizeof(expectations[0]); i++) {
+		const expectation *e = &expectations[i];
+		css_select_invalidation scope;
+		css_select_change change;
+
+		change.type = e->type;
+		change.name = NULL;
+		change.state = e->state;
+
+		if (e->name != NULL) {
+			assert(lwc_intern_string(e->name, strlen(e->name),
+					&change.name) == lwc_error_ok);
+		}
+
+		assert(css_select_ctx_invalidation(select, &change,
+				&scope) == CSS_OK);
+
+		if (scope != e->scope) {
+			printf("%s: expected scope %d, got %d\n",
+					e->name != NULL ? e->name : "state",
+					e->scope, scope);
+			assert(0 && "unexpected scope");
+		}
+
+		if (change.name != NULL)
+			lwc_string_unref(change.name);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	css_stylesheet_params params;
+	css_stylesheet *sheet;
+	css_select_ctx *select, *clone;
+	css_select_invalidation scope;
+	css_select_change change;
+
+	UNUSED(argc);
+	UNUSED(argv);
+
+	params.params_version = CSS_STYLESHEET_PARAMS_VERSION_1;
+	params.level = CSS_LEVEL_21;
+	params.charset = "UTF-8";
+	params.url = "foo";
+	params.title = "foo";
+	params.allow_quirks = false;
+	params.inline_style = false;
+	params.resolve = resolve_url;
+	params.resolve_pw = NULL;
+	params.import = NULL;
+	params.import_pw = NULL;
+	params.color = NULL;
+	params.color_pw = NULL;
+	params.font = NULL;
+	params.font_pw = NULL;
+
+	assert(css_stylesheet_create(&params, myrealloc, NULL,
+			&sheet) == CSS_OK);
+	assert(css_stylesheet_append_data(sheet,
+			(const uint8_t *) sheet_data,
+			strlen(sheet_data)) == CSS_NEEDDATA);
+	assert(css_stylesheet_data_done(sheet) == CSS_OK);
+
+	assert(css_select_ctx_create(myrealloc, NULL, &select) == CSS_OK);
+
+	/* Without sheets, no change affects any node */
+	change.type = CSS_SELECT_CHANGE_STATE;
+	change.name = NULL;
+	change.state = CSS_NODE_STATE_HOVER;
+	assert(css_select_ctx_invalidation(select, &change,
+			&scope) == CSS_OK);
+	assert(scope == CSS_SELECT_INVALIDATE_NONE);
+
+	/* Names are required for changes other than of state */
+	change.type = CSS_SELECT_CHANGE_CLASS;
+	assert(css_select_ctx_invalidation(select, &change,
+			&scope) == CSS_BADPARM);
+
+	/* The map must be rebuilt once sheets are added */
+	assert(css_select_ctx_append_sheet(select, sheet, CSS_ORIGIN_AUTHOR,
+			CSS_MEDIA_SCREEN) == CSS_OK);
+	check_expectations(select);
+
+	/* Frozen contexts, and their clones, may be queried too */
+	assert(css_select_ctx_freeze(select) == CSS_OK);
+	check_expectations(select);
+
+	assert(css_select_ctx_clone(select, &clone) == CSS_OK);
+	check_expectations(clone);
+	assert(css_select_ctx_destroy(clone) == CSS_OK);
+
+	assert(css_select_ctx_destroy(select) == CSS_OK);
+	assert(css_stylesheet_destroy(sheet) == CSS_OK);
+
+	printf("PASS\n");
+
+	return 0;
+}
+
@@ -0,0 +1,188 @@
+/*
+ * Extension block sharing test
+ *
+ * Children composed from a parent share the parent's blocks of inherited,
+ * uncommon and page properties where their values are the same. A shared
+ * block must be copied before either style using it is modified, and must
+ * outlive whichever style is destroyed first.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libcss/libcss.h>
+
+#include "select/computed.h"
+#include "select/propget.h"
+#include "select/propset.h"
+#include "utils/utils.h"
+
+#include "testutils.h"
+
+static void *myrealloc(void *data, size_t len, void *pw)
+{
+	UNUSED(pw);
+
+	return realloc(data, len);
+}
+
+/* Every keyword size is 16px, so relative sizes need no table */
+static css_error compute_font_size(void *pw, const css_hint *parent,
+		css_hint *size)
+{
+	UNUSED(pw);
+	UNUSED(parent);
+
+	if (size->status != CSS_FONT_SIZE_DIMENSION) {
+		size->data.length.value = INTTOFIX(16);
+		size->data.length.unit = CSS_UNIT_PX;
+		size->status = CSS_FONT_SIZE_DIMENSION;
+	}
+
+	return CSS_OK;
+}
+
+static css_computed_style *make_style(void)
+{
+	css_computed_style *style;
+
+	assert(css_computed_style_create(myrealloc, NULL,
+			&style) == CSS_OK);
+	assert(css_computed_style_initialise(style, NULL, NULL) == CSS_OK);
+
+	return style;
+}
+
+static void compose(const css_computed_style *parent,
+		css_computed_style *style)
+{
+	assert(css_computed_style_compose(parent, style, compute_font_size,
+			NULL, style) == CSS_OK);
+}
+
+static void check_letter_spacing(const css_computed_style *style,
+		int32_t px)
+{
+	css_fixed length = 0;
+	css_unit unit = CSS_UNIT_EM;
+
+	assert(css_computed_letter_spacing(style, &length,
+			&unit) == CSS_LETTER_SPACING_SET);
+	assert(length == INTTOFIX(px) && unit == CSS_UNIT_PX);
+}
+
+int main(int argc, char **argv)
+{
+	css_computed_style *root, *parent, *child, *sibling, *other;
+	lwc_string **urls, **child_urls = NULL, *cursor;
+	css_fixed count = 0;
+	css_color color = 0;
+	css_unit unit = CSS_UNIT_EM;
+
+	UNUSED(argc);
+	UNUSED(argv);
+
+	assert(lwc_intern_string("hand.cur", SLEN("hand.cur"),
+			&cursor) == lwc_error_ok);
+
+	root = make_style();
+	assert(set_font_size(root, CSS_FONT_SIZE_DIMENSION, INTTOFIX(16),
+			CSS_UNIT_PX) == CSS_OK);
+	assert(set_color(root, CSS_COLOR_COLOR, 0xff000000) == CSS_OK);
+
+	/* The parent has inherited uncommon and page properties */
+	parent = make_style();
+	assert(set_letter_spacing(parent, CSS_LETTER_SPACING_SET,
+			INTTOFIX(2), CSS_UNIT_PX) == CSS_OK);
+	assert(set_orphans(parent, CSS_ORPHANS_SET, INTTOFIX(3)) == CSS_OK);
+
+	urls = malloc(2 * sizeof(lwc_string *));
+	assert(urls != NULL);
+	urls[0] = cursor;
+	urls[1] = NULL;
+	assert(set_cursor(parent, CSS_CURSOR_POINTER, urls) == CSS_OK);
+
+	compose(root, parent);
+
+	/* Children which inherit them share the parent's blocks */
+	child = make_style();
+	assert(set_orphans(child, CSS_ORPHANS_INHERIT, 0) == CSS_OK);
+	compose(parent, child);
+
+	sibling = make_style();
+	compose(parent, sibling);
+
+	assert(child->inherited == parent->inherited);
+	assert(sibling->inherited == parent->inherited);
+	assert(child->uncommon == parent->uncommon);
+	assert(sibling->uncommon == parent->uncommon);
+	assert(child->page == parent->page);
+	assert(sibling->page == NULL);
+	check_letter_spacing(child, 2);
+
+	/* Modifying a style copies the block it shares */
+	assert(set_letter_spacing(child, CSS_LETTER_SPACING_SET,
+			INTTOFIX(5), CSS_UNIT_PX) == CSS_OK);
+	assert(set_orphans(child, CSS_ORPHANS_SET, INTTOFIX(4)) == CSS_OK);
+	assert(set_color(child, CSS_COLOR_COLOR, 0xff00ff00) == CSS_OK);
+
+	assert(child->inherited != parent->inherited);
+	assert(child->uncommon != parent->uncommon);
+	assert(child->page != parent->page);
+	check_letter_spacing(child, 5);
+	check_letter_spacing(parent, 2);
+	check_letter_spacing(sibling, 2);
+
+	assert(get_orphans(parent, &count) == CSS_ORPHANS_SET);
+	assert(count == INTTOFIX(3));
+	assert(get_orphans(child, &count) == CSS_ORPHANS_SET);
+	assert(count == INTTOFIX(4));
+
+	assert(css_computed_color(child, &color) == CSS_COLOR_COLOR);
+	assert(color == 0xff00ff00);
+	assert(css_computed_color(sibling, &color) == CSS_COLOR_COLOR);
+	assert(color == 0xff000000);
+
+	/* The copy has its own references to the parent's strings */
+	assert(css_computed_cursor(child, &child_urls) == CSS_CURSOR_POINTER);
+	assert(child_urls != NULL && child_urls != urls);
+	assert(child_urls[0] == cursor && child_urls[1] == NULL);
+
+	/* Shared blocks outlive the parent */
+	assert(css_computed_style_destroy(parent) == CSS_OK);
+
+	check_letter_spacing(sibling, 2);
+	assert(css_computed_font_size(sibling, &count,
+			&unit) == CSS_FONT_SIZE_DIMENSION);
+	assert(count == INTTOFIX(16) && unit == CSS_UNIT_PX);
+	assert(css_computed_cursor(sibling, &child_urls) ==
+			CSS_CURSOR_POINTER);
+	assert(child_urls[0] == cursor);
+
+	/* A child may not share a block with non-inherited values it lacks */
+	other = make_style();
+	assert(set_outline_color(other, CSS_OUTLINE_COLOR_COLOR,
+			0xff0000ff) == CSS_OK);
+	compose(root, other);
+
+	assert(css_computed_style_destroy(child) == CSS_OK);
+	child = make_style();
+	compose(other, child);
+
+	assert(child->uncommon != NULL && child->uncommon != other->uncommon);
+	assert(css_computed_outline_color(child,
+			&color) == CSS_OUTLINE_COLOR_INVERT);
+
+	assert(css_computed_style_destroy(other) == CSS_OK);
+	assert(css_computed_style_destroy(child) == CSS_OK);
+	assert(css_computed_style_destroy(sibling) == CSS_OK);
+	assert(css_computed_style_destroy(root) == CSS_OK);
+
+	lwc_string_unref(cursor);
+
+	printf("PASS\n");
+
+	return 0;
+}
@@ -0,0 +1,1248 @@
+/*
+ * Multi-threaded selection test
+ *
+ * A generated document is styled by a number of threads at once, sharing a
+ * single frozen selection context. Half of them select each node's style
+ * against the context; the others walk the document with
+ * css_select_subtree(), using clones of it. Every thread must obtain the
+ * same styles as a single-threaded run with an ordinary context.
+ *
+ * Selecting with a frozen context modifies no reference counts, so the
+ * threads take no lock. The handler returns borrowed strings to them.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <libcss/libcss.h>
+#include <libcss/computed.h>
+#include <libcss/select.h>
+#include <libcss/stylesheet.h>
+
+#include "utils/utils.h"
+
+#include "dump_computed.h"
+#include "testutils.h"
+
+/* Number of threads to style the document with */
+#define N_THREADS 4
+
+/* Number of times each thread styles the document */
+#define N_ITERATIONS 5
+
+/* Maximum depth of generated document */
+#define MAX_DEPTH 8
+
+/* Node is hovered */
+#define NODE_HOVER 0x1
+
+typedef struct node {
+	lwc_string *name;
+	lwc_string *id;
+	lwc_string *classes[2];
+	uint32_t n_classes;
+	lwc_string *title;
+	uint32_t flags;
+
+	uint32_t index;
+
+	struct node *parent;
+	struct node *next;
+	struct node *prev;
+	struct node *children;
+	struct node *last_child;
+} node;
+
+typedef struct thread_ctx {
+	css_select_ctx *select;		/* Selection context */
+	bool frozen;			/* Whether select borrows strings */
+	bool subtree;			/* Whether to use css_select_subtree */
+
+	css_select_results **results;	/* Results for each node */
+	uint32_t mismatches;		/* Number of styles not as expected */
+} thread_ctx;
+
+static const char *sheet_data =
+	"html { color: #000; font-family: \"Foo\", serif; }\n"
+	"body { margin: 8px; quotes: \"<\" \">\"; }\n"
+	"div { display: block; padding-left: 1em; }\n"
+	"p { margin-top: 1em; line-height: 1.5; }\n"
+	"span { font-weight: bold; }\n"
+	"a { color: #00f; text-decoration: underline; }\n"
+	"a:hover { color: #f00; }\n"
+	"li { display: list-item; list-style-type: square; }\n"
+	"ul > li { margin-left: 2em; }\n"
+	"div p { font-size: 90%; }\n"
+	"div > p:first-child { text-indent: 2em; }\n"
+	"p + p { margin-top: 0; }\n"
+	"span ~ a { font-style: italic; }\n"
+	".a { background-color: #eee; }\n"
+	".b { border-top-style: solid; border-top-width: 2px; }\n"
+	".a.b { border-top-color: #0f0; }\n"
+	".c span { font-family: monospace; }\n"
+	"div.a > .b { width: 50%; }\n"
+	"#n1 { position: relative; left: 3px; }\n"
+	"#n2 p { z-index: 2; }\n"
+	"[title] { cursor: pointer; }\n"
+	"[title=foo] { opacity: 0.5; }\n"
+	"[title|=en] { font-variant: small-caps; }\n"
+	"[title~=bar] { word-spacing: 4px; }\n"
+	"[title^=fo] { letter-spacing: 1px; }\n"
+	"[title$=ar] { text-transform: uppercase; }\n"
+	"[title*=oo] { vertical-align: top; }\n"
+	"li:nth-child(2n+1) { color: #888; }\n"
+	"li:last-child { margin-bottom: 1em; }\n"
+	"p:only-of-type { float: left; }\n"
+	":root { font-size: 12pt; }\n"
+	"span:empty { display: none; }\n"
+	".d { background-image: url(d.png); cursor: url(d.cur), help; }\n"
+	"ul { list-style-image: url(ul.png); counter-reset: a 2 b; }\n"
+	"p::before { content: \"[\" counter(a) \"]\"; counter-increment: a; }\n"
+	"li::after { content: open-quote attr(title) close-quote; }\n"
+	"div::first-line { font-weight: bold; }\n"
+	"@media screen { .c { max-width: 10em; } }\n"
+	"@media print { p { color: #f0f; } }\n";
+
+static const char *names[] = { "div", "p", "span", "a", "ul", "li" };
+static const char *classes[] = { "a", "b", "c", "d" };
+static const char *ids[] = { "n1", "n2", "n3" };
+static const char *titles[] = { "foo", "en-GB", "foo bar", "qux" };
+
+static lwc_string *attr_class;
+static lwc_string *attr_id;
+static lwc_string *attr_title;
+static lwc_string *name_a;
+static lwc_string *hint_image;
+
+static node **nodes;
+static uint32_t n_nodes;
+
+static uint32_t *expected;
+static uint32_t seed = 1;
+
+static node *create_node(node *parent, const char *name);
+static void generate(node *parent, uint32_t depth);
+static void destroy_node(node *n);
+static lwc_string *intern(const char *data);
+static lwc_string *give_string(thread_ctx *tc, lwc_string *str);
+static uint32_t next_random(uint32_t range);
+static double now(void);
+static uint32_t hash_results(const css_select_results *results);
+static void *run_thread(void *pw);
+static css_error style_node(thread_ctx *tc, node *n);
+
+static css_error node_name(void *pw, void *node,
+		css_qname *qname);
+static css_error node_classes(void *pw, void *node,
+		lwc_string ***classes, uint32_t *n_classes);
+static css_error node_id(void *pw, void *node,
+		lwc_string **id);
+static css_error named_ancestor_node(void *pw, void *node,
+		const css_qname *qname,
+		void **ancestor);
+static css_error named_parent_node(void *pw, void *node,
+		const css_qname *qname,
+		void **parent);
+static css_error named_sibling_node(void *pw, void *node,
+		const css_qname *qname,
+		void **sibling);
+static css_error named_generic_sibling_node(void *pw, void *node,
+		const css_qname *qname,
+		void **sibling);
+static css_error parent_node(void *pw, void *node, void **parent);
+static css_error sibling_node(void *pw, void *node, void **sibling);
+static css_error node_has_name(void *pw, void *node,
+		const css_qname *qname,
+		bool *match);
+static css_error node_has_class(void *pw, void *node,
+		lwc_string *name,
+		bool *match);
+static css_error node_has_id(void *pw, void *node,
+		lwc_string *name,
+		bool *match);
+static css_error node_has_attribute(void *pw, void *node,
+		const css_qname *qname,
+		bool *match);
+static css_error node_has_attribute_equal(void *pw, void *node,
+		const css_qname *qname,
+		lwc_string *value,
+		bool *match);
+static css_error node_has_attribute_dashmatch(void *pw, void *node,
+		const css_qname *qname,
+		lwc_string *value,
+		bool *match);
+static css_error node_has_attribute_includes(void *pw, void *node,
+		const css_qname *qname,
+		lwc_string *value,
+		bool *match);
+static css_error node_has_attribute_prefix(void *pw, void *node,
+		const css_qname *qname,
+		lwc_string *value,
+		bool *match);
+static css_error node_has_attribute_suffix(void *pw, void *node,
+		const css_qname *qname,
+		lwc_string *value,
+		bool *match);
+static css_error node_has_attribute_substring(void *pw, void *node,
+		const css_qname *qname,
+		lwc_string *value,
+		bool *match);
+static css_error node_is_root(void *pw, void *node, bool *match);
+static css_error node_count_siblings(void *pw, void *node,
+		bool same_name, bool after, int32_t *count);
+static css_error node_is_empty(void *pw, void *node, bool *match);
+static css_error node_is_link(void *pw, void *node, bool *match);
+static css_error node_is_hover(void *pw, void *node, bool *match);
+static css_error node_is_false(void *pw, void *node, bool *match);
+static css_error node_is_lang(void *pw, void *node,
+		lwc_string *lang,
+		bool *match);
+static css_error node_presentational_hint(void *pw, void *node,
+		uint32_t property, css_hint *hint);
+static css_error ua_default_for_property(void *pw, uint32_t property,
+		css_hint *hint);
+static css_error compute_font_size(void *pw, const css_hint *parent,
+		css_hint *size);
+
+static css_error first_child(void *pw, void *node, void **child);
+static css_error next_sibling(void *pw, void *node, void **sibling);
+static css_error node_inline_style(void *pw, void *node,
+		const css_stylesheet **inline_style);
+static css_error parent_style(void *pw, void *node,
+		const css_computed_style **style);
+static css_error visit(void *pw, void *node, css_select_results *results);
+
+static css_select_handler select_handler = {
+	CSS_SELECT_HANDLER_VERSION_1,
+
+	node_name,
+	node_classes,
+	node_id,
+	named_ancestor_node,
+	named_parent_node,
+	named_sibling_node,
+	named_generic_sibling_node,
+	parent_node,
+	sibling_node,
+	node_has_name,
+	node_has_class,
+	node_has_id,
+	node_has_attribute,
+	node_has_attribute_equal,
+	node_has_attribute_dashmatch,
+	node_has_attribute_includes,
+	node_has_attribute_prefix,
+	node_has_attribute_suffix,
+	node_has_attribute_substring,
+	node_is_root,
+	node_count_siblings,
+	node_is_empty,
+	node_is_link,
+	node_is_false,		/* visited */
+	node_is_hover,
+	node_is_false,		/* active */
+	node_is_false,		/* focus */
+	node_is_false,		/* enabled */
+	node_is_false,		/* disabled */
+	node_is_false,		/* checked */
+	node_is_false,		/* target */
+	node_is_lang,
+	node_presentational_hint,
+	ua_default_for_property,
+	compute_font_size,
+	NULL,			/* node_state; unused in version 1 */
+	NULL			/* node_attribute_names; unused in version 1 */
+};
+
+static css_select_visitor select_visitor = {
+	CSS_SELECT_VISITOR_VERSION_1,
+
+	first_child,
+	next_sibling,
+	node_inline_style,
+	parent_style,
+	visit
+};
+
+static void *myrealloc(void *data, size_t len, void *pw)
+{
+	UNUSED(pw);
+
+	return realloc(data, len);
+}
+
+static css_error resolve_url(void *pw,
+		const char *base, lwc_string *rel, lwc_string **abs)
+{
+	UNUSED(pw);
+	UNUSED(base);
+
+	*abs = lwc_string_ref(rel);
+
+	return CSS_OK;
+}
+
+static void prepare_string(lwc_string *str, void *pw)
+{
+	bool match;
+
+	UNUSED(pw);
+
+	/* Intern the string's caseless form, so that comparing it on
+	 * several threads doesn't modify LibWapcaplet's string table */
+	assert(lwc_string_caseless_isequal(str, str, &match) == lwc_error_ok);
+}
+
+int main(int argc, char **argv)
+{
+	css_stylesheet_params params;
+	css_stylesheet *sheet;
+	css_select_ctx *reference;
+	css_select_ctx *select;
+	pthread_t threads[N_THREADS];
+	thread_ctx tcs[N_THREADS];
+	thread_ctx single;
+	double start, single_time, threaded_time;
+	uint32_t i, j;
+	node *root, *n;
+
+	UNUSED(argc);
+	UNUSED(argv);
+
+	/* Create the document */
+	attr_class = intern("class");
+	attr_id = intern("id");
+	attr_title = intern("title");
+	name_a = intern("a");
+	hint_image = intern("title.png");
+
+	root = create_node(NULL, "html");
+	generate(create_node(root, "body"), 1);
+
+	nodes = malloc(n_nodes * sizeof(node *));
+	assert(nodes != NULL);
+
+	/* Index the nodes in document order */
+	for (n = root; n != NULL; ) {
+		nodes[n->index] = n;
+
+		if (n->children != NULL) {
+			n = n->children;
+		} else {
+			while (n != NULL && n->next == NULL)
+				n = n->parent;
+			if (n != NULL)
+				n = n->next;
+		}
+	}
+
+	/* Create the frozen selection context */
+	params.params_version = CSS_STYLESHEET_PARAMS_VERSION_1;
+	params.level = CSS_LEVEL_21;
+	params.charset = "UTF-8";
+	params.url = "foo";
+	params.title = "foo";
+	params.allow_quirks = false;
+	params.inline_style = false;
+	params.resolve = resolve_url;
+	params.resolve_pw = NULL;
+	params.import = NULL;
+	params.import_pw = NULL;
+	params.color = NULL;
+	params.color_pw = NULL;
+	params.font = NULL;
+	params.font_pw = NULL;
+
+	assert(css_stylesheet_create(&params, myrealloc, NULL,
+			&sheet) == CSS_OK);
+	assert(css_stylesheet_append_data(sheet,
+			(const uint8_t *) sheet_data,
+			strlen(sheet_data)) == CSS_NEEDDATA);
+	assert(css_stylesheet_data_done(sheet) == CSS_OK);
+
+	assert(css_select_ctx_create(myrealloc, NULL, &reference) == CSS_OK);
+	assert(css_select_ctx_append_sheet(reference, sheet,
+			CSS_ORIGIN_AUTHOR, CSS_MEDIA_ALL) == CSS_OK);
+
+	assert(css_select_ctx_create(myrealloc, NULL, &select) == CSS_OK);
+	assert(css_select_ctx_append_sheet(select, sheet, CSS_ORIGIN_AUTHOR,
+			CSS_MEDIA_ALL) == CSS_OK);
+	assert(css_select_ctx_freeze(select) == CSS_OK);
+
+	/* Sheets may no longer be changed, nor may thread-private state
+	 * be used directly */
+	assert(css_select_ctx_remove_sheet(select, sheet) == CSS_INVALID);
+	assert(css_select_ctx_begin_pass(select) == CSS_INVALID);
+	assert(css_select_bloom_push(select, root, &select_handler,
+			NULL) == CSS_INVALID);
+
+	/* Style the document on a single thread, with an ordinary context,
+	 * to obtain the expected styles and a baseline time */
+	expected = malloc(n_nodes * sizeof(uint32_t));
+	assert(expected != NULL);
+
+	memset(&single, 0, sizeof(single));
+	single.select = reference;
+	single.results = calloc(n_nodes, sizeof(css_select_results *));
+	assert(single.results != NULL);
+
+	start = now();
+
+	for (j = 0; j < N_ITERATIONS; j++) {
+		for (i = 0; i < n_nodes; i++) {
+			assert(style_node(&single, nodes[i]) == CSS_OK);
+			expected[i] = hash_results(single.results[i]);
+		}
+	}
+
+	single_time = now() - start;
+
+	for (i = 0; i < n_nodes; i++)
+		css_select_results_destroy(single.results[i]);
+	free(single.results);
+
+	css_select_ctx_destroy(reference);
+
+	/* Prepare the threads: those walking subtrees need their own
+	 * clone of the selection context */
+	for (i = 0; i < N_THREADS; i++) {
+		tcs[i].subtree = (i % 2) == 1;
+		tcs[i].select = select;
+		tcs[i].frozen = true;
+		tcs[i].mismatches = 0;
+		tcs[i].results = calloc(n_nodes, sizeof(css_select_results *));
+		assert(tcs[i].results != NULL);
+
+		if (tcs[i].subtree) {
+			assert(css_select_ctx_clone(select,
+					&tcs[i].select) == CSS_OK);
+		}
+	}
+
+	lwc_iterate_strings(prepare_string, NULL);
+
+	/* Style the document on all threads at once */
+	start = now();
+
+	for (i = 0; i < N_THREADS; i++) {
+		assert(pthread_create(&threads[i], NULL,
+				run_thread, &tcs[i]) == 0);
+	}
+
+	for (i = 0; i < N_THREADS; i++)
+		assert(pthread_join(threads[i], NULL) == 0);
+
+	threaded_time = now() - start;
+
+	printf("%" PRIu32 " nodes, %d iterations\n", n_nodes, N_ITERATIONS);
+	printf("1 thread: %.1f ms\n", single_time * 1000);
+	printf("%d threads: %.1f ms, %.2f times the throughput\n", N_THREADS,
+			threaded_time * 1000,
+			N_THREADS * single_time / threaded_time);
+
+	/* Clean up */
+	for (i = 0; i < N_THREADS; i++) {
+		assert(tcs[i].mismatches == 0);
+
+		for (j = 0; j < n_nodes; j++) {
+			if (tcs[i].results[j] != NULL)
+				css_select_results_destroy(tcs[i].results[j]);
+		}
+		free(tcs[i].results);
+
+		if (tcs[i].subtree)
+			css_select_ctx_destroy(tcs[i].select);
+	}
+
+	css_select_ctx_destroy(select);
+	css_stylesheet_destroy(sheet);
+
+	destroy_node(root);
+	free(nodes);
+	free(expected);
+
+	lwc_string_unref(attr_class);
+	lwc_string_unref(attr_id);
+	lwc_string_unref(attr_title);
+	lwc_string_unref(name_a);
+	lwc_string_unref(hint_image);
+
+	printf("PASS\n");
+
+	return 0;
+}
+
+void *run_thread(void *pw)
+{
+	thread_ctx *tc = pw;
+	uint32_t i, j;
+
+	for (j = 0; j < N_ITERATIONS; j++) {
+		if (tc->subtree) {
+			assert(css_select_subtree(tc->select, nodes[0],
+					CSS_MEDIA_SCREEN, &select_handler, tc,
+					&select_visitor) == CSS_OK);
+		} else {
+			for (i = 0; i < n_nodes; i++) {
+				assert(style_node(tc, nodes[i]) == CSS_OK);
+
+				if (hash_results(tc->results[i]) !=
+						expected[i])
+					tc->mismatches++;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+css_error style_node(thread_ctx *tc, node *n)
+{
+	css_select_results *results;
+	const css_computed_style *parent;
+	uint32_t i;
+	css_error error;
+
+	error = css_select_style(tc->select, n, CSS_MEDIA_SCREEN, NULL,
+			&select_handler, tc, &results);
+	if (error != CSS_OK)
+		return error;
+
+	/* Nodes are styled in document order, so the parent's composed
+	 * style is available */
+	if (n->parent != NULL) {
+		parent = tc->results[n->parent->index]->styles[
+				CSS_PSEUDO_ELEMENT_NONE];
+
+		error = css_computed_style_compose(parent,
+				results->styles[CSS_PSEUDO_ELEMENT_NONE],
+				compute_font_size, NULL,
+				results->styles[CSS_PSEUDO_ELEMENT_NONE]);
+		if (error != CSS_OK)
+			return error;
+	}
+
+	for (i = CSS_PSEUDO_ELEMENT_NONE + 1; i < CSS_PSEUDO_ELEMENT_COUNT;
+			i++) {
+		if (results->styles[i] == NULL)
+			continue;
+
+		error = css_computed_style_compose(
+				results->styles[CSS_PSEUDO_ELEMENT_NONE],
+				results->styles[i], compute_font_size, NULL,
+				results->styles[i]);
+		if (error != CSS_OK)
+			return error;
+	}
+
+	if (tc->results[n->index] != NULL)
+		css_select_results_destroy(tc->results[n->index]);
+	tc->results[n->index] = results;
+
+	return CSS_OK;
+}
+
+uint32_t hash_results(const css_select_results *results)
+{
+	char buf[8192];
+	uint32_t hash = 0x811c9dc5;
+	uint32_t i;
+	size_t j, len;
+
+	for (i = 0; i < CSS_PSEUDO_ELEMENT_COUNT; i++) {
+		hash ^= i;
+		hash *= 0x01000193;
+
+		if (results->styles[i] == NULL)
+			continue;
+
+		len = sizeof(buf);
+		dump_computed_style(results->styles[i], buf, &len);
+
+		for (j = 0; j < sizeof(buf) - len; j++) {
+			hash ^= (uint8_t) buf[j];
+			hash *= 0x01000193;
+		}
+	}
+
+	return hash;
+}
+
+node *create_node(node *parent, const char *name)
+{
+	node *n = calloc(1, sizeof(node));
+	assert(n != NULL);
+
+	n->name = intern(name);
+	n->index = n_nodes++;
+
+	if (parent != NULL) {
+		n->parent = parent;
+
+		if (parent->children == NULL) {
+			parent->children = n;
+		} else {
+			parent->last_child->next = n;
+			n->prev = parent->last_child;
+		}
+		parent->last_child = n;
+	}
+
+	return n;
+}
+
+void generate(node *parent, uint32_t depth)
+{
+	uint32_t i, n_children;
+
+	if (depth >= MAX_DEPTH)
+		return;
+
+	n_children = depth < 4 ? 3 + next_random(3) : next_random(5);
+
+	for (i = 0; i < n_children; i++) {
+		node *n = create_node(parent,
+				names[next_random(N_ELEMENTS(names))]);
+
+		if (next_random(3) == 0) {
+			n->classes[n->n_classes++] =
+				intern(classes[next_random(N_ELEMENTS(classes))]);
+			if (next_random(2) == 0) {
+				n->classes[n->n_classes++] = intern(classes[
+					next_random(N_ELEMENTS(classes))]);
+			}
+		}
+
+		if (next_random(20) == 0)
+			n->id = intern(ids[next_random(N_ELEMENTS(ids))]);
+
+		if (next_random(5) == 0) {
+			n->title =
+				intern(titles[next_random(N_ELEMENTS(titles))]);
+		}
+
+		if (next_random(10) == 0)
+			n->flags |= NODE_HOVER;
+
+		generate(n, depth + 1);
+	}
+}
+
+void destroy_node(node *n)
+{
+	node *c, *next;
+	uint32_t i;
+
+	for (c = n->children; c != NULL; c = next) {
+		next = c->next;
+		destroy_node(c);
+	}
+
+	lwc_string_unref(n->name);
+	if (n->id != NULL)
+		lwc_string_unref(n->id);
+	for (i = 0; i < n->n_classes; i++)
+		lwc_string_unref(n->classes[i]);
+	if (n->title != NULL)
+		lwc_string_unref(n->title);
+
+	free(n);
+}
+
+lwc_string *intern(const char *data)
+{
+	lwc_string *str;
+
+	assert(lwc_intern_string(data, strlen(data), &str) == lwc_error_ok);
+
+	return str;
+}
+
+lwc_string *give_string(thread_ctx *tc, lwc_string *str)
+{
+	/* Frozen contexts borrow the strings they are given */
+	return tc->frozen ? str : lwc_string_ref(str);
+}
+
+uint32_t next_random(uint32_t range)
+{
+	seed = seed * 1103515245 + 12345;
+
+	return (seed >> 16) % range;
+}
+
+double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static lwc_string *node_attribute(node *n, const css_qname *qname)
+{
+	bool match;
+
+	assert(lwc_string_caseless_isequal(qname->name, attr_title,
+			&match) == lwc_error_ok);
+	if (match)
+		return n->title;
+
+	assert(lwc_string_caseless_isequal(qname->name, attr_id,
+			&match) == lwc_error_ok);
+	if (match)
+		return n->id;
+
+	assert(lwc_string_caseless_isequal(qname->name, attr_class,
+			&match) == lwc_error_ok);
+	if (match)
+		return n->n_classes > 0 ? n->classes[0] : NULL;
+
+	return NULL;
+}
+
+static bool node_is_named(node *n, const css_qname *qname)
+{
+	bool match;
+
+	assert(lwc_string_caseless_isequal(qname->name, n->name,
+			&match) == lwc_error_ok);
+
+	return match;
+}
+
+css_error node_name(void *pw, void *n, css_qname *qname)
+{
+	node *node = n;
+
+	qname->ns = NULL;
+	qname->name = give_string(pw, node->name);
+
+	return CSS_OK;
+}
+
+css_error node_classes(void *pw, void *n,
+		lwc_string ***classes, uint32_t *n_classes)
+{
+	node *node = n;
+	uint32_t i;
+
+	*classes = NULL;
+	*n_classes = 0;
+
+	if (node->n_classes > 0) {
+		*classes = malloc(node->n_classes * sizeof(lwc_string *));
+		if (*classes == NULL)
+			return CSS_NOMEM;
+
+		for (i = 0; i < node->n_classes; i++)
+			(*classes)[i] = give_string(pw, node->classes[i]);
+
+		*n_classes = node->n_classes;
+	}
+
+	return CSS_OK;
+}
+
+css_error node_id(void *pw, void *n, lwc_string **id)
+{
+	node *node = n;
+
+	*id = node->id != NULL ? give_string(pw, node->id) : NULL;
+
+	return CSS_OK;
+}
+
+css_error named_ancestor_node(void *pw, void *n,
+		const css_qname *qname, void **ancestor)
+{
+	node *node = n;
+
+	UNUSED(pw);
+
+	for (node = node->parent; node != NULL; node = node->parent) {
+		if (node_is_named(node, qname))
+			break;
+	}
+
+	*ancestor = (void *) node;
+
+	return CSS_OK;
+}
+
+css_error named_parent_node(void *pw, void *n,
+		const css_qname *qname, void **parent)
+{
+	node *node = n;
+
+	UNUSED(pw);
+
+	*parent = NULL;
+	if (node->parent != NULL && node_is_named(node->parent, qname))
+		*parent = (void *) node->parent;
+
+	return CSS_OK;
+}
+
+css_error named_sibling_node(void *pw, void *n,
+		const css_qname *qname, void **sibling)
+{
+	node *node = n;
+
+	UNUSED(pw);
+
+	*sibling = NULL;
+	if (node->prev != NULL && node_is_named(node->prev, qname))
+		*sibling = (void *) node->prev;
+
+	return CSS_OK;
+}
+
+css_error named_generic_sibling_node(void *pw, void *n,
+		const css_qname *qname, void **sibling)
+{
+	node *node = n;
+
+	UNUSED(pw);
+
+	for (node = node->prev; node != NULL; node = node->prev) {
+		if (node_is_named(node, qname))
+			break;
+	}
+
+	*sibling = (void *) node;
+
+	return CSS_OK;
+}
+
+css_error parent_node(void *pw, void *n, void **parent)
+{
+	node *node = n;
+
+	UNUSED(pw);
+
+	*parent = (void *) node->parent;
+
+	return CSS_OK;
+}
+
+css_error sibling_node(void *pw, void *n, void **sibling)
+{
+	node *node = n;
+
+	UNUSED(pw);
+
+	*sibling = (void *) node->prev;
+
+	return CSS_OK;
+}
+
+css_error node_has_name(void *pw, void *n,
+		const css_qname *qname, bool *match)
+{
+	UNUSED(pw);
+
+	*match = node_is_named(n, qname);
+
+	return CSS_OK;
+}
+
+css_error node_has_class(void *pw, void *n,
+		lwc_string *name, bool *match)
+{
+	node *node = n;
+	uint32_t i;
+
+	UNUSED(pw);
+
+	/* Classes are case-sensitive in HTML */
+	*match = false;
+	for (i = 0; i < node->n_classes; i++) {
+		if (name == node->classes[i])
+			*match = true;
+	}
+
+	return CSS_OK;
+}
+
+css_error node_has_id(void *pw, void *n,
+		lwc_string *name, bool *match)
+{
+	node *node = n;
+
+	UNUSED(pw);
+
+	*match = name == node->id;
+
+	return CSS_OK;
+}
+
+css_error node_has_attribute(void *pw, void *n,
+		const css_qname *qname, bool *match)
+{
+	UNUSED(pw);
+
+	*match = node_attribute(n, qname) != NULL;
+
+	return CSS_OK;
+}
+
+css_error node_has_attribute_equal(void *pw, void *n,
+		const css_qname *qname, lwc_string *value, bool *match)
+{
+	UNUSED(pw);
+
+	*match = node_attribute(n, qname) == value;
+
+	return CSS_OK;
+}
+
+css_error node_has_attribute_dashmatch(void *pw, void *n,
+		const css_qname *qname, lwc_string *value, bool *match)
+{
+	lwc_string *attr = node_attribute(n, qname);
+	size_t vlen = lwc_string_length(value);
+
+	UNUSED(pw);
+
+	*match = attr != NULL && lwc_string_length(attr) >= vlen &&
+			memcmp(lwc_string_data(attr),
+				lwc_string_data(value), vlen) == 0 &&
+			(lwc_string_length(attr) == vlen ||
+				lwc_string_data(attr)[vlen] == '-');
+
+	return CSS_OK;
+}
+
+css_error node_has_attribute_includes(void *pw, void *n,
+		const css_qname *qname, lwc_string *value, bool *match)
+{
+	lwc_string *attr = node_attribute(n, qname);
+	size_t vlen = lwc_string_length(value);
+	const char *p, *start, *end;
+
+	UNUSED(pw);
+
+	*match = false;
+	if (attr == NULL)
+		return CSS_OK;
+
+	end = lwc_string_data(attr) + lwc_string_length(attr);
+
+	for (p = start = lwc_string_data(attr); p <= end; p++) {
+		if (p == end || *p == ' ') {
+			if ((size_t) (p - start) == vlen && memcmp(start,
+					lwc_string_data(value), vlen) == 0) {
+				*match = true;
+				break;
+			}
+
+			start = p + 1;
+		}
+	}
+
+	return CSS_OK;
+}
+
+css_error node_has_attribute_prefix(void *pw, void *n,
+		const css_qname *qname, lwc_string *value, bool *match)
+{
+	lwc_string *attr = node_attribute(n, qname);
+	size_t vlen = lwc_string_length(value);
+
+	UNUSED(pw);
+
+	*match = attr != NULL && lwc_string_length(attr) >= vlen &&
+			memcmp(lwc_string_data(attr),
+				lwc_string_data(value), vlen) == 0;
+
+	return CSS_OK;
+}
+
+css_error node_has_attribute_suffix(void *pw, void *n,
+		const css_qname *qname, lwc_string *value, bool *match)
+{
+	lwc_string *attr = node_attribute(n, qname);
+	size_t vlen = lwc_string_length(value);
+
+	UNUSED(pw);
+
+	*match = attr != NULL && lwc_string_length(attr) >= vlen &&
+			memcmp(lwc_string_data(attr) +
+				lwc_string_length(attr) - vlen,
+				lwc_string_data(value), vlen) == 0;
+
+	return CSS_OK;
+}
+
+css_error node_has_attribute_substring(void *pw, void *n,
+		const css_qname *qname, lwc_string *value, bool *match)
+{
+	lwc_string *attr = node_attribute(n, qname);
+	size_t vlen = lwc_string_length(value);
+	size_t i;
+
+	UNUSED(pw);
+
+	*match = false;
+	if (attr == NULL || lwc_string_length(attr) < vlen)
+		return CSS_OK;
+
+	for (i = 0; i + vlen <= lwc_string_length(attr); i++) {
+		if (memcmp(lwc_string_data(attr) + i,
+				lwc_string_data(value), vlen) == 0) {
+			*match = true;
+			break;
+		}
+	}
+
+	return CSS_OK;
+}
+
+css_error node_is_root(void *pw, void *n, bool *match)
+{
+	node *node = n;
+
+	UNUSED(pw);
+
+	*match = node->parent == NULL;
+
+	return CSS_OK;
+}
+
+css_error node_count_siblings(void *pw, void *n,
+		bool same_name, bool after, int32_t *count)
+{
+	node *node = n;
+	lwc_string *name = node->name;
+	int32_t cnt = 0;
+
+	UNUSED(pw);
+
+	for (node = after ? node->next : node->prev; node != NULL;
+			node = after ? node->next : node->prev) {
+		/* Names are interned, and all lower case */
+		if (same_name == false || node->name == name)
+			cnt++;
+	}
+
+	*count = cnt;
+
+	return CSS_OK;
+}
+
+css_error node_is_empty(void *pw, void *n, bool *match)
+{
+	node *node = n;
+
+	UNUSED(pw);
+
+	*match = node->children == NULL;
+
+	return CSS_OK;
+}
+
+css_error node_is_link(void *pw, void *n, bool *match)
+{
+	node *node = n;
+
+	UNUSED(pw);
+
+	*match = node->name == name_a;
+
+	return CSS_OK;
+}
+
+css_error node_is_hover(void *pw, void *n, bool *match)
+{
+	node *node = n;
+
+	UNUSED(pw);
+
+	*match = (node->flags & NODE_HOVER) != 0;
+
+	return CSS_OK;
+}
+
+css_error node_is_false(void *pw, void *n, bool *match)
+{
+	UNUSED(pw);
+	UNUSED(n);
+
+	*match = false;
+
+	return CSS_OK;
+}
+
+css_error node_is_lang(void *pw, void *n,
+		lwc_string *lang, bool *match)
+{
+	UNUSED(pw);
+	UNUSED(n);
+	UNUSED(lang);
+
+	*match = false;
+
+	return CSS_OK;
+}
+
+css_error node_presentational_hint(void *pw, void *n,
+		uint32_t property, css_hint *hint)
+{
+	node *node = n;
+
+	if (property == CSS_PROP_BACKGROUND_IMAGE && node->title != NULL) {
+		hint->data.string = give_string(pw, hint_image);
+		hint->status = CSS_BACKGROUND_IMAGE_IMAGE;
+
+		return CSS_OK;
+	}
+
+	return CSS_PROPERTY_NOT_SET;
+}
+
+css_error ua_default_for_property(void *pw, uint32_t property, css_hint *hint)
+{
+	UNUSED(pw);
+
+	if (property == CSS_PROP_COLOR) {
+		hint->data.color = 0xff000000;
+		hint->status = CSS_COLOR_COLOR;
+	} else if (property == CSS_PROP_FONT_FAMILY) {
+		hint->data.strings = NULL;
+		hint->status = CSS_FONT_FAMILY_SANS_SERIF;
+	} else if (property == CSS_PROP_QUOTES) {
+		hint->data.strings = NULL;
+		hint->status = CSS_QUOTES_NONE;
+	} else if (property == CSS_PROP_VOICE_FAMILY) {
+		hint->data.strings = NULL;
+		hint->status = 0;
+	} else {
+		return CSS_INVALID;
+	}
+
+	return CSS_OK;
+}
+
+css_error compute_font_size(void *pw, const css_hint *parent, css_hint *size)
+{
+	static const css_hint_length sizes[] = {
+		{ FLTTOFIX(6.75), CSS_UNIT_PT },
+		{ FLTTOFIX(7.50), CSS_UNIT_PT },
+		{ FLTTOFIX(9.75), CSS_UNIT_PT },
+		{ FLTTOFIX(12.0), CSS_UNIT_PT },
+		{ FLTTOFIX(13.5), CSS_UNIT_PT },
+		{ FLTTOFIX(18.0), CSS_UNIT_PT },
+		{ FLTTOFIX(24.0), CSS_UNIT_PT }
+	};
+	const css_hint_length *parent_size;
+
+	UNUSED(pw);
+
+	/* Grab parent size, defaulting to medium if none */
+	if (parent == NULL)
+		parent_size = &sizes[CSS_FONT_SIZE_MEDIUM - 1];
+	else
+		parent_size = &parent->data.length;
+
+	if (size->status < CSS_FONT_SIZE_LARGER) {
+		/* Keyword -- simple */
+		size->data.length = sizes[size->status - 1];
+	} else if (size->status == CSS_FONT_SIZE_LARGER) {
+		size->data.length.value =
+				FMUL(parent_size->value, FLTTOFIX(1.2));
+		size->data.length.unit = parent_size->unit;
+	} else if (size->status == CSS_FONT_SIZE_SMALLER) {
+		size->data.length.value =
+				FDIV(parent_size->value, FLTTOFIX(1.2));
+		size->data.length.unit = parent_size->unit;
+	} else if (size->data.length.unit == CSS_UNIT_EM ||
+			size->data.length.unit == CSS_UNIT_EX) {
+		size->data.length.value =
+			FMUL(size->data.length.value, parent_size->value);
+
+		if (size->data.length.unit == CSS_UNIT_EX) {
+			size->data.length.value = FMUL(size->data.length.value,
+					FLTTOFIX(0.6));
+		}
+
+		size->data.length.unit = parent_size->unit;
+	} else if (size->data.length.unit == CSS_UNIT_PCT) {
+		size->data.length.value = FDIV(FMUL(size->data.length.value,
+				parent_size->value), FLTTOFIX(100));
+		size->data.length.unit = parent_size->unit;
+	}
+
+	size->status = CSS_FONT_SIZE_DIMENSION;
+
+	return CSS_OK;
+}
+
+css_error first_child(void *pw, void *n, void **child)
+{
+	node *node = n;
+
+	UNUSED(pw);
+
+	*child = (void *) node->children;
+
+	return CSS_OK;
+}
+
+css_error next_sibling(void *pw, void *n, void **sibling)
+{
+	node *node = n;
+
+	UNUSED(pw);
+
+	*sibling = (void *) node->next;
+
+	return CSS_OK;
+}
+
+css_error node_inline_style(void *pw, void *n,
+		const css_stylesheet **inline_style)
+{
+	UNUSED(pw);
+	UNUSED(n);
+
+	*inline_style = NULL;
+
+	return CSS_OK;
+}
+
+css_error parent_style(void *pw, void *n, const css_computed_style **style)
+{
+	thread_ctx *tc = pw;
+	node *node = n;
+
+	*style = tc->results[node->parent->index]->styles[
+			CSS_PSEUDO_ELEMENT_NONE];
+
+	return CSS_OK;
+}
+
+css_error visit(void *pw, void *n, css_select_results *results)
+{
+	thread_ctx *tc = pw;
+	node *node = n;
+
+	if (hash_results(results) != expected[node->index])
+		tc->mismatches++;
+
+	/* The previous results for the node are no longer needed, as
+	 * its descendants will be styled again after it */
+	if (tc->results[node->index] != NULL)
+		css_select_results_destroy(tc->results[node->index]);
+	tc->results[node->index] = results;
+
+	return CSS_OK;
+}